@@ -15,7 +15,7 @@
 #    along with this program; if not, write to the Free Software
 #    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 
-from rs274 import Translated, ArcsToSegmentsMixin, OpenGLTk
+from rs274 import Translated, ArcsToSegmentsMixin, OpenGLTk, previewcache
 from minigl import *
 import math
 import glnav
@@ -40,13 +40,17 @@ limiticon = array.array('B',
 
 class GLCanon(Translated, ArcsToSegmentsMixin):
     lineno = -1
+    # let gcode.parse store straight and arc moves in the segments lists
+    # itself instead of calling straight_feed, straight_traverse and
+    # arc_feed; subclasses which override those must set this to False
+    native_preview = True
     def __init__(self, colors, geometry, is_foam=0):
         # traverse list - [line number, [start position], [end position], [tlo x, tlo y, tlo z]]
-        self.traverse = []; self.traverse_append = self.traverse.append
+        self.traverse = gcode.segments(0); self.traverse_append = self.traverse.append
         # feed list - [line number, [start position], [end position], feedrate, [tlo x, tlo y, tlo z]]
-        self.feed = []; self.feed_append = self.feed.append
+        self.feed = gcode.segments(); self.feed_append = self.feed.append
         # arcfeed list - [line number, [start position], [end position], feedrate, [tlo x, tlo y, tlo z]]
-        self.arcfeed = []; self.arcfeed_append = self.arcfeed.append
+        self.arcfeed = gcode.segments(); self.arcfeed_append = self.arcfeed.append
         # dwell list - [line number, color, pos x, pos y, pos z, plane]
         self.dwells = []; self.dwells_append = self.dwells.append
         self.choice = None
@@ -151,6 +155,21 @@ class GLCanon(Translated, ArcsToSegmentsMixin):
     def draw_dwells(self, dwells, alpha, for_selection, j0=0):
         return linuxcnc.draw_dwells(self.geometry, dwells, alpha, for_selection, self.is_lathe())
 
+    # attributes gcode.parse fills in, saved in the preview cache
+    cached_attributes = ('traverse', 'feed', 'arcfeed', 'dwells',
+        'dwell_time', 'foam_z', 'foam_w')
+
+    def cache_entry(self):
+        return dict((a, getattr(self, a)) for a in self.cached_attributes)
+
+    def restore_cache_entry(self, entry):
+        for a in self.cached_attributes:
+            setattr(self, a, entry[a])
+        self.traverse_append = self.traverse.append
+        self.feed_append = self.feed.append
+        self.arcfeed_append = self.arcfeed.append
+        self.dwells_append = self.dwells.append
+
     def calc_extents(self):
         self.min_extents, self.max_extents, self.min_extents_notool, self.max_extents_notool = gcode.calc_extents(self.arcfeed, self.feed, self.traverse)
         if self.is_foam:
@@ -381,6 +400,8 @@ class GlCanonDraw:
         self.select_buffer_size = 100
         self.cached_tool = -1
         self.initialised = 0
+        # processes used to preview long programs, 0 for one per processor
+        self.preview_jobs = 0
 
     def realize(self):
         self.hershey = hershey.Hershey()
@@ -1588,7 +1609,18 @@ class GlCanonDraw:
 
     def load_preview(self, f, canon, unitcode, initcode, interpname=""):
         self.set_canon(canon)
-        result, seq = gcode.parse(f, canon, unitcode, initcode, interpname)
+        key = previewcache.key(f, canon, unitcode, initcode, interpname)
+        entry = previewcache.load(key)
+        if entry is not None:
+            canon.restore_cache_entry(entry)
+            result, seq = entry['result'], entry['seq']
+        else:
+            from rs274 import parallel
+            result, seq = parallel.parse(f, canon, unitcode, initcode,
+                                    interpname, self.preview_jobs)
+            entry = canon.cache_entry()
+            entry.update(result=result, seq=seq)
+            previewcache.save(key, entry)
 
         if result <= gcode.MIN_ERROR:
             self.canon.progress.nextphase(1)
@@ -0,0 +1,266 @@
+#    This is a component of AXIS, a front-end for emc
+#
+#    This program is free software; you can redistribute it and/or modify
+#    it under the terms of the GNU General Public License as published by
+#    the Free Software Foundation; either version 2 of the License, or
+#    (at your option) any later version.
+#
+#    This program is distributed in the hope that it will be useful,
+#    but WITHOUT ANY WARRANTY; without even the implied warranty of
+#    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+#    GNU General Public License for more details.
+#
+#    You should have received a copy of the GNU General Public License
+#    along with this program; if not, write to the Free Software
+#    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+# Preview of long programs on several processors.
+#
+# The program is cut into sections at lines after which the interpreter
+# no longer depends on where the machine was: top level G0 moves that give
+# every axis an absolute position.  Each section is interpreted by its own
+# process.  Section k runs the lines before the first cut, jumps to the
+# last tool change before its own cut, and keeps the moves from its cut
+# up to the next one.
+#
+# At each cut gcode.parse records a fingerprint of the interpreter state.
+# A section is only used when its fingerprint at its cut is the one the
+# section before it ended with.  Otherwise, or if any section fails, the
+# whole program is interpreted again by gcode.parse in this process, so
+# the result is always the same as a sequential parse.
+#
+# Processes are used rather than threads because the interpreter and the
+# canon callbacks of gcode keep their state in globals.
+
+import os, re, shutil, tempfile, time
+import multiprocessing
+import gcode
+from rs274.glcanon import GLCanon
+from rs274.interpret import StatMixin
+
+# programs shorter than this are not worth starting processes for
+MIN_LINES = 20000
+
+_comment = re.compile(r"\([^)]*\)|;.*")
+_word = re.compile(r"([a-z])([-+]?(?:\d+\.?\d*|\.\d+))")
+_oword = re.compile(r"^(?:n\d+)?o(?:\d+|<[^>]*>)(sub|endsub|if|endif|while|endwhile|do|repeat|endrepeat)?")
+_axes = "xyzabcuvw"
+
+def _words(line):
+    """Return the words of a line, or None if it is not only plain words"""
+    line = _comment.sub("", line.lower()).replace(" ", "").replace("\t", "")
+    line = line.strip()
+    words = _word.findall(line)
+    if _word.sub("", line): return None
+    return [(l, float(v)) for l, v in words]
+
+def _scan(lines, axis_mask):
+    """Return the lines that can start a section, and the lines that
+    select or change tools.  Both lists hold 1-based line numbers."""
+    cuts = []
+    tools = []
+    stack = []
+    required = set(a for i, a in enumerate(_axes) if axis_mask & (1<<i))
+    for i, line in enumerate(lines):
+        lineno = i + 1
+        text = _comment.sub("", line.lower()).replace(" ", "").strip()
+        m = _oword.match(text)
+        if m:
+            kind = m.group(1)
+            if kind in ("sub", "if", "do", "repeat"):
+                stack.append(kind)
+            elif kind == "while":
+                if stack and stack[-1] == "do": stack.pop()
+                else: stack.append(kind)
+            elif kind and kind.startswith("end") and stack:
+                stack.pop()
+            continue
+        if stack: continue
+        words = _words(line)
+        if words is None: continue
+        letters = set(l for l, v in words)
+        if "t" in letters or ("m", 6) in words:
+            tools.append(lineno)
+        if not required or not required.issubset(letters): continue
+        if not letters.issubset(set(_axes + "gnfs")): continue
+        g = [v for l, v in words if l == "g"]
+        if 0 not in g or not set(g).issubset((0, 90)): continue
+        cuts.append(lineno)
+    return cuts, tools
+
+def _plan(lines, axis_mask, jobs):
+    """Choose the cuts for jobs sections, and where each section starts"""
+    cuts, tools = _scan(lines, axis_mask)
+    chosen = []
+    for j in range(1, jobs):
+        target = len(lines) * j / jobs
+        best = min(cuts, key=lambda c: abs(c - target)) if cuts else None
+        if best is not None and best > 1 and best not in chosen:
+            chosen.append(best)
+    chosen.sort()
+    starts = []
+    for k, cut in enumerate(chosen):
+        prev = chosen[k-1] if k else 1
+        lead = [t for t in tools if prev <= t < cut]
+        starts.append(min(lead[-1:] + [cut]))
+    return chosen, starts
+
+def _usable(filename, canon, interpname, jobs):
+    if interpname or jobs < 2: return False
+    if not isinstance(canon, GLCanon) or not isinstance(canon, StatMixin):
+        return False
+    if not getattr(canon, "native_preview", False): return False
+    ininame = os.environ.get("INI_FILE_NAME")
+    if ininame:
+        # remapped codes and python subroutines keep state of their own
+        import linuxcnc
+        inifile = linuxcnc.ini(ininame)
+        if inifile.find("RS274NGC", "REMAP") or inifile.find("PYTHON", "TOPLEVEL"):
+            return False
+    return True
+
+class SectionCanon(GLCanon, StatMixin):
+    """The canon of one section, with the settings of the canon it is for"""
+    def __init__(self, canon, parameter_file):
+        GLCanon.__init__(self, canon.colors, canon.geometry, canon.is_foam)
+        StatMixin.__init__(self, canon.s, canon.random)
+        self.tools = list(canon.tools)
+        self.arcdivision = canon.arcdivision
+        self.parameter_file = parameter_file
+        self.entry = None
+
+    def change_tool(self, pocket):
+        GLCanon.change_tool(self, pocket)
+        StatMixin.change_tool(self, pocket)
+
+    def canon_state(self):
+        return self.foam_z, self.foam_w
+
+    def mark_state(self, state):
+        self.dwells = []; self.dwells_append = self.dwells.append
+        self.dwell_time = 0
+        self.entry = state, self.canon_state()
+
+# the work shared with the section processes, which inherit it by fork
+_job = None
+
+def _section(k):
+    job = _job
+    cuts, starts = job['cuts'], job['starts']
+    skip, mark, stop = None, 0, 0
+    if k:
+        mark = cuts[k-1]
+        if starts[k-1] > cuts[0]:
+            skip = cuts[0], starts[k-1]
+    if k < len(cuts): stop = cuts[k]
+
+    parent = job['canon']
+    parameter_file = getattr(parent, "parameter_file", "")
+    tmp = None
+    if parameter_file and os.path.exists(parameter_file):
+        # Interp.init writes the parameter file back
+        fd, tmp = tempfile.mkstemp(prefix="preview", suffix=".var")
+        os.close(fd)
+        shutil.copy(parameter_file, tmp)
+        parameter_file = tmp
+    canon = SectionCanon(parent, parameter_file)
+    try:
+        try:
+            result, seq = gcode.parse(job['filename'], canon, job['unitcode'],
+                    job['initcode'], "", skip, mark, stop)
+            state = gcode.state()
+        except BaseException:
+            return None
+    finally:
+        if tmp: os.unlink(tmp)
+    entry = canon.cache_entry()
+    entry.update(result=result, seq=seq, entry=canon.entry,
+        exit=(state, canon.canon_state()), lo=canon.lo,
+        first_move=canon.first_move, tools=canon.tools,
+        stopped=result in (gcode.INTERP_OK, gcode.INTERP_EXECUTE_FINISH))
+    return entry
+
+def _run(job, jobs, canon):
+    global _job
+    _job = job
+    pool = multiprocessing.Pool(jobs)
+    try:
+        pending = [pool.apply_async(_section, (k,))
+                    for k in range(len(job['cuts']) + 1)]
+        pool.close()
+        update = getattr(getattr(canon, "progress", None), "update", None)
+        while not all(r.ready() for r in pending):
+            canon.check_abort()
+            if update:
+                update(sum(n for r, n in zip(pending, job['sizes'])
+                            if r.ready()))
+            time.sleep(.05)
+        return [r.get() for r in pending]
+    finally:
+        _job = None
+        pool.terminate()
+        pool.join()
+
+def _stitch(canon, cuts, sections):
+    """Put the sections together in canon; return their result, or None if
+    they do not add up to the program"""
+    used = [sections[0]]
+    for cut, prev, section in zip(cuts, sections, sections[1:]):
+        if prev is None: return None
+        if not prev['stopped']: break
+        (state, resumable), canon_state = prev['exit']
+        if section is None or not resumable or section['entry'] is None:
+            return None
+        if section['entry'] != ((state, resumable), canon_state): return None
+        used.append(section)
+    if used[-1] is None: return None
+
+    prev = None
+    for cut, section in zip([None] + cuts, used):
+        # the move on the cut line starts where the last section ended
+        if (prev and len(section['traverse'])
+                and section['traverse'][0][0] == cut):
+            canon.traverse.extend(section['traverse'], prev['lo'])
+        else:
+            canon.traverse.extend(section['traverse'])
+        canon.feed.extend(section['feed'])
+        canon.arcfeed.extend(section['arcfeed'])
+        canon.dwells.extend(section['dwells'])
+        canon.dwell_time += section['dwell_time']
+        prev = section
+    for a in ('foam_z', 'foam_w', 'lo', 'first_move', 'tools'):
+        setattr(canon, a, prev[a])
+    return prev['result'], prev['seq']
+
+def parse(filename, canon, unitcode, initcode, interpname="", jobs=0):
+    """Like gcode.parse, but interpret long programs on up to jobs
+    processors (0 means one per processor)"""
+    if jobs <= 0:
+        try:
+            jobs = multiprocessing.cpu_count()
+        except NotImplementedError:
+            jobs = 1
+    if not _usable(filename, canon, interpname, jobs):
+        return gcode.parse(filename, canon, unitcode, initcode, interpname)
+
+    f = open(filename, "rb")
+    try:
+        lines = f.readlines()
+    finally:
+        f.close()
+    if len(lines) < MIN_LINES or any("axis,notify" in l.lower() for l in lines):
+        return gcode.parse(filename, canon, unitcode, initcode, interpname)
+    cuts, starts = _plan(lines, canon.get_axis_mask(), jobs)
+    if not cuts:
+        return gcode.parse(filename, canon, unitcode, initcode, interpname)
+
+    bounds = [1] + cuts + [len(lines) + 1]
+    sizes = [b - a for a, b in zip(bounds, bounds[1:])]
+    job = dict(filename=filename, canon=canon, unitcode=unitcode,
+        initcode=initcode, cuts=cuts, starts=starts, sizes=sizes)
+    sections = _run(job, min(jobs, len(cuts) + 1), canon)
+    result = _stitch(canon, cuts, sections)
+    if result is not None: return result
+    return gcode.parse(filename, canon, unitcode, initcode, interpname)
+
+# vim:ts=8:sts=4:sw=4:et:
@@ -0,0 +1,174 @@
+#    This is a component of AXIS, a front-end for emc
+#
+#    This program is free software; you can redistribute it and/or modify
+#    it under the terms of the GNU General Public License as published by
+#    the Free Software Foundation; either version 2 of the License, or
+#    (at your option) any later version.
+#
+#    This program is distributed in the hope that it will be useful,
+#    but WITHOUT ANY WARRANTY; without even the implied warranty of
+#    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+#    GNU General Public License for more details.
+#
+#    You should have received a copy of the GNU General Public License
+#    along with this program; if not, write to the Free Software
+#    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+# On-disk cache of preview results, so that reopening a program whose
+# inputs did not change does not run the interpreter again.
+#
+# An entry is keyed on a hash of everything the preview depends on: the
+# program text, the .ngc files the interpreter could call as subroutines,
+# the ini file, the parameter file, the unit and startup codes, and the
+# tool table and other status the canon reports to the interpreter.
+# Subroutine files are hashed by name, size and modification time.
+
+import os, errno, hashlib, tempfile
+import cPickle as pickle
+import gcode
+
+FORMAT = 1
+MAX_ENTRIES = 16
+
+def cache_dir():
+    base = os.environ.get("XDG_CACHE_HOME") or os.path.expanduser("~/.cache")
+    return os.path.join(base, "linuxcnc", "preview")
+
+def _hash_file(h, filename):
+    h.update(filename + "\0")
+    try:
+        f = open(filename, "rb")
+    except IOError:
+        h.update("\1")
+        return
+    try:
+        while 1:
+            block = f.read(1 << 20)
+            if not block: break
+            h.update(block)
+    finally:
+        f.close()
+    h.update("\0")
+
+def _hash_dir(h, dirname, suffixes):
+    h.update(dirname + "\0")
+    try:
+        names = sorted(os.listdir(dirname))
+    except OSError:
+        return
+    for n in names:
+        if not n.endswith(suffixes): continue
+        try:
+            st = os.stat(os.path.join(dirname, n))
+        except OSError:
+            continue
+        h.update("%s\0%d\0%r\0" % (n, st.st_size, st.st_mtime))
+
+def _ini_dirs(inifile, inidir):
+    """Directories the interpreter searches for called files.  Relative
+    paths are relative to the directory of the ini file, which is where
+    linuxcnc runs the interpreter from."""
+    if inifile is None: return []
+    dirs = []
+    prefix = inifile.find("DISPLAY", "PROGRAM_PREFIX")
+    if prefix: dirs.append(prefix)
+    for section, name in (("RS274NGC", "SUBROUTINE_PATH"),
+            ("PYTHON", "PATH_APPEND"), ("PYTHON", "PATH_PREPEND")):
+        path = inifile.find(section, name)
+        if path: dirs.extend(path.split(":"))
+    return [os.path.join(inidir, os.path.expanduser(d)) for d in dirs]
+
+def key(filename, canon, unitcode, initcode, interpname=""):
+    """Return the cache key for previewing filename with canon"""
+    import linuxcnc
+    h = hashlib.sha1()
+    h.update("%d\0%s\0%s\0%s\0" % (FORMAT, unitcode, initcode, interpname))
+    _hash_file(h, filename)
+    st = os.stat(gcode.__file__)
+    h.update("%d\0%r\0" % (st.st_size, st.st_mtime))
+
+    ininame = os.environ.get("INI_FILE_NAME")
+    inifile = None
+    if ininame:
+        _hash_file(h, ininame)
+        inifile = linuxcnc.ini(ininame)
+    inidir = os.path.dirname(os.path.abspath(ininame)) if ininame else ""
+    for d in [os.path.dirname(filename)] + _ini_dirs(inifile, inidir):
+        _hash_dir(h, d, (".ngc", ".py"))
+
+    parameter_file = getattr(canon, "parameter_file", None)
+    if parameter_file: _hash_file(h, parameter_file)
+
+    h.update(repr(getattr(canon, "arcdivision", None)))
+    h.update(repr(getattr(canon, "tools", None)))
+    for m in ("get_axis_mask", "get_block_delete",
+            "get_external_length_units", "get_external_angular_units"):
+        if hasattr(canon, m):
+            h.update("%s\0%r\0" % (m, getattr(canon, m)()))
+    return h.hexdigest()
+
+def load(k):
+    """Return the entry saved under k, or None"""
+    try:
+        f = open(os.path.join(cache_dir(), k), "rb")
+    except IOError:
+        return None
+    try:
+        try:
+            entry = pickle.load(f)
+        except Exception:
+            return None
+    finally:
+        f.close()
+    if not isinstance(entry, dict) or entry.get("format") != FORMAT:
+        return None
+    try:
+        os.utime(f.name, None)      # keep recently used entries in _prune
+    except OSError:
+        pass
+    return entry
+
+def _prune(d):
+    entries = []
+    for n in os.listdir(d):
+        if n.startswith(".tmp"): continue
+        p = os.path.join(d, n)
+        try:
+            entries.append((os.stat(p).st_mtime, p))
+        except OSError:
+            pass
+    entries.sort()
+    for mtime, p in entries[:-MAX_ENTRIES]:
+        try:
+            os.unlink(p)
+        except OSError:
+            pass
+
+def save(k, entry):
+    """Save entry under k; failures only mean the next load is slow"""
+    d = cache_dir()
+    try:
+        os.makedirs(d)
+    except OSError, e:
+        if e.errno != errno.EEXIST: return
+    entry = dict(entry, format=FORMAT)
+    try:
+        fd, tmp = tempfile.mkstemp(dir=d, prefix=".tmp")
+    except OSError:
+        return
+    try:
+        f = os.fdopen(fd, "wb")
+        try:
+            pickle.dump(entry, f, pickle.HIGHEST_PROTOCOL)
+        finally:
+            f.close()
+        os.rename(tmp, os.path.join(d, k))
+    except (IOError, OSError, pickle.PicklingError):
+        try:
+            os.unlink(tmp)
+        except OSError:
+            pass
+        return
+    _prune(d)
+
+# vim:ts=8:sts=4:sw=4:et:
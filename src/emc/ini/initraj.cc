@@ -225,6 +225,24 @@ static int loadTraj(EmcIniFile *trajInifile)
         old_inihal_data.traj_arc_blend_gap_cycles = arcBlendGapCycles;
         old_inihal_data.traj_arc_blend_ramp_freq = arcBlendRampFreq;
 
+        int plannerType = 0;
+        double maxJerk = 0.0;
+        trajInifile->Find(&plannerType, "PLANNER_TYPE", "TRAJ");
+        trajInifile->Find(&maxJerk, "MAX_LINEAR_JERK", "TRAJ");
+        if (plannerType != 1) {
+            maxJerk = 0.0;
+        } else if (maxJerk <= 0.0) {
+            rcs_print("PLANNER_TYPE = 1 needs a positive MAX_LINEAR_JERK, using trapezoidal profiles\n");
+            maxJerk = 0.0;
+        }
+
+        if (0 != emcSetMaxJerk(maxJerk)) {
+            if (emc_debug & EMC_DEBUG_CONFIG) {
+                rcs_print("bad return value from emcSetMaxJerk\n");
+            }
+            return -1;
+        }
+
         double maxFeedScale = 1.0;
         trajInifile->Find(&maxFeedScale, "MAX_FEED_OVERRIDE", "DISPLAY");
 
@@ -389,10 +389,10 @@ STATIC int is_feed_type(int motion_type)
 }
 
 /*
-  emcmotCommandHandler() is called each main cycle to read the
-  shared memory buffer
+  emcmotCommandExecute() carries out the command emcmotCommand points
+  at, leaving the result in emcmotStatus->commandStatus
   */
-void emcmotCommandHandler(void *arg, long period)
+static void emcmotCommandExecute(void)
 {
     int joint_num, axis_num;
     int n;
@@ -401,27 +401,6 @@ void emcmotCommandHandler(void *arg, long period)
     double tmp1;
     emcmot_comp_entry_t *comp_entry;
     char issue_atspeed = 0;
-    
-check_stuff ( "before command_handler()" );
-
-    /* check for split read */
-    if (emcmotCommand->head != emcmotCommand->tail) {
-	emcmotDebug->split++;
-	return;			/* not really an error */
-    }
-    if (emcmotCommand->commandNum != emcmotStatus->commandNumEcho) {
-	/* increment head count-- we'll be modifying emcmotStatus */
-	emcmotStatus->head++;
-	emcmotDebug->head++;
-
-	/* got a new command-- echo command and number... */
-	emcmotStatus->commandEcho = emcmotCommand->command;
-	emcmotStatus->commandNumEcho = emcmotCommand->commandNum;
-
-	/* clear status value by default */
-	emcmotStatus->commandStatus = EMCMOT_COMMAND_OK;
-	
-	/* ...and process command */
 
 	/* Many commands uses "command->joint" to indicate which joint they
 	   wish to operate on.  This code eliminates the need to copy
@@ -1083,6 +1062,59 @@ check_stuff ( "before command_handler()" );
 	    }
 	    break;
 
+	case EMCMOT_SET_SPLINE:
+	    /* emcmotDebug->coord_tp up a spline move */
+	    /* requires coordinated mode, enable on, not on limits */
+	    rtapi_print_msg(RTAPI_MSG_DBG, "SET_SPLINE");
+	    if (!GET_MOTION_COORD_FLAG() || !GET_MOTION_ENABLE_FLAG()) {
+		reportError(_("need to be enabled, in coord mode for spline move"));
+		emcmotStatus->commandStatus = EMCMOT_COMMAND_INVALID_COMMAND;
+		SET_MOTION_ERROR_FLAG(1);
+		break;
+	    } else if (!inRange(emcmotCommand->pos, emcmotCommand->id, "Spline")) {
+		emcmotStatus->commandStatus = EMCMOT_COMMAND_INVALID_PARAMS;
+		tpAbort(&emcmotDebug->coord_tp);
+		SET_MOTION_ERROR_FLAG(1);
+		break;
+	    } else if (!limits_ok()) {
+		reportError(_("can't do spline move with limits exceeded"));
+		emcmotStatus->commandStatus = EMCMOT_COMMAND_INVALID_PARAMS;
+		tpAbort(&emcmotDebug->coord_tp);
+		SET_MOTION_ERROR_FLAG(1);
+		break;
+	    }
+            if(emcmotStatus->atspeed_next_feed) {
+                issue_atspeed = 1;
+                emcmotStatus->atspeed_next_feed = 0;
+            }
+
+	    /* append it to the emcmotDebug->tp */
+		tpSetId(&emcmotDebug->coord_tp, emcmotCommand->id);
+		int res_addspline = tpAddSpline(&emcmotDebug->coord_tp, emcmotCommand->pos,
+							emcmotCommand->ctrl, emcmotCommand->weight,
+                            emcmotCommand->order, emcmotCommand->motion_type,
+                            emcmotCommand->vel, emcmotCommand->ini_maxvel,
+                            emcmotCommand->acc, emcmotStatus->enables_new, issue_atspeed);
+        if (res_addspline < 0) {
+            reportError(_("can't add spline move at line %d, error code %d"),
+                    emcmotCommand->id, res_addspline);
+		emcmotStatus->commandStatus = EMCMOT_COMMAND_BAD_EXEC;
+		tpAbort(&emcmotDebug->coord_tp);
+		SET_MOTION_ERROR_FLAG(1);
+		break;
+        } else if (res_addspline != 0) {
+            if (issue_atspeed) {
+                emcmotStatus->atspeed_next_feed = 1;
+            }
+        } else {
+		SET_MOTION_ERROR_FLAG(0);
+		/* set flag that indicates all joints need rehoming, if any
+		   joint is moved in joint mode, for machines with no forward
+		   kins */
+		rehomeAll = 1;
+	    }
+	    break;
+
 	case EMCMOT_SET_VEL:
 	    /* set the velocity for subsequent moves */
 	    /* can do it at any time */
@@ -1751,6 +1783,12 @@ check_stuff ( "before command_handler()" );
             emcmotConfig->arcBlendGapCycles = emcmotCommand->arcBlendGapCycles;
             emcmotConfig->arcBlendRampFreq = emcmotCommand->arcBlendRampFreq;
             break;
+        case EMCMOT_SET_MAX_JERK:
+            /* applies to moves queued from now on */
+            rtapi_print_msg(RTAPI_MSG_DBG, "SET_MAX_JERK");
+            emcmotConfig->maxJerk = emcmotCommand->maxJerk;
+            tpSetJmax(&emcmotDebug->coord_tp, emcmotConfig->maxJerk);
+            break;
 
 	}			/* end of: command switch */
 	if (emcmotStatus->commandStatus != EMCMOT_COMMAND_OK) {
@@ -1758,12 +1796,103 @@ check_stuff ( "before command_handler()" );
 		emcmotStatus->commandStatus);
 	}
 	rtapi_print_msg(RTAPI_MSG_DBG, "\n");
-	/* synch tail count */
-	emcmotStatus->tail = emcmotStatus->head;
-	emcmotConfig->tail = emcmotConfig->head;
-	emcmotDebug->tail = emcmotDebug->head;
+}
 
+/*
+  emcmotCommandRingDrain() runs up to EMCMOT_COMMAND_RING_BATCH of the
+  moves queued in emcmotStruct->ring.  The first failure is latched in
+  the ring, not in commandEcho/commandNumEcho/commandStatus, which stay
+  with the direct command.  Returns the number of commands still queued.
+  */
+static unsigned int emcmotCommandRingDrain(void)
+{
+    emcmot_command_ring_t *ring = &emcmotStruct->ring;
+    emcmot_command_t *direct = emcmotCommand;
+    cmd_status_t directStatus = emcmotStatus->commandStatus;
+    unsigned int get = ring->get;
+    unsigned int put;
+    int n;
+
+    /* pairs with the release store in usrmotWriteEmcmotCommand(), so
+       the slot contents are visible before the count that covers them */
+    put = __atomic_load_n(&ring->put, __ATOMIC_ACQUIRE);
+    if (put == get) {
+	return 0;
     }
-    /* end of: if-new-command */
+    if (ring->failNum != 0) {
+	/* a queued command already failed, the rest wait for an abort */
+	__atomic_store_n(&ring->get, put, __ATOMIC_RELEASE);
+	return 0;
+    }
+
+    for (n = 0; n < EMCMOT_COMMAND_RING_BATCH && get != put; n++) {
+	emcmotCommand = &ring->slot[get % EMCMOT_COMMAND_RING_SIZE];
+	emcmotStatus->commandStatus = EMCMOT_COMMAND_OK;
+	emcmotCommandExecute();
+	get++;
+	if (emcmotStatus->commandStatus != EMCMOT_COMMAND_OK) {
+	    ring->failStatus = emcmotStatus->commandStatus;
+	    ring->failNum = emcmotCommand->commandNum;
+	    get = put;
+	}
+    }
+    emcmotCommand = direct;
+    emcmotStatus->commandStatus = directStatus;
+    __atomic_store_n(&ring->get, get, __ATOMIC_RELEASE);
+    return put - get;
+}
+
+/*
+  emcmotCommandHandler() is called each main cycle to read the
+  shared memory buffer
+  */
+void emcmotCommandHandler(void *arg, long period)
+{
+    emcmot_command_ring_t *ring = &emcmotStruct->ring;
+    unsigned int queued;
+
+check_stuff ( "before command_handler()" );
+
+    /* increment head count-- we'll be modifying emcmotStatus */
+    emcmotStatus->head++;
+    emcmotDebug->head++;
+
+    /* moves queued ahead of the direct command go first */
+    queued = emcmotCommandRingDrain();
+
+    /* check for split read */
+    if (emcmotCommand->head != emcmotCommand->tail) {
+	emcmotDebug->split++;
+    } else if (emcmotCommand->commandNum != emcmotStatus->commandNumEcho) {
+	if (emcmotCommand->command == EMCMOT_ABORT) {
+	    /* abort throws away whatever is still queued */
+	    __atomic_store_n(&ring->get,
+		__atomic_load_n(&ring->put, __ATOMIC_ACQUIRE), __ATOMIC_RELEASE);
+	    ring->failNum = 0;
+	    ring->failStatus = EMCMOT_COMMAND_OK;
+	} else if (queued != 0 ||
+	    __atomic_load_n(&ring->put, __ATOMIC_ACQUIRE) != ring->get) {
+	    /* moves queued before this command are still waiting, keep
+	       it for a later cycle so it takes effect after them */
+	    queued = 1;
+	}
+	if (emcmotCommand->command == EMCMOT_ABORT || queued == 0) {
+	    /* got a new command-- echo command and number... */
+	    emcmotStatus->commandEcho = emcmotCommand->command;
+	    emcmotStatus->commandNumEcho = emcmotCommand->commandNum;
+
+	    /* clear status value by default */
+	    emcmotStatus->commandStatus = EMCMOT_COMMAND_OK;
+
+	    /* ...and process command */
+	    emcmotCommandExecute();
+	}
+    }
+
+    /* synch tail count */
+    emcmotStatus->tail = emcmotStatus->head;
+    emcmotConfig->tail = emcmotConfig->head;
+    emcmotDebug->tail = emcmotDebug->head;
+
 check_stuff ( "after command_handler()" );
 }
@@ -24,6 +24,7 @@
 #include "tc.h"
 #include "simple_tp.h"
 #include "motion_debug.h"
+#include "motion_struct.h"
 #include "config.h"
 #include "motion_types.h"
 
@@ -200,10 +201,15 @@ static void output_to_hal(void);
 
 /* 'update_status()' copies assorted status information to shared
    memory (the emcmotStatus structure) so that it is available to
-   higher level code.
+   higher level code, then publishes a snapshot of it.
 */
 static void update_status(void);
 
+/* 'publish_status()' copies emcmotStatus into the free half of the
+   double-buffered status snapshot that user space reads.
+*/
+static void publish_status(void);
+
 /***********************************************************************
 *                        PUBLIC FUNCTION CODE                          *
 ************************************************************************/
@@ -331,10 +337,10 @@ check_stuff ( "after get_pos_cmds()" );
 check_stuff ( "after compute_screw_comp()" );
     output_to_hal();
 check_stuff ( "after output_to_hal()" );
+    emcmotStatus->heartbeat++;
     update_status();
 check_stuff ( "after update_status()" );
     /* here ends the core of the controller */
-    emcmotStatus->heartbeat++;
     /* set tail to head, to indicate work complete */
     emcmotStatus->tail = emcmotStatus->head;
 /* end of controller function */
@@ -1902,6 +1908,7 @@ static void update_status(void)
 
     /* motion emcmotDebug->coord_tp status */
     emcmotStatus->depth = tpQueueDepth(&emcmotDebug->coord_tp);
+    emcmotStatus->commandRingGet = emcmotStruct->ring.get;
     emcmotStatus->activeDepth = tpActiveDepth(&emcmotDebug->coord_tp);
     emcmotStatus->id = tpGetExecId(&emcmotDebug->coord_tp);
     emcmotStatus->motionType = tpGetMotionType(&emcmotDebug->coord_tp);
@@ -1922,5 +1929,19 @@ static void update_status(void)
 	old_motion_flag = emcmotStatus->motionFlag;
     }
 #endif
+    publish_status();
+}
+
+static void publish_status(void)
+{
+    emcmot_status_snapshot_t *snap = &emcmotStruct->status_snapshot;
+    unsigned int seq = snap->seq;
+
+    /* seq goes odd before the copy and even after it; readers check it
+       around their own copy (see usrmotintf.cc) */
+    __atomic_store_n(&snap->seq, seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    snap->buf[(seq / 2 + 1) & 1] = *emcmotStatus;
+    __atomic_store_n(&snap->seq, seq + 2, __ATOMIC_RELEASE);
 }
 
@@ -45,6 +45,15 @@
 /* seconds to delay between comm retries */
 #define DEFAULT_EMCMOT_COMM_WAIT 0.010
 
+/* slots in the queued motion command ring, and how many of them the
+   command handler takes per cycle.  Task lets at most
+   EMCMOT_COMMAND_RING_BATCH moves wait in the ring, so one cycle drains
+   it and the planner queue grows by no more than that many moves (and
+   their blend arcs) between two status updates, well inside
+   TC_QUEUE_MARGIN */
+#define EMCMOT_COMMAND_RING_SIZE 16
+#define EMCMOT_COMMAND_RING_BATCH 8
+
 /* initial velocity, accel used for coordinated moves */
 #define DEFAULT_VELOCITY 1.0
 #define DEFAULT_ACCELERATION 10.0
@@ -62,6 +71,9 @@
  * about a megabyte.  */
 #define DEFAULT_TC_QUEUE_SIZE 2000
 
+/* most control points of a spline move, so cubic spans at most */
+#define EMCMOT_MAX_SPLINE_ORDER 4
+
 /* max following error */
 #define DEFAULT_MAX_FERROR 100
 
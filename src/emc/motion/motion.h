@@ -124,6 +124,7 @@ extern "C" {
 
 	EMCMOT_SET_LINE,	/* queue up a linear move */
 	EMCMOT_SET_CIRCLE,	/* queue up a circular move */
+	EMCMOT_SET_SPLINE,	/* queue up a spline move */
 	EMCMOT_CLEAR_PROBE_FLAGS,	/* clears probeTripped flag */
 	EMCMOT_PROBE,		/* go to pos, stop if probe trips, record
 				   trip pos */
@@ -151,6 +152,7 @@ extern "C" {
         EMCMOT_SET_OFFSET, /* set tool offsets */
         EMCMOT_SET_MAX_FEED_OVERRIDE,
         EMCMOT_SETUP_ARC_BLENDS,
+        EMCMOT_SET_MAX_JERK,    /* jerk limit for trajectory planning */
 
 	EMCMOT_JOG_CONT,	/* continuous jog */
 	EMCMOT_JOG_INCR,	/* incremental jog */
@@ -210,6 +212,9 @@ extern "C" {
 	EmcPose pos;		/* line/circle endpt, or teleop vector */
 	PmCartesian center;	/* center for circle */
 	PmCartesian normal;	/* normal vec for circle */
+	PmCartesian ctrl[EMCMOT_MAX_SPLINE_ORDER];	/* control points for spline */
+	double weight[EMCMOT_MAX_SPLINE_ORDER];	/* weights of spline control points */
+	int order;		/* number of spline control points */
 	int turn;		/* turns for circle or which rotary to unlock for a line */
 	double vel;		/* max velocity */
         double ini_maxvel;      /* max velocity allowed by machine
@@ -255,8 +260,28 @@ extern "C" {
         int arcBlendGapCycles;
         double arcBlendRampFreq;
         double maxFeedScale;
+        double maxJerk;
     } emcmot_command_t;
 
+/* Queued motion commands.  Moves (SET_LINE, SET_CIRCLE, SET_SPLINE and
+   RIGID_TAP) need no answer before the next command goes out, so user
+   space appends them here rather than handing them over one at a time
+   through the command structure.  There is one producer (task) and one
+   consumer (the command handler): only user space writes 'put', only
+   the handler writes 'get' and the result fields.  The first queued
+   command that fails latches its number and status; the handler then
+   drops queued commands until an EMCMOT_ABORT clears the latch.  The
+   latch is the only result: queued commands that succeed report
+   nothing.
+*/
+    typedef struct emcmot_command_ring_t {
+	unsigned int put;	/* count of commands appended */
+	unsigned int get;	/* count of commands taken by the handler */
+	int failNum;		/* commandNum of the one that failed, or 0 */
+	cmd_status_t failStatus;	/* status of the failed command */
+	emcmot_command_t slot[EMCMOT_COMMAND_RING_SIZE];
+    } emcmot_command_ring_t;
+
 /*! \todo FIXME - these packed bits might be replaced with chars
    memory is cheap, and being able to access them without those
    damn macros would be nice
@@ -674,6 +699,7 @@ Suggestion: Split this in to an Error and a Status flag register..
 				   changed. */
 	int id;			/* id for executing motion */
 	int depth;		/* motion queue depth */
+	unsigned int commandRingGet;	/* ring 'get' when depth was taken */
 	int activeDepth;	/* depth of active blend elements */
 	int queueFull;		/* Flag to indicate the tc queue is full */
 	int paused;		/* Flag to signal motion paused */
@@ -700,6 +726,18 @@ Suggestion: Split this in to an Error and a Status flag register..
         
     } emcmot_status_t;
 
+/* Status as user space reads it.  Once per cycle the controller copies
+   emcmotStatus into buf[], and readers copy back out of buf[] without
+   holding the controller up.  seq is odd while a copy is being made;
+   snapshot n = seq / 2 is complete and sits in buf[n & 1], so it stays
+   untouched while snapshot n + 1 goes into the other buffer, and a
+   reader only has to retry if its copy outlasts a whole cycle.
+*/
+    typedef struct emcmot_status_snapshot_t {
+	unsigned int seq;	/* twice the snapshot count, +1 while writing */
+	emcmot_status_t buf[2];
+    } emcmot_status_snapshot_t;
+
 /*********************************
         CONFIG STRUCTURE
 *********************************/
@@ -758,6 +796,7 @@ Suggestion: Split this in to an Error and a Status flag register..
         int arcBlendGapCycles;
         double arcBlendRampFreq;
         double maxFeedScale;
+        double maxJerk;         /* 0 for trapezoidal velocity profiles */
     } emcmot_config_t;
 
 /* error structure - A ring buffer used to pass formatted printf stings to usr space */
@@ -40,7 +40,9 @@
 static int inited = 0;		/* flag if inited */
 
 static emcmot_command_t *emcmotCommand = 0;
+static emcmot_command_ring_t *emcmotCommandRing = 0;
 static emcmot_status_t *emcmotStatus = 0;
+static emcmot_status_snapshot_t *emcmotStatusSnapshot = 0;
 static emcmot_config_t *emcmotConfig = 0;
 static emcmot_debug_t *emcmotDebug = 0;
 static emcmot_error_t *emcmotError = 0;
@@ -72,6 +74,64 @@ int usrmotIniLoad(const char *filename)
     return 0;
 }
 
+/* true for the moves that go through the command ring */
+static int usrmotCommandIsQueued(cmd_code_t command)
+{
+    switch (command) {
+    case EMCMOT_SET_LINE:
+    case EMCMOT_SET_CIRCLE:
+    case EMCMOT_SET_SPLINE:
+    case EMCMOT_RIGID_TAP:
+	return 1;
+    default:
+	return 0;
+    }
+}
+
+/* appends c to the command ring; only waits if the ring is full */
+static int usrmotQueueEmcmotCommand(emcmot_command_t * c)
+{
+    emcmot_command_ring_t *ring = emcmotCommandRing;
+    static int reportedFailNum = 0;
+    unsigned int put = ring->put;
+    double end;
+
+    /* a queued move failed: report it once, then refuse further moves
+       until an abort clears it */
+    if (ring->failNum != 0) {
+	if (ring->failNum != reportedFailNum) {
+	    reportedFailNum = ring->failNum;
+	    rcs_print("USRMOT: ERROR: queued command %d failed, status %d\n",
+		ring->failNum, ring->failStatus);
+	}
+	return EMCMOT_COMM_ERROR_COMMAND;
+    }
+
+    end = etime() + EMCMOT_COMM_TIMEOUT;
+    while (put - __atomic_load_n(&ring->get, __ATOMIC_ACQUIRE) >=
+	EMCMOT_COMMAND_RING_SIZE) {
+	if (etime() >= end) {
+	    rcs_print("USRMOT: ERROR: command ring timeout\n");
+	    return EMCMOT_COMM_ERROR_TIMEOUT;
+	}
+	esleep(25e-6);
+    }
+    ring->slot[put % EMCMOT_COMMAND_RING_SIZE] = *c;
+    /* publish the slot; pairs with the acquire in emcmotCommandHandler() */
+    __atomic_store_n(&ring->put, put + 1, __ATOMIC_RELEASE);
+    return EMCMOT_COMM_OK;
+}
+
+/* number of queued moves the motion controller had not yet taken when
+   it wrote status s, so s->depth + this covers every move sent */
+unsigned int usrmotCommandRingPending(emcmot_status_t const * s)
+{
+    if (0 == emcmotCommandRing) {
+	return 0;
+    }
+    return emcmotCommandRing->put - s->commandRingGet;
+}
+
 /* writes command from c */
 int usrmotWriteEmcmotCommand(emcmot_command_t * c)
 {
@@ -93,6 +153,10 @@ int usrmotWriteEmcmotCommand(emcmot_command_t * c)
         rcs_print("USRMOT: ERROR: can't connect to shared memory\n");
 	return EMCMOT_COMM_ERROR_CONNECT;
     }
+    /* moves are queued without waiting for the handler to run them */
+    if (usrmotCommandIsQueued(c->command)) {
+	return usrmotQueueEmcmotCommand(c);
+    }
     /* copy entire command structure to shared memory */
     *emcmotCommand = *c;
     /* poll for receipt of command */
@@ -100,8 +164,9 @@ int usrmotWriteEmcmotCommand(emcmot_command_t * c)
     end = etime() + EMCMOT_COMM_TIMEOUT;
     /* now check to see if it got it */
     while (etime() < end) {
-	/* update status */
-	if (( usrmotReadEmcmotStatus(&s) == 0 ) && ( s.commandNumEcho == commandNum )) {
+	/* update the command echo and result */
+	if (( usrmotReadEmcmotStatusRange(&s, commandNumEcho, commandStatus) == 0 ) &&
+	    ( s.commandNumEcho == commandNum )) {
 	    /* now check emcmot status flag */
 	    if (s.commandStatus == EMCMOT_COMMAND_OK) {
 		return EMCMOT_COMM_OK;
@@ -116,29 +181,37 @@ int usrmotWriteEmcmotCommand(emcmot_command_t * c)
     return EMCMOT_COMM_ERROR_TIMEOUT;
 }
 
-/* copies status to s */
-int usrmotReadEmcmotStatus(emcmot_status_t * s)
+/* copies len bytes at offset in the latest complete status snapshot
+   to the same place in s */
+int usrmotReadEmcmotStatusPart(emcmot_status_t * s, size_t offset, size_t len)
 {
-    int split_read_count;
-    
+    emcmot_status_snapshot_t *snap = emcmotStatusSnapshot;
+    unsigned int seq, n;
+    int tries;
+
     /* check for shmem still around */
-    if (0 == emcmotStatus) {
+    if (0 == snap) {
 	return EMCMOT_COMM_ERROR_CONNECT;
     }
-    split_read_count = 0;
-    do {
-	/* copy status struct from shmem to local memory */
-	memcpy(s, emcmotStatus, sizeof(emcmot_status_t));
-	/* got it, now check head-tail matche */
-	if (s->head == s->tail) {
-	    /* head and tail match, done */
+    for (tries = 0; tries < 3; tries++) {
+	seq = __atomic_load_n(&snap->seq, __ATOMIC_ACQUIRE);
+	n = seq / 2;
+	memcpy((char *) s + offset, (char *) &snap->buf[n & 1] + offset, len);
+	__atomic_thread_fence(__ATOMIC_ACQUIRE);
+	/* buf[n & 1] is only rewritten once seq passes 2n + 2 */
+	if (__atomic_load_n(&snap->seq, __ATOMIC_RELAXED) - 2 * n <= 2) {
 	    return EMCMOT_COMM_OK;
 	}
-	/* inc counter and try again, max three times */
-    } while ( ++split_read_count < 3 );
+    }
     return EMCMOT_COMM_SPLIT_READ_TIMEOUT;
 }
 
+/* copies status to s */
+int usrmotReadEmcmotStatus(emcmot_status_t * s)
+{
+    return usrmotReadEmcmotStatusPart(s, 0, sizeof(emcmot_status_t));
+}
+
 /* copies config to s */
 int usrmotReadEmcmotConfig(emcmot_config_t * s)
 {
@@ -674,7 +747,9 @@ int usrmotInit(const char *modname)
     }
     /* got it */
     emcmotCommand = &(emcmotStruct->command);
+    emcmotCommandRing = &(emcmotStruct->ring);
     emcmotStatus = &(emcmotStruct->status);
+    emcmotStatusSnapshot = &(emcmotStruct->status_snapshot);
     emcmotDebug = &(emcmotStruct->debug);
     emcmotConfig = &(emcmotStruct->config);
     emcmotError = &(emcmotStruct->error);
@@ -693,7 +768,9 @@ int usrmotExit(void)
 
     emcmotStruct = 0;
     emcmotCommand = 0;
+    emcmotCommandRing = 0;
     emcmotStatus = 0;
+    emcmotStatusSnapshot = 0;
     emcmotError = 0;
 /*! \todo Another #if 0 */
 #if 0
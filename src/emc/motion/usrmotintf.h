@@ -15,6 +15,8 @@
 #ifndef USRMOTINTF_H
 #define USRMOTINTF_H
 
+#include <stddef.h>		/* size_t, offsetof() */
+
 struct emcmot_status_t;
 struct emcmot_command_t;
 struct emcmot_config_t;
@@ -33,6 +35,17 @@ extern "C" {
    the emcmot controller and puts it in arg */
     extern int usrmotReadEmcmotStatus(emcmot_status_t * s);
 
+/* usrmotReadEmcmotStatusPart() gets only the len bytes at offset of
+   the status info and puts them at the same place in arg.  The
+   usrmotReadEmcmotStatusRange() macro does it for the members first
+   through last, e.g. just carte_pos_cmd .. carte_pos_fb_ok */
+    extern int usrmotReadEmcmotStatusPart(emcmot_status_t * s,
+	size_t offset, size_t len);
+#define usrmotReadEmcmotStatusRange(s, first, last) \
+    usrmotReadEmcmotStatusPart((s), offsetof(emcmot_status_t, first), \
+	offsetof(emcmot_status_t, last) + sizeof((s)->last) - \
+	offsetof(emcmot_status_t, first))
+
 /* usrmotReadEmcmotConfig() gets the config info out of
    the emcmot controller and puts it in arg */
     extern int usrmotReadEmcmotConfig(emcmot_config_t * s);
@@ -67,9 +80,15 @@ extern "C" {
 #define EMCMOT_COMM_INVALID_MOTION_ID -5 /* do not queue a motion id MOTION_INVALID_ID */
 
 /* usrmotWriteEmcmotCommand() writes the command to the emcmot process.
-   Return values are as per the #defines above */
+   Moves are queued in the command ring and return once queued; a
+   queued move that fails is reported as EMCMOT_COMM_ERROR_COMMAND by
+   the next move written.  Return values are as per the #defines above */
     extern int usrmotWriteEmcmotCommand(emcmot_command_t * c);
 
+/* usrmotCommandRingPending() returns how many queued moves the emcmot
+   process had not taken yet when it wrote the status in s */
+    extern unsigned int usrmotCommandRingPending(emcmot_status_t const * s);
+
 /* usrmotInit() initializes communication with the emcmot process */
     extern int usrmotInit(const char *name);
 
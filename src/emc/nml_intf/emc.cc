@@ -258,6 +258,9 @@ int emcFormat(NMLTYPE type, void *buffer, CMS * cms)
     case EMC_STAT_TYPE:
 	((EMC_STAT *) buffer)->update(cms);
 	break;
+    case EMC_STAT_DELTA_TYPE:
+	((EMC_STAT_DELTA *) buffer)->update(cms);
+	break;
     case EMC_TASK_ABORT_TYPE:
 	((EMC_TASK_ABORT *) buffer)->update(cms);
 	break;
@@ -378,6 +381,9 @@ int emcFormat(NMLTYPE type, void *buffer, CMS * cms)
     case EMC_TRAJ_CIRCULAR_MOVE_TYPE:
 	((EMC_TRAJ_CIRCULAR_MOVE *) buffer)->update(cms);
 	break;
+    case EMC_TRAJ_SPLINE_MOVE_TYPE:
+	((EMC_TRAJ_SPLINE_MOVE *) buffer)->update(cms);
+	break;
     case EMC_TRAJ_RIGID_TAP_TYPE:
 	((EMC_TRAJ_RIGID_TAP *) buffer)->update(cms);
         break;
@@ -621,6 +627,8 @@ const char *emc_symbol_lookup(uint32_t type)
 	return "EMC_SPINDLE_STAT";
     case EMC_STAT_TYPE:
 	return "EMC_STAT";
+    case EMC_STAT_DELTA_TYPE:
+	return "EMC_STAT_DELTA";
     case EMC_TASK_ABORT_TYPE:
 	return "EMC_TASK_ABORT";
     case EMC_TASK_HALT_TYPE:
@@ -759,6 +767,8 @@ const char *emc_symbol_lookup(uint32_t type)
 	return "EMC_TRAJ_SET_VELOCITY";
     case EMC_TRAJ_STAT_TYPE:
 	return "EMC_TRAJ_STAT";
+    case EMC_TRAJ_SPLINE_MOVE_TYPE:
+	return "EMC_TRAJ_SPLINE_MOVE";
     case EMC_TRAJ_STEP_TYPE:
 	return "EMC_TRAJ_STEP";
     default:
@@ -1302,6 +1312,46 @@ void EMC_STAT::update(CMS * cms)
 
 }
 
+/*
+*	Section offsets for EMC_STAT_DELTA. Things that change every
+*	cycle while the machine moves are kept apart from the big, mostly
+*	static parts like the tool table and the interpreter settings.
+*/
+int EMC_STAT::sections(long *offset) const
+{
+    const char *base = (const char *) this;
+    int n = 0;
+
+    offset[n++] = 0;
+    offset[n++] = (const char *) &task - base;
+    offset[n++] = (const char *) task.file - base;
+    offset[n++] = (const char *) &task.g5x_offset - base;
+    offset[n++] = (const char *) &task.interpreter_errcode - base;
+    offset[n++] = (const char *) &motion - base;
+    offset[n++] = (const char *) &motion.traj - base;
+    for (int i = 0; i < EMCMOT_MAX_JOINTS; i++) {
+	offset[n++] = (const char *) &motion.joint[i] - base;
+    }
+    offset[n++] = (const char *) &motion.axis[0] - base;
+    offset[n++] = (const char *) &motion.spindle - base;
+    offset[n++] = (const char *) &motion.synch_di[0] - base;
+    offset[n++] = (const char *) &io - base;
+    offset[n++] = (const char *) &io.tool - base;
+    offset[n++] = (const char *) &io.coolant - base;
+    offset[n++] = (const char *) &debug - base;
+    return n;
+}
+
+/*
+*	NML/CMS Update function for EMC_STAT_DELTA
+*/
+void EMC_STAT_DELTA::update(CMS * cms)
+{
+
+    RCS_STAT_DELTA_MSG::update(cms, data, sizeof(data));
+
+}
+
 /*
 *	NML/CMS Update function for EMC_JOG_CONT
 */
@@ -1553,6 +1603,25 @@ void EMC_TRAJ_CIRCULAR_MOVE::update(CMS * cms)
 
 }
 
+/*
+*	NML/CMS Update function for EMC_TRAJ_SPLINE_MOVE
+*/
+void EMC_TRAJ_SPLINE_MOVE::update(CMS * cms)
+{
+
+    EMC_TRAJ_CMD_MSG::update(cms);
+    EmcPose_update(cms, &end);
+    cms->update(ctrl, EMCMOT_MAX_SPLINE_ORDER);
+    cms->update(weight, EMCMOT_MAX_SPLINE_ORDER);
+    cms->update(order);
+    cms->update(type);
+    cms->update(vel);
+    cms->update(ini_maxvel);
+    cms->update(acc);
+    cms->update(feed_mode);
+
+}
+
 /*
 *	NML/CMS Update function for EMC_TRAJ_SET_TERM_COND
 *	Automatically generated by NML CodeGen Java Applet.
@@ -146,6 +146,7 @@ struct PM_CARTESIAN;
 #define EMC_TRAJ_SET_SO_ENABLE_TYPE                  ((NMLTYPE) 235)
 #define EMC_TRAJ_SET_FH_ENABLE_TYPE                  ((NMLTYPE) 236)
 #define EMC_TRAJ_RIGID_TAP_TYPE                      ((NMLTYPE) 237)
+#define EMC_TRAJ_SPLINE_MOVE_TYPE                    ((NMLTYPE) 239)
 
 #define EMC_TRAJ_STAT_TYPE                           ((NMLTYPE) 299)
 
@@ -286,6 +287,7 @@ struct PM_CARTESIAN;
 #define EMC_HALT_TYPE                                ((NMLTYPE) 1902)
 #define EMC_ABORT_TYPE                               ((NMLTYPE) 1903)
 
+#define EMC_STAT_DELTA_TYPE                          ((NMLTYPE) 1998)
 #define EMC_STAT_TYPE                                ((NMLTYPE) 1999)
 
 // types for EMC_TASK mode
@@ -460,6 +462,9 @@ extern int emcTrajLinearMove(EmcPose end, int type, double vel,
                              double ini_maxvel, double acc, int indexrotary);
 extern int emcTrajCircularMove(EmcPose end, PM_CARTESIAN center, PM_CARTESIAN
         normal, int turn, int type, double vel, double ini_maxvel, double acc);
+extern int emcTrajSplineMove(EmcPose end, PM_CARTESIAN const *ctrl,
+        double const *weight, int order, int type, double vel,
+        double ini_maxvel, double acc);
 extern int emcTrajSetTermCond(int cond, double tolerance);
 extern int emcTrajSetSpindleSync(double feed_per_revolution, bool wait_for_index);
 extern int emcTrajSetOffset(EmcPose tool_offset);
@@ -565,6 +570,7 @@ extern int emcHalt();
 extern int emcAbort();
 
 int emcSetMaxFeedOverride(double maxFeedScale);
+int emcSetMaxJerk(double maxJerk);
 int emcSetupArcBlends(int arcBlendEnable,
         int arcBlendFallbackEnable,
         int arcBlendOptDepth,
@@ -18,6 +18,7 @@
 #include "rcs.hh"
 #include "cmd_msg.hh"
 #include "stat_msg.hh"
+#include "stat_delta.hh"
 #include "emcpos.h"
 #include "canon.hh"		// CANON_TOOL_TABLE, CANON_UNITS
 #include "rs274ngc.hh"		// ACTIVE_G_CODES, etc
@@ -864,6 +865,24 @@ class EMC_TRAJ_CIRCULAR_MOVE:public EMC_TRAJ_CMD_MSG {
     int feed_mode;
 };
 
+class EMC_TRAJ_SPLINE_MOVE:public EMC_TRAJ_CMD_MSG {
+  public:
+    EMC_TRAJ_SPLINE_MOVE():EMC_TRAJ_CMD_MSG(EMC_TRAJ_SPLINE_MOVE_TYPE,
+					    sizeof(EMC_TRAJ_SPLINE_MOVE)) {
+    };
+
+    // For internal NML/CMS use only.
+    void update(CMS * cms);
+
+    EmcPose end;
+    PM_CARTESIAN ctrl[EMCMOT_MAX_SPLINE_ORDER];	// rational Bezier control points
+    double weight[EMCMOT_MAX_SPLINE_ORDER];
+    int order;			// number of control points used
+    int type;
+    double vel, ini_maxvel, acc;
+    int feed_mode;
+};
+
 class EMC_TRAJ_SET_TERM_COND:public EMC_TRAJ_CMD_MSG {
   public:
     EMC_TRAJ_SET_TERM_COND():EMC_TRAJ_CMD_MSG(EMC_TRAJ_SET_TERM_COND_TYPE,
@@ -2151,6 +2170,25 @@ class EMC_STAT:public EMC_STAT_MSG {
     EMC_IO_STAT io;
 
     int debug;			// copy of EMC_DEBUG global
+
+    // offsets of the parts tracked separately by EMC_STAT_DELTA
+    int sections(long *offset) const;
+};
+
+// the parts of EMC_STAT that changed recently, see stat_delta.hh
+class EMC_STAT_DELTA:public RCS_STAT_DELTA_MSG {
+  public:
+    EMC_STAT_DELTA();
+
+    // For internal NML/CMS use only.
+    void update(CMS * cms);
+
+    // copy the changes into stat, which was read at write id *serial
+    int apply(EMC_STAT * stat, long *serial) const {
+	return RCS_STAT_DELTA_MSG::apply(data, stat, serial);
+    };
+
+    char data[sizeof(EMC_STAT)];
 };
 
 /*
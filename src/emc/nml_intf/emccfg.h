@@ -36,6 +36,9 @@ extern "C" {
 /* default interp len */
 #define DEFAULT_EMC_TASK_INTERP_MAX_LEN 1000
 
+/* most feed moves the naive cam detector joins into one */
+#define DEFAULT_EMC_NAIVECAM_WINDOW 100
+
 /* default name of EMC_TOOL tool table file */
 #define DEFAULT_TOOL_TABLE_FILE "tool.tbl"
 
@@ -32,6 +32,9 @@ double emc_task_cycle_time = DEFAULT_EMC_TASK_CYCLE_TIME;
 double emc_io_cycle_time = DEFAULT_EMC_IO_CYCLE_TIME;
 
 int emc_task_interp_max_len = DEFAULT_EMC_TASK_INTERP_MAX_LEN;
+int emc_naivecam_window = DEFAULT_EMC_NAIVECAM_WINDOW;
+int emc_naivecam_all_axes = 0;
+int emc_naivecam_arcs = 0;
 
 char tool_table_file[LINELEN] = DEFAULT_TOOL_TABLE_FILE;
 
@@ -48,6 +48,12 @@ extern "C" {
 
     extern int emc_task_interp_max_len;
 
+    /* naive cam detector: most moves joined, whether moves of ABC
+       and UVW are joined too, and whether runs of moves are sent as arcs */
+    extern int emc_naivecam_window;
+    extern int emc_naivecam_all_axes;
+    extern int emc_naivecam_arcs;
+
     extern char tool_table_file[LINELEN];
 
     extern struct EmcPose tool_change_position;
@@ -224,3 +224,8 @@ EMC_TOOL_STAT EMC_TOOL_STAT::operator =(EMC_TOOL_STAT s)
 EMC_STAT::EMC_STAT():EMC_STAT_MSG(EMC_STAT_TYPE, sizeof(EMC_STAT))
 {
 }
+
+EMC_STAT_DELTA::EMC_STAT_DELTA():RCS_STAT_DELTA_MSG(EMC_STAT_DELTA_TYPE,
+    sizeof(EMC_STAT_DELTA))
+{
+}
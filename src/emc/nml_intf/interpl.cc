@@ -16,21 +16,31 @@
 ********************************************************************/
 
 
+#include <stdlib.h>		/* malloc(), free() */
 #include <string.h>		/* memcpy() */
 
-#include "rcs.hh"		// LinkedList
+#include "rcs.hh"
 #include "interpl.hh"		// these decls
 #include "emc.hh"
 #include "emcglb.h"
-#include "linklist.hh"
 #include "nmlmsg.hh"            /* class NMLmsg */
 #include "rcs_print.hh"
 
+// slots start on this boundary, so the commands in them are aligned
+#define NML_INTERP_LIST_ALIGN 16
+
 NML_INTERP_LIST interp_list;	/* NML Union, for interpreter */
 
 NML_INTERP_LIST::NML_INTERP_LIST()
 {
-    linked_list_ptr = new LinkedList;
+    buffer = NULL;
+    buffer_size = 0;
+    head = 0;
+    tail = 0;
+    used = 0;
+    retrieved = 0;
+    retired = NULL;
+    count = 0;
 
     next_line_number = 0;
     line_number = 0;
@@ -38,10 +48,10 @@ NML_INTERP_LIST::NML_INTERP_LIST()
 
 NML_INTERP_LIST::~NML_INTERP_LIST()
 {
-    if (NULL != linked_list_ptr) {
-	delete linked_list_ptr;
-	linked_list_ptr = NULL;
-    }
+    free(buffer);
+    buffer = NULL;
+    free(retired);
+    retired = NULL;
 }
 
 int NML_INTERP_LIST::append(NMLmsg & nml_msg)
@@ -57,8 +67,111 @@ int NML_INTERP_LIST::set_line_number(int line)
     return 0;
 }
 
+// offset of the slot starting at or wrapping around from offset
+long NML_INTERP_LIST::slot(long offset)
+{
+    if (buffer_size - offset < (long) sizeof(NML_INTERP_LIST_NODE) ||
+	0 == ((NML_INTERP_LIST_NODE *) (buffer + offset))->size) {
+	return 0;
+    }
+    return offset;
+}
+
+// moves the queued slots to the front of a bigger buffer
+int NML_INTERP_LIST::grow(long size)
+{
+    long new_size;
+    long offset;
+    long pos;
+    char *new_buffer;
+    NML_INTERP_LIST_NODE *node_ptr;
+    int i;
+
+    new_size = buffer_size ? buffer_size * 2 : NML_INTERP_LIST_INITIAL_SIZE;
+    while (new_size < used - retrieved + size) {
+	new_size *= 2;
+    }
+    new_buffer = (char *) malloc(new_size);
+    if (NULL == new_buffer) {
+	return -1;
+    }
+
+    offset = 0;
+    pos = head;
+    for (i = 0; i < count; i++) {
+	pos = slot(pos);
+	node_ptr = (NML_INTERP_LIST_NODE *) (buffer + pos);
+	memcpy(new_buffer + offset, node_ptr, node_ptr->size);
+	offset += node_ptr->size;
+	pos += node_ptr->size;
+    }
+
+    // the command handed out by get() has to stay put until the next get()
+    if (retrieved > 0) {
+	retired = buffer;
+    } else {
+	free(buffer);
+    }
+
+    if (emc_debug & EMC_DEBUG_INTERP_LIST) {
+	rcs_print("NML_INTERP_LIST(%p)::grow(): %ld -> %ld bytes\n",
+		  this, buffer_size, new_size);
+    }
+
+    buffer = new_buffer;
+    buffer_size = new_size;
+    head = 0;
+    tail = offset;
+    used = offset;
+    retrieved = 0;
+
+    return 0;
+}
+
+// finds room for a slot at the tail, returns its offset or -1
+long NML_INTERP_LIST::reserve(long size)
+{
+    long start;
+
+    if (0 == used) {
+	// empty, start over at the front
+	head = 0;
+	tail = 0;
+    }
+
+    if (used < buffer_size) {
+	// start of the oldest slot still in use
+	start = (head - retrieved + buffer_size) % buffer_size;
+	if (tail >= start) {
+	    if (size <= buffer_size - tail) {
+		return tail;
+	    }
+	    if (size <= start) {
+		// mark the end of the buffer unused and wrap around
+		if (buffer_size - tail >= (long) sizeof(NML_INTERP_LIST_NODE)) {
+		    ((NML_INTERP_LIST_NODE *) (buffer + tail))->size = 0;
+		}
+		used += buffer_size - tail;
+		tail = 0;
+		return tail;
+	    }
+	} else if (size <= start - tail) {
+	    return tail;
+	}
+    }
+
+    if (0 != grow(size)) {
+	return -1;
+    }
+    return tail;
+}
+
 int NML_INTERP_LIST::append(NMLmsg * nml_msg_ptr)
 {
+    NML_INTERP_LIST_NODE *node_ptr;
+    long size;
+    long offset;
+
     /* check for invalid data */
     if (NULL == nml_msg_ptr) {
 	rcs_print_error
@@ -82,39 +195,31 @@ int NML_INTERP_LIST::append(NMLmsg * nml_msg_ptr)
 	    ("NML_INTERP_LIST::append : command size is invalid.");
 	return -1;
     }
-#ifdef DEBUG_INTERPL
-    if (sizeof(temp_node) < MAX_NML_COMMAND_SIZE + 4 ||
-	sizeof(temp_node) > MAX_NML_COMMAND_SIZE + 16 ||
-	((void *) &temp_node.line_number) >
-	((void *) &temp_node.command.commandbuf)) {
-	rcs_print_error
-	    ("NML_INTERP_LIST::append : assumptions about NML_INTERP_LIST_NODE have been violated.");
-	return -1;
-    }
-#endif
 
-    if (NULL == linked_list_ptr) {
+    size = (sizeof(NML_INTERP_LIST_NODE) + nml_msg_ptr->size +
+	    NML_INTERP_LIST_ALIGN - 1) & ~(NML_INTERP_LIST_ALIGN - 1);
+    offset = reserve(size);
+    if (offset < 0) {
+	rcs_print_error
+	    ("NML_INTERP_LIST::append : out of memory.\n");
 	return -1;
     }
-    // fill in the NML_INTERP_LIST_NODE
-    temp_node.line_number = next_line_number;
-    memcpy(temp_node.command.commandbuf, nml_msg_ptr, nml_msg_ptr->size);
 
-    // stick it on the list
-    linked_list_ptr->store_at_tail(&temp_node,
-				   nml_msg_ptr->size +
-				   sizeof(temp_node.line_number) +
-				   sizeof(temp_node.dummy) + 32 + (32 -
-								   nml_msg_ptr->
-								   size %
-								   32), 1);
+    // fill in the slot in place
+    node_ptr = (NML_INTERP_LIST_NODE *) (buffer + offset);
+    node_ptr->line_number = next_line_number;
+    node_ptr->size = size;
+    memcpy(node_ptr + 1, nml_msg_ptr, nml_msg_ptr->size);
+    tail = offset + size;
+    used += size;
+    count++;
 
     if (emc_debug & EMC_DEBUG_INTERP_LIST) {
 	rcs_print
 	    ("NML_INTERP_LIST(%p)::append(nml_msg_ptr{size=%ld,type=%s}) : list_size=%d, line_number=%d\n",
              this,
 	     nml_msg_ptr->size, emc_symbol_lookup(nml_msg_ptr->type),
-	     linked_list_ptr->list_size, temp_node.line_number);
+	     count, node_ptr->line_number);
     }
 
     return 0;
@@ -125,22 +230,34 @@ NMLmsg *NML_INTERP_LIST::get()
     NMLmsg *ret;
     NML_INTERP_LIST_NODE *node_ptr;
 
-    if (NULL == linked_list_ptr) {
-	line_number = 0;
-	return NULL;
+    // the command from the last get() is done with, free its slot
+    used -= retrieved;
+    retrieved = 0;
+    if (NULL != retired) {
+	free(retired);
+	retired = NULL;
     }
 
-    node_ptr = (NML_INTERP_LIST_NODE *) linked_list_ptr->retrieve_head();
-
-    if (NULL == node_ptr) {
+    if (0 == count) {
 	line_number = 0;
 	return NULL;
     }
+
+    // skip over the unused end of the buffer
+    if (slot(head) != head) {
+	retrieved += buffer_size - head;
+	head = 0;
+    }
+    node_ptr = (NML_INTERP_LIST_NODE *) (buffer + head);
+    retrieved += node_ptr->size;
+    head += node_ptr->size;
+    count--;
+
     // save line number of this one, for use by get_line_number
     line_number = node_ptr->line_number;
 
-    // get it off the front
-    ret = (NMLmsg *) ((char *) node_ptr->command.commandbuf);
+    // the slot stays reserved until the next get()
+    ret = (NMLmsg *) (node_ptr + 1);
 
     if (emc_debug & EMC_DEBUG_INTERP_LIST) {
         rcs_print(
@@ -148,7 +265,7 @@ NMLmsg *NML_INTERP_LIST::get()
             this,
             ret->size,
             emc_symbol_lookup(ret->type),
-            linked_list_ptr->list_size
+            count
         );
     }
 
@@ -157,41 +274,36 @@ NMLmsg *NML_INTERP_LIST::get()
 
 void NML_INTERP_LIST::clear()
 {
-    if (NULL != linked_list_ptr) {
-	linked_list_ptr->delete_members();
-    }
+    // drop the queued commands, but not the one handed out by get()
+    tail = head;
+    used = retrieved;
+    count = 0;
 }
 
 void NML_INTERP_LIST::print()
 {
     NMLmsg *ret;
     NML_INTERP_LIST_NODE *node_ptr;
-    int line_number;
-
-    if (NULL == linked_list_ptr) {
-	return;
-    }
-    node_ptr = (NML_INTERP_LIST_NODE *) linked_list_ptr->get_head();
+    long pos;
+    int i;
 
-    rcs_print("NML_INTERP_LIST::print(): list size=%d\n",linked_list_ptr->list_size);
-    while (NULL != node_ptr) {
-	line_number = node_ptr->line_number;
-	ret = (NMLmsg *) ((char *) node_ptr->command.commandbuf);
+    rcs_print("NML_INTERP_LIST::print(): list size=%d\n", count);
+    pos = head;
+    for (i = 0; i < count; i++) {
+	pos = slot(pos);
+	node_ptr = (NML_INTERP_LIST_NODE *) (buffer + pos);
+	ret = (NMLmsg *) (node_ptr + 1);
 	rcs_print("--> type=%s,  line_number=%d\n",
 		  emc_symbol_lookup((int)ret->type),
-		  line_number);
-	node_ptr = (NML_INTERP_LIST_NODE *) linked_list_ptr->get_next();
+		  node_ptr->line_number);
+	pos += node_ptr->size;
     }
     rcs_print("\n");
 }
 
 int NML_INTERP_LIST::len()
 {
-    if (NULL == linked_list_ptr) {
-	return 0;
-    }
-
-    return ((int) linked_list_ptr->list_size);
+    return count;
 }
 
 int NML_INTERP_LIST::get_line_number()
@@ -21,9 +21,13 @@
 
 #define MAX_NML_COMMAND_SIZE 1000
 
-// these go on the interp list
+// initial size of the interp list buffer, it doubles when full
+#define NML_INTERP_LIST_INITIAL_SIZE (64 * 1024)
+
+// header of each slot in the interp list buffer, the NML command follows
 struct NML_INTERP_LIST_NODE {
     int line_number;		// line number it was on
+    int size;			// bytes in slot including header, 0 = wrap
     union _dummy_union {
 	int32_t i;
 	int32_t l;
@@ -32,19 +36,9 @@ struct NML_INTERP_LIST_NODE {
 	int64_t ll;
 	long double ld;
     } dummy;			// paranoid alignment variable.
-
-    union _command_union {
-	char commandbuf[MAX_NML_COMMAND_SIZE];	// the NML command;
-	int32_t i;
-	int32_t l;
-	double d;
-	float f;
-	int64_t ll;
-	long double ld;
-    } command;
 };
 
-// here's the interp list itself
+// here's the interp list itself, a ring buffer of variable size slots
 class NML_INTERP_LIST {
   public:
     NML_INTERP_LIST();
@@ -60,12 +54,21 @@ class NML_INTERP_LIST {
     int len();
 
   private:
-    class LinkedList * linked_list_ptr;
-    NML_INTERP_LIST_NODE temp_node;	// filled in and put on the list
-    int next_line_number;	// line number used to fill temp_node
+    long reserve(long size);
+    int grow(long size);
+    long slot(long offset);
+
+    char *buffer;		// ring of NML_INTERP_LIST_NODE slots
+    long buffer_size;
+    long head;			// offset of the oldest queued slot
+    long tail;			// offset of the next slot to append
+    long used;			// bytes in use, including retrieved slot
+    long retrieved;		// bytes before head still held for get()
+    char *retired;		// old buffer holding the slot from get()
+    int count;			// number of queued commands
+    int next_line_number;	// line number used for appended slots
     int line_number;		// line number of node from get()
 };
-
 extern NML_INTERP_LIST interp_list;	/* NML Union, for interpreter */
 
 #endif
@@ -16,6 +16,7 @@
 //    along with this program; if not, write to the Free Software
 //    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 
+#define PY_SSIZE_T_CLEAN
 #include <Python.h>
 #include <structmember.h>
 
@@ -23,8 +24,12 @@
 #include "rs274ngc_interp.hh"
 #include "interp_return.hh"
 #include "canon.hh"
+#include "preview_segments.hh"
 #include "config.h"		// LINELEN
 
+#include <string>
+#include <vector>
+
 int _task = 0; // control preview behaviour when remapping
 
 char _parameter_file_name[LINELEN];
@@ -137,6 +142,287 @@ static PyTypeObject LineCodeType = {
     0,                      /*tp_is_gc*/
 };
 
+/* A list of preview moves that keeps its items as packed doubles (see
+ * preview_segments.hh) instead of one tuple per move.  Items read back as
+ * the same tuples rs274.glcanon puts in its traverse and feed lists, so
+ * code that walks those lists keeps working. */
+typedef struct {
+    PyObject_HEAD
+    std::vector<double> *data;
+    int feed;                   // items carry a feed rate
+    int exports;                // buffer views handed out
+    Py_ssize_t shape[2];
+    Py_ssize_t strides[2];
+} Segments;
+
+static Py_ssize_t Segments_length(Segments *s) {
+    return s->data->size() / PREVIEW_SEGMENT_SIZE;
+}
+
+static bool Segments_add(Segments *s, int line_number,
+        const double *start, const double *end,
+        double feedrate, const double *tlo) {
+    if(s->exports) {
+        PyErr_SetString(PyExc_BufferError,
+                "gcode.segments: cannot append while a buffer is exported");
+        return false;
+    }
+    std::vector<double> &d = *s->data;
+    d.push_back(line_number);
+    d.insert(d.end(), start, start + 9);
+    d.insert(d.end(), end, end + 9);
+    d.push_back(feedrate);
+    d.insert(d.end(), tlo, tlo + 3);
+    return true;
+}
+
+static PyObject *Segments_new(PyTypeObject *type, PyObject *args, PyObject *kw) {
+    Segments *s = (Segments*)type->tp_alloc(type, 0);
+    if(!s) return NULL;
+    s->data = new std::vector<double>;
+    return (PyObject*)s;
+}
+
+static int Segments_init(Segments *s, PyObject *args, PyObject *kw) {
+    int feed = 1;
+    const char *buf = NULL;
+    Py_ssize_t len = 0;
+    if(!PyArg_ParseTuple(args, "|is#:segments", &feed, &buf, &len)) return -1;
+    if(len % (PREVIEW_SEGMENT_SIZE * sizeof(double))) {
+        PyErr_SetString(PyExc_ValueError,
+                "gcode.segments: data is not a whole number of moves");
+        return -1;
+    }
+    if(s->exports) {
+        PyErr_SetString(PyExc_BufferError,
+                "gcode.segments: cannot change while a buffer is exported");
+        return -1;
+    }
+    s->feed = feed;
+    s->data->assign((const double*)buf, (const double*)(buf + len));
+    return 0;
+}
+
+static void Segments_dealloc(Segments *s) {
+    delete s->data;
+    s->ob_type->tp_free((PyObject*)s);
+}
+
+static PyObject *Segments_item(Segments *s, Py_ssize_t i) {
+    if(i < 0 || i >= Segments_length(s)) {
+        PyErr_SetString(PyExc_IndexError, "segment index out of range");
+        return NULL;
+    }
+    const double *r = &(*s->data)[i * PREVIEW_SEGMENT_SIZE];
+    const double *p = r + PREVIEW_SEGMENT_START, *q = r + PREVIEW_SEGMENT_END,
+                 *t = r + PREVIEW_SEGMENT_TLO;
+    if(s->feed)
+        return Py_BuildValue("i(ddddddddd)(ddddddddd)d[ddd]",
+            (int)r[PREVIEW_SEGMENT_LINE],
+            p[0], p[1], p[2], p[3], p[4], p[5], p[6], p[7], p[8],
+            q[0], q[1], q[2], q[3], q[4], q[5], q[6], q[7], q[8],
+            r[PREVIEW_SEGMENT_FEED], t[0], t[1], t[2]);
+    return Py_BuildValue("i(ddddddddd)(ddddddddd)[ddd]",
+        (int)r[PREVIEW_SEGMENT_LINE],
+        p[0], p[1], p[2], p[3], p[4], p[5], p[6], p[7], p[8],
+        q[0], q[1], q[2], q[3], q[4], q[5], q[6], q[7], q[8],
+        t[0], t[1], t[2]);
+}
+
+static PyObject *Segments_append(Segments *s, PyObject *o) {
+    int n;
+    double p[9], q[9], t[3], feedrate = 0;
+    int r;
+    if(s->feed)
+        r = PyArg_ParseTuple(o,
+            "i(ddddddddd)(ddddddddd)d(ddd):segments.append", &n,
+            &p[0], &p[1], &p[2], &p[3], &p[4], &p[5], &p[6], &p[7], &p[8],
+            &q[0], &q[1], &q[2], &q[3], &q[4], &q[5], &q[6], &q[7], &q[8],
+            &feedrate, &t[0], &t[1], &t[2]);
+    else
+        r = PyArg_ParseTuple(o,
+            "i(ddddddddd)(ddddddddd)(ddd):segments.append", &n,
+            &p[0], &p[1], &p[2], &p[3], &p[4], &p[5], &p[6], &p[7], &p[8],
+            &q[0], &q[1], &q[2], &q[3], &q[4], &q[5], &q[6], &q[7], &q[8],
+            &t[0], &t[1], &t[2]);
+    if(!r) return NULL;
+    if(!Segments_add(s, n, p, q, feedrate, t)) return NULL;
+    Py_RETURN_NONE;
+}
+
+/* Append the moves of another segments object.  If start is given it
+ * replaces the start point of the first appended move; parallel preview
+ * uses this to join sections interpreted from a different position. */
+static PyObject *Segments_extend(Segments *s, PyObject *args) {
+    PyObject *o;
+    double p[9];
+    int has_start = PyTuple_Size(args) > 1;
+    if(!PyArg_ParseTuple(args, "O|(ddddddddd):segments.extend", &o,
+                &p[0], &p[1], &p[2], &p[3], &p[4], &p[5], &p[6], &p[7], &p[8]))
+        return NULL;
+    if(!PyObject_TypeCheck(o, s->ob_type)) {
+        PyErr_SetString(PyExc_TypeError,
+                "segments.extend: argument must be gcode.segments");
+        return NULL;
+    }
+    if(s->exports) {
+        PyErr_SetString(PyExc_BufferError,
+                "gcode.segments: cannot append while a buffer is exported");
+        return NULL;
+    }
+    std::vector<double> &d = *s->data;
+    size_t first = d.size();
+    if(o == (PyObject*)s) {
+        d.reserve(2 * first);
+        for(size_t i = 0; i < first; i++) d.push_back(d[i]);
+    } else {
+        const std::vector<double> &src = *((Segments*)o)->data;
+        d.insert(d.end(), src.begin(), src.end());
+    }
+    if(d.size() == first) Py_RETURN_NONE;
+    if(has_start)
+        std::copy(p, p + 9, d.begin() + first + PREVIEW_SEGMENT_START);
+    Py_RETURN_NONE;
+}
+
+// pickle as segments(feed, packed data)
+static PyObject *Segments_reduce(Segments *s) {
+    return Py_BuildValue("O(is#)", s->ob_type, s->feed,
+            s->data->empty() ? "" : (const char*)&(*s->data)[0],
+            (Py_ssize_t)(s->data->size() * sizeof(double)));
+}
+
+static double segment_length(const double *r) {
+    const double *p = r + PREVIEW_SEGMENT_START, *q = r + PREVIEW_SEGMENT_END;
+    return sqrt((q[0]-p[0])*(q[0]-p[0]) + (q[1]-p[1])*(q[1]-p[1])
+            + (q[2]-p[2])*(q[2]-p[2]));
+}
+
+static PyObject *Segments_distance(Segments *s) {
+    double d = 0;
+    for(size_t i = 0; i < s->data->size(); i += PREVIEW_SEGMENT_SIZE)
+        d += segment_length(&(*s->data)[i]);
+    return PyFloat_FromDouble(d);
+}
+
+static PyObject *Segments_time(Segments *s, PyObject *args) {
+    double max_feed, t = 0;
+    if(!PyArg_ParseTuple(args, "d:segments.time", &max_feed)) return NULL;
+    for(size_t i = 0; i < s->data->size(); i += PREVIEW_SEGMENT_SIZE) {
+        const double *r = &(*s->data)[i];
+        double f = max_feed;
+        if(s->feed) f = std::min(f, r[PREVIEW_SEGMENT_FEED]);
+        t += segment_length(r) / f;
+    }
+    return PyFloat_FromDouble(t);
+}
+
+static int Segments_getbuffer(Segments *s, Py_buffer *view, int flags) {
+    static double empty;
+    if(flags & PyBUF_WRITABLE) {
+        PyErr_SetString(PyExc_BufferError, "gcode.segments is read-only");
+        view->obj = NULL;
+        return -1;
+    }
+    s->shape[0] = Segments_length(s);
+    s->shape[1] = PREVIEW_SEGMENT_SIZE;
+    s->strides[0] = PREVIEW_SEGMENT_SIZE * sizeof(double);
+    s->strides[1] = sizeof(double);
+    view->obj = (PyObject*)s;
+    Py_INCREF(s);
+    view->buf = s->data->empty() ? &empty : &(*s->data)[0];
+    view->len = s->data->size() * sizeof(double);
+    view->readonly = 1;
+    view->itemsize = sizeof(double);
+    view->format = (flags & PyBUF_FORMAT) ? (char*)"d" : NULL;
+    view->ndim = 2;
+    view->shape = (flags & PyBUF_ND) ? s->shape : NULL;
+    view->strides = (flags & PyBUF_STRIDES) == PyBUF_STRIDES ? s->strides : NULL;
+    view->suboffsets = NULL;
+    view->internal = NULL;
+    s->exports++;
+    return 0;
+}
+
+static void Segments_releasebuffer(Segments *s, Py_buffer *view) {
+    s->exports--;
+}
+
+static PySequenceMethods SegmentsSequence = {
+    (lenfunc)Segments_length,           /*sq_length*/
+    0,                                  /*sq_concat*/
+    0,                                  /*sq_repeat*/
+    (ssizeargfunc)Segments_item,        /*sq_item*/
+};
+
+static PyBufferProcs SegmentsBuffer = {
+    0,                                  /*bf_getreadbuffer*/
+    0,                                  /*bf_getwritebuffer*/
+    0,                                  /*bf_getsegcount*/
+    0,                                  /*bf_getcharbuffer*/
+    (getbufferproc)Segments_getbuffer,  /*bf_getbuffer*/
+    (releasebufferproc)Segments_releasebuffer, /*bf_releasebuffer*/
+};
+
+static PyMethodDef SegmentsMethods[] = {
+    {"append", (PyCFunction)Segments_append, METH_O,
+        "Append a move given as a rs274.glcanon tuple"},
+    {"extend", (PyCFunction)Segments_extend, METH_VARARGS,
+        "Append the moves of another segments, optionally moving the first start"},
+    {"distance", (PyCFunction)Segments_distance, METH_NOARGS,
+        "Total xyz length of the moves"},
+    {"time", (PyCFunction)Segments_time, METH_VARARGS,
+        "Time to run the moves, none faster than the given speed"},
+    {"__reduce__", (PyCFunction)Segments_reduce, METH_NOARGS,
+        "Support for pickle"},
+    {NULL}
+};
+
+static PyTypeObject SegmentsType = {
+    PyObject_HEAD_INIT(NULL)
+    0,                      /*ob_size*/
+    "gcode.segments",       /*tp_name*/
+    sizeof(Segments),       /*tp_basicsize*/
+    0,                      /*tp_itemsize*/
+    /* methods */
+    (destructor)Segments_dealloc, /*tp_dealloc*/
+    0,                      /*tp_print*/
+    0,                      /*tp_getattr*/
+    0,                      /*tp_setattr*/
+    0,                      /*tp_compare*/
+    0,                      /*tp_repr*/
+    0,                      /*tp_as_number*/
+    &SegmentsSequence,      /*tp_as_sequence*/
+    0,                      /*tp_as_mapping*/
+    0,                      /*tp_hash*/
+    0,                      /*tp_call*/
+    0,                      /*tp_str*/
+    0,                      /*tp_getattro*/
+    0,                      /*tp_setattro*/
+    &SegmentsBuffer,        /*tp_as_buffer*/
+    Py_TPFLAGS_DEFAULT | Py_TPFLAGS_HAVE_NEWBUFFER, /*tp_flags*/
+    "segments([feed[, data]]) -> packed list of preview moves", /*tp_doc*/
+    0,                      /*tp_traverse*/
+    0,                      /*tp_clear*/
+    0,                      /*tp_richcompare*/
+    0,                      /*tp_weaklistoffset*/
+    0,                      /*tp_iter*/
+    0,                      /*tp_iternext*/
+    SegmentsMethods,        /*tp_methods*/
+    0,                      /*tp_members*/
+    0,                      /*tp_getset*/
+    0,                      /*tp_base*/
+    0,                      /*tp_dict*/
+    0,                      /*tp_descr_get*/
+    0,                      /*tp_descr_set*/
+    0,                      /*tp_dictoffset*/
+    (initproc)Segments_init, /*tp_init*/
+    0,                      /*tp_alloc*/
+    Segments_new,           /*tp_new*/
+    0,                      /*tp_free*/
+    0,                      /*tp_is_gc*/
+};
+
 static PyObject *callback;
 static int interp_error;
 static int last_sequence_number;
@@ -149,19 +435,125 @@ static InterpBase *pinterp;
 
 #define callmethod(o, m, f, ...) PyObject_CallMethod((o), (char*)(m), (char*)(f), ## __VA_ARGS__)
 
-static void maybe_new_line(int sequence_number=interp_new.sequence_number());
-static void maybe_new_line(int sequence_number) {
-    if(!pinterp) return;
-    if(interp_error) return;
-    if(sequence_number == last_sequence_number)
-        return;
+/* Native preview: when the canon is a rs274.glcanon.GLCanon (it sets
+ * native_preview and keeps its moves in gcode.segments), straight and arc
+ * moves are stored here without calling back into Python.  The canon
+ * attributes the moves depend on are mirrored in 'preview'; they are
+ * written back before, and read again after, each callback that may use
+ * or change them (see callstate). */
+static struct {
+    bool active;
+    Segments *traverse, *feed, *arcfeed;
+    bool pending;               // next_line not yet sent for lineno
+    int lineno;
+    double lo[9];
+    bool first_move;
+    int suppress;
+    double feedrate;
+    double to[3];
+    double g5x_offset[9], g92_offset[9];
+    double rotation_xy, rotation_cos, rotation_sin;
+    int plane, arcdivision;
+} preview;
+
+static const char *axis_suffix[9] = {"x", "y", "z", "a", "b", "c", "u", "v", "w"};
+
+static bool preview_get(const char *attr_name, double *v) {
+    PyObject *attr = PyObject_GetAttrString(callback, attr_name);
+    if(!attr) return false;
+    *v = PyFloat_AsDouble(attr);
+    Py_DECREF(attr);
+    return !PyErr_Occurred();
+}
+
+static bool preview_get(const char *attr_name, int *v) {
+    PyObject *attr = PyObject_GetAttrString(callback, attr_name);
+    if(!attr) return false;
+    *v = PyInt_AsLong(attr);
+    Py_DECREF(attr);
+    return !PyErr_Occurred();
+}
+
+static bool preview_get(const char *attr_name, double *v, int n) {
+    PyObject *attr = PyObject_GetAttrString(callback, attr_name);
+    if(!attr) return false;
+    PyObject *seq = PySequence_Fast(attr, attr_name);
+    Py_DECREF(attr);
+    if(!seq) return false;
+    if(PySequence_Fast_GET_SIZE(seq) != n) {
+        PyErr_Format(PyExc_TypeError, "%s: expected %d items", attr_name, n);
+        Py_DECREF(seq);
+        return false;
+    }
+    for(int i=0; i<n; i++)
+        v[i] = PyFloat_AsDouble(PySequence_Fast_GET_ITEM(seq, i));
+    Py_DECREF(seq);
+    return !PyErr_Occurred();
+}
+
+static bool preview_get_offsets(const char *prefix, double *v) {
+    char attr_name[32];
+    for(int i=0; i<9; i++) {
+        snprintf(attr_name, sizeof(attr_name), "%s_%s", prefix, axis_suffix[i]);
+        if(!preview_get(attr_name, &v[i])) return false;
+    }
+    return true;
+}
+
+// read back the canon attributes a Python callback may have changed
+static bool preview_pull() {
+    PyObject *attr = PyObject_GetAttrString(callback, "first_move");
+    if(!attr) return false;
+    preview.first_move = PyObject_IsTrue(attr);
+    Py_DECREF(attr);
+    double xo, yo, zo;
+    if(!preview_get("lo", preview.lo, 9)
+            || !preview_get("suppress", &preview.suppress)
+            || !preview_get("feedrate", &preview.feedrate)
+            || !preview_get("xo", &xo)
+            || !preview_get("yo", &yo)
+            || !preview_get("zo", &zo)
+            || !preview_get("plane", &preview.plane)
+            || !preview_get_offsets("g5x_offset", preview.g5x_offset)
+            || !preview_get_offsets("g92_offset", preview.g92_offset)
+            || !preview_get("rotation_xy", &preview.rotation_xy))
+        return false;
+    preview.to[0] = xo; preview.to[1] = yo; preview.to[2] = zo;
+    preview.rotation_cos = 1;
+    preview.rotation_sin = 0;
+    if(PyObject_HasAttrString(callback, "rotation_cos")
+            && (!preview_get("rotation_cos", &preview.rotation_cos)
+                || !preview_get("rotation_sin", &preview.rotation_sin)))
+        return false;
+    return true;
+}
+
+// write the mirrored attributes back to the canon
+static bool preview_push() {
+    const double *lo = preview.lo;
+    PyObject *v = Py_BuildValue("(ddddddddd)",
+            lo[0], lo[1], lo[2], lo[3], lo[4], lo[5], lo[6], lo[7], lo[8]);
+    if(!v) return false;
+    int r = PyObject_SetAttrString(callback, "lo", v);
+    Py_DECREF(v);
+    if(r < 0) return false;
+    if(PyObject_SetAttrString(callback, "first_move",
+                preview.first_move ? Py_True : Py_False) < 0)
+        return false;
+    v = PyInt_FromLong(preview.lineno);
+    if(!v) return false;
+    r = PyObject_SetAttrString(callback, "lineno", v);
+    Py_DECREF(v);
+    return r == 0;
+}
+
+static void next_line(int sequence_number) {
     LineCode *new_line_code =
         (LineCode*)(PyObject_New(LineCode, &LineCodeType));
     interp_new.active_settings(new_line_code->settings);
     interp_new.active_g_codes(new_line_code->gcodes);
     interp_new.active_m_codes(new_line_code->mcodes);
     new_line_code->gcodes[0] = sequence_number;
-    last_sequence_number = sequence_number;
     PyObject *result = 
         callmethod(callback, "next_line", "O", new_line_code);
     Py_DECREF(new_line_code);
@@ -169,6 +561,125 @@ static void maybe_new_line(int sequence_number) {
     Py_XDECREF(result);
 }
 
+// send the next_line callback held back while only moves were seen
+static void preview_flush() {
+    if(!preview.pending || interp_error) return;
+    preview.pending = false;
+    next_line(preview.lineno);
+}
+
+static bool callstate_before() {
+    if(!preview.active) return true;
+    preview_flush();
+    if(interp_error) return false;
+    return preview_push();
+}
+
+static PyObject *callstate_after(PyObject *result) {
+    if(result && preview.active && !preview_pull()) {
+        Py_DECREF(result);
+        return NULL;
+    }
+    return result;
+}
+
+// callmethod for callbacks that use or change the mirrored canon state
+#define callstate(o, m, f, ...) \
+    (callstate_before() ? \
+        callstate_after(callmethod(o, m, f, ## __VA_ARGS__)) : NULL)
+
+static void preview_begin() {
+    preview.active = false;
+    preview.pending = false;
+    PyObject *attr = PyObject_GetAttrString(callback, "native_preview");
+    bool wanted = attr && PyObject_IsTrue(attr);
+    Py_XDECREF(attr);
+    PyErr_Clear();
+    if(!wanted) return;
+    PyObject *traverse = PyObject_GetAttrString(callback, "traverse");
+    PyObject *feed = PyObject_GetAttrString(callback, "feed");
+    PyObject *arcfeed = PyObject_GetAttrString(callback, "arcfeed");
+    if(traverse && PyObject_TypeCheck(traverse, &SegmentsType)
+            && feed && PyObject_TypeCheck(feed, &SegmentsType)
+            && arcfeed && PyObject_TypeCheck(arcfeed, &SegmentsType)) {
+        preview.traverse = (Segments*)traverse;
+        preview.feed = (Segments*)feed;
+        preview.arcfeed = (Segments*)arcfeed;
+        preview.lineno = -1;
+        if(preview_get("arcdivision", &preview.arcdivision) && preview_pull()) {
+            preview.active = true;
+            return;
+        }
+    }
+    Py_XDECREF(traverse);
+    Py_XDECREF(feed);
+    Py_XDECREF(arcfeed);
+    PyErr_Clear();
+}
+
+static void preview_end() {
+    if(!preview.active) return;
+    if(!interp_error) {
+        preview_flush();
+        if(!interp_error && !preview_push()) interp_error++;
+    }
+    preview.active = false;
+    Py_DECREF(preview.traverse);
+    Py_DECREF(preview.feed);
+    Py_DECREF(preview.arcfeed);
+}
+
+static void rotate_and_translate(double *p) {
+    for(int ax=0; ax<9; ax++) p[ax] += preview.g92_offset[ax];
+    if(preview.rotation_xy) {
+        double rotx = p[0] * preview.rotation_cos - p[1] * preview.rotation_sin;
+        p[1] = p[0] * preview.rotation_sin + p[1] * preview.rotation_cos;
+        p[0] = rotx;
+    }
+    for(int ax=0; ax<9; ax++) p[ax] += preview.g5x_offset[ax];
+}
+
+static void preview_move(Segments *s, const double *l) {
+    if(!Segments_add(s, preview.lineno, preview.lo, l,
+                preview.feedrate, preview.to)) {
+        interp_error++;
+        return;
+    }
+    memcpy(preview.lo, l, sizeof(preview.lo));
+}
+
+static void preview_straight(bool traverse,
+                   double x, double y, double z,
+                   double a, double b, double c,
+                   double u, double v, double w) {
+    if(preview.suppress > 0) return;
+    double l[9] = {x, y, z, a, b, c, u, v, w};
+    rotate_and_translate(l);
+    if(!traverse) {
+        preview.first_move = false;
+        preview_move(preview.feed, l);
+    } else if(!preview.first_move) {
+        preview_move(preview.traverse, l);
+    } else {
+        memcpy(preview.lo, l, sizeof(preview.lo));
+    }
+}
+
+static void maybe_new_line(int sequence_number=interp_new.sequence_number());
+static void maybe_new_line(int sequence_number) {
+    if(!pinterp) return;
+    if(interp_error) return;
+    if(sequence_number == last_sequence_number)
+        return;
+    last_sequence_number = sequence_number;
+    if(preview.active) {
+        preview.pending = true;
+        preview.lineno = sequence_number;
+        return;
+    }
+    next_line(sequence_number);
+}
+
 void NURBS_FEED(int line_number, std::vector<CONTROL_POINT> nurbs_control_points, unsigned int k) {
     double u = 0.0;
     unsigned int n = nurbs_control_points.size() - 1;
@@ -187,6 +698,110 @@ void NURBS_FEED(int line_number, std::vector<CONTROL_POINT> nurbs_control_points
     knot_vector.clear();
 }
 
+static void unrotate(double &x, double &y, double c, double s) {
+    double tx = x * c + y * s;
+    y = -x * s + y * c;
+    x = tx;
+}
+
+static void rotate(double &x, double &y, double c, double s) {
+    double tx = x * c - y * s;
+    y = x * s + y * c;
+    x = tx;
+}
+
+// Split an arc starting at lo into straight segments, leaving the end of
+// each segment in points (9 doubles per point)
+static void arc_points(std::vector<double> &points, const double *lo,
+        int plane, double rotation_cos, double rotation_sin,
+        const double *g5xoffset, const double *g92offset,
+        double x1, double y1, double cx, double cy, int rot, double z1,
+        double a, double b, double c, double u, double v, double w,
+        int max_segments) {
+    double o[9], n[9];
+    int X, Y, Z;
+
+    memcpy(o, lo, sizeof(o));
+    if(plane == 1) {
+        X=0; Y=1; Z=2;
+    } else if(plane == 3) {
+        X=2; Y=0; Z=1;
+    } else {
+        X=1; Y=2; Z=0;
+    }
+    n[X] = x1;
+    n[Y] = y1;
+    n[Z] = z1;
+    n[3] = a;
+    n[4] = b;
+    n[5] = c;
+    n[6] = u;
+    n[7] = v;
+    n[8] = w;
+    for(int ax=0; ax<9; ax++) o[ax] -= g5xoffset[ax];
+    unrotate(o[0], o[1], rotation_cos, rotation_sin);
+    for(int ax=0; ax<9; ax++) o[ax] -= g92offset[ax];
+
+    double theta1 = atan2(o[Y]-cy, o[X]-cx);
+    double theta2 = atan2(n[Y]-cy, n[X]-cx);
+
+    if(rot < 0) {
+        while(theta2 - theta1 > -CIRCLE_FUZZ) theta2 -= 2*M_PI;
+    } else {
+        while(theta2 - theta1 < CIRCLE_FUZZ) theta2 += 2*M_PI;
+    }
+
+    // if multi-turn, add the right number of full circles
+    if(rot < -1) theta2 += 2*M_PI*(rot+1);
+    if(rot > 1) theta2 += 2*M_PI*(rot-1);
+
+    int steps = std::max(3, int(max_segments * fabs(theta1 - theta2) / M_PI));
+    double rsteps = 1. / steps;
+    points.clear();
+    points.reserve(steps * 9);
+
+    double dtheta = theta2 - theta1;
+    double d[9] = {0, 0, 0, n[3]-o[3], n[4]-o[4], n[5]-o[5], n[6]-o[6], n[7]-o[7], n[8]-o[8]};
+    d[Z] = n[Z] - o[Z];
+
+    double tx = o[X] - cx, ty = o[Y] - cy, dc = cos(dtheta*rsteps), ds = sin(dtheta*rsteps);
+    for(int i=0; i<steps-1; i++) {
+        double f = (i+1) * rsteps;
+        double p[9];
+        rotate(tx, ty, dc, ds);
+        p[X] = tx + cx;
+        p[Y] = ty + cy;
+        p[Z] = o[Z] + d[Z] * f;
+        p[3] = o[3] + d[3] * f;
+        p[4] = o[4] + d[4] * f;
+        p[5] = o[5] + d[5] * f;
+        p[6] = o[6] + d[6] * f;
+        p[7] = o[7] + d[7] * f;
+        p[8] = o[8] + d[8] * f;
+        for(int ax=0; ax<9; ax++) p[ax] += g92offset[ax];
+        rotate(p[0], p[1], rotation_cos, rotation_sin);
+        for(int ax=0; ax<9; ax++) p[ax] += g5xoffset[ax];
+        points.insert(points.end(), p, p + 9);
+    }
+    for(int ax=0; ax<9; ax++) n[ax] += g92offset[ax];
+    rotate(n[0], n[1], rotation_cos, rotation_sin);
+    for(int ax=0; ax<9; ax++) n[ax] += g5xoffset[ax];
+    points.insert(points.end(), n, n + 9);
+}
+
+static void preview_arc(double x1, double y1, double cx, double cy, int rot,
+        double z1, double a, double b, double c, double u, double v, double w) {
+    static std::vector<double> points;
+    if(preview.suppress > 0) return;
+    preview.first_move = false;
+    arc_points(points, preview.lo, preview.plane,
+            preview.rotation_cos, preview.rotation_sin,
+            preview.g5x_offset, preview.g92_offset,
+            x1, y1, cx, cy, rot, z1, a, b, c, u, v, w, preview.arcdivision);
+    for(size_t i=0; i<points.size() && !interp_error; i += 9)
+        preview_move(preview.arcfeed, &points[i]);
+}
+
 void ARC_FEED(int line_number,
               double first_end, double second_end, double first_axis,
               double second_axis, int rotation, double axis_end_point,
@@ -205,6 +820,12 @@ void ARC_FEED(int line_number,
     }
     maybe_new_line(line_number);
     if(interp_error) return;
+    if(preview.active) {
+        preview_arc(first_end, second_end, first_axis, second_axis,
+                rotation, axis_end_point, a_position, b_position, c_position,
+                u_position, v_position, w_position);
+        return;
+    }
     PyObject *result =
         callmethod(callback, "arc_feed", "ffffifffffff",
                             first_end, second_end, first_axis, second_axis,
@@ -225,6 +846,10 @@ void STRAIGHT_FEED(int line_number,
     if(metric) { x /= 25.4; y /= 25.4; z /= 25.4; u /= 25.4; v /= 25.4; w /= 25.4; }
     maybe_new_line(line_number);
     if(interp_error) return;
+    if(preview.active) {
+        preview_straight(false, x, y, z, a, b, c, u, v, w);
+        return;
+    }
     PyObject *result =
         callmethod(callback, "straight_feed", "fffffffff",
                             x, y, z, a, b, c, u, v, w);
@@ -242,6 +867,10 @@ void STRAIGHT_TRAVERSE(int line_number,
     if(metric) { x /= 25.4; y /= 25.4; z /= 25.4; u /= 25.4; v /= 25.4; w /= 25.4; }
     maybe_new_line(line_number);
     if(interp_error) return;
+    if(preview.active) {
+        preview_straight(true, x, y, z, a, b, c, u, v, w);
+        return;
+    }
     PyObject *result =
         callmethod(callback, "straight_traverse", "fffffffff",
                             x, y, z, a, b, c, u, v, w);
@@ -257,7 +886,7 @@ void SET_G5X_OFFSET(int g5x_index,
     maybe_new_line();
     if(interp_error) return;
     PyObject *result =
-        callmethod(callback, "set_g5x_offset", "ifffffffff",
+        callstate(callback, "set_g5x_offset", "ifffffffff",
                             g5x_index, x, y, z, a, b, c, u, v, w);
     if(result == NULL) interp_error ++;
     Py_XDECREF(result);
@@ -270,7 +899,7 @@ void SET_G92_OFFSET(double x, double y, double z,
     maybe_new_line();
     if(interp_error) return;
     PyObject *result =
-        callmethod(callback, "set_g92_offset", "fffffffff",
+        callstate(callback, "set_g92_offset", "fffffffff",
                             x, y, z, a, b, c, u, v, w);
     if(result == NULL) interp_error ++;
     Py_XDECREF(result);
@@ -280,7 +909,7 @@ void SET_XY_ROTATION(double t) {
     maybe_new_line();
     if(interp_error) return;
     PyObject *result =
-        callmethod(callback, "set_xy_rotation", "f", t);
+        callstate(callback, "set_xy_rotation", "f", t);
     if(result == NULL) interp_error ++;
     Py_XDECREF(result);
 };
@@ -291,7 +920,7 @@ void SELECT_PLANE(CANON_PLANE pl) {
     maybe_new_line();   
     if(interp_error) return;
     PyObject *result =
-        callmethod(callback, "set_plane", "i", pl);
+        callstate(callback, "set_plane", "i", pl);
     if(result == NULL) interp_error ++;
     Py_XDECREF(result);
 }
@@ -300,7 +929,7 @@ void SET_TRAVERSE_RATE(double rate) {
     maybe_new_line();   
     if(interp_error) return;
     PyObject *result =
-        callmethod(callback, "set_traverse_rate", "f", rate);
+        callstate(callback, "set_traverse_rate", "f", rate);
     if(result == NULL) interp_error ++;
     Py_XDECREF(result);
 }
@@ -310,7 +939,7 @@ void SET_FEED_MODE(int mode) {
     maybe_new_line();   
     if(interp_error) return;
     PyObject *result =
-        callmethod(callback, "set_feed_mode", "i", mode);
+        callstate(callback, "set_feed_mode", "i", mode);
     if(result == NULL) interp_error ++;
     Py_XDECREF(result);
 #endif
@@ -320,7 +949,7 @@ void CHANGE_TOOL(int pocket) {
     maybe_new_line();
     if(interp_error) return;
     PyObject *result = 
-        callmethod(callback, "change_tool", "i", pocket);
+        callstate(callback, "change_tool", "i", pocket);
     if(result == NULL) interp_error ++;
     Py_XDECREF(result);
 }
@@ -340,7 +969,7 @@ void SET_FEED_RATE(double rate) {
     if(interp_error) return;
     if(metric) rate /= 25.4;
     PyObject *result =
-        callmethod(callback, "set_feed_rate", "f", rate);
+        callstate(callback, "set_feed_rate", "f", rate);
     if(result == NULL) interp_error ++;
     Py_XDECREF(result);
 }
@@ -349,7 +978,7 @@ void DWELL(double time) {
     maybe_new_line();   
     if(interp_error) return;
     PyObject *result =
-        callmethod(callback, "dwell", "f", time);
+        callstate(callback, "dwell", "f", time);
     if(result == NULL) interp_error ++;
     Py_XDECREF(result);
 }
@@ -358,7 +987,7 @@ void MESSAGE(char *comment) {
     maybe_new_line();   
     if(interp_error) return;
     PyObject *result =
-        callmethod(callback, "message", "s", comment);
+        callstate(callback, "message", "s", comment);
     if(result == NULL) interp_error ++;
     Py_XDECREF(result);
 }
@@ -372,7 +1001,7 @@ void COMMENT(const char *comment) {
     maybe_new_line();   
     if(interp_error) return;
     PyObject *result =
-        callmethod(callback, "comment", "s", comment);
+        callstate(callback, "comment", "s", comment);
     if(result == NULL) interp_error ++;
     Py_XDECREF(result);
 }
@@ -388,7 +1017,7 @@ void USE_TOOL_LENGTH_OFFSET(EmcPose offset) {
     if(metric) {
         offset.tran.x /= 25.4; offset.tran.y /= 25.4; offset.tran.z /= 25.4;
         offset.u /= 25.4; offset.v /= 25.4; offset.w /= 25.4; }
-    PyObject *result = callmethod(callback, "tool_offset", "ddddddddd", offset.tran.x, offset.tran.y, offset.tran.z,
+    PyObject *result = callstate(callback, "tool_offset", "ddddddddd", offset.tran.x, offset.tran.y, offset.tran.z,
         offset.a, offset.b, offset.c, offset.u, offset.v, offset.w);
     if(result == NULL) interp_error ++;
     Py_XDECREF(result);
@@ -478,7 +1107,7 @@ void STRAIGHT_PROBE(int line_number,
     maybe_new_line(line_number);
     if(interp_error) return;
     PyObject *result =
-        callmethod(callback, "straight_probe", "fffffffff",
+        callstate(callback, "straight_probe", "fffffffff",
                             x, y, z, a, b, c, u, v, w);
     if(result == NULL) interp_error ++;
     Py_XDECREF(result);
@@ -490,7 +1119,7 @@ void RIGID_TAP(int line_number,
     maybe_new_line(line_number);
     if(interp_error) return;
     PyObject *result =
-        callmethod(callback, "rigid_tap", "fff",
+        callstate(callback, "rigid_tap", "fff",
             x, y, z);
     if(result == NULL) interp_error ++;
     Py_XDECREF(result);
@@ -549,7 +1178,7 @@ static void user_defined_function(int num, double arg1, double arg2) {
     if(interp_error) return;
     maybe_new_line();
     PyObject *result =
-        callmethod(callback, "user_defined_function",
+        callstate(callback, "user_defined_function",
                             "idd", num, arg1, arg2);
     if(result == NULL) interp_error++;
     Py_XDECREF(result);
@@ -681,13 +1310,139 @@ CANON_MOTION_MODE GET_EXTERNAL_MOTION_CONTROL_MODE() { return motion_mode; }
 void SET_NAIVECAM_TOLERANCE(double tolerance) { }
 
 #define RESULT_OK (result == INTERP_OK || result == INTERP_EXECUTE_FINISH)
+/* Interpreter state for parallel preview (see rs274.parallel): everything
+ * that can change how the rest of a program is interpreted, except the
+ * current position and line number.  Two runs that reach a line with the
+ * same state produce the same moves from there on, once a move to an
+ * absolute position has been made. */
+template<class T> static void state_add(std::string &b, const T &v) {
+    b.append((const char*)&v, sizeof(v));
+}
+
+template<class T> static void state_add(std::string &b, const T *v, int n) {
+    b.append((const char*)v, n * sizeof(*v));
+}
+
+static void state_add(std::string &b, const char *str) {
+    b.append(str ? str : "");
+    b.push_back(0);
+}
+
+static PyObject *interp_state(Interp *ip) {
+    setup &s = ip->_setup;
+    std::string b;
+    // element 0 of the active codes is the line number
+    state_add(b, s.active_g_codes + 1, ACTIVE_G_CODES - 1);
+    state_add(b, s.active_m_codes + 1, ACTIVE_M_CODES - 1);
+    state_add(b, s.active_settings + 1, ACTIVE_SETTINGS - 1);
+    // 5420-5428 are the current position
+    state_add(b, s.parameters, 5420);
+    state_add(b, s.parameters + 5429, RS274NGC_MAX_PARAMETERS - 5429);
+    parameter_map &named = s.sub_context[0].named_params;
+    for(parameter_map::iterator it = named.begin(); it != named.end(); ++it) {
+        state_add(b, it->first);
+        state_add(b, it->second.attr);
+        if(!(it->second.attr & (PA_USE_LOOKUP | PA_PYTHON)))
+            state_add(b, it->second.value);
+    }
+    b.push_back(0);
+    for(offset_map_type::iterator it = s.offset_map.begin();
+            it != s.offset_map.end(); ++it)
+        state_add(b, it->first);
+    b.push_back(0);
+    state_add(b, s.current_pocket);
+    state_add(b, s.selected_pocket);
+    state_add(b, s.selected_tool);
+    state_add(b, s.tool_offset);
+    for(int i = 0; i < s.pockets_max && i < CANON_POCKETS_MAX; i++) {
+        const CANON_TOOL_TABLE &t = s.tool_table[i];
+        state_add(b, t.toolno);
+        state_add(b, t.offset);
+        state_add(b, t.diameter);
+        state_add(b, t.frontangle);
+        state_add(b, t.backangle);
+        state_add(b, t.orientation);
+    }
+    state_add(b, s.cutter_comp_side);
+    state_add(b, s.cutter_comp_radius);
+    state_add(b, s.cutter_comp_orientation);
+    state_add(b, s.cycle_cc); state_add(b, s.cycle_i);
+    state_add(b, s.cycle_j); state_add(b, s.cycle_k);
+    state_add(b, s.cycle_l); state_add(b, s.cycle_p);
+    state_add(b, s.cycle_q); state_add(b, s.cycle_r);
+    state_add(b, s.cycle_il); state_add(b, s.cycle_il_flag);
+    state_add(b, s.arc_not_allowed);
+    state_add(b, s.toolchange_flag);
+    state_add(b, s.probe_flag);
+    state_add(b, s.traverse_rate);
+    state_add(b, s.lathe_diameter_mode);
+    // the canon state mirrored for native preview
+    state_add(b, preview.first_move);
+    state_add(b, preview.suppress);
+    state_add(b, preview.feedrate);
+    state_add(b, preview.to, 3);
+    state_add(b, preview.g5x_offset, 9);
+    state_add(b, preview.g92_offset, 9);
+    state_add(b, preview.rotation_xy);
+    state_add(b, preview.plane);
+    return PyString_FromStringAndSize(b.data(), b.size());
+}
+
+// true if the next line can be run from the state alone, see interp_state
+static bool interp_resumable(Interp *ip) {
+    setup &s = ip->_setup;
+    return s.call_level == 0 && s.remap_level == 0
+        && !s.defining_sub && !s.skipping_o && !s.skipping_to_sub
+        && s.distance_mode == MODE_ABSOLUTE
+        && s.cutter_comp_side == CANON_SIDE_OFF
+        && preview.suppress <= 0;
+}
+
+static PyObject *rs274_state(PyObject *self, PyObject *args) {
+    Interp *ip = dynamic_cast<Interp*>(pinterp);
+    if(!ip) Py_RETURN_NONE;
+    PyObject *blob = interp_state(ip);
+    if(!blob) return NULL;
+    return Py_BuildValue("(NO)", blob,
+            interp_resumable(ip) ? Py_True : Py_False);
+}
+
+// clear the moves so far and tell the canon the state at this line
+static void mark_state(Interp *ip) {
+    if(preview.active) {
+        Segments *lists[3] = {preview.traverse, preview.feed, preview.arcfeed};
+        for(int i = 0; i < 3; i++) {
+            if(lists[i]->exports) {
+                PyErr_SetString(PyExc_BufferError,
+                    "gcode.segments: cannot change while a buffer is exported");
+                interp_error++;
+                return;
+            }
+            lists[i]->data->clear();
+        }
+    }
+    PyObject *state = rs274_state(NULL, NULL);
+    if(!state) { interp_error++; return; }
+    PyObject *result = callstate(callback, "mark_state", "O", state);
+    Py_DECREF(state);
+    if(result == NULL) interp_error++;
+    Py_XDECREF(result);
+}
+
 static PyObject *parse_file(PyObject *self, PyObject *args) {
     char *f;
     char *unitcode=0, *initcode=0, *interpname=0;
     int error_line_offset = 0;
     struct timeval t0, t1;
     int wait = 1;
-    if(!PyArg_ParseTuple(args, "sO|sss", &f, &callback, &unitcode, &initcode, &interpname))
+    PyObject *skip = Py_None;
+    int skip_from = 0, skip_to = 0, mark = 0, stop = 0;
+    if(!PyArg_ParseTuple(args, "sO|sssOii", &f, &callback, &unitcode, &initcode, &interpname, &skip, &mark, &stop))
+        return NULL;
+    // skip=(from_line, to_line): continue at to_line instead of reading
+    // from_line; mark and stop act before reading that line
+    if(skip != Py_None && !PyArg_ParseTuple(skip, "ii:parse skip",
+                &skip_from, &skip_to))
         return NULL;
 
     if(pinterp) {
@@ -699,6 +1454,16 @@ static PyObject *parse_file(PyObject *self, PyObject *args) {
     if(!pinterp)
         pinterp = new Interp;
 
+    Interp *ip = 0;
+    if(skip_from || mark || stop) {
+        ip = dynamic_cast<Interp*>(pinterp);
+        if(!ip) {
+            PyErr_SetString(PyExc_ValueError,
+                "gcode.parse: skip, mark and stop need the built-in interpreter");
+            return NULL;
+        }
+    }
+
     for(int i=0; i<USER_DEFINED_FUNCTION_NUM; i++) 
         USER_DEFINED_FUNCTION[i] = user_defined_function;
 
@@ -711,6 +1476,7 @@ static PyObject *parse_file(PyObject *self, PyObject *args) {
     _pos_x = _pos_y = _pos_z = _pos_a = _pos_b = _pos_c = 0;
     _pos_u = _pos_v = _pos_w = 0;
 
+    preview_begin();
     interp_new.init();
     interp_new.open(f);
 
@@ -728,11 +1494,33 @@ static PyObject *parse_file(PyObject *self, PyObject *args) {
         result = interp_new.execute();
     }
     while(!interp_error && RESULT_OK) {
+        if(ip && ip->_setup.call_level == 0
+                && !ip->_setup.defining_sub && !ip->_setup.skipping_o) {
+            int next = ip->_setup.sequence_number + 1;
+            if(next == skip_from) {
+                if(ip->_setup.file_pointer->seek_line(skip_to) < 0) {
+                    PyErr_SetFromErrno(PyExc_IOError);
+                    interp_error++;
+                    break;
+                }
+                ip->_setup.sequence_number = skip_to - 1;
+                next = skip_to;
+            }
+            if(next == stop) break;
+            if(next == mark) {
+                mark_state(ip);
+                if(interp_error) break;
+            }
+        }
         error_line_offset = 1;
         result = interp_new.read();
         gettimeofday(&t1, NULL);
         if(t1.tv_sec > t0.tv_sec + wait) {
-            if(check_abort()) return NULL;
+            preview_flush();
+            if(interp_error || check_abort()) {
+                interp_error++;
+                break;
+            }
             t0 = t1;
         }
         if(!RESULT_OK) break;
@@ -741,6 +1529,7 @@ static PyObject *parse_file(PyObject *self, PyObject *args) {
     }
 out_error:
     if(pinterp) pinterp->close();
+    preview_end();
     if(interp_error) {
         if(!PyErr_Occurred()) {
             PyErr_Format(PyExc_RuntimeError,
@@ -778,26 +1567,37 @@ static PyObject *rs274_calc_extents(PyObject *self, PyObject *args) {
         if(!si) return NULL;
         int j;
         double xs, ys, zs, xe, ye, ze, xt, yt, zt;
+        bool packed = PyObject_TypeCheck(si, &SegmentsType);
         for(j=0; j<PySequence_Length(si); j++) {
-            PyObject *sj = PySequence_GetItem(si, j);
-            PyObject *unused;
-            int r;
-            if(PyTuple_Size(sj) == 4)
-                r = PyArg_ParseTuple(sj,
-                    "O(dddOOOOOO)(dddOOOOOO)(ddd):calc_extents item",
-                    &unused,
-                    &xs, &ys, &zs, &unused, &unused, &unused, &unused, &unused, &unused,
-                    &xe, &ye, &ze, &unused, &unused, &unused, &unused, &unused, &unused,
-                    &xt, &yt, &zt);
-            else
-                r = PyArg_ParseTuple(sj,
-                    "O(dddOOOOOO)(dddOOOOOO)O(ddd):calc_extents item",
-                    &unused,
-                    &xs, &ys, &zs, &unused, &unused, &unused, &unused, &unused, &unused,
-                    &xe, &ye, &ze, &unused, &unused, &unused, &unused, &unused, &unused,
-                    &unused, &xt, &yt, &zt);
-            Py_DECREF(sj);
-            if(!r) return NULL;
+            if(packed) {
+                const double *r = &(*((Segments*)si)->data)[j * PREVIEW_SEGMENT_SIZE];
+                xs = r[PREVIEW_SEGMENT_START]; ys = r[PREVIEW_SEGMENT_START+1];
+                zs = r[PREVIEW_SEGMENT_START+2];
+                xe = r[PREVIEW_SEGMENT_END]; ye = r[PREVIEW_SEGMENT_END+1];
+                ze = r[PREVIEW_SEGMENT_END+2];
+                xt = r[PREVIEW_SEGMENT_TLO]; yt = r[PREVIEW_SEGMENT_TLO+1];
+                zt = r[PREVIEW_SEGMENT_TLO+2];
+            } else {
+                PyObject *sj = PySequence_GetItem(si, j);
+                PyObject *unused;
+                int r;
+                if(PyTuple_Size(sj) == 4)
+                    r = PyArg_ParseTuple(sj,
+                        "O(dddOOOOOO)(dddOOOOOO)(ddd):calc_extents item",
+                        &unused,
+                        &xs, &ys, &zs, &unused, &unused, &unused, &unused, &unused, &unused,
+                        &xe, &ye, &ze, &unused, &unused, &unused, &unused, &unused, &unused,
+                        &xt, &yt, &zt);
+                else
+                    r = PyArg_ParseTuple(sj,
+                        "O(dddOOOOOO)(dddOOOOOO)O(ddd):calc_extents item",
+                        &unused,
+                        &xs, &ys, &zs, &unused, &unused, &unused, &unused, &unused, &unused,
+                        &xe, &ye, &ze, &unused, &unused, &unused, &unused, &unused, &unused,
+                        &unused, &xt, &yt, &zt);
+                Py_DECREF(sj);
+                if(!r) return NULL;
+            }
             max_x = std::max(max_x, xs);
             max_y = std::max(max_y, ys);
             max_z = std::max(max_z, zs);
@@ -871,24 +1671,11 @@ static bool get_attr(PyObject *o, const char *attr_name, const char *fmt, ...) {
     return result;
 }
 
-static void unrotate(double &x, double &y, double c, double s) {
-    double tx = x * c + y * s;
-    y = -x * s + y * c;
-    x = tx;
-}
-
-static void rotate(double &x, double &y, double c, double s) {
-    double tx = x * c - y * s;
-    y = x * s + y * c;
-    x = tx;
-}
-
 static PyObject *rs274_arc_to_segments(PyObject *self, PyObject *args) {
     PyObject *canon;
     double x1, y1, cx, cy, z1, a, b, c, u, v, w;
-    double o[9], n[9], g5xoffset[9], g92offset[9];
+    double o[9], g5xoffset[9], g92offset[9];
     int rot, plane;
-    int X, Y, Z;
     double rotation_cos, rotation_sin;
     int max_segments = 128;
 
@@ -919,72 +1706,18 @@ static PyObject *rs274_arc_to_segments(PyObject *self, PyObject *args) {
     if(!get_attr(canon, "g92_offset_v", &g92offset[7])) return NULL;
     if(!get_attr(canon, "g92_offset_w", &g92offset[8])) return NULL;
 
-    if(plane == 1) {
-        X=0; Y=1; Z=2;
-    } else if(plane == 3) {
-        X=2; Y=0; Z=1;
-    } else {
-        X=1; Y=2; Z=0;
-    }
-    n[X] = x1;
-    n[Y] = y1;
-    n[Z] = z1;
-    n[3] = a;
-    n[4] = b;
-    n[5] = c;
-    n[6] = u;
-    n[7] = v;
-    n[8] = w;
-    for(int ax=0; ax<9; ax++) o[ax] -= g5xoffset[ax];
-    unrotate(o[0], o[1], rotation_cos, rotation_sin);
-    for(int ax=0; ax<9; ax++) o[ax] -= g92offset[ax];
-
-    double theta1 = atan2(o[Y]-cy, o[X]-cx);
-    double theta2 = atan2(n[Y]-cy, n[X]-cx);
-
-    if(rot < 0) {
-        while(theta2 - theta1 > -CIRCLE_FUZZ) theta2 -= 2*M_PI;
-    } else {
-        while(theta2 - theta1 < CIRCLE_FUZZ) theta2 += 2*M_PI;
-    }
+    std::vector<double> points;
+    arc_points(points, o, plane, rotation_cos, rotation_sin,
+            g5xoffset, g92offset, x1, y1, cx, cy, rot, z1,
+            a, b, c, u, v, w, max_segments);
 
-    // if multi-turn, add the right number of full circles
-    if(rot < -1) theta2 += 2*M_PI*(rot+1);
-    if(rot > 1) theta2 += 2*M_PI*(rot-1);
-
-    int steps = std::max(3, int(max_segments * fabs(theta1 - theta2) / M_PI));
-    double rsteps = 1. / steps;
+    int steps = points.size() / 9;
     PyObject *segs = PyList_New(steps);
-
-    double dtheta = theta2 - theta1;
-    double d[9] = {0, 0, 0, n[3]-o[3], n[4]-o[4], n[5]-o[5], n[6]-o[6], n[7]-o[7], n[8]-o[8]};
-    d[Z] = n[Z] - o[Z];
-
-    double tx = o[X] - cx, ty = o[Y] - cy, dc = cos(dtheta*rsteps), ds = sin(dtheta*rsteps);
-    for(int i=0; i<steps-1; i++) {
-        double f = (i+1) * rsteps;
-        double p[9];
-        rotate(tx, ty, dc, ds);
-        p[X] = tx + cx;
-        p[Y] = ty + cy;
-        p[Z] = o[Z] + d[Z] * f;
-        p[3] = o[3] + d[3] * f;
-        p[4] = o[4] + d[4] * f;
-        p[5] = o[5] + d[5] * f;
-        p[6] = o[6] + d[6] * f;
-        p[7] = o[7] + d[7] * f;
-        p[8] = o[8] + d[8] * f;
-        for(int ax=0; ax<9; ax++) p[ax] += g92offset[ax];
-        rotate(p[0], p[1], rotation_cos, rotation_sin);
-        for(int ax=0; ax<9; ax++) p[ax] += g5xoffset[ax];
+    for(int i=0; i<steps; i++) {
+        const double *p = &points[i*9];
         PyList_SET_ITEM(segs, i,
             Py_BuildValue("ddddddddd", p[0], p[1], p[2], p[3], p[4], p[5], p[6], p[7], p[8]));
     }
-    for(int ax=0; ax<9; ax++) n[ax] += g92offset[ax];
-    rotate(n[0], n[1], rotation_cos, rotation_sin);
-    for(int ax=0; ax<9; ax++) n[ax] += g5xoffset[ax];
-    PyList_SET_ITEM(segs, steps-1,
-        Py_BuildValue("ddddddddd", n[0], n[1], n[2], n[3], n[4], n[5], n[6], n[7], n[8]));
     return segs;
 }
 
@@ -996,6 +1729,8 @@ static PyMethodDef gcode_methods[] = {
         "Calculate information about extents of gcode"},
     {"arc_to_segments", (PyCFunction)rs274_arc_to_segments, METH_VARARGS,
         "Convert an arc to straight segments"},
+    {"state", (PyCFunction)rs274_state, METH_NOARGS,
+        "Fingerprint of the interpreter state, and whether it is resumable"},
     {NULL}
 };
 
@@ -1005,9 +1740,14 @@ initgcode(void) {
                 "Interface to EMC rs274ngc interpreter");
     PyType_Ready(&LineCodeType);
     PyModule_AddObject(m, "linecode", (PyObject*)&LineCodeType);
+    PyType_Ready(&SegmentsType);
+    PyModule_AddObject(m, "segments", (PyObject*)&SegmentsType);
     PyObject_SetAttrString(m, "MAX_ERROR", PyInt_FromLong(maxerror));
     PyObject_SetAttrString(m, "MIN_ERROR",
             PyInt_FromLong(INTERP_MIN_ERROR));
+    PyObject_SetAttrString(m, "INTERP_OK", PyInt_FromLong(INTERP_OK));
+    PyObject_SetAttrString(m, "INTERP_EXECUTE_FINISH",
+            PyInt_FromLong(INTERP_EXECUTE_FINISH));
 }
 
 // vim:ts=8:sts=4:sw=4:et:
@@ -0,0 +1,224 @@
+/********************************************************************
+* Description: interp_file.cc
+*
+*   NC code files read into memory for the interpreter, see interp_file.hh.
+*
+* License: GPL Version 2
+* System: Linux
+*
+********************************************************************/
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "interp_file.hh"
+
+// unused file contents kept for reopening
+#define NGC_FILE_CACHE 32
+
+struct NgcFile::mapping {
+    unsigned long id;
+    std::string filename;
+    dev_t dev;
+    ino_t ino;
+    off_t size;
+    struct timespec mtime;
+    const char *data;
+    size_t len;
+    bool cached;                // still in the cache
+    int refs;
+    std::vector<size_t> index;  // offset of the start of each line
+};
+
+typedef std::map<std::string, NgcFile::mapping *> mapping_cache;
+static mapping_cache cache;
+static unsigned long last_id;
+
+static bool same_file(const NgcFile::mapping *m, const struct stat &st)
+{
+    return m->dev == st.st_dev && m->ino == st.st_ino
+        && m->size == st.st_size
+        && m->mtime.tv_sec == st.st_mtim.tv_sec
+        && m->mtime.tv_nsec == st.st_mtim.tv_nsec;
+}
+
+static void free_mapping(NgcFile::mapping *m)
+{
+    delete[] m->data;
+    delete m;
+}
+
+static void uncache(NgcFile::mapping *m)
+{
+    cache.erase(m->filename);
+    m->cached = false;
+    if (m->refs == 0)
+        free_mapping(m);
+}
+
+// drop unused file contents beyond NGC_FILE_CACHE
+static void trim_cache()
+{
+    mapping_cache::iterator it = cache.begin();
+    while (cache.size() > NGC_FILE_CACHE && it != cache.end()) {
+        NgcFile::mapping *m = (it++)->second;
+        if (m->refs == 0)
+            uncache(m);
+    }
+}
+
+// Read the whole file, however long it turns out to be.  The file is not
+// mapped: if it were truncated while open, touching the lost pages would
+// raise SIGBUS in the interpreter.
+static bool read_all(int fd, off_t size_hint, NgcFile::mapping *m)
+{
+    std::vector<char> buf;
+    char block[65536];
+    if (size_hint > 0)
+        buf.reserve(size_hint);
+    ssize_t n;
+    while ((n = read(fd, block, sizeof(block))) != 0) {
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        buf.insert(buf.end(), block, block + n);
+    }
+    char *data = new char[buf.size() + 1];
+    if (!buf.empty())
+        memcpy(data, &buf[0], buf.size());
+    m->data = data;
+    m->len = buf.size();
+    return true;
+}
+
+static NgcFile::mapping *load(const char *filename)
+{
+    int fd = ::open(filename, O_RDONLY);
+    if (fd < 0)
+        return NULL;
+    struct stat st;
+    if (fstat(fd, &st) < 0) {
+        int e = errno;
+        ::close(fd);
+        errno = e;
+        return NULL;
+    }
+    NgcFile::mapping *m = new NgcFile::mapping;
+    m->id = ++last_id;
+    m->filename = filename;
+    m->dev = st.st_dev;
+    m->ino = st.st_ino;
+    m->size = st.st_size;
+    m->mtime = st.st_mtim;
+    m->cached = false;
+    m->refs = 0;
+    m->data = NULL;
+    m->len = 0;
+    bool ok = read_all(fd, S_ISREG(st.st_mode) ? st.st_size : 0, m);
+    int e = errno;
+    ::close(fd);
+    if (!ok) {
+        delete m;
+        errno = e;
+        return NULL;
+    }
+
+    m->index.push_back(0);
+    for (const char *p = m->data, *end = m->data + m->len;
+         (p = (const char *) memchr(p, '\n', end - p)) != NULL && ++p < end;)
+        m->index.push_back(p - m->data);
+
+    // only regular files are the same file when opened again
+    if (S_ISREG(st.st_mode)) {
+        trim_cache();
+        cache[m->filename] = m;
+        m->cached = true;
+    }
+    return m;
+}
+
+NgcFile *NgcFile::open(const char *filename)
+{
+    mapping *m = NULL;
+    mapping_cache::iterator it = cache.find(filename);
+    if (it != cache.end()) {
+        struct stat st;
+        if (stat(filename, &st) == 0 && same_file(it->second, st))
+            m = it->second;
+        else
+            uncache(it->second);
+    }
+    if (!m && !(m = load(filename)))
+        return NULL;
+    m->refs++;
+    return new NgcFile(m);
+}
+
+void NgcFile::close()
+{
+    if (--map->refs == 0 && !map->cached)
+        free_mapping(map);
+    delete this;
+}
+
+char *NgcFile::gets(char *buf, int size)
+{
+    if (size <= 0 || pos >= map->len)
+        return NULL;
+    size_t n = map->len - pos;
+    if (n > (size_t) size - 1)
+        n = size - 1;
+    const char *start = map->data + pos;
+    const char *nl = (const char *) memchr(start, '\n', n);
+    if (nl)
+        n = nl - start + 1;
+    memcpy(buf, start, n);
+    buf[n] = 0;
+    pos += n;
+    return buf;
+}
+
+int NgcFile::getc()
+{
+    if (pos >= map->len)
+        return EOF;
+    return (unsigned char) map->data[pos++];
+}
+
+int NgcFile::seek(long offset)
+{
+    if (offset < 0) {
+        errno = EINVAL;
+        return -1;
+    }
+    pos = offset;
+    return 0;
+}
+
+int NgcFile::lines() const
+{
+    return map->len ? map->index.size() : 0;
+}
+
+unsigned long NgcFile::id() const
+{
+    return map->id;
+}
+
+int NgcFile::seek_line(int line)
+{
+    if (line < 1 || line > lines()) {
+        errno = EINVAL;
+        return -1;
+    }
+    pos = map->index[line - 1];
+    return 0;
+}
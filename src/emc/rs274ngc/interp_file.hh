@@ -0,0 +1,55 @@
+/********************************************************************
+* Description: interp_file.hh
+*
+*   NC code files read into memory for the interpreter.
+*
+* License: GPL Version 2
+* System: Linux
+*
+********************************************************************/
+#ifndef INTERP_FILE_HH
+#define INTERP_FILE_HH
+
+#include <stddef.h>
+
+/* An open NC code file.  The file is read into memory once and the start
+ * of every line is indexed, so reading a line, ftell/fseek style seeks for
+ * o-word control flow and returning from a subroutine file do not go
+ * through stdio or make system calls.
+ *
+ * The contents are shared: opening a regular file again while an unchanged
+ * copy of it exists (checked with stat) reuses that copy and its index.
+ * Files are read rather than mapped, so a program that is truncated or
+ * rewritten while it runs can't crash the interpreter. */
+class NgcFile {
+public:
+    // returns NULL and sets errno if filename cannot be opened
+    static NgcFile *open(const char *filename);
+    // frees this NgcFile; the contents may stay cached for the next open
+    void close();
+
+    // like fgets(3) and fgetc(3)
+    char *gets(char *buf, int size);
+    int getc();
+
+    // like ftell(3) and fseek(3) with SEEK_SET
+    long tell() const { return pos; }
+    int seek(long offset);
+
+    // number of lines, and position at the start of line (counting from 1)
+    int lines() const;
+    int seek_line(int line);
+
+    // differs between files, and between versions of a changed file
+    unsigned long id() const;
+
+    struct mapping;
+
+private:
+    NgcFile(mapping *m) : map(m), pos(0) {}
+    ~NgcFile() {}
+    mapping *map;
+    size_t pos;
+};
+
+#endif
@@ -327,16 +327,56 @@ Side effects:
    One RS274 line is read into a block and the block is checked for
    errors. System parameters may be reset.
 
+A line read from a file (from_file, with block->offset set to where it
+starts) that neither uses parameters nor has a semicolon comment nor is
+an o-word line reads the same every time.  If it is likely to be read
+again, because it is in a subroutine or is already being read a second
+time (a loop came back to it), the block read_items makes of it is kept
+in settings->block_cache and used instead of reading the line the next
+time.  Lines of a program that runs straight through are never cached.
+
 Called by:  Interp::read
 
 */
 
 int Interp::parse_line(char *line,       //!< array holding a line of RS274 code  
                       block_pointer block,      //!< pointer to a block to be filled     
-                      setup_pointer settings)   //!< pointer to machine settings         
+                      setup_pointer settings,   //!< pointer to machine settings         
+                      bool from_file)   //!< line was read at block->offset in the open file
 {
-  CHP(init_block(block));
-  CHP(read_items(block, line, settings->parameters));
+  bool cacheable = from_file && settings->file_pointer
+    && !settings->skipping_o && !strpbrk(line, "#;");
+  std::pair<unsigned long, long> key;
+  block_cache_type::iterator cached = settings->block_cache.end();
+  if (cacheable) {
+    key = std::make_pair(settings->file_pointer->id(), block->offset);
+    long &read_mark = settings->block_read_mark[key.first];
+    bool read_before = block->offset < read_mark;
+    if (!read_before)
+      read_mark = block->offset + 1;
+    cacheable = read_before || settings->call_level > 0;
+  }
+  if (cacheable) {
+    cached = settings->block_cache.find(key);
+    if (cached != settings->block_cache.end() &&
+        cached->second.lathe_diameter_mode != settings->lathe_diameter_mode)
+      cached = settings->block_cache.end();
+  }
+  if (cached != settings->block_cache.end()) {
+    *block = cached->second.read;
+  } else {
+    CHP(init_block(block));
+    CHP(read_items(block, line, settings->parameters));
+    if (cacheable && block->o_type == O_none) {
+      if (settings->block_cache.size() >= MAX_CACHED_BLOCKS) {
+        settings->block_cache.clear();
+        settings->block_read_mark.clear();
+      }
+      block_cache_entry &entry = settings->block_cache[key];
+      entry.lathe_diameter_mode = settings->lathe_diameter_mode;
+      entry.read = *block;
+    }
+  }
 
   if(settings->skipping_o == 0)
   {
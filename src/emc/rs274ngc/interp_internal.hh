@@ -19,13 +19,16 @@
 #include "config.h"
 #include <limits.h>
 #include <stdio.h>
+#include <sys/stat.h>
 #include <set>
 #include <map>
+#include <string>
 #include <bitset>
 #include "canon.hh"
 #include "emcpos.h"
 #include "libintl.h"
 #include "python_plugin.hh"
+#include "interp_file.hh"
 
 
 #define _(s) gettext(s)
@@ -538,6 +541,27 @@ enum retopts { RET_NONE, RET_DOUBLE, RET_INT, RET_YIELD, RET_STOPITERATION, RET_
 
 typedef block *block_pointer;
 
+class IniFile;
+
+// blocks as read_items left them, for lines read again from a file
+// (loops, subroutines); keyed by NgcFile::id and the line's offset
+typedef struct block_cache_entry_struct {
+    bool lathe_diameter_mode;   // read_x depends on it
+    block read;
+} block_cache_entry;
+typedef std::map<std::pair<unsigned long, long>, block_cache_entry> block_cache_type;
+// per NgcFile::id, the offset just past the start of the furthest line read
+typedef std::map<unsigned long, long> block_read_mark_type;
+#define MAX_CACHED_BLOCKS 10000
+
+// where #<_hal[...]> names were found; valid as long as no HAL name went
+// away (hal_data->name_generation unchanged), see fetch_hal_param
+typedef struct hal_cache_entry_struct {
+    int kind;                   // HAL_NAME_PIN, HAL_NAME_SIG or HAL_NAME_PARAM
+    void *obj;
+} hal_cache_entry;
+typedef std::map<std::string, hal_cache_entry> hal_cache_type;
+
 // parameters will go to a std::map<const char *,paramter_value_pointer>
 typedef struct parameter_value_struct {
     double value;
@@ -684,7 +708,7 @@ typedef struct setup_struct
   bool feed_override;         // whether feed override is enabled
   double feed_rate;             // feed rate in current units/min
   char filename[PATH_MAX];      // name of currently open NC code file
-  FILE *file_pointer;           // file pointer for open NC code file
+  NgcFile *file_pointer;        // open NC code file
   bool flood;                 // whether flood coolant is on
   CANON_UNITS length_units;     // millimeters or inches
   double center_arc_radius_tolerance_inch; // modify with ini setting
@@ -750,6 +774,12 @@ typedef struct setup_struct
   context sub_context[INTERP_SUB_ROUTINE_LEVELS];
   int call_state;                  //  enum call_states - inidicate Py handler reexecution
   offset_map_type offset_map;      // store label x name, file, line
+  block_cache_type block_cache;    // see parse_line
+  block_read_mark_type block_read_mark; // see parse_line
+  IniFile *ini_file;               // open for #<_ini[...]>, see fetch_ini_param
+  struct stat ini_stat;            // of ini_file when it was opened
+  hal_cache_type hal_cache;        // see fetch_hal_param
+  unsigned long hal_generation;    // hal_data->name_generation of hal_cache
 
   bool adaptive_feed;              // adaptive feed is enabled
   bool feed_hold;                  // feed hold is enabled
@@ -168,6 +168,44 @@ int Interp::read_named_parameter(
     return INTERP_OK;
 }
 
+// the ini file for #<_ini[section]name> lookups.  It is kept open as
+// long as it does not change on disk; when it does, the values taken
+// from the old version are dropped so they are looked up again.
+IniFile *Interp::ini_param_file(const char *iniFileName)
+{
+    struct stat st;
+    if (stat(iniFileName, &st) != 0)
+	st.st_ino = 0;
+    if (_setup.ini_file && st.st_ino
+	&& st.st_dev == _setup.ini_stat.st_dev
+	&& st.st_ino == _setup.ini_stat.st_ino
+	&& st.st_size == _setup.ini_stat.st_size
+	&& st.st_mtim.tv_sec == _setup.ini_stat.st_mtim.tv_sec
+	&& st.st_mtim.tv_nsec == _setup.ini_stat.st_mtim.tv_nsec)
+	return _setup.ini_file;
+
+    if (_setup.ini_file) {
+	logNP("ini file '%s' changed, dropping cached values", iniFileName);
+	delete _setup.ini_file;
+	_setup.ini_file = NULL;
+	parameter_map &globals = _setup.sub_context[0].named_params;
+	for (parameter_map_iterator pi = globals.begin(); pi != globals.end();) {
+	    if (pi->second.attr & PA_FROM_INI)
+		globals.erase(pi++);
+	    else
+		++pi;
+	}
+    }
+    IniFile *inifile = new IniFile();
+    if (!inifile->Open(iniFileName)) {
+	delete inifile;
+	return NULL;
+    }
+    _setup.ini_file = inifile;
+    _setup.ini_stat = st;
+    return inifile;
+}
+
 // if the variable is of the form '_ini[section]name', then treat it as
 // an inifile  variable. Lookup section/name and cache the value
 // as global and read-only.
@@ -181,7 +219,7 @@ int Interp::fetch_ini_param( const char *nameBuf, int *status, double *value)
      if ((n > 7) &&
 	((s = (char *) strchr(&nameBuf[6],']')) != NULL)) {
 
-	IniFile inifile;
+	IniFile *inifile;
 	const char *iniFileName;
 	int retval;
 	int closeBracket = s - nameBuf;
@@ -191,7 +229,7 @@ int Interp::fetch_ini_param( const char *nameBuf, int *status, double *value)
 	    *status = 0;
 	    return INTERP_OK;
 	}
-	if (!inifile.Open(iniFileName)) {
+	if ((inifile = ini_param_file(iniFileName)) == NULL) {
 	    *status = 0;
 	    ERS(_("cant open ini file '%s'"), iniFileName);
 	}
@@ -204,11 +242,9 @@ int Interp::fetch_ini_param( const char *nameBuf, int *status, double *value)
 	    *p = toupper(*p);
 	capName[closeBracket] = '\0';
 
-	if ((retval = inifile.Find( value, &capName[closeBracket+1], &capName[5])) == 0) {
+	if ((retval = inifile->Find( value, &capName[closeBracket+1], &capName[5])) == 0) {
 	    *status = 1;
-	    inifile.Close();
 	} else {
-	    inifile.Close();
 	    *status = 0;
 	    ERS(_("Named ini parameter #<%s> not found in inifile '%s': error=0x%x"),
 		nameBuf, iniFileName, retval);
@@ -219,7 +255,7 @@ int Interp::fetch_ini_param( const char *nameBuf, int *status, double *value)
 
 // if the variable is of the form '_hal[hal_name]', then treat it as
 // a HAL pin, signal or param. Lookup value, convert to float, and export as global and read-only.
-// do not cache.
+// do not cache the value.
 // the shortest possible ini variable is '_hal[x]' or 7 chars long .
 int Interp::fetch_hal_param( const char *nameBuf, int *status, double *value)
 {
@@ -254,15 +290,35 @@ int Interp::fetch_hal_param( const char *nameBuf, int *status, double *value)
 	    *status = 0;
 	    ERS("%s: trailing garbage after closing bracket", nameBuf);
 	}
-	// the result of these lookups could be cached in the parameter struct, but I'm not sure
-	// this is a good idea - a removed pin/signal will not be noticed
-
-	// I dont think that's needed - no change in pins/sigs/params
-	// rtapi_mutex_get(&(hal_data->mutex)); 
-        // rtapi_mutex_give(&(hal_data->mutex));
+	// where a name was found is remembered until a HAL name goes away
+	// (pin, signal or param deleted or aliased), which changes the
+	// generation; the data pointer is taken from the object every time
+	// since pins can be linked and unlinked.
+	// no locking, like the lookups before: nothing is changed here
+	if (_setup.hal_generation != hal_data->name_generation) {
+	    _setup.hal_cache.clear();
+	    _setup.hal_generation = hal_data->name_generation;
+	}
+	hal_cache_type::iterator cached = _setup.hal_cache.find(hal_name);
+	if (cached == _setup.hal_cache.end()) {
+	    hal_cache_entry entry;
+	    if ((entry.obj = halpr_find_pin_by_name(hal_name)) != NULL)
+		entry.kind = HAL_NAME_PIN;
+	    else if ((entry.obj = halpr_find_sig_by_name(hal_name)) != NULL)
+		entry.kind = HAL_NAME_SIG;
+	    else if ((entry.obj = halpr_find_param_by_name(hal_name)) != NULL)
+		entry.kind = HAL_NAME_PARAM;
+	    else {
+		*status = 0;
+		ERS("Named hal parameter #<%s> not found", nameBuf);
+	    }
+	    cached = _setup.hal_cache.insert(std::make_pair(std::string(hal_name), entry)).first;
+	}
 
-	if ((pin = halpr_find_pin_by_name(hal_name)) != NULL) {
-            if (pin && !pin->signal) {
+	switch (cached->second.kind) {
+	case HAL_NAME_PIN:
+	    pin = (hal_pin_t *) cached->second.obj;
+            if (!pin->signal) {
 		logOword("%s: no signal connected", hal_name);
 	    } 
 	    type = pin->type;
@@ -273,21 +329,19 @@ int Interp::fetch_hal_param( const char *nameBuf, int *status, double *value)
 		ptr = (hal_data_u *) &(pin->dummysig);
 	    }
 	    goto assign;
-	}
-	if ((sig = halpr_find_sig_by_name(hal_name)) != NULL) {
+	case HAL_NAME_SIG:
+	    sig = (hal_sig_t *) cached->second.obj;
 	    if (!sig->writers) 
 		logOword("%s: signal has no writer", hal_name);
 	    type = sig->type;
 	    ptr = (hal_data_u *) SHMPTR(sig->data_ptr);
 	    goto assign;
-	}
-	if ((param = halpr_find_param_by_name(hal_name)) != NULL) {
+	case HAL_NAME_PARAM:
+	    param = (hal_param_t *) cached->second.obj;
 	    type = param->type;
 	    ptr = (hal_data_u *) SHMPTR(param->data_ptr);
 	    goto assign;
 	}
-	*status = 0;
-	ERS("Named hal parameter #<%s> not found", nameBuf);
     }
     return INTERP_OK;
 
@@ -206,7 +206,7 @@ int Interp::execute_call(setup_pointer settings,
 	if (settings->file_pointer == NULL) {
 	    previous_frame->position = -1;
 	} else {
-	    previous_frame->position = ftell(settings->file_pointer);
+	    previous_frame->position = settings->file_pointer->tell();
 	}
 
 	// save return location
@@ -407,8 +407,8 @@ int Interp::execute_return(setup_pointer settings, context_pointer current_frame
 		}
 		//!!!KL must open the new file, if changed
 		if (0 != strcmp(settings->filename, previous_frame->filename))  {
-		    fclose(settings->file_pointer);
-		    settings->file_pointer = fopen(previous_frame->filename, "r");
+		    settings->file_pointer->close();
+		    settings->file_pointer = NgcFile::open(previous_frame->filename);
 		    if (settings->file_pointer == NULL)  {
 			ERS(NCE_CANNOT_REOPEN_FILE, 
 			    previous_frame->filename,
@@ -416,7 +416,7 @@ int Interp::execute_return(setup_pointer settings, context_pointer current_frame
 		    }
 		    strcpy(settings->filename, previous_frame->filename);
 		}
-		fseek(settings->file_pointer, previous_frame->position, SEEK_SET);
+		settings->file_pointer->seek(previous_frame->position);
 		settings->sequence_number = previous_frame->sequence_number;
 		logOword("endsub/return: %s:%d pos=%ld", 
 			 settings->filename,previous_frame->sequence_number,
@@ -473,7 +473,7 @@ int Interp::control_back_to( block_pointer block, // pointer to block
     static char name[] = "control_back_to";
     char newFileName[PATH_MAX+1];
     char tmpFileName[PATH_MAX+1];
-    FILE *newFP;
+    NgcFile *newFP;
     offset_map_iterator it;
     offset_pointer op;
 
@@ -489,12 +489,12 @@ int Interp::control_back_to( block_pointer block, // pointer to block
 	if (0 != strcmp(settings->filename,
 			op->filename)) {
 	    // open the new file...
-	    newFP = fopen(op->filename, "r");
+	    newFP = NgcFile::open(op->filename);
 	    // set the line number
 	    settings->sequence_number = 0;
             strncpy(settings->filename, op->filename, sizeof(settings->filename));
             if (settings->filename[sizeof(settings->filename)-1] != '\0') {
-                fclose(settings->file_pointer);
+                if (newFP) newFP->close();
                 logOword("filename too long: %s", op->filename);
                 ERS(NCE_UNABLE_TO_OPEN_FILE, op->filename);
             }
@@ -502,7 +502,7 @@ int Interp::control_back_to( block_pointer block, // pointer to block
 	    if (newFP) {
 		// close the old file...
 		if (settings->file_pointer) // only close if it was open
-		    fclose(settings->file_pointer);
+		    settings->file_pointer->close();
 		settings->file_pointer = newFP;
 	    } else {
 		logOword("Unable to open file: %s", settings->filename);
@@ -510,8 +510,7 @@ int Interp::control_back_to( block_pointer block, // pointer to block
 	    }
 	}
 	if (settings->file_pointer) { // only seek if it was open
-	    fseek(settings->file_pointer,
-		  op->offset, SEEK_SET);
+	    settings->file_pointer->seek(op->offset);
 	}
 	settings->sequence_number = op->sequence_number;
 	return INTERP_OK;
@@ -524,7 +523,7 @@ int Interp::control_back_to( block_pointer block, // pointer to block
 
 	// close the old file...
 	if (settings->file_pointer)
-	    fclose(settings->file_pointer);
+	    settings->file_pointer->close();
 	settings->file_pointer = newFP;
         strncpy(settings->filename, newFileName, sizeof(settings->filename));
         if (settings->filename[sizeof(settings->filename)-1] != '\0') {
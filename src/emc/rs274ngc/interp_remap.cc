@@ -439,10 +439,10 @@ int Interp::parse_remap(const char *inistring, int lineno)
 		errored = true;
 		continue;
 	    }
-	    FILE *fp = find_ngc_file(&_setup,arg);
+	    NgcFile *fp = find_ngc_file(&_setup,arg);
 	    if (fp) {
 		r.remap_ngc = strstore(arg);
-		fclose(fp);
+		fp->close();
 	    } else {
 		Error("NGC file not found: ngc=%s - %d:REMAP = %s",
 		      arg, lineno,inistring);
@@ -130,6 +130,8 @@ setup_struct::setup_struct() :
     value_returned(0),
     call_level(0),
     call_state(0),
+    ini_file(NULL),
+    hal_generation(0),
     adaptive_feed(0),
     feed_hold(0),
     loggingLevel(0),
@@ -167,6 +169,7 @@ setup_struct::setup_struct() :
     memset(log_file, 0, sizeof(log_file));
     memset(program_prefix, 0, sizeof(program_prefix));
     memset(wizard_root, 0, sizeof(wizard_root));
+    memset(&ini_stat, 0, sizeof(ini_stat));
     memset(tool_table, 0, sizeof(tool_table));
     ZERO_EMC_POSE(tool_offset);
 
@@ -0,0 +1,28 @@
+/********************************************************************
+* Description: preview_segments.hh
+*   Layout of the gcode.segments buffer shared between the preview
+*   interpreter (gcode.so) and the OpenGL helpers (linuxcnc.so).
+*
+* License: GPL Version 2
+* System: Linux
+*
+* Copyright (c) 2016 All rights reserved.
+*
+********************************************************************/
+#ifndef PREVIEW_SEGMENTS_HH
+#define PREVIEW_SEGMENTS_HH
+
+/* A gcode.segments object exports its moves as a read-only buffer of
+   doubles with shape (n, PREVIEW_SEGMENT_SIZE).  Each row is one move:
+   the line number, the 9-axis start and end points, the feed rate (0 for
+   traverses) and the x, y, z tool length offset in effect. */
+enum preview_segment_field {
+    PREVIEW_SEGMENT_LINE = 0,
+    PREVIEW_SEGMENT_START = 1,
+    PREVIEW_SEGMENT_END = 10,
+    PREVIEW_SEGMENT_FEED = 19,
+    PREVIEW_SEGMENT_TLO = 20,
+    PREVIEW_SEGMENT_SIZE = 23
+};
+
+#endif
@@ -132,6 +132,7 @@ public:
  int add_named_param(const char *nameBuf, int attr = 0);
  int fetch_ini_param( const char *nameBuf, int *status, double *value);
  int fetch_hal_param( const char *nameBuf, int *status, double *value);
+ IniFile *ini_param_file(const char *iniFileName);
 
     // common combination of add_named_param and store_named_param
     // int assign_named_param(const char *nameBuf, int attr = 0, double value = 0.0);
@@ -391,7 +392,7 @@ public:
                                 setup_pointer settings);
  int move_endpoint_and_flush(setup_pointer, double, double);
  int parse_line(char *line, block_pointer block,
-                      setup_pointer settings);
+                      setup_pointer settings, bool from_file = false);
  int precedence(int an_operator);
  int _read(const char *command);
  int read_a(char *line, int *counter, block_pointer block,
@@ -480,7 +481,7 @@ public:
                   double *parameters);
  int read_t(char *line, int *counter, block_pointer block,
                   double *parameters);
- int read_text(const char *command, FILE * inport, char *raw_line,
+ int read_text(const char *command, NgcFile * inport, char *raw_line,
                      char *line, int *length);
  int read_unary(char *line, int *counter, double *double_ptr,
                       double *parameters);
@@ -637,7 +638,7 @@ int read_inputs(setup_pointer settings);
 	       int calltype);
     int py_execute(const char *cmd, bool as_file = false); // for (py, ....) comments
     int py_reload();
-    FILE *find_ngc_file(setup_pointer settings,const char *basename, char *foundhere = NULL);
+    NgcFile *find_ngc_file(setup_pointer settings,const char *basename, char *foundhere = NULL);
 
     const char *getSavedError();
     // set error message text without going through printf format interpretation
@@ -156,6 +156,9 @@ Interp::Interp()
 
 Interp::~Interp() {
 
+    delete _setup.ini_file;
+    _setup.ini_file = NULL;
+
     if(log_file) {
         if(log_file != stderr)
             fclose(log_file);
@@ -229,7 +232,7 @@ int Interp::close()
     }
 
   if (_setup.file_pointer != NULL) {
-    fclose(_setup.file_pointer);
+    _setup.file_pointer->close();
     _setup.file_pointer = NULL;
     _setup.percent_flag = false;
   }
@@ -1321,15 +1324,18 @@ int Interp::open(const char *filename) //!< string: the name of the input NC-pro
     }
   CHKS((_setup.file_pointer != NULL), NCE_A_FILE_IS_ALREADY_OPEN);
   CHKS((strlen(filename) > (LINELEN - 1)), NCE_FILE_NAME_TOO_LONG);
-  _setup.file_pointer = fopen(filename, "r");
+  _setup.file_pointer = NgcFile::open(filename);
   CHKS((_setup.file_pointer == NULL), NCE_UNABLE_TO_OPEN_FILE, filename);
+  // drop #<_ini[...]> values if the ini file was edited since
+  if (_setup.ini_file && getenv("INI_FILE_NAME"))
+      ini_param_file(getenv("INI_FILE_NAME"));
   line = _setup.linetext;
   for (index = -1; index == -1;) {      /* skip blank lines */
-    CHKS((fgets(line, LINELEN, _setup.file_pointer) ==
+    CHKS((_setup.file_pointer->gets(line, LINELEN) ==
          NULL), NCE_FILE_ENDED_WITH_NO_PERCENT_SIGN);
     length = strlen(line);
     if (length == (LINELEN - 1)) {   // line is too long. need to finish reading the line to recover
-      for (; fgetc(_setup.file_pointer) != '\n';);      // could look for EOF
+      for (; _setup.file_pointer->getc() != '\n';);      // could look for EOF
       ERS(NCE_COMMAND_TOO_LONG);
     }
     for (index = (length - 1);  // index set on last char
@@ -1342,12 +1348,12 @@ int Interp::open(const char *filename) //!< string: the name of the input NC-pro
       _setup.sequence_number = 1;       // We have already read the first line
       // and we are not going back to it.
     } else {
-      fseek(_setup.file_pointer, 0, SEEK_SET);
+      _setup.file_pointer->seek(0);
       _setup.percent_flag = false;
       _setup.sequence_number = 0;       // Going back to line 0
     }
   } else {
-    fseek(_setup.file_pointer, 0, SEEK_SET);
+    _setup.file_pointer->seek(0);
     _setup.percent_flag = false;
     _setup.sequence_number = 0; // Going back to line 0
   }
@@ -1532,7 +1538,7 @@ int Interp::_read(const char *command)  //!< may be NULL or a string to read
 
   if(_setup.file_pointer)
   {
-      EXECUTING_BLOCK(_setup).offset = ftell(_setup.file_pointer);
+      EXECUTING_BLOCK(_setup).offset = _setup.file_pointer->tell();
   }
 
   read_status =
@@ -1549,7 +1555,8 @@ int Interp::_read(const char *command)  //!< may be NULL or a string to read
   if ((read_status == INTERP_EXECUTE_FINISH)
       || (read_status == INTERP_OK)) {
     if (_setup.line_length != 0) {
-	CHP(parse_line(_setup.blocktext, &(EXECUTING_BLOCK(_setup)), &_setup));
+	CHP(parse_line(_setup.blocktext, &(EXECUTING_BLOCK(_setup)), &_setup,
+		       command == NULL));
     }
 
     else // Blank line (zero length)
@@ -1612,13 +1619,13 @@ int Interp::unwind_call(int status, const char *file, int line, const char *func
 	// needed to make sure this works in rs274 -n 0 (continue on error) mode
 	if (sub->filename && sub->filename[0]) {
 	    if(0 != strcmp(_setup.filename, sub->filename)) {
-		fclose(_setup.file_pointer);
-		_setup.file_pointer = fopen(sub->filename, "r");
+		_setup.file_pointer->close();
+		_setup.file_pointer = NgcFile::open(sub->filename);
 		logDebug("unwind_call: reopening '%s' at %ld",
 			 sub->filename, sub->position);
 		strcpy(_setup.filename, sub->filename);
 	    }
-	    fseek(_setup.file_pointer, sub->position, SEEK_SET);
+	    _setup.file_pointer->seek(sub->position);
 	}
 	_setup.sequence_number = sub->sequence_number;
 	logDebug("unwind_call: setting sequence number=%d from frame %d",
@@ -2451,9 +2458,9 @@ int Interp::on_abort(int reason, const char *message)
 
 // spun out from interp_o_word so we can use it to test ngc file accessibility during
 // config file parsing (REMAP... ngc=<basename>)
-FILE *Interp::find_ngc_file(setup_pointer settings,const char *basename, char *foundhere )
+NgcFile *Interp::find_ngc_file(setup_pointer settings,const char *basename, char *foundhere )
 {
-    FILE *newFP;
+    NgcFile *newFP;
     char tmpFileName[PATH_MAX+1];
     char newFileName[PATH_MAX+1];
     char foundPlace[PATH_MAX+1];
@@ -2467,7 +2474,7 @@ FILE *Interp::find_ngc_file(setup_pointer settings,const char *basename, char *f
 
     // first look in the program_prefix place
     sprintf(newFileName, "%s/%s", settings->program_prefix, tmpFileName);
-    newFP = fopen(newFileName, "r");
+    newFP = NgcFile::open(newFileName);
 
     // then look in the subroutines place
     if (!newFP) {
@@ -2475,7 +2482,7 @@ FILE *Interp::find_ngc_file(setup_pointer settings,const char *basename, char *f
 	    if (!settings->subroutines[dct])
 		continue;
 	    sprintf(newFileName, "%s/%s", settings->subroutines[dct], tmpFileName);
-	    newFP = fopen(newFileName, "r");
+	    newFP = NgcFile::open(newFileName);
 	    if (newFP) {
 		// logOword("fopen: |%s|", newFileName);
 		break; // use first occurrence in dir search
@@ -2491,7 +2498,7 @@ FILE *Interp::find_ngc_file(setup_pointer settings,const char *basename, char *f
 	    // create the long name
 	    sprintf(newFileName, "%s/%s",
 		    foundPlace, tmpFileName);
-	    newFP = fopen(newFileName, "r");
+	    newFP = NgcFile::open(newFileName);
 	}
     }
     if (foundhere && (newFP != NULL)) 
@@ -424,10 +424,14 @@ std::vector<CONTROL_POINT> nurbs_control_points, unsigned int k)
 {
   fprintf(_outfile, "%5d ", _line_number++);
   print_nc_line_number();
-  fprintf(_outfile, "NURBS_FEED(%lu, ...)\n", (unsigned long)nurbs_control_points.size());
-
-  _program_position_x = nurbs_control_points[nurbs_control_points.size()].X;
-  _program_position_y = nurbs_control_points[nurbs_control_points.size()].Y;
+  fprintf(_outfile, "NURBS_FEED(%lu, %u", (unsigned long)nurbs_control_points.size(), k);
+  for (unsigned int i = 0; i < nurbs_control_points.size(); i++)
+    fprintf(_outfile, ", %.4f, %.4f, %.4f", nurbs_control_points[i].X,
+            nurbs_control_points[i].Y, nurbs_control_points[i].W);
+  fprintf(_outfile, ")\n");
+
+  _program_position_x = nurbs_control_points[nurbs_control_points.size() - 1].X;
+  _program_position_y = nurbs_control_points[nurbs_control_points.size() - 1].Y;
 }
 
 void ARC_FEED(int line_number,
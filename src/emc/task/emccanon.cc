@@ -41,6 +41,7 @@
 #include "canon.hh"
 #include "canon_position.hh"		// data type for a machine position
 #include "interpl.hh"		// interp_list
+#include "spline.h"		// splineNurbsSpan
 #include "emcglb.h"		// TRAJ_MAX_VELOCITY
 
 //#define EMCCANON_DEBUG
@@ -806,15 +807,299 @@ static VelData getStraightVelocity(CANON_POSITION pos)
             pos.w);
 }
 
+/*
+  The naive cam detector joins short feed moves into one longer move when
+  every point between them lies within canon.naivecamTolerance of it.
+
+  Points are seen one at a time and not kept.  The start of the chain is
+  canon.endPoint; for each point P at distance d from it, the joined move
+  may only go in a direction within asin(tolerance / d) of P.  The chain
+  keeps one cone of directions inside all of these, so a new end point is
+  checked in constant time: it must be in the cone, and at least as far
+  from the start as every point before it (so that no point lies past
+  the end of the joined move).  The cone is a little smaller than the
+  exact set of directions, which only means a chain may end early.
+
+  Normally only XYZ moves are joined.  With emc_naivecam_all_axes all
+  nine axes are, with lengths in mm and angles in degrees measured as one
+  distance.
+*/
 #include <vector>
+#define CHAIN_DIMS 9
 struct pt { double x, y, z, a, b, c, u, v, w; int line_no;};
 
-static std::vector<struct pt> chained_points;
+static struct {
+    int length;                 // points in the chain, 0 if none
+    struct pt last;             // the last of them
+    double axis[CHAIN_DIMS];    // directions the joined move may take:
+    double radius;              // within radius (radians) of axis
+    double reach;               // largest distance of a point from the start
+    std::vector<PM_CARTESIAN> points;   // XYZ of each point, for arcs
+} chain;
+
+static void chain_clear(void) {
+    chain.length = 0;
+    chain.points.clear();
+}
+
+static int chain_dims(void) {
+    return emc_naivecam_all_axes ? CHAIN_DIMS : 3;
+}
+
+// p minus the start of the chain, in as many dimensions as are joined
+static double chain_offset(const struct pt &p, double *d) {
+    double m = 0;
+    d[0] = p.x - canon.endPoint.x;
+    d[1] = p.y - canon.endPoint.y;
+    d[2] = p.z - canon.endPoint.z;
+    d[3] = p.a - canon.endPoint.a;
+    d[4] = p.b - canon.endPoint.b;
+    d[5] = p.c - canon.endPoint.c;
+    d[6] = p.u - canon.endPoint.u;
+    d[7] = p.v - canon.endPoint.v;
+    d[8] = p.w - canon.endPoint.w;
+    for(int i=0; i<chain_dims(); i++) m += d[i] * d[i];
+    return sqrt(m);
+}
+
+// add p to the chain, and narrow the cone to the directions that pass
+// within tolerance of it
+static void chain_add(const struct pt &p) {
+    double d[CHAIN_DIMS];
+    double dist = chain_offset(p, d);
+    int n = chain_dims();
+
+    if(chain.length == 0) {
+        chain.radius = M_PI;
+        chain.reach = 0;
+    }
+    chain.length++;
+    chain.last = p;
+    if(emc_naivecam_arcs) chain.points.push_back(PM_CARTESIAN(p.x, p.y, p.z));
+    if(dist > chain.reach) chain.reach = dist;
+    if(dist <= canon.naivecamTolerance) return;
+
+    double r = asin(canon.naivecamTolerance / dist);
+    for(int i=0; i<n; i++) d[i] /= dist;
+    if(chain.radius >= M_PI) {
+        for(int i=0; i<n; i++) chain.axis[i] = d[i];
+        chain.radius = r;
+        return;
+    }
 
-static void flush_segments(void) {
-    if(chained_points.empty()) return;
+    double cos_t = 0;
+    for(int i=0; i<n; i++) cos_t += chain.axis[i] * d[i];
+    if(cos_t > 1) cos_t = 1;
+    if(cos_t < -1) cos_t = -1;
+    double t = acos(cos_t);
+    if(t + chain.radius <= r) return;        // old cone is inside the new one
+    if(t + r <= chain.radius) {              // new cone is inside the old one
+        for(int i=0; i<n; i++) chain.axis[i] = d[i];
+        chain.radius = r;
+        return;
+    }
+    // the largest cone inside both is on the arc between their axes
+    // (p was in the old cone, so they overlap)
+    double phi = (t + chain.radius - r) / 2;
+    double ka = sin(t - phi) / sin(t), kd = sin(phi) / sin(t);
+    double m = 0;
+    for(int i=0; i<n; i++) {
+        chain.axis[i] = ka * chain.axis[i] + kd * d[i];
+        m += chain.axis[i] * chain.axis[i];
+    }
+    m = sqrt(m);
+    for(int i=0; i<n; i++) chain.axis[i] /= m;
+    chain.radius = (chain.radius + r - t) / 2;
+}
 
-    struct pt &pos = chained_points.back();
+/*
+  With emc_naivecam_arcs, the moves the naive cam detector sends are held
+  back for a while, and runs of three or more of them whose points all lie
+  within canon.naivecamTolerance of one circular arc are sent as that arc.
+  The points checked are the programmed ones, not the ends of the joined
+  moves, so the arc is within the tolerance of the program itself rather
+  than of the moves that were already allowed to stray from it by as much.
+  The arc may be in any plane.  Each run is checked again as it grows, so
+  this is O(n^2) in the length of a run, which emc_naivecam_window limits.
+  canon.endPoint is already the end of the last move held back.
+*/
+struct held_line {
+    EMC_TRAJ_LINEAR_MOVE msg;
+    int line_no;
+    bool queue;                 // the move would be queued (not zero length)
+    double vel, maxvel, acc;    // internal units
+    CANON_POSITION end;
+    std::vector<PM_CARTESIAN> points;   // programmed points, ending at end
+};
+
+static std::vector<held_line> held;
+static CANON_POSITION held_start;       // where the first held move starts
+
+static struct {
+    size_t lines;               // held moves the arc was fitted to, or 0
+    PM_CARTESIAN center, normal;
+    double radius;
+} held_arc;
+
+static bool arcs_enabled(void) {
+    return emc_naivecam_arcs && canon.motionMode == CANON_CONTINUOUS
+        && canon.naivecamTolerance > 0 && !canon.synched;
+}
+
+// distance of p from a circle, and its angle around normal from e1
+static double arc_deviation(const PM_CARTESIAN &p, const PM_CARTESIAN &center,
+                            const PM_CARTESIAN &normal, double radius,
+                            const PM_CARTESIAN &e1, const PM_CARTESIAN &e2,
+                            double &theta) {
+    PM_CARTESIAN r = p - center;
+    double h = dot(r, normal);
+    double px = dot(r, e1), py = dot(r, e2);
+    theta = atan2(py, px);
+    if(theta < 0) theta += 2 * M_PI;
+    return hypot(h, hypot(px, py) - radius);
+}
+
+// fit an arc to the held moves, and set held_arc if all of them are close
+// enough to it; held_arc is left alone otherwise
+static bool fit_held_arc(void) {
+    size_t n = held.size();
+    double tol = canon.naivecamTolerance;
+
+    for(size_t i=0; i<n; i++) {
+        if(!held[i].queue) return false;
+        if(held[i].end.a != held_start.a || held[i].end.b != held_start.b
+                || held[i].end.c != held_start.c
+                || held[i].end.u != held_start.u
+                || held[i].end.v != held_start.v
+                || held[i].end.w != held_start.w)
+            return false;
+    }
+
+    // the circle through the start, the middle and the end
+    PM_CARTESIAN A = held_start.xyz(), B = held[(n - 1) / 2].end.xyz(),
+                 C = held[n - 1].end.xyz();
+    PM_CARTESIAN U = B - A, V = C - A, W = cross(U, V);
+    double ww = dot(W, W);
+    if(ww <= 1e-12 * dot(U, U) * dot(V, V)) return false;     // collinear
+    PM_CARTESIAN center = A + (dot(U, U) * cross(V, W) + dot(V, V) * cross(W, U))
+                              / (2 * ww);
+    PM_CARTESIAN normal = W / sqrt(ww);
+    double radius = mag(A - center);
+
+    PM_CARTESIAN e1 = (A - center) / radius;
+    PM_CARTESIAN e2 = cross(normal, e1);
+    PM_CARTESIAN prev = A;
+    double last_theta = 0, theta, mid_theta;
+    for(size_t i=0; i<n; i++) {
+        const std::vector<PM_CARTESIAN> &points = held[i].points;
+        for(size_t j=0; j<points.size(); j++) {
+            PM_CARTESIAN p = points[j];
+            // the programmed point, and the middle of the programmed line
+            if(arc_deviation(p, center, normal, radius, e1, e2, theta) > tol)
+                return false;
+            if(theta <= last_theta || theta - last_theta >= M_PI)
+                return false;
+            if(arc_deviation((prev + p) / 2, center, normal, radius, e1, e2,
+                             mid_theta) > tol)
+                return false;
+            last_theta = theta;
+            prev = p;
+        }
+    }
+    held_arc.lines = n;
+    held_arc.center = center;
+    held_arc.normal = normal;
+    held_arc.radius = radius;
+    return true;
+}
+
+static void send_line(held_line &l) {
+    if(l.queue) {
+        interp_list.set_line_number(l.line_no);
+        interp_list.append(l.msg);
+    }
+}
+
+// send the first held_arc.lines held moves as one arc
+static void send_held_arc(void) {
+    size_t n = held_arc.lines;
+    held_line &last = held[n - 1];
+    double vel = last.vel, maxvel = last.maxvel, acc = last.acc;
+
+    for(size_t i=0; i<n; i++) {
+        vel = MIN(vel, held[i].vel);
+        maxvel = MIN(maxvel, held[i].maxvel);
+        acc = MIN(acc, held[i].acc);
+    }
+    // as in ARC_FEED, keep the centripetal acceleration in bounds
+    double v_max_radial = sqrt(acc * sqrt(3.0)/2.0 * held_arc.radius);
+    vel = MIN(vel, v_max_radial);
+    maxvel = MIN(maxvel, v_max_radial);
+
+    EMC_TRAJ_CIRCULAR_MOVE circularMoveMsg;
+    circularMoveMsg.feed_mode = last.msg.feed_mode;
+    circularMoveMsg.end = last.msg.end;
+    circularMoveMsg.center = to_ext_len(held_arc.center);
+    circularMoveMsg.normal = held_arc.normal;
+    circularMoveMsg.turn = 0;
+    circularMoveMsg.type = EMC_MOTION_TYPE_ARC;
+    circularMoveMsg.vel = toExtVel(vel);
+    circularMoveMsg.ini_maxvel = toExtVel(maxvel);
+    circularMoveMsg.acc = toExtAcc(acc);
+    interp_list.set_line_number(last.line_no);
+    interp_list.append(circularMoveMsg);
+
+    held_start = last.end;
+    held.erase(held.begin(), held.begin() + n);
+    held_arc.lines = 0;
+}
+
+static void send_first_held(void) {
+    send_line(held[0]);
+    held_start = held[0].end;
+    held.erase(held.begin());
+    held_arc.lines = 0;
+}
+
+static bool held_fits(void) {
+    size_t n = held.size();
+    if(n == 1) return true;
+    if((int) n > emc_naivecam_window) return false;
+    if(n == 2) {
+        held_arc.lines = 0;
+        return held[0].queue && held[1].queue;
+    }
+    return fit_held_arc();
+}
+
+static void hold_line(held_line &l) {
+    if(!arcs_enabled()) {
+        send_line(l);
+        return;
+    }
+    if(held.empty()) held_start = canon.endPoint;
+    held.push_back(l);
+    while(!held_fits()) {
+        if(held_arc.lines >= 3 && held_arc.lines == held.size() - 1)
+            send_held_arc();
+        else
+            send_first_held();
+    }
+}
+
+static void send_held(void) {
+    if(held_arc.lines >= 3 && held_arc.lines == held.size())
+        send_held_arc();
+    for(size_t i=0; i<held.size(); i++) send_line(held[i]);
+    held.clear();
+    held_arc.lines = 0;
+}
+
+// end the chain of joined points, and hand the move to hold_line
+static void end_chain(void) {
+    if(chain.length == 0) return;
+
+    struct pt &pos = chain.last;
 
     double x = pos.x, y = pos.y, z = pos.z;
     double a = pos.a, b = pos.b, c = pos.c;
@@ -823,7 +1108,7 @@ static void flush_segments(void) {
     int line_no = pos.line_no;
 
 #ifdef SHOW_JOINED_SEGMENTS
-    for(unsigned int i=0; i != chained_points.size(); i++) { printf("."); }
+    for(int i=0; i != chain.length; i++) { printf("."); }
     printf("\n");
 #endif
 
@@ -870,22 +1155,33 @@ static void flush_segments(void) {
 
     linearMoveMsg.type = EMC_MOTION_TYPE_FEED;
     linearMoveMsg.indexrotary = -1;
-    if ((vel && acc) || canon.synched) {
-        interp_list.set_line_number(line_no);
-        interp_list.append(linearMoveMsg);
-    }
+    held_line l;
+    l.msg = linearMoveMsg;
+    l.line_no = line_no;
+    l.queue = (vel && acc) || canon.synched;
+    l.vel = vel;
+    l.maxvel = linedata.vel;
+    l.acc = acc;
+    l.end = CANON_POSITION(x, y, z, a, b, c, u, v, w);
+    l.points.swap(chain.points);
+    hold_line(l);
     canonUpdateEndPoint(x, y, z, a, b, c, u, v, w);
 
-    chained_points.clear();
+    chain_clear();
+}
+
+static void flush_segments(void) {
+    end_chain();
+    send_held();
 }
 
 static void get_last_pos(double &lx, double &ly, double &lz) {
-    if(chained_points.empty()) {
+    if(chain.length == 0) {
         lx = canon.endPoint.x;
         ly = canon.endPoint.y;
         lz = canon.endPoint.z;
     } else {
-        struct pt &pos = chained_points.back();
+        struct pt &pos = chain.last;
         lx = pos.x;
         ly = pos.y;
         lz = pos.z;
@@ -893,39 +1189,32 @@ static void get_last_pos(double &lx, double &ly, double &lz) {
 }
 
 static bool
-linkable(double x, double y, double z, 
-         double a, double b, double c, 
-         double u, double v, double w) {
-    struct pt &pos = chained_points.back();
+linkable(const struct pt &p) {
+    struct pt &pos = chain.last;
     if(canon.motionMode != CANON_CONTINUOUS || canon.naivecamTolerance == 0)
         return false;
-    //FIXME make this length controlled elsewhere?
-    if(chained_points.size() > 100) return false;
-
-    //If ABCUVW motion, then the tangent calculation fails?
-    // TODO is there a fundamental reason that we can't handle 9D motion here?
-    if(a != pos.a) return false;
-    if(b != pos.b) return false;
-    if(c != pos.c) return false;
-    if(u != pos.u) return false;
-    if(v != pos.v) return false;
-    if(w != pos.w) return false;
-
-    if(x==canon.endPoint.x && y==canon.endPoint.y && z==canon.endPoint.z) return false;
-    
-    for(std::vector<struct pt>::iterator it = chained_points.begin();
-            it != chained_points.end(); it++) {
-        PM_CARTESIAN M(x-canon.endPoint.x, y-canon.endPoint.y, z-canon.endPoint.z),
-                     B(canon.endPoint.x, canon.endPoint.y, canon.endPoint.z),
-                     P(it->x, it->y, it->z);
-        double t0 = dot(M, P-B) / dot(M, M);
-        if(t0 < 0) t0 = 0;
-        if(t0 > 1) t0 = 1;
-
-        double D = mag(P - (B + t0 * M));
-        if(D > canon.naivecamTolerance) return false;
+    if(chain.length >= emc_naivecam_window) return false;
+
+    if(!emc_naivecam_all_axes) {
+        if(p.a != pos.a) return false;
+        if(p.b != pos.b) return false;
+        if(p.c != pos.c) return false;
+        if(p.u != pos.u) return false;
+        if(p.v != pos.v) return false;
+        if(p.w != pos.w) return false;
     }
-    return true;
+
+    double d[CHAIN_DIMS];
+    double dist = chain_offset(p, d);
+    if(dist == 0) return false;
+    if(dist < chain.reach) return false;
+    if(chain.radius >= M_PI) return true;
+
+    double cos_t = 0;
+    for(int i=0; i<chain_dims(); i++) cos_t += chain.axis[i] * d[i];
+    cos_t /= dist;
+    if(cos_t > 1) cos_t = 1;
+    return acos(cos_t) <= chain.radius;
 }
 
 static void
@@ -941,13 +1230,13 @@ see_segment(int line_number,
         || (v != canon.endPoint.v)
         || (w != canon.endPoint.w);
 
-    if(!chained_points.empty() && !linkable(x, y, z, a, b, c, u, v, w)) {
-        flush_segments();
-    }
     pt pos = {x, y, z, a, b, c, u, v, w, line_number};
-    chained_points.push_back(pos);
-    if(changed_abc || changed_uvw) {
-        flush_segments();
+    if(chain.length && !linkable(pos)) {
+        end_chain();
+    }
+    chain_add(pos);
+    if((changed_abc || changed_uvw) && !emc_naivecam_all_axes) {
+        end_chain();
     }
 }
 
@@ -1277,11 +1566,8 @@ biarc(int lineno, double p0x, double p0y, double tsx, double tsy,
 }
 
 
-/* Canon calls */
-
-void NURBS_FEED(int lineno, std::vector<CONTROL_POINT> nurbs_control_points, unsigned int k) {
-    flush_segments();
-
+static void
+nurbs_biarcs(int lineno, std::vector<CONTROL_POINT> &nurbs_control_points, unsigned int k) {
     unsigned int n = nurbs_control_points.size() - 1;
     double umax = n - k + 2;
     unsigned int div = nurbs_control_points.size()*4;
@@ -1303,6 +1589,81 @@ void NURBS_FEED(int lineno, std::vector<CONTROL_POINT> nurbs_control_points, uns
 }
 
 
+/* Canon calls */
+
+/* NURBS up to cubic go to motion a span at a time, as rational Bezier
+   spline moves; higher orders are broken into biarcs here */
+void NURBS_FEED(int lineno, std::vector<CONTROL_POINT> nurbs_control_points, unsigned int k) {
+    flush_segments();
+
+    int count = nurbs_control_points.size();
+    int order = k;
+    if (order > EMCMOT_MAX_SPLINE_ORDER) {
+        nurbs_biarcs(lineno, nurbs_control_points, k);
+        return;
+    }
+
+    std::vector<PmCartesian> ctrl(count);
+    std::vector<double> weight(count);
+    for (int i = 0; i < count; i++) {
+        double x = FROM_PROG_LEN(nurbs_control_points[i].X);
+        double y = FROM_PROG_LEN(nurbs_control_points[i].Y);
+        double unused = 0;
+        rotate_and_offset_pos(x, y, unused, unused, unused, unused, unused, unused, unused);
+        ctrl[i].x = x;
+        ctrl[i].y = y;
+        ctrl[i].z = canon.endPoint.z;
+        weight[i] = nurbs_control_points[i].W;
+    }
+
+    // the spline can head any way in the plane, so use the slower axis
+    double v_max = MIN(FROM_EXT_LEN(emcAxisGetMaxVelocity(0)),
+                       FROM_EXT_LEN(emcAxisGetMaxVelocity(1)));
+    double a_max = MIN(FROM_EXT_LEN(emcAxisGetMaxAcceleration(0)),
+                       FROM_EXT_LEN(emcAxisGetMaxAcceleration(1)));
+    double vel = MIN(canon.linearFeedRate, v_max);
+
+    canon.cartesian_move = 1;
+
+    CANON_POSITION endpt = canon.endPoint;
+    for (int span = 0; span <= count - order; span++) {
+        PmCartesian bezier[EMCMOT_MAX_SPLINE_ORDER];
+        double bezier_weight[EMCMOT_MAX_SPLINE_ORDER];
+        if (splineNurbsSpan(&ctrl[0], &weight[0], count, order, span,
+                            bezier, bezier_weight) != 0) {
+            break;
+        }
+
+        // end exactly on the last control point, as the interpreter has it
+        if (span == count - order) {
+            bezier[order - 1] = ctrl[count - 1];
+        }
+
+        EMC_TRAJ_SPLINE_MOVE splineMoveMsg;
+        endpt.x = bezier[order - 1].x;
+        endpt.y = bezier[order - 1].y;
+        splineMoveMsg.end = to_ext_pose(endpt);
+        for (int i = 0; i < order; i++) {
+            PM_CARTESIAN p(bezier[i].x, bezier[i].y, bezier[i].z);
+            splineMoveMsg.ctrl[i] = to_ext_len(p);
+            splineMoveMsg.weight[i] = bezier_weight[i];
+        }
+        splineMoveMsg.order = order;
+        splineMoveMsg.type = EMC_MOTION_TYPE_ARC;
+        splineMoveMsg.feed_mode = canon.feed_mode;
+        splineMoveMsg.vel = toExtVel(vel);
+        splineMoveMsg.ini_maxvel = toExtVel(v_max);
+        splineMoveMsg.acc = toExtAcc(a_max);
+
+        if(vel && a_max) {
+            interp_list.set_line_number(lineno);
+            interp_list.append(splineMoveMsg);
+        }
+    }
+    canonUpdateEndPoint(endpt);
+}
+
+
 /**
  * Simple circular shift function for PM_CARTESIAN type.
  * Cycle around axes without changing the individual values. A circshift of -1
@@ -2425,7 +2786,8 @@ void INIT_CANON()
 {
     double units;
 
-    chained_points.clear();
+    chain_clear();
+    held.clear();
 
     // initialize locals to original values
     canon.xy_rotation = 0.0;
@@ -2536,7 +2898,8 @@ CANON_POSITION GET_EXTERNAL_POSITION()
     CANON_POSITION position;
     EmcPose pos;
 
-    chained_points.clear();
+    chain_clear();
+    held.clear();
 
     pos = emcStatus->motion.traj.position;
 
@@ -100,6 +100,7 @@ static RCS_STAT_CHANNEL *emcStatusChannel = NULL;
 static NML *emcErrorChannel = NULL;
 static RCS_CMD_CHANNEL *toolCommandChannel = NULL;
 static RCS_STAT_CHANNEL *toolStatusChannel = NULL;
+static RCS_STAT_CHANNEL *emcStatusDeltaChannel = NULL;
 
 int main(int argc, char *argv[])
 {
@@ -141,6 +142,11 @@ int main(int argc, char *argv[])
 	    emcErrorChannel =
 		new NML(nmlErrorFormat, "emcError", "emcsvr", emc_nmlfile);
 	}
+	if (NULL == emcStatusDeltaChannel) {
+	    emcStatusDeltaChannel =
+		new RCS_STAT_CHANNEL(emcFormat, "emcStatusDelta", "emcsvr",
+				     emc_nmlfile);
+	}
 	if (tool_channels) {
 	    if (NULL == toolCommandChannel) {
 		toolCommandChannel =
@@ -162,6 +168,11 @@ int main(int argc, char *argv[])
 	    delete emcStatusChannel;
 	    emcStatusChannel = NULL;
 	}
+	// emcStatusDelta is optional, so it is not waited for
+	if (!emcStatusDeltaChannel->valid()) {
+	    delete emcStatusDeltaChannel;
+	    emcStatusDeltaChannel = NULL;
+	}
 	if (!emcErrorChannel->valid()) {
 	    delete emcErrorChannel;
 	    emcErrorChannel = NULL;
@@ -94,6 +94,11 @@ static RCS_CMD_CHANNEL *emcCommandBuffer = 0;
 static RCS_STAT_CHANNEL *emcStatusBuffer = 0;
 static NML *emcErrorBuffer = 0;
 
+// optional channel with only the parts of emcStatus that changed
+static RCS_STAT_CHANNEL *emcStatusDeltaBuffer = 0;
+static EMC_STAT_DELTA *emcStatusDelta = 0;
+static RCS_STAT_DELTA *emcStatusTracker = 0;
+
 // NML command channel data pointer
 static RCS_CMD_MSG *emcCommand = 0;
 
@@ -379,6 +384,7 @@ static EMC_TRAJ_SET_VELOCITY *emcTrajSetVelocityMsg;
 static EMC_TRAJ_SET_ACCELERATION *emcTrajSetAccelerationMsg;
 static EMC_TRAJ_LINEAR_MOVE *emcTrajLinearMoveMsg;
 static EMC_TRAJ_CIRCULAR_MOVE *emcTrajCircularMoveMsg;
+static EMC_TRAJ_SPLINE_MOVE *emcTrajSplineMoveMsg;
 static EMC_TRAJ_DELAY *emcTrajDelayMsg;
 static EMC_TRAJ_SET_TERM_COND *emcTrajSetTermCondMsg;
 static EMC_TRAJ_SET_SPINDLESYNC *emcTrajSetSpindlesyncMsg;
@@ -1423,6 +1429,7 @@ static int emcTaskCheckPreconditions(NMLmsg * cmd)
 
     case EMC_TRAJ_LINEAR_MOVE_TYPE:
     case EMC_TRAJ_CIRCULAR_MOVE_TYPE:
+    case EMC_TRAJ_SPLINE_MOVE_TYPE:
     case EMC_TRAJ_SET_VELOCITY_TYPE:
     case EMC_TRAJ_SET_ACCELERATION_TYPE:
     case EMC_TRAJ_SET_TERM_COND_TYPE:
@@ -1752,6 +1759,16 @@ static int emcTaskIssueCommand(NMLmsg * cmd)
                 emcTrajCircularMoveMsg->acc);
 	break;
 
+    case EMC_TRAJ_SPLINE_MOVE_TYPE:
+	emcTrajSplineMoveMsg = (EMC_TRAJ_SPLINE_MOVE *) cmd;
+        retval = emcTrajSplineMove(emcTrajSplineMoveMsg->end,
+                emcTrajSplineMoveMsg->ctrl, emcTrajSplineMoveMsg->weight,
+                emcTrajSplineMoveMsg->order, emcTrajSplineMoveMsg->type,
+                emcTrajSplineMoveMsg->vel,
+                emcTrajSplineMoveMsg->ini_maxvel,
+                emcTrajSplineMoveMsg->acc);
+	break;
+
     case EMC_TRAJ_PAUSE_TYPE:
 	emcStatus->task.task_paused = 1;
 	retval = emcTrajPause();
@@ -2303,6 +2320,7 @@ static int emcTaskCheckPostconditions(NMLmsg * cmd)
 
     case EMC_TRAJ_LINEAR_MOVE_TYPE:
     case EMC_TRAJ_CIRCULAR_MOVE_TYPE:
+    case EMC_TRAJ_SPLINE_MOVE_TYPE:
     case EMC_TRAJ_SET_VELOCITY_TYPE:
     case EMC_TRAJ_SET_ACCELERATION_TYPE:
     case EMC_TRAJ_SET_TERM_COND_TYPE:
@@ -2804,6 +2822,25 @@ static int emctask_startup()
 	return -1;
     }
 
+    // the delta buffer is optional, older nml files don't have it
+    set_rcs_print_destination(RCS_PRINT_TO_NULL);
+    emcStatusDeltaBuffer =
+	new RCS_STAT_CHANNEL(emcFormat, "emcStatusDelta", "emc", emc_nmlfile);
+    if (emc_debug & EMC_DEBUG_NML) {
+	set_rcs_print_destination(RCS_PRINT_TO_STDOUT);
+    }
+    if (!emcStatusDeltaBuffer->valid()) {
+	delete emcStatusDeltaBuffer;
+	emcStatusDeltaBuffer = 0;
+    } else {
+	EMC_STAT stat;
+	long offset[RCS_STAT_DELTA_MAX_SECTIONS];
+	int sections = stat.sections(offset);
+	emcStatusDelta = new EMC_STAT_DELTA;
+	emcStatusTracker = new RCS_STAT_DELTA(offset, sections,
+	    sizeof(EMC_STAT), sizeof(emcStatusDelta->data));
+    }
+
     if (!(emc_debug & EMC_DEBUG_NML)) {
 	set_rcs_print_destination(RCS_PRINT_TO_NULL);	// inhibit diag
 	// messages
@@ -2969,6 +3006,15 @@ static int emctask_shutdown(void)
 	emcErrorBuffer = 0;
     }
 
+    if (0 != emcStatusDeltaBuffer) {
+	delete emcStatusDeltaBuffer;
+	emcStatusDeltaBuffer = 0;
+	delete emcStatusDelta;
+	emcStatusDelta = 0;
+	delete emcStatusTracker;
+	emcStatusTracker = 0;
+    }
+
     if (0 != emcStatusBuffer) {
 	delete emcStatusBuffer;
 	emcStatusBuffer = 0;
@@ -3050,6 +3096,25 @@ static int iniLoad(const char *filename)
 	}
     }
 
+    saveInt = emc_naivecam_window;
+    if (NULL != (inistring = inifile.Find("NAIVECAM_WINDOW", "TASK"))) {
+	if (1 != sscanf(inistring, "%d", &emc_naivecam_window)
+		|| emc_naivecam_window <= 0) {
+	    emc_naivecam_window = saveInt;
+	    rcs_print
+		("invalid [TASK] NAIVECAM_WINDOW in %s (%s); using default %d\n",
+		 filename, inistring, emc_naivecam_window);
+	}
+    }
+
+    if (NULL != (inistring = inifile.Find("NAIVECAM_ALL_AXES", "TASK"))) {
+	emc_naivecam_all_axes = atoi(inistring) != 0;
+    }
+
+    if (NULL != (inistring = inifile.Find("NAIVECAM_ARCS", "TASK"))) {
+	emc_naivecam_arcs = atoi(inistring) != 0;
+    }
+
     if (NULL != (inistring = inifile.Find("RS274NGC_STARTUP_CODE", "RS274NGC"))) {
 	// copy to global
 	strcpy(rs274ngc_startup_code, inistring);
@@ -3131,6 +3196,7 @@ int main(int argc, char *argv[])
 {
     int taskPlanError = 0;
     int taskExecuteError = 0;
+    int serial;			// write id of the last status
     double startTime, endTime, deltaTime;
     double minTime, maxTime;
 
@@ -3378,7 +3444,12 @@ int main(int argc, char *argv[])
 	// since emcStatus was passed to the WM init functions, it
 	// will be updated in the _update() functions above. There's
 	// no need to call the individual functions on all WM items.
-	emcStatusBuffer->write(emcStatus);
+	if (0 == emcStatusBuffer->write(emcStatus, &serial) &&
+	    0 != emcStatusDeltaBuffer &&
+	    0 == emcStatusTracker->encode(emcStatus, serial,
+		emcStatusDelta, emcStatusDelta->data)) {
+	    emcStatusDeltaBuffer->write(emcStatusDelta);
+	}
 
 	// wait on timer cycle, if specified, or calculate actual
 	// interval if ini file says to run full out via
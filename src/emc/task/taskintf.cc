@@ -1286,6 +1286,41 @@ int emcTrajCircularMove(EmcPose end, PM_CARTESIAN center,
     return usrmotWriteEmcmotCommand(&emcmotCommand);
 }
 
+int emcTrajSplineMove(EmcPose end, PM_CARTESIAN const *ctrl,
+        double const *weight, int order, int type, double vel,
+        double ini_maxvel, double acc)
+{
+    CATCH_NAN(isnan(end.tran.x) || isnan(end.tran.y) || isnan(end.tran.z) ||
+        isnan(end.a) || isnan(end.b) || isnan(end.c) ||
+        isnan(end.u) || isnan(end.v) || isnan(end.w));
+
+    if (order < 2 || order > EMCMOT_MAX_SPLINE_ORDER) {
+        return -1;
+    }
+
+    emcmotCommand.command = EMCMOT_SET_SPLINE;
+
+    emcmotCommand.pos = end;
+    emcmotCommand.motion_type = type;
+
+    for (int i = 0; i < order; i++) {
+        CATCH_NAN(isnan(ctrl[i].x) || isnan(ctrl[i].y) || isnan(ctrl[i].z) ||
+            isnan(weight[i]));
+        emcmotCommand.ctrl[i].x = ctrl[i].x;
+        emcmotCommand.ctrl[i].y = ctrl[i].y;
+        emcmotCommand.ctrl[i].z = ctrl[i].z;
+        emcmotCommand.weight[i] = weight[i];
+    }
+    emcmotCommand.order = order;
+    emcmotCommand.id = TrajConfig.MotionId;
+
+    emcmotCommand.vel = vel;
+    emcmotCommand.ini_maxvel = ini_maxvel;
+    emcmotCommand.acc = acc;
+
+    return usrmotWriteEmcmotCommand(&emcmotCommand);
+}
+
 int emcTrajClearProbeTrippedFlag()
 {
     emcmotCommand.command = EMCMOT_CLEAR_PROBE_FLAGS;
@@ -1334,6 +1369,7 @@ static double last_id_time;
 int emcTrajUpdate(EMC_TRAJ_STAT * stat)
 {
     int joint, enables;
+    unsigned int pending;
 
     stat->joints = TrajConfig.Joints;
     stat->axes = TrajConfig.Axes;
@@ -1364,9 +1400,13 @@ int emcTrajUpdate(EMC_TRAJ_STAT * stat)
     }
 
     stat->inpos = emcmotStatus.motionFlag & EMCMOT_MOTION_INPOS_BIT;
-    stat->queue = emcmotStatus.depth;
+    /* moves still in the command ring count as queued, and task stops
+       feeding the ring once a handler cycle's worth is waiting there */
+    pending = usrmotCommandRingPending(&emcmotStatus);
+    stat->queue = emcmotStatus.depth + pending;
     stat->activeQueue = emcmotStatus.activeDepth;
-    stat->queueFull = emcmotStatus.queueFull;
+    stat->queueFull = emcmotStatus.queueFull ||
+	pending >= EMCMOT_COMMAND_RING_BATCH;
     stat->id = emcmotStatus.id;
     stat->motion_type = emcmotStatus.motionType;
     stat->distance_to_go = emcmotStatus.distance_to_go;
@@ -1816,6 +1856,12 @@ int emcSetupArcBlends(int arcBlendEnable,
     return usrmotWriteEmcmotCommand(&emcmotCommand);
 }
 
+int emcSetMaxJerk(double maxJerk) {
+    emcmotCommand.command = EMCMOT_SET_MAX_JERK;
+    emcmotCommand.maxJerk = maxJerk;
+    return usrmotWriteEmcmotCommand(&emcmotCommand);
+}
+
 int emcSetMaxFeedOverride(double maxFeedScale) {
     emcmotCommand.command = EMCMOT_SET_MAX_FEED_OVERRIDE;
     emcmotCommand.maxFeedScale = maxFeedScale;
@@ -647,6 +647,9 @@ int blendParamKinematics(BlendGeom3 * const geom,
     tp_debug_print("a_max = %f, a_n_max = %f\n", param->a_max,
             param->a_n_max);
 
+    // Blend arcs take on the jerk limit of the segment being added
+    param->j_max = tc->maxjerk;
+
     // Find common velocity and acceleration
     param->v_req = fmax(prev_tc->reqvel, tc->reqvel);
     param->v_goal = param->v_req * maxFeedScale;
@@ -1132,6 +1135,9 @@ int blendComputeParameters(BlendParameters * const param)
 
     // Find maximum velocity allowed by accel and radius
     double v_normal = pmSqrt(param->a_n_max * R_geom);
+    if (param->j_max > 0.0) {
+        v_normal = fmin(v_normal, findArcJerkVel(R_geom, param->j_max));
+    }
     tp_debug_print("v_normal = %f\n", v_normal);
 
     param->v_plan = fmin(v_normal, param->v_goal);
@@ -1151,6 +1157,11 @@ int blendComputeParameters(BlendParameters * const param)
     double R_blend = fmin(s_blend / param->phi, R_geom);   //Clamp by limiting radius
 
     param->R_plan = fmax(pmSq(param->v_plan) / param->a_n_max, R_blend);
+    if (param->j_max > 0.0) {
+        // Smallest radius that keeps the arc's jerk v^3 / R^2 within bounds
+        double R_jerk = pmSqrt(pmSq(param->v_plan) * param->v_plan / param->j_max);
+        param->R_plan = fmax(param->R_plan, R_jerk);
+    }
     param->d_plan = param->R_plan / tan(param->theta);
 
     tp_debug_print("v_plan = %f\n", param->v_plan);
@@ -1621,16 +1632,31 @@ double pmCircleActualMaxVel(PmCircle * const circle,
         double v_max,
         double a_max,
         int parabolic)
+{
+    double eff_radius = pmCircleEffectiveMinRadius(circle);
+    return findCurvatureMaxVel(eff_radius, acc_ratio_tangential, v_max, a_max, parabolic);
+}
+
+
+/**
+ * Find the maximum speed along a curve with a given smallest radius of
+ * curvature, keeping enough acceleration in reserve for the tangential
+ * direction.
+ */
+double findCurvatureMaxVel(double radius,
+        double * const acc_ratio_tangential,
+        double v_max,
+        double a_max,
+        int parabolic)
 {
     if (parabolic) {
         a_max /= 2.0;
     }
     double a_n_max = BLEND_ACC_RATIO_NORMAL * a_max;
-    double eff_radius = pmCircleEffectiveMinRadius(circle);
-    double v_max_acc = pmSqrt(a_n_max * eff_radius);
+    double v_max_acc = pmSqrt(a_n_max * radius);
     double v_max_eff = fmin(v_max_acc, v_max);
     if (acc_ratio_tangential) {
-        double a_normal = fmin(pmSq(v_max_eff) / eff_radius, a_n_max);
+        double a_normal = fmin(pmSq(v_max_eff) / radius, a_n_max);
         *acc_ratio_tangential = (pmSqrt(pmSq(a_max) - pmSq(a_normal)) / a_max);
         tp_debug_print("acc_ratio_tan = %f\n",*acc_ratio_tangential);
     }
@@ -1822,3 +1848,186 @@ double pmCircleEffectiveMinRadius(PmCircle const * const circle)
             effective_radius);
     return effective_radius;
 }
+
+
+/** @section scurvefuncs Functions for jerk-limited velocity profiles */
+
+/**
+ * Find the distance needed to change velocity by dv, starting and ending with
+ * zero acceleration.
+ * The acceleration profile is a triangle if the peak acceleration stays below
+ * a_max, and a trapezoid otherwise. Either way it is symmetric, so the
+ * average velocity is halfway between the start and end velocities.
+ */
+static double findSCurveSymmetricDist(double v_0, double v_f, double a_max, double j_max)
+{
+    double dv = v_0 - v_f;
+    if (dv <= 0.0) {
+        return 0.0;
+    }
+    double t_total;
+    if (dv * j_max <= pmSq(a_max)) {
+        t_total = 2.0 * pmSqrt(dv / j_max);
+    } else {
+        t_total = dv / a_max + a_max / j_max;
+    }
+    return (v_0 + v_f) / 2.0 * t_total;
+}
+
+
+/**
+ * Find the distance needed to slow down to exactly v_f with zero
+ * acceleration, or to cross v_f if already slowing down harder than needed.
+ */
+static double findSCurveStopDistTo(double v, double a, double v_f, double a_max, double j_max)
+{
+    double t_a = fabs(a) / j_max;
+    if (a >= 0.0) {
+        // Velocity keeps increasing while acceleration drops to zero
+        double d_ramp = v * t_a + a * pmSq(t_a) / 2.0 - j_max * pmSq(t_a) * t_a / 6.0;
+        double v_0 = v + pmSq(a) / (2.0 * j_max);
+        return d_ramp + findSCurveSymmetricDist(v_0, v_f, a_max, j_max);
+    }
+
+    if (v <= v_f) {
+        return 0.0;
+    }
+    if (v - pmSq(a) / (2.0 * j_max) <= v_f) {
+        // Slowing down harder than needed: even easing off right away
+        // takes us below v_f. Find where we cross it.
+        double t_f = (-a - pmSqrt(pmSq(a) - 2.0 * j_max * (v - v_f))) / j_max;
+        return v * t_f + a * pmSq(t_f) / 2.0 + j_max * pmSq(t_f) * t_f / 6.0;
+    }
+
+    // Already slowing down. Extend the profile back to where acceleration was
+    // zero, and subtract the part that is behind us.
+    double v_0 = v + pmSq(a) / (2.0 * j_max);
+    double d_ramp = v_0 * t_a - j_max * pmSq(t_a) * t_a / 6.0;
+    return fmax(findSCurveSymmetricDist(v_0, v_f, a_max, j_max) - d_ramp, 0.0);
+}
+
+
+/**
+ * Find the lowest (most negative) acceleration reached while slowing down to
+ * v_f as in findSCurveStopDistTo.
+ */
+static double findSCurveStopPeakAccelTo(double v, double a, double v_f, double a_max, double j_max)
+{
+    if (a < 0.0 && v - pmSq(a) / (2.0 * j_max) <= v_f) {
+        // Easing off right away
+        return a;
+    }
+    // Velocity where the acceleration is (or was) zero, less v_f
+    double dv = v + pmSq(a) / (2.0 * j_max) - v_f;
+    if (dv <= 0.0) {
+        return fmin(a, 0.0);
+    }
+    return -fmin(a_max, pmSqrt(dv * j_max));
+}
+
+
+/**
+ * Pick the velocity to slow down to when any velocity up to v_f will do.
+ * With a jerk limit, slowing down a little can take further than stopping
+ * outright (the distance peaks at about a third of the starting velocity),
+ * so the shorter of the two is used.
+ */
+static double findSCurveStopTarget(double v, double a, double v_f, double a_max, double j_max)
+{
+    if (v_f > 0.0 && findSCurveStopDistTo(v, a, 0.0, a_max, j_max) <
+            findSCurveStopDistTo(v, a, v_f, a_max, j_max)) {
+        return 0.0;
+    }
+    return v_f;
+}
+
+
+/**
+ * Find the distance needed to slow down to v_f or less, from velocity v and
+ * acceleration a, using a jerk-limited profile.
+ * The profile ends with zero acceleration, unless it is already slowing down
+ * harder than needed, in which case it ends where the velocity crosses v_f.
+ * @param v current velocity
+ * @param a current acceleration (may be positive)
+ * @param v_f highest velocity to end at
+ * @param a_max maximum acceleration magnitude
+ * @param j_max maximum jerk magnitude
+ */
+double findSCurveStopDist(double v, double a, double v_f, double a_max, double j_max)
+{
+    double v_stop = findSCurveStopTarget(v, a, v_f, a_max, j_max);
+    return findSCurveStopDistTo(v, a, v_stop, a_max, j_max);
+}
+
+
+/**
+ * Find the lowest (most negative) acceleration reached while slowing down as
+ * in findSCurveStopDist.
+ */
+double findSCurveStopPeakAccel(double v, double a, double v_f, double a_max, double j_max)
+{
+    double v_stop = findSCurveStopTarget(v, a, v_f, a_max, j_max);
+    return findSCurveStopPeakAccelTo(v, a, v_stop, a_max, j_max);
+}
+
+
+/**
+ * Find the highest velocity from which a jerk-limited profile can slow down
+ * to exactly v_f within a given distance.
+ */
+static double findSCurveVStartTo(double v_f, double dist, double a_max, double j_max)
+{
+    if (dist <= 0.0) {
+        return v_f;
+    }
+    // Distance where the acceleration profile changes from triangle to trapezoid
+    double dv_corner = pmSq(a_max) / j_max;
+    double dist_corner = (2.0 * v_f + dv_corner) * a_max / j_max;
+
+    if (dist > dist_corner) {
+        // Solve dv^2 / (2 a) + dv (v_f / a + a / (2 j)) + v_f a / j - dist = 0
+        double b = v_f / a_max + a_max / (2.0 * j_max);
+        double disc = pmSq(b) + 2.0 * (dist - v_f * a_max / j_max) / a_max;
+        return v_f + a_max * (pmSqrt(disc) - b);
+    }
+
+    // Solve s^3 + 2 v_f s - dist sqrt(j) = 0 for s = sqrt(dv) (Cardano)
+    double p = 2.0 * v_f;
+    double q = dist * pmSqrt(j_max);
+    double r = pmSqrt(pmSq(q) / 4.0 + pmSq(p) * p / 27.0);
+    double s = pow(q / 2.0 + r, 1.0 / 3.0) - pow(r - q / 2.0, 1.0 / 3.0);
+    // One Newton step to clean up cancellation when v_f is large
+    double f_prime = 3.0 * pmSq(s) + p;
+    if (f_prime > 0.0) {
+        s -= (pmSq(s) * s + p * s - q) / f_prime;
+    }
+    return v_f + pmSq(fmax(s, 0.0));
+}
+
+
+/**
+ * Find the highest velocity from which a jerk-limited profile can slow down
+ * to v_f or less within a given distance, starting and ending with zero
+ * acceleration. This is the jerk-limited equivalent of
+ * sqrt(v_f^2 + 2 * a_max * dist).
+ * Stopping outright can take less distance than slowing down to a low v_f
+ * (see findSCurveStopTarget), so both are tried. This keeps the result from
+ * dropping when v_f goes up, which would pull the rug out from under a
+ * segment that is already slowing down for the old value.
+ */
+double findSCurveVStart(double v_f, double dist, double a_max, double j_max)
+{
+    return fmax(findSCurveVStartTo(v_f, dist, a_max, j_max),
+            findSCurveVStartTo(0.0, dist, a_max, j_max));
+}
+
+
+/**
+ * Find the maximum speed along an arc allowed by a jerk limit.
+ * The acceleration vector of constant speed circular motion rotates at v / R,
+ * so the jerk is v^3 / R^2 even when speed doesn't change.
+ */
+double findArcJerkVel(double radius, double j_max)
+{
+    return pow(j_max * pmSq(radius), 1.0 / 3.0);
+}
@@ -74,6 +74,7 @@ typedef struct {
     double L2;          /* Available part of line 2 to blend over */
     double v_req;       /* requsted velocity for the blend arc */
     double a_max;       /* max acceleration allowed for blend */
+    double j_max;       /* max jerk allowed for blend, 0 if not limited */
 
     /* These fields are considered "output", and may be refactored into a
      * separate structure in the future */
@@ -234,6 +235,11 @@ double pmCircleActualMaxVel(PmCircle * const circle,
         double v_max,
         double a_max,
         int parabolic);
+double findCurvatureMaxVel(double radius,
+        double * const acc_ratio,
+        double v_max,
+        double a_max,
+        int parabolic);
 int findSpiralArcLengthFit(PmCircle const * const circle,
         SpiralArcLengthFit * const fit);
 double pmCircleAngleFromProgress(PmCircle const * const circle,
@@ -241,4 +247,8 @@ double pmCircleAngleFromProgress(PmCircle const * const circle,
         double progress);
 double pmCircleLength(PmCircle const * const circle);
 double pmCircleEffectiveMinRadius(PmCircle const * const circle);
+double findSCurveStopDist(double v, double a, double v_f, double a_max, double j_max);
+double findSCurveStopPeakAccel(double v, double a, double v_f, double a_max, double j_max);
+double findSCurveVStart(double v_f, double dist, double a_max, double j_max);
+double findArcJerkVel(double radius, double j_max);
 #endif
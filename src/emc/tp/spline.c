@@ -0,0 +1,474 @@
+/********************************************************************
+ * Description: spline.c
+ *
+ * Rational Bezier spline segments for the trajectory planner, evaluated
+ * by arc length.
+ *
+ * License: GPL Version 2
+ * System: Linux
+ *
+ ********************************************************************/
+
+#include "posemath.h"
+#include "spline.h"
+#include "tp_types.h"
+#include "rtapi_math.h"
+
+#include "tp_debug.h"
+
+/* 5 point Gauss-Legendre quadrature on [-1, 1] */
+static const double gl_node[5] = {
+    -0.9061798459386640, -0.5384693101056831, 0.0,
+    0.5384693101056831, 0.9061798459386640
+};
+static const double gl_weight[5] = {
+    0.2369268850561891, 0.4786286704993665, 0.5688888888888889,
+    0.4786286704993665, 0.2369268850561891
+};
+
+/**
+ * Evaluate the curve at t with de Casteljau's algorithm on the homogeneous
+ * control points (w x, w y, w z, w). Gives the point and, if asked for, its
+ * first and second derivatives with respect to t.
+ */
+static void splineEval(PmSpline const * const spline, double t,
+        PmCartesian * const pos, PmCartesian * const d1, PmCartesian * const d2)
+{
+    double h[SPLINE_MAX_ORDER][4];
+    double r1[2][4] = {{0}}, r2[3][4] = {{0}};
+    int degree = spline->order - 1;
+    int i, k, m;
+
+    for (i = 0; i < spline->order; ++i) {
+        double w = spline->weight[i];
+        h[i][0] = spline->ctrl[i].x * w;
+        h[i][1] = spline->ctrl[i].y * w;
+        h[i][2] = spline->ctrl[i].z * w;
+        h[i][3] = w;
+    }
+    // m points are left at each level; the last three and two points give
+    // the second and first derivatives
+    for (m = spline->order; m > 1; --m) {
+        for (k = 0; k < 4; ++k) {
+            if (m == 3) {
+                r2[0][k] = h[0][k];
+                r2[1][k] = h[1][k];
+                r2[2][k] = h[2][k];
+            } else if (m == 2) {
+                r1[0][k] = h[0][k];
+                r1[1][k] = h[1][k];
+            }
+        }
+        for (i = 0; i < m - 1; ++i) {
+            for (k = 0; k < 4; ++k) {
+                h[i][k] += t * (h[i + 1][k] - h[i][k]);
+            }
+        }
+    }
+
+    double w = h[0][3];
+    PmCartesian c = {h[0][0] / w, h[0][1] / w, h[0][2] / w};
+    if (pos) {
+        *pos = c;
+    }
+    if (!d1 && !d2) {
+        return;
+    }
+
+    // Quotient rule on C = A / w, with A' and A'' from the saved levels
+    double dA[4], ddA[4];
+    for (k = 0; k < 4; ++k) {
+        dA[k] = degree * (r1[1][k] - r1[0][k]);
+        ddA[k] = degree > 1 ?
+            degree * (degree - 1) * (r2[2][k] - 2.0 * r2[1][k] + r2[0][k]) : 0.0;
+    }
+    PmCartesian dc = {
+        (dA[0] - dA[3] * c.x) / w,
+        (dA[1] - dA[3] * c.y) / w,
+        (dA[2] - dA[3] * c.z) / w
+    };
+    if (d1) {
+        *d1 = dc;
+    }
+    if (d2) {
+        d2->x = (ddA[0] - 2.0 * dA[3] * dc.x - ddA[3] * c.x) / w;
+        d2->y = (ddA[1] - 2.0 * dA[3] * dc.y - ddA[3] * c.y) / w;
+        d2->z = (ddA[2] - 2.0 * dA[3] * dc.z - ddA[3] * c.z) / w;
+    }
+}
+
+static double splineSpeed(PmSpline const * const spline, double t)
+{
+    PmCartesian d1;
+    double speed;
+    splineEval(spline, t, NULL, &d1, NULL);
+    pmCartMag(&d1, &speed);
+    return speed;
+}
+
+/**
+ * Arc length of the curve from t0 to t1, by Gauss-Legendre quadrature.
+ */
+static double splineLength(PmSpline const * const spline, double t0, double t1)
+{
+    double half = (t1 - t0) / 2.0, mid = (t1 + t0) / 2.0;
+    double sum = 0.0;
+    int i;
+    for (i = 0; i < 5; ++i) {
+        sum += gl_weight[i] * splineSpeed(spline, mid + half * gl_node[i]);
+    }
+    return sum * half;
+}
+
+/**
+ * Angle between two directions, 0 if either is zero.
+ */
+static double splineTurn(PmCartesian const * const u, PmCartesian const * const v)
+{
+    PmCartesian cross;
+    double dot, sine;
+    pmCartCartDot(u, v, &dot);
+    pmCartCartCross(u, v, &cross);
+    pmCartMag(&cross, &sine);
+    if (dot == 0.0 && sine == 0.0) {
+        return 0.0;
+    }
+    return atan2(sine, dot);
+}
+
+/**
+ * Score a step of the length table from t0 to t1. The step needs splitting
+ * if the score is over 1, that is if the length found over the whole step
+ * differs from the sum over its halves by more than tol, or if the tangent
+ * turns by more than SPLINE_MAX_TURN.
+ */
+static double splineStepScore(PmSpline const * const spline, double t0,
+        double t1, double tol)
+{
+    double mid = (t0 + t1) / 2.0;
+    double err = fabs(splineLength(spline, t0, t1) -
+            splineLength(spline, t0, mid) - splineLength(spline, mid, t1));
+    PmCartesian d0, dm, d1;
+    splineEval(spline, t0, NULL, &d0, NULL);
+    splineEval(spline, mid, NULL, &dm, NULL);
+    splineEval(spline, t1, NULL, &d1, NULL);
+    double turn = splineTurn(&d0, &dm) + splineTurn(&dm, &d1);
+    return fmax(err / tol, turn / SPLINE_MAX_TURN);
+}
+
+/**
+ * Radius of curvature |C'|^3 / |C' x C''| at t, TP_BIG_NUM where the curve
+ * is straight.
+ */
+static double splineRadius(PmSpline const * const spline, double t)
+{
+    PmCartesian d1, d2, cross;
+    double speed, bend;
+    splineEval(spline, t, NULL, &d1, &d2);
+    pmCartMag(&d1, &speed);
+    pmCartCartCross(&d1, &d2, &cross);
+    pmCartMag(&cross, &bend);
+    if (!(bend > 0.0) || pmSq(speed) * speed >= bend * TP_BIG_NUM) {
+        return TP_BIG_NUM;
+    }
+    return pmSq(speed) * speed / bend;
+}
+
+/**
+ * Find the smallest radius of curvature from the steps of the length table.
+ * The radius is sampled at the inner step ends and the middle of each step,
+ * and a minimum between two samples is narrowed down by golden section
+ * search. The ends of the curve are left out since a repeated end point
+ * makes C' vanish there.
+ */
+static double splineMinRadius(PmSpline const * const spline)
+{
+    int samples = 2 * spline->steps;
+    double r_min = TP_BIG_NUM;
+    int k_min = 0;
+    int k;
+
+    // Sample k is at t[k / 2], or the middle of step k / 2 for odd k
+    for (k = 1; k < samples; ++k) {
+        double t = (k % 2) ?
+            (spline->t[k / 2] + spline->t[k / 2 + 1]) / 2.0 : spline->t[k / 2];
+        double r = splineRadius(spline, t);
+        if (r < r_min) {
+            r_min = r;
+            k_min = k;
+        }
+    }
+    if (k_min < 2 || k_min > samples - 2 || r_min >= TP_BIG_NUM) {
+        return r_min;
+    }
+
+    // The samples either side of the smallest bracket the minimum
+    double lo = (k_min % 2) ? spline->t[k_min / 2] :
+        (spline->t[k_min / 2 - 1] + spline->t[k_min / 2]) / 2.0;
+    double hi = (k_min % 2) ? spline->t[k_min / 2 + 1] :
+        (spline->t[k_min / 2] + spline->t[k_min / 2 + 1]) / 2.0;
+    const double g = (sqrt(5.0) - 1.0) / 2.0;
+    double a = hi - g * (hi - lo), b = lo + g * (hi - lo);
+    double ra = splineRadius(spline, a), rb = splineRadius(spline, b);
+    int i;
+    for (i = 0; i < SPLINE_RADIUS_ITERATIONS; ++i) {
+        if (ra < rb) {
+            hi = b;
+            b = a;
+            rb = ra;
+            a = hi - g * (hi - lo);
+            ra = splineRadius(spline, a);
+        } else {
+            lo = a;
+            a = b;
+            ra = rb;
+            b = lo + g * (hi - lo);
+            rb = splineRadius(spline, b);
+        }
+    }
+    return fmin(r_min, fmin(ra, rb));
+}
+
+/**
+ * Set up a spline from its control points and weights, and tabulate its
+ * arc length and smallest radius of curvature. Weights must be positive.
+ *
+ * The table starts from SPLINE_START_STEPS even steps of t, and the step
+ * with the worst score is split in half until all are good or the table is
+ * full, so the steps are short where the curve bends sharply.
+ */
+int splineInit(PmSpline * const spline, PmCartesian const * const ctrl,
+        double const * const weight, int order)
+{
+    double score[SPLINE_MAX_STEPS];
+    int i;
+
+    if (!spline) {
+        return TP_ERR_MISSING_OUTPUT;
+    }
+    if (!ctrl || !weight) {
+        return TP_ERR_MISSING_INPUT;
+    }
+    if (order < 2 || order > SPLINE_MAX_ORDER) {
+        return TP_ERR_RANGE;
+    }
+    for (i = 0; i < order; ++i) {
+        if (!(weight[i] > 0.0)) {
+            return TP_ERR_GEOM;
+        }
+        spline->ctrl[i] = ctrl[i];
+        spline->weight[i] = weight[i];
+    }
+    spline->order = order;
+
+    // Rough length, only to scale the tolerance on each step
+    double length = 0.0;
+    for (i = 0; i < SPLINE_START_STEPS; ++i) {
+        length += splineLength(spline, (double) i / SPLINE_START_STEPS,
+                (double) (i + 1) / SPLINE_START_STEPS);
+    }
+    double tol = fmax(length * SPLINE_LENGTH_TOL, SPLINE_POS_EPSILON);
+
+    spline->steps = SPLINE_START_STEPS;
+    for (i = 0; i <= SPLINE_START_STEPS; ++i) {
+        spline->t[i] = (double) i / SPLINE_START_STEPS;
+    }
+    for (i = 0; i < SPLINE_START_STEPS; ++i) {
+        score[i] = splineStepScore(spline, spline->t[i], spline->t[i + 1], tol);
+    }
+    while (spline->steps < SPLINE_MAX_STEPS) {
+        int worst = 0;
+        for (i = 1; i < spline->steps; ++i) {
+            if (score[i] > score[worst]) {
+                worst = i;
+            }
+        }
+        if (score[worst] <= 1.0) {
+            break;
+        }
+        // Make room for the new step end after worst
+        for (i = spline->steps; i > worst; --i) {
+            spline->t[i + 1] = spline->t[i];
+            score[i] = score[i - 1];
+        }
+        spline->steps++;
+        spline->t[worst + 1] = (spline->t[worst] + spline->t[worst + 2]) / 2.0;
+        score[worst] = splineStepScore(spline, spline->t[worst],
+                spline->t[worst + 1], tol);
+        score[worst + 1] = splineStepScore(spline, spline->t[worst + 1],
+                spline->t[worst + 2], tol);
+    }
+
+    /* Each step's length comes from a single quadrature over the step, the
+     * same one splinePoint uses inside it, so the length is continuous
+     * across step ends */
+    spline->s[0] = 0.0;
+    for (i = 0; i < spline->steps; ++i) {
+        spline->s[i + 1] = spline->s[i] +
+            splineLength(spline, spline->t[i], spline->t[i + 1]);
+    }
+    spline->length = spline->s[spline->steps];
+    spline->min_radius = splineMinRadius(spline);
+
+    tp_debug_print("spline order %d, length %f, %d steps, min radius %g\n",
+            order, spline->length, spline->steps, spline->min_radius);
+    return TP_ERR_OK;
+}
+
+/**
+ * Find the point at arc length progress along the spline.
+ *
+ * Newton's method finds the t in the table step holding progress, kept
+ * inside a bracket that shrinks with each iteration. A step that would leave
+ * the bracket, or where the curve stops, is replaced by bisection, so the
+ * search always converges.
+ */
+int splinePoint(PmSpline const * const spline, double progress,
+        PmCartesian * const out)
+{
+    if (progress <= 0.0) {
+        *out = spline->ctrl[0];
+        return TP_ERR_OK;
+    }
+    if (progress >= spline->length) {
+        *out = spline->ctrl[spline->order - 1];
+        return TP_ERR_OK;
+    }
+
+    // Step of the table that holds progress
+    int lo = 0, hi = spline->steps;
+    while (hi - lo > 1) {
+        int mid = (lo + hi) / 2;
+        if (spline->s[mid] <= progress) {
+            lo = mid;
+        } else {
+            hi = mid;
+        }
+    }
+    double t0 = spline->t[lo];
+    double a = t0, b = spline->t[hi];
+    double ds = spline->s[hi] - spline->s[lo];
+    double t = a;
+    if (ds > 0.0) {
+        t += (b - a) * (progress - spline->s[lo]) / ds;
+    }
+
+    // Solve length(t0, t) = progress - s[lo] for t in [a, b]. Rounding in
+    // the quadrature grows with the length.
+    double tol = SPLINE_POS_EPSILON * fmax(spline->length, 1.0);
+    int i;
+    for (i = 0; i < SPLINE_POINT_ITERATIONS; ++i) {
+        double err = spline->s[lo] + splineLength(spline, t0, t) - progress;
+        if (fabs(err) < tol) {
+            break;
+        }
+        if (err < 0.0) {
+            a = t;
+        } else {
+            b = t;
+        }
+        double speed = splineSpeed(spline, t);
+        double t_next = speed > 0.0 ? t - err / speed : a;
+        if (!(t_next > a && t_next < b)) {
+            t_next = (a + b) / 2.0;
+        }
+        if (t_next == t) {
+            break;
+        }
+        t = t_next;
+    }
+    splineEval(spline, t, out, NULL, NULL);
+    return TP_ERR_OK;
+}
+
+/**
+ * Unit tangent at the start or end of the spline. The direction is that of
+ * the first control point that differs from the end point, which stays
+ * correct when end points are repeated.
+ */
+int splineTangent(PmSpline const * const spline, int at_end,
+        PmCartesian * const out)
+{
+    int last = spline->order - 1;
+    int i;
+    for (i = 1; i <= last; ++i) {
+        PmCartesian v;
+        double mag;
+        if (at_end) {
+            pmCartCartSub(&spline->ctrl[last], &spline->ctrl[last - i], &v);
+        } else {
+            pmCartCartSub(&spline->ctrl[i], &spline->ctrl[0], &v);
+        }
+        pmCartMag(&v, &mag);
+        if (mag > SPLINE_POS_EPSILON) {
+            pmCartScalMult(&v, 1.0 / mag, out);
+            return TP_ERR_OK;
+        }
+    }
+    return TP_ERR_GEOM;
+}
+
+/* Knot i of the clamped uniform knot vector of count control points, with
+ * integer knots as in G5.2 */
+static double nurbsKnot(int i, int count, int order)
+{
+    if (i < order) {
+        return 0.0;
+    } else if (i < count) {
+        return i - order + 1;
+    }
+    return count - order + 1;
+}
+
+/**
+ * Convert span number span (counting from 0) of a NURBS curve into a
+ * rational Bezier curve with the same number of control points as the
+ * order. The NURBS has count control points and a clamped uniform knot
+ * vector, so it has count - order + 1 spans.
+ *
+ * Each Bezier control point is a blossom of the span's polynomial in
+ * homogeneous coordinates, found with de Boor's algorithm.
+ */
+int splineNurbsSpan(PmCartesian const * const ctrl,
+        double const * const weight, int count, int order, int span,
+        PmCartesian * const out, double * const out_weight)
+{
+    int degree = order - 1;
+    int m = span + degree;      // knots m and m + 1 bound the span
+    int l, r, i, k;
+
+    if (order < 2 || order > SPLINE_MAX_ORDER || count < order ||
+            span < 0 || span > count - order) {
+        return TP_ERR_RANGE;
+    }
+    double a = nurbsKnot(m, count, order), b = nurbsKnot(m + 1, count, order);
+
+    for (l = 0; l < order; ++l) {
+        double q[SPLINE_MAX_ORDER][4];
+        for (i = 0; i < order; ++i) {
+            double w = weight[span + i];
+            q[i][0] = ctrl[span + i].x * w;
+            q[i][1] = ctrl[span + i].y * w;
+            q[i][2] = ctrl[span + i].z * w;
+            q[i][3] = w;
+        }
+        // Blossom at (a, ..., a, b, ..., b) with b repeated l times
+        for (r = 1; r <= degree; ++r) {
+            double u = r <= degree - l ? a : b;
+            for (i = degree; i >= r; --i) {
+                int g = span + i;
+                double lo = nurbsKnot(g, count, order);
+                double hi = nurbsKnot(g + degree + 1 - r, count, order);
+                double alpha = (u - lo) / (hi - lo);
+                for (k = 0; k < 4; ++k) {
+                    q[i][k] = (1.0 - alpha) * q[i - 1][k] + alpha * q[i][k];
+                }
+            }
+        }
+        out_weight[l] = q[degree][3];
+        out[l].x = q[degree][0] / q[degree][3];
+        out[l].y = q[degree][1] / q[degree][3];
+        out[l].z = q[degree][2] / q[degree][3];
+    }
+    return TP_ERR_OK;
+}
@@ -0,0 +1,72 @@
+/********************************************************************
+ * Description: spline.h
+ *
+ * Rational Bezier spline segments for the trajectory planner, evaluated
+ * by arc length.
+ *
+ * License: GPL Version 2
+ * System: Linux
+ *
+ ********************************************************************/
+#ifndef SPLINE_H
+#define SPLINE_H
+
+#include "posemath.h"
+#include "emcmotcfg.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SPLINE_MAX_ORDER EMCMOT_MAX_SPLINE_ORDER
+// even parameter steps the arc length table starts from, and the most it
+// is split into
+#define SPLINE_START_STEPS 4
+#define SPLINE_MAX_STEPS 32
+// steps are split until the length of each is known to this fraction of the
+// total length and the tangent turns by at most SPLINE_MAX_TURN radians
+#define SPLINE_LENGTH_TOL 1e-10
+#define SPLINE_MAX_TURN 0.2
+// iterations to find the parameter of a length, and to refine the smallest
+// radius of curvature
+#define SPLINE_POINT_ITERATIONS 60
+#define SPLINE_RADIUS_ITERATIONS 40
+#define SPLINE_POS_EPSILON 1e-12
+
+/**
+ * One rational Bezier curve in XYZ.
+ * The curve runs from ctrl[0] (t = 0) to ctrl[order - 1] (t = 1). Positions
+ * along it are given as arc length, looked up in a table of the length at
+ * steps of t and refined with Newton's method. The steps are split where
+ * the curve bends or the length is poorly known, so the table stays small
+ * and the cost per servo cycle is bounded and needs no allocation.
+ */
+typedef struct {
+    PmCartesian ctrl[SPLINE_MAX_ORDER];
+    double weight[SPLINE_MAX_ORDER];
+    int order;                  // number of control points, degree + 1
+    double length;              // total arc length
+    int steps;                  // steps used in the table
+    double t[SPLINE_MAX_STEPS + 1];     // parameter at the end of each step
+    double s[SPLINE_MAX_STEPS + 1];     // arc length at t[i]
+    double min_radius;          // smallest radius of curvature
+} PmSpline;
+
+int splineInit(PmSpline * const spline, PmCartesian const * const ctrl,
+        double const * const weight, int order);
+
+int splinePoint(PmSpline const * const spline, double progress,
+        PmCartesian * const out);
+
+int splineTangent(PmSpline const * const spline, int at_end,
+        PmCartesian * const out);
+
+int splineNurbsSpan(PmCartesian const * const ctrl,
+        double const * const weight, int count, int order, int span,
+        PmCartesian * const out, double * const out_weight);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -22,6 +22,7 @@
 #include "tc.h"
 #include "tp_types.h"
 #include "spherical_arc.h"
+#include "spline.h"
 #include "motion_types.h"
 
 //Debug output
@@ -77,6 +78,8 @@ int tcGetStartAccelUnitVector(TC_STRUCT const * const tc, PmCartesian * const ou
         case TC_CIRCULAR:
             tcCircleStartAccelUnitVector(tc,out);
             break;
+        case TC_SPLINE:
+            return splineTangent(&tc->coords.spline.xyz, false, out);
         case TC_SPHERICAL:
             return -1;
         default:
@@ -101,6 +104,8 @@ int tcGetEndAccelUnitVector(TC_STRUCT const * const tc, PmCartesian * const out)
         case TC_CIRCULAR:
             tcCircleEndAccelUnitVector(tc,out);
             break;
+        case TC_SPLINE:
+            return splineTangent(&tc->coords.spline.xyz, true, out);
        case TC_SPHERICAL:
             return -1;
        default:
@@ -207,6 +212,8 @@ int tcGetStartTangentUnitVector(TC_STRUCT const * const tc, PmCartesian * const
         case TC_CIRCULAR:
             pmCircleTangentVector(&tc->coords.circle.xyz, 0.0, out);
             break;
+        case TC_SPLINE:
+            return splineTangent(&tc->coords.spline.xyz, false, out);
         default:
             rtapi_print_msg(RTAPI_MSG_ERR, "Invalid motion type %d!\n",tc->motion_type);
             return -1;
@@ -230,6 +237,8 @@ int tcGetEndTangentUnitVector(TC_STRUCT const * const tc, PmCartesian * const ou
             pmCircleTangentVector(&tc->coords.circle.xyz,
                     tc->coords.circle.xyz.angle, out);
             break;
+        case TC_SPLINE:
+            return splineTangent(&tc->coords.spline.xyz, true, out);
         default:
             rtapi_print_msg(RTAPI_MSG_ERR, "Invalid motion type %d!\n",tc->motion_type);
             return -1;
@@ -333,6 +342,17 @@ int tcGetPosReal(TC_STRUCT const * const tc, int of_point, EmcPose * const pos)
             abc = tc->coords.arc.abc;
             uvw = tc->coords.arc.uvw;
             break;
+        case TC_SPLINE:
+            splinePoint(&tc->coords.spline.xyz,
+                    progress,
+                    &xyz);
+            pmCartLinePoint(&tc->coords.spline.abc,
+                    progress * tc->coords.spline.abc.tmag / tc->target,
+                    &abc);
+            pmCartLinePoint(&tc->coords.spline.uvw,
+                    progress * tc->coords.spline.uvw.tmag / tc->target,
+                    &uvw);
+            break;
     }
 
     pmCartesianToEmcPose(&xyz, &abc, &uvw, pos);
@@ -555,6 +575,13 @@ int tcSetupState(TC_STRUCT * const tc, TP_STRUCT const * const tp)
     tc->tolerance = tp->tolerance;
     tc->synchronized = tp->synchronized;
     tc->uu_per_rev = tp->uu_per_rev;
+    // Spindle-synchronized moves have to track the spindle, so they don't
+    // get jerk-limited profiles
+    if (tc->synchronized) {
+        tc->maxjerk = 0.0;
+    } else {
+        tc->maxjerk = tp->jMax;
+    }
     return TP_ERR_OK;
 }
 
@@ -623,6 +650,55 @@ double pmCircle9Target(PmCircle9 const * const circ9)
     return helical_length;
 }
 
+/**
+ * Set up a spline segment from the start pose to the end pose. The first and
+ * last control points are replaced by the start and end positions, so the
+ * spline always joins up with the neighbouring segments.
+ */
+int pmSpline9Init(PmSpline9 * const spline9,
+        EmcPose const * const start,
+        EmcPose const * const end,
+        PmCartesian const * const ctrl,
+        double const * const weight,
+        int order)
+{
+    PmCartesian start_xyz, end_xyz;
+    PmCartesian start_uvw, end_uvw;
+    PmCartesian start_abc, end_abc;
+    PmCartesian points[SPLINE_MAX_ORDER];
+    int i;
+
+    if (order < 2 || order > SPLINE_MAX_ORDER) {
+        rtapi_print_msg(RTAPI_MSG_ERR,"Spline order %d out of range\n", order);
+        return TP_ERR_RANGE;
+    }
+
+    emcPoseToPmCartesian(start, &start_xyz, &start_abc, &start_uvw);
+    emcPoseToPmCartesian(end, &end_xyz, &end_abc, &end_uvw);
+
+    for (i = 0; i < order; ++i) {
+        points[i] = ctrl[i];
+    }
+    points[0] = start_xyz;
+    points[order - 1] = end_xyz;
+
+    int xyz_fail = splineInit(&spline9->xyz, points, weight, order);
+    int abc_fail = pmCartLineInit(&spline9->abc, &start_abc, &end_abc);
+    int uvw_fail = pmCartLineInit(&spline9->uvw, &start_uvw, &end_uvw);
+
+    if (xyz_fail || abc_fail || uvw_fail) {
+        rtapi_print_msg(RTAPI_MSG_ERR,"Failed to initialize Spline9, err codes %d, %d, %d\n",
+                xyz_fail, abc_fail, uvw_fail);
+        return TP_ERR_FAIL;
+    }
+    return TP_ERR_OK;
+}
+
+double pmSpline9Target(PmSpline9 const * const spline9)
+{
+    return spline9->xyz.length;
+}
+
 /**
  * "Finalizes" a segment so that its length can't change.
  * By setting the finalized flag, we tell the optimizer that this segment's
@@ -650,6 +726,8 @@ int tcFinalizeLength(TC_STRUCT * const tc)
 
     if (tc->motion_type == TC_CIRCULAR) {
         tc->maxvel = pmCircleActualMaxVel(&tc->coords.circle.xyz, &tc->acc_ratio_tan, tc->maxvel, tc->maxaccel, parabolic);
+    } else if (tc->motion_type == TC_SPLINE) {
+        tc->maxvel = findCurvatureMaxVel(tc->coords.spline.xyz.min_radius, &tc->acc_ratio_tan, tc->maxvel, tc->maxaccel, parabolic);
     }
     tc->finalized = 1;
     return TP_ERR_OK;
@@ -69,6 +69,15 @@ int pmCircle9Init(PmCircle9 * const circ9,
         PmCartesian const * const normal,
         int turn);
 
+int pmSpline9Init(PmSpline9 * const spline9,
+        EmcPose const * const start,
+        EmcPose const * const end,
+        PmCartesian const * const ctrl,
+        double const * const weight,
+        int order);
+
+double pmSpline9Target(PmSpline9 const * const spline9);
+
 int pmRigidTapInit(PmRigidTap * const tap,
         EmcPose const * const start,
         EmcPose const * const end);
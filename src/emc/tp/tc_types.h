@@ -14,6 +14,7 @@
 #define TC_TYPES_H
 
 #include "spherical_arc.h"
+#include "spline.h"
 #include "posemath.h"
 #include "emcpos.h"
 #include "emcmotcfg.h"
@@ -31,7 +32,8 @@ typedef enum {
     TC_LINEAR = 1,
     TC_CIRCULAR = 2,
     TC_RIGIDTAP = 3,
-    TC_SPHERICAL = 4
+    TC_SPHERICAL = 4,
+    TC_SPLINE = 5
 } tc_motion_type_t;
 
 typedef enum {
@@ -83,6 +85,12 @@ typedef struct {
     PmCartesian uvw;
 } Arc9;
 
+typedef struct {
+    PmSpline xyz;
+    PmCartLine abc;
+    PmCartLine uvw;
+} PmSpline9;
+
 typedef enum {
     TAPPING, REVERSING, RETRACTION, FINAL_REVERSAL, FINAL_PLACEMENT
 } RIGIDTAP_STATE;
@@ -126,6 +134,10 @@ typedef struct {
     //Acceleration
     double maxaccel;        // accel calc'd by task
     double acc_ratio_tan;// ratio between normal and tangential accel
+    double currentacc;      // acceleration used for the last cycle
+
+    //Jerk
+    double maxjerk;         // max jerk, 0 for trapezoidal velocity profiles
     
     int id;                 // segment's serial number
 
@@ -134,11 +146,13 @@ typedef struct {
         PmCircle9 circle;
         PmRigidTap rigidtap;
         Arc9 arc;
+        PmSpline9 spline;
     } coords;
 
     int motion_type;       // TC_LINEAR (coords.line) or
                             // TC_CIRCULAR (coords.circle) or
-                            // TC_RIGIDTAP (coords.rigidtap)
+                            // TC_RIGIDTAP (coords.rigidtap) or
+                            // TC_SPLINE (coords.spline)
     int active;            // this motion is being executed
     int canon_motion_type;  // this motion is due to which canon function?
     int term_cond;          // gcode requests continuous feed at the end of
@@ -239,6 +239,31 @@ TC_STRUCT * tcqItem(TC_QUEUE_STRUCT const * const tcq, int n)
     return &(tcq->queue[(tcq->start + n) % tcq->size]);
 }
 
+/*! tcqIndex() function
+ *
+ * \brief find the position of a TC element in the queue
+ *
+ * The inverse of tcqItem(). Since the elements are stored by value, a pointer
+ * that was taken earlier may now refer to a later segment stored in the same
+ * slot; this only checks that it points at a slot that is in use.
+ *
+ * @param    tcq       pointer to the TC_QUEUE_STRUCT
+ * @param    tc        pointer to an element of the queue
+ *
+ * @return	 int       position (0 is the front), or -1 if tc is not in the queue
+ */
+int tcqIndex(TC_QUEUE_STRUCT const * const tcq, TC_STRUCT const * const tc)
+{
+    if (tcqCheck(tcq) || !tc) return -1;
+
+    int slot = tc - tcq->queue;
+    if (slot < 0 || slot >= tcq->size) return -1;
+
+    int n = (slot - tcq->start + tcq->size) % tcq->size;
+    if (n >= tcq->_len) return -1;
+    return n;
+}
+
 /*!
  * \def TC_QUEUE_MARGIN
  * sets up a margin at the end of the queue, to reduce effects of race conditions
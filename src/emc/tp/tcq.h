@@ -58,6 +58,9 @@ extern int tcqLen(TC_QUEUE_STRUCT const * const tcq);
 /* look at nth item, first is 0 */
 extern TC_STRUCT * tcqItem(TC_QUEUE_STRUCT const * const tcq, int n);
 
+/* position of an item, or -1 if it isn't in the queue */
+extern int tcqIndex(TC_QUEUE_STRUCT const * const tcq, TC_STRUCT const * const tc);
+
 /**
  * Get the "end" of the queue, the most recently added item.
  */
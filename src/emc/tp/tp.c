@@ -20,6 +20,7 @@
 #include "motion_debug.h"
 #include "motion_types.h"
 #include "spherical_arc.h"
+#include "spline.h"
 #include "blendmath.h"
 //KLUDGE Don't include all of emc.hh here, just hand-copy the TERM COND
 //definitions until we can break the emc constants out into a separate file.
@@ -61,6 +62,8 @@ STATIC int tpUpdateCycle(TP_STRUCT * const tp,
 
 STATIC int tpRunOptimization(TP_STRUCT * const tp);
 
+STATIC int tpResumeOptimization(TP_STRUCT * const tp, int * const steps);
+
 STATIC inline int tpAddSegmentToQueue(TP_STRUCT * const tp, TC_STRUCT * const tc, int inc_id);
 
 STATIC inline double tpGetMaxTargetVel(TP_STRUCT const * const tp, TC_STRUCT const * const tc);
@@ -106,6 +109,12 @@ STATIC int tpRotaryMotionCheck(TP_STRUCT const * const tp, TC_STRUCT const * con
             } else {
                 return true;
             }
+        case TC_SPLINE:
+            if (tc->coords.spline.abc.tmag_zero && tc->coords.spline.uvw.tmag_zero) {
+                return false;
+            } else {
+                return true;
+            }
         case TC_SPHERICAL:
             return true;
         default:
@@ -283,7 +292,8 @@ STATIC inline double tpGetScaledAccel(TP_STRUCT const * const tp,
     if (tc->term_cond == TC_TERM_COND_PARABOLIC || tc->blend_prev) {
         a_scale *= 0.5;
     }
-    if (tc->motion_type == TC_CIRCULAR || tc->motion_type == TC_SPHERICAL) {
+    if (tc->motion_type == TC_CIRCULAR || tc->motion_type == TC_SPHERICAL ||
+            tc->motion_type == TC_SPLINE) {
         //Limit acceleration for cirular arcs to allow for normal acceleration
         a_scale *= tc->acc_ratio_tan;
     }
@@ -370,6 +380,7 @@ int tpClear(TP_STRUCT * const tp)
     tp->tolerance = 0.0;
     tp->done = 1;
     tp->depth = tp->activeDepth = 0;
+    tp->opt_pending_count = 0;
     tp->aborting = 0;
     tp->pausing = 0;
     tp->synchronized = 0;
@@ -400,6 +411,8 @@ int tpInit(TP_STRUCT * const tp)
     //FIXME this acceleration bound isn't valid (nor is it used)
     tpGetMachineAccelBounds(&acc_bound);
     tpGetMachineActiveLimit(&tp->aMax, &acc_bound);
+    //Trapezoidal velocity profiles until a jerk limit is set
+    tp->jMax = 0.0;
     //Angular limits
     tp->wMax = 0.0;
     tp->wDotMax = 0.0;
@@ -482,6 +495,21 @@ int tpSetAmax(TP_STRUCT * const tp, double aMax)
     return TP_ERR_OK;
 }
 
+/**
+ * Sets the max jerk for subsequent moves.
+ * A jerk limit of 0 selects the usual trapezoidal velocity profiles.
+ */
+int tpSetJmax(TP_STRUCT * const tp, double jMax)
+{
+    if (0 == tp || jMax < 0.0) {
+        return TP_ERR_FAIL;
+    }
+
+    tp->jMax = jMax;
+
+    return TP_ERR_OK;
+}
+
 /**
  * Sets the id that will be used for the next appended motions.
  * nextId is incremented so that the next time a motion is appended its id will
@@ -640,6 +668,9 @@ STATIC double tpCalculateTriangleVel(TP_STRUCT const * const tp, TC_STRUCT * con
     //Compute peak velocity for blend calculations
     double acc_scaled = tpGetScaledAccel(tp, tc);
     double triangle_vel = pmSqrt( acc_scaled * tc->target);
+    if (tc->maxjerk > 0.0) {
+        triangle_vel = findSCurveVStart(0.0, tc->target / 2.0, acc_scaled, tc->maxjerk);
+    }
     tp_debug_print("triangle vel for segment %d is %f\n", tc->id, triangle_vel);
 
     return triangle_vel;
@@ -659,6 +690,10 @@ STATIC double tpCalculateOptimizationInitialVel(TP_STRUCT const * const tp, TC_S
     double acc_scaled = tpGetScaledAccel(tp, tc);
     //FIXME this is defined in two places!
     double triangle_vel = pmSqrt( acc_scaled * tc->target * BLEND_DIST_FRACTION);
+    if (tc->maxjerk > 0.0) {
+        triangle_vel = findSCurveVStart(0.0, tc->target * BLEND_DIST_FRACTION / 2.0,
+                acc_scaled, tc->maxjerk);
+    }
     double max_vel = tpGetMaxTargetVel(tp, tc);
     tp_debug_print("optimization initial vel for segment %d is %f\n", tc->id, triangle_vel);
     return fmin(triangle_vel, max_vel);
@@ -1424,8 +1459,18 @@ STATIC int tpComputeOptimalVelocity(TP_STRUCT const * const tp, TC_STRUCT * cons
 
     // Find the reachable velocity of tc, moving backwards in time
     double vs_back = pmSqrt(pmSq(tc->finalvel) + 2.0 * acc_this * tc->target);
+    if (tc->maxjerk > 0.0) {
+        // Assumes tc starts with zero acceleration. If the previous segment
+        // is still speeding up when it ends, tpCheckSCurveStops makes room.
+        vs_back = findSCurveVStart(tc->finalvel, tc->target, acc_this, tc->maxjerk);
+    }
     // Find the reachable velocity of prev1_tc, moving forwards in time
 
+    //Reduce max velocity to match sample rate (before using it, so that the
+    //result doesn't depend on whether tc has been optimized before)
+    double sample_maxvel = tc->target / (tp->cycleTime * TP_MIN_SEGMENT_CYCLES);
+    tc->maxvel = fmin(tc->maxvel, sample_maxvel);
+
     double vf_limit_this = tc->maxvel;
     //Limit the PREVIOUS velocity by how much we can overshoot into
     double vf_limit_prev = prev1_tc->maxvel;
@@ -1441,10 +1486,6 @@ STATIC int tpComputeOptimalVelocity(TP_STRUCT const * const tp, TC_STRUCT * cons
     //Limit tc's target velocity to avoid creating "humps" in the velocity profile
     prev1_tc->finalvel = vs_back;
 
-    //Reduce max velocity to match sample rate
-    double sample_maxvel = tc->target / (tp->cycleTime * TP_MIN_SEGMENT_CYCLES);
-    tc->maxvel = fmin(tc->maxvel, sample_maxvel);
-
     tp_info_print(" prev1_tc-> fv = %f, tc->fv = %f, capped target = %f\n",
             prev1_tc->finalvel, tc->finalvel, tc->target_vel);
 
@@ -1452,15 +1493,42 @@ STATIC int tpComputeOptimalVelocity(TP_STRUCT const * const tp, TC_STRUCT * cons
 }
 
 
+/**
+ * Remember that an optimization pass ran out of steps at tc, so that the
+ * segments before it can be updated later. If too many passes are pending
+ * the pass is dropped, which is safe: the segments before tc just keep
+ * their older, lower final velocities.
+ */
+STATIC int tpDeferOptimization(TP_STRUCT * const tp, TC_STRUCT * const tc) {
+    int i;
+    for (i = 0; i < tp->opt_pending_count; ++i) {
+        if (tp->opt_pending[i] == tc) {
+            return TP_ERR_OK;
+        }
+    }
+    if (tp->opt_pending_count >= TP_OPTIMIZATION_PENDING) {
+        tp_debug_print("too many pending optimization passes, dropping one at id %d\n", tc->id);
+        return TP_ERR_NO_ACTION;
+    }
+    tp->opt_pending[tp->opt_pending_count++] = tc;
+    return TP_ERR_OK;
+}
+
 /**
  * Do "rising tide" optimization to find allowable final velocities for each queued segment.
- * Walk along the queue from the back to the front. Based on the "current"
- * segment's final velocity, calculate the previous segment's maximum allowable
- * final velocity. The depth we walk along the queue is controlled by the
- * TP_LOOKAHEAD_DEPTH constant for now. The process safetly aborts early due to
- * a short queue or other conflicts.
+ * Walk along the queue from the segment at index start towards the front.
+ * Based on the "current" segment's final velocity, calculate the previous
+ * segment's maximum allowable final velocity. The depth we walk along the
+ * queue (measured from the back) is limited by ARC_BLEND_OPTIMIZATION_DEPTH.
+ * The process safetly aborts early due to a short queue or other conflicts.
+ *
+ * The result for a segment only depends on the segments after it, so once a
+ * segment's final velocity comes out the same as on the previous pass, the
+ * ones before it would too, and the pass stops there. This keeps the work per
+ * new segment small even with a deep lookahead. Each step uses up one of
+ * *steps; if they run out, the pass is deferred and resumed later.
  */
-STATIC int tpRunOptimization(TP_STRUCT * const tp) {
+STATIC int tpOptimizeFrom(TP_STRUCT * const tp, int start, int * const steps) {
     // Pointers to the "current", previous, and 2nd previous trajectory
     // components. Current in this context means the segment being optimized,
     // NOT the currently excecuting segment.
@@ -1468,21 +1536,15 @@ STATIC int tpRunOptimization(TP_STRUCT * const tp) {
     TC_STRUCT *tc;
     TC_STRUCT *prev1_tc;
 
-    int ind, x;
+    int ind;
     int len = tcqLen(&tp->queue);
-    //TODO make lookahead depth configurable from the INI file
 
     int hit_peaks = 0;
 
-    /* Starting at the 2nd to last element in the queue, work backwards towards
-     * the front. We can't do anything with the very last element because its
-     * length may change if a new line is added to the queue.*/
-
-    for (x = 1; x < emcmotConfig->arcBlendOptDepth + 2; ++x) {
-        tp_info_print("==== Optimization step %d ====\n",x-2);
+    for (ind = start; len - ind < emcmotConfig->arcBlendOptDepth + 2; --ind) {
+        tp_info_print("==== Optimization step %d ====\n", len - ind - 2);
 
         // Update the pointers to the trajectory segments in use
-        ind = len-x;
         tc = tcqItem(&tp->queue, ind);
         prev1_tc = tcqItem(&tp->queue, ind-1);
 
@@ -1516,11 +1578,20 @@ STATIC int tpRunOptimization(TP_STRUCT * const tp) {
             return TP_ERR_OK;
         }
 
+        if (*steps <= 0) {
+            tp_debug_print("Out of optimization steps at id %d, deferring\n", tc->id);
+            tpDeferOptimization(tp, tc);
+            return TP_ERR_OK;
+        }
+        --*steps;
+
         tp_info_print("  current term = %u, type = %u, id = %u, accel_mode = %d\n",
                 tc->term_cond, tc->motion_type, tc->id, tc->accel_mode);
         tp_info_print("  prev term = %u, type = %u, id = %u, accel_mode = %d\n",
                 prev1_tc->term_cond, prev1_tc->motion_type, prev1_tc->id, prev1_tc->accel_mode);
 
+        double prev_finalvel = prev1_tc->finalvel;
+
         if (tc->atspeed) {
             //Assume worst case that we have a stop at this point. This may cause a
             //slight hiccup, but the alternative is a sudden hard stop.
@@ -1537,7 +1608,13 @@ STATIC int tpRunOptimization(TP_STRUCT * const tp) {
             tpComputeOptimalVelocity(tp, tc, prev1_tc);
         }
 
-        tc->active_depth = x - 2 - hit_peaks;
+        tc->active_depth = len - ind - 2 - hit_peaks;
+
+        if (tc->finalized && fabs(prev1_tc->finalvel - prev_finalvel) < TP_VEL_EPSILON) {
+            tp_debug_print("Final velocity of id %d unchanged, stopping optimization\n",
+                    prev1_tc->id);
+            return TP_ERR_OK;
+        }
 #ifdef TP_OPTIMIZATION_LAZY
         if (tc->optimization_state == TC_OPTIM_AT_MAX) {
             hit_peaks++;
@@ -1552,6 +1629,35 @@ STATIC int tpRunOptimization(TP_STRUCT * const tp) {
     return TP_ERR_OK;
 }
 
+/**
+ * Continue optimization passes that ran out of steps earlier.
+ */
+STATIC int tpResumeOptimization(TP_STRUCT * const tp, int * const steps) {
+    while (*steps > 0 && tp->opt_pending_count > 0) {
+        TC_STRUCT *tc = tp->opt_pending[--tp->opt_pending_count];
+        int ind = tcqIndex(&tp->queue, tc);
+        if (ind < 0) {
+            // Already consumed, nothing left to do
+            continue;
+        }
+        tpOptimizeFrom(tp, ind, steps);
+    }
+    return TP_ERR_OK;
+}
+
+/**
+ * Optimize the final velocities of the queued segments after a segment is
+ * added. Starting at the last element in the queue, work backwards towards
+ * the front. We can't do much with the very last element because its length
+ * may change if a new line is added to the queue.
+ */
+STATIC int tpRunOptimization(TP_STRUCT * const tp) {
+    int steps = TP_OPTIMIZATION_MAX_STEPS;
+
+    tpOptimizeFrom(tp, tcqLen(&tp->queue) - 1, &steps);
+    return tpResumeOptimization(tp, &steps);
+}
+
 STATIC double pmCartAbsMax(PmCartesian const * const v)
 {
     return fmax(fmax(fabs(v->x),fabs(v->y)),fabs(v->z));
@@ -1633,7 +1739,8 @@ STATIC int tpSetupTangent(TP_STRUCT const * const tp,
 
     double acc_scale_max = pmCartAbsMax(&acc_scale);
     //KLUDGE lumping a few calculations together here
-    if (prev_tc->motion_type == TC_CIRCULAR || tc->motion_type == TC_CIRCULAR) {
+    if (prev_tc->motion_type == TC_CIRCULAR || tc->motion_type == TC_CIRCULAR ||
+            prev_tc->motion_type == TC_SPLINE || tc->motion_type == TC_SPLINE) {
         acc_scale_max /= BLEND_ACC_RATIO_NORMAL;
     }
 
@@ -1873,6 +1980,10 @@ int tpAddCircle(TP_STRUCT * const tp,
 
     double v_max_actual = pmCircleActualMaxVel(&tc.coords.circle.xyz, &tc.acc_ratio_tan, ini_maxvel, acc, false);
     tp_debug_print("tc.acc_ratio_tan = %f\n",tc.acc_ratio_tan);
+    if (tc.maxjerk > 0.0) {
+        double eff_radius = pmCircleEffectiveMinRadius(&tc.coords.circle.xyz);
+        v_max_actual = fmin(v_max_actual, findArcJerkVel(eff_radius, tc.maxjerk));
+    }
 
     // Copy in motion parameters
     tcSetupMotion(&tc,
@@ -1899,6 +2010,100 @@ int tpAddCircle(TP_STRUCT * const tp,
 }
 
 
+/**
+ * Adds a spline move from the end of the last move to this new position.
+ *
+ * The spline is a rational Bezier curve in XYZ with order control points,
+ * of which the first and last are taken from the current and the new end
+ * position. ABC and UVW move linearly along with it. A whole span of a NURBS
+ * goes in one segment, which the planner walks through by arc length.
+ */
+int tpAddSpline(TP_STRUCT * const tp,
+        EmcPose end,
+        PmCartesian const * const ctrl,
+        double const * const weight,
+        int order,
+        int canon_motion_type,
+        double vel,
+        double ini_maxvel,
+        double acc,
+        unsigned char enables,
+        char atspeed)
+{
+    if (tpErrorCheck(tp)<0) {
+        return TP_ERR_FAIL;
+    }
+
+    tp_info_print("== AddSpline ==\n");
+    tp_debug_print("ini_maxvel = %f\n",ini_maxvel);
+
+    TC_STRUCT tc = {0};
+
+    tcInit(&tc,
+            TC_SPLINE,
+            canon_motion_type,
+            tp->cycleTime,
+            enables,
+            atspeed);
+    // Setup any synced IO for this move
+    tpSetupSyncedIO(tp, &tc);
+
+    // Copy over state data from the trajectory planner
+    tcSetupState(&tc, tp);
+
+    // Setup spline geometry
+    int res_init = pmSpline9Init(&tc.coords.spline,
+            &tp->goalPos,
+            &end,
+            ctrl,
+            weight,
+            order);
+
+    if (res_init) return res_init;
+
+    tc.target = pmSpline9Target(&tc.coords.spline);
+    if (tc.target < TP_POS_EPSILON) {
+        return TP_ERR_ZERO_LENGTH;
+    }
+    tp_debug_print("tc.target = %f\n",tc.target);
+    tc.nominal_length = tc.target;
+
+    //Reduce max velocity to match sample rate
+    double sample_maxvel = tc.target / (tp->cycleTime * TP_MIN_SEGMENT_CYCLES);
+    ini_maxvel = fmin(ini_maxvel, sample_maxvel);
+
+    double v_max_actual = findCurvatureMaxVel(tc.coords.spline.xyz.min_radius,
+            &tc.acc_ratio_tan, ini_maxvel, acc, false);
+    if (tc.maxjerk > 0.0) {
+        v_max_actual = fmin(v_max_actual,
+                findArcJerkVel(tc.coords.spline.xyz.min_radius, tc.maxjerk));
+    }
+
+    // Copy in motion parameters
+    tcSetupMotion(&tc,
+            vel,
+            v_max_actual,
+            acc);
+
+    TC_STRUCT *prev_tc;
+    prev_tc = tcqLast(&tp->queue);
+
+    tpCheckCanonType(prev_tc, &tc);
+    if (emcmotConfig->arcBlendEnable){
+        // No blend arcs into a spline, but a tangent join is still found
+        tpHandleBlendArc(tp, &tc);
+    }
+    tcCheckLastParabolic(&tc, prev_tc);
+    tcFinalizeLength(prev_tc);
+    tcFlagEarlyStop(prev_tc, &tc);
+
+    int retval = tpAddSegmentToQueue(tp, &tc, true);
+
+    tpRunOptimization(tp);
+    return retval;
+}
+
+
 /**
  * Adjusts blend velocity and acceleration to safe limits.
  * If we are blending between tc and nexttc, then we need to figure out what a
@@ -2004,7 +2209,13 @@ STATIC int tcUpdateDistFromAccel(TC_STRUCT * const tc, double acc, double vel_de
         //also occurs during pausing and stopping, which can happen far from
         //the end. If we could "cruise" to the endpoint within a cycle at our
         //current speed, then assume that we want to be at the end.
-        if ((tc->target - tc->progress) < (tc->currentvel *  tc->cycle_time)) {
+        double dx_snap = tc->currentvel * tc->cycle_time;
+        if (tc->maxjerk > 0.0) {
+            // Jerk-limited stops can't land on a cycle boundary either, and
+            // may come up short by about one cycle's worth of jerk
+            dx_snap += tc->maxjerk * pmSq(tc->cycle_time) * tc->cycle_time;
+        }
+        if ((tc->target - tc->progress) < dx_snap) {
             tc->progress = tc->target;
         }
     } else {
@@ -2156,6 +2367,151 @@ STATIC int tpCalculateRampAccel(TP_STRUCT const * const tp,
     return TP_ERR_OK;
 }
 
+/**
+ * Check if a cycle at acceleration acc still leaves room to slow down to
+ * v_final within dist_after past the end of the segment, within the jerk limit.
+ * Acceleration only changes once per cycle, in steps of up to
+ * maxjerk * cycle_time. A staircase like this moves exactly like a continuous
+ * jerk-limited ramp through the middle of each step, so the stopping
+ * distance is found from the middle of this cycle. The velocity matches the
+ * ramp exactly, but each step of a ramp down moves maxjerk * cycle_time^3 / 24
+ * further than the ramp does, so that much is added per step.
+ * Returns the amount the check fails by, or zero (or less) if it passes.
+ */
+STATIC double tpCheckSCurveStop(TC_STRUCT const * const tc, double acc,
+        double v_final, double dist_after, double a_max)
+{
+    double dt_mid = tc->cycle_time / 2.0;
+    double v_mid = fmax(tc->currentvel + acc * dt_mid, 0.0);
+    double dx_mid = tc->target - tc->progress + dist_after -
+        (tc->currentvel + v_mid) * 0.5 * dt_mid;
+    double a_peak = findSCurveStopPeakAccel(v_mid, acc, v_final, a_max, tc->maxjerk);
+    double margin = fmax(acc - a_peak, 0.0) * pmSq(tc->cycle_time) / 24.0;
+    return findSCurveStopDist(v_mid, acc, v_final, a_max, tc->maxjerk) + margin - dx_mid;
+}
+
+/**
+ * Check if a cycle at acceleration acc leaves room to slow down for the end
+ * of this segment and the end of the next one.
+ * The next segment's start velocity is planned as if it starts with zero
+ * acceleration. If this segment is still speeding up when it ends, the next
+ * one needs extra room to level off, so check across the junction too.
+ * Returns the larger amount the checks fail by, as tpCheckSCurveStop.
+ */
+STATIC double tpCheckSCurveStops(TP_STRUCT const * const tp,
+        TC_STRUCT const * const tc, TC_STRUCT const * const nexttc,
+        double acc, double v_final, double a_max)
+{
+    double shortfall = tpCheckSCurveStop(tc, acc, v_final, 0.0, a_max);
+    if (!nexttc || v_final <= 0.0) {
+        return shortfall;
+    }
+
+    double v_next = 0.0;
+    if (nexttc->term_cond == TC_TERM_COND_TANGENT) {
+        v_next = fmin(nexttc->finalvel, tpGetRealTargetVel(tp, nexttc));
+    }
+    double a_next = fmin(a_max, tpGetScaledAccel(tp, nexttc));
+    return fmax(shortfall,
+            tpCheckSCurveStop(tc, acc, v_next, nexttc->target, a_next));
+}
+
+/**
+ * Check if a cycle at acceleration acc can still level off at v_target
+ * without overshooting it, within the jerk limit.
+ */
+STATIC int tpCheckSCurveTarget(TC_STRUCT const * const tc, double acc,
+        double v_target)
+{
+    double v_mid = tc->currentvel + acc * tc->cycle_time / 2.0;
+    return v_mid + acc * fabs(acc) / (2.0 * tc->maxjerk) <= v_target;
+}
+
+/**
+ * Calculate jerk-limited ("S-curve") acceleration for a cycle.
+ * The acceleration can only change by maxjerk * cycle_time from the last
+ * cycle. Within that window, pick the highest acceleration that can still
+ * level off at the target velocity and slow down to the final velocity in
+ * the remaining distance. If the lowest one only misses the final velocity
+ * by a rounding-sized amount, or is already at -a_max, brake as hard as the
+ * jerk limit allows anyway. If it misses by more (e.g. after a sudden feed
+ * override change), fail so that the caller falls back to a trapezoidal
+ * profile.
+ */
+STATIC int tpCalculateSCurveAccel(TP_STRUCT const * const tp,
+        TC_STRUCT * const tc,
+        TC_STRUCT const * const nexttc,
+        double * const acc,
+        double * const vel_desired)
+{
+    tc_debug_print("using jerk-limited acceleration\n");
+
+    double v_target = tpGetRealTargetVel(tp, tc);
+    double v_final = tpGetRealFinalVel(tp, tc, nexttc);
+    double a_max = tpGetScaledAccel(tp, tc);
+
+    if (tc->cycle_time < tp->cycleTime) {
+        // Rest of a cycle split with the previous segment, which already
+        // picked the acceleration for the whole cycle. The checks below only
+        // hold from the middle of a whole cycle, so don't redo them here.
+        *acc = saturate(tc->currentacc, a_max);
+        *vel_desired = v_target;
+        return TP_ERR_OK;
+    }
+
+    double a_step = tc->maxjerk * tc->cycle_time;
+    if (a_step >= 2.0 * a_max) {
+        // Any acceleration is reachable in one cycle, so there's nothing to limit
+        return TP_ERR_FAIL;
+    }
+    double a_low = fmax(tc->currentacc - a_step, -a_max);
+    double a_high = fmin(tc->currentacc + a_step, a_max);
+    // Don't slow down past zero, so that the velocity isn't clipped instead
+    a_low = fmin(fmax(a_low, -tc->currentvel / tc->cycle_time), a_high);
+
+    double shortfall = tpCheckSCurveStops(tp, tc, nexttc, a_low, v_final, a_max);
+    if (shortfall > 0.0) {
+        tc_debug_print(" short of final vel %f by %e\n", v_final, shortfall);
+        // A trapezoidal profile can't slow down any harder than a_max either
+        if (a_low > -a_max && shortfall >
+                TP_SCURVE_SHORTFALL_CYCLES * tc->maxjerk * pmSq(tp->cycleTime) * tp->cycleTime) {
+            return TP_ERR_FAIL;
+        }
+        *acc = a_low;
+        *vel_desired = v_target;
+        return TP_ERR_OK;
+    }
+
+    if (tpCheckSCurveStops(tp, tc, nexttc, a_high, v_final, a_max) <= 0.0 &&
+            tpCheckSCurveTarget(tc, a_high, v_target)) {
+        *acc = a_high;
+    } else {
+        // Both checks only get harder as acceleration increases, so bisect
+        // for the limit. a_low is used even if it overshoots the target
+        // velocity, since that's the fastest we can slow down.
+        int i;
+        for (i = 0; i < TP_SCURVE_ITERATIONS; ++i) {
+            double a_mid = (a_low + a_high) / 2.0;
+            if (tpCheckSCurveStops(tp, tc, nexttc, a_mid, v_final, a_max) <= 0.0 &&
+                    tpCheckSCurveTarget(tc, a_mid, v_target)) {
+                a_low = a_mid;
+            } else {
+                a_high = a_mid;
+            }
+        }
+        *acc = a_low;
+    }
+
+    if (*acc <= 0.0 && tc->currentvel <= 0.0) {
+        // Stopped just short of the end, let the trapezoidal profile finish
+        tc_debug_print(" stalled with dx = %e\n", tc->target - tc->progress);
+        return TP_ERR_FAIL;
+    }
+
+    *vel_desired = v_target;
+    return TP_ERR_OK;
+}
+
 void tpToggleDIOs(TC_STRUCT * const tc) {
 
     int i=0;
@@ -2338,6 +2694,7 @@ STATIC void tpHandleEmptyQueue(TP_STRUCT * const tp)
     tp->goalPos = tp->currentPos;
     tp->done = 1;
     tp->depth = tp->activeDepth = 0;
+    tp->opt_pending_count = 0;
     tp->aborting = 0;
     tp->execId = 0;
     tp->motionType = 0;
@@ -2418,6 +2775,7 @@ STATIC int tpHandleAbort(TP_STRUCT * const tp, TC_STRUCT * const tc,
         tp->goalPos = tp->currentPos;
         tp->done = 1;
         tp->depth = tp->activeDepth = 0;
+        tp->opt_pending_count = 0;
         tp->aborting = 0;
         tp->execId = 0;
         tp->motionType = 0;
@@ -2550,6 +2908,7 @@ STATIC int tpActivateSegment(TP_STRUCT * const tp, TC_STRUCT * const tc) {
 
 
     if (segment_time < cutoff_time &&
+            tc->maxjerk <= 0.0 &&
             tc->canon_motion_type != EMC_MOTION_TYPE_TRAVERSE &&
             tc->term_cond == TC_TERM_COND_TANGENT &&
             tc->motion_type != TC_RIGIDTAP)
@@ -2747,9 +3106,12 @@ STATIC int tpUpdateCycle(TP_STRUCT * const tp,
     int res_accel = 1;
     double acc, vel_desired;
     
-    // If the slowdown is not too great, use velocity ramping instead of trapezoidal velocity
-    // Also, don't ramp up for parabolic blends
-    if (tc->accel_mode && tc->term_cond == TC_TERM_COND_TANGENT) {
+    // Use jerk-limited acceleration if the segment has a jerk limit.
+    // Otherwise, if the slowdown is not too great, use velocity ramping
+    // instead of trapezoidal velocity. Also, don't ramp up for parabolic blends
+    if (tc->maxjerk > 0.0) {
+        res_accel = tpCalculateSCurveAccel(tp, tc, nexttc, &acc, &vel_desired);
+    } else if (tc->accel_mode && tc->term_cond == TC_TERM_COND_TANGENT) {
         res_accel = tpCalculateRampAccel(tp, tc, nexttc, &acc, &vel_desired);
     }
 
@@ -2759,6 +3121,12 @@ STATIC int tpUpdateCycle(TP_STRUCT * const tp,
     }
 
     tcUpdateDistFromAccel(tc, acc, vel_desired);
+    // Remember the acceleration so that the next cycle can limit jerk
+    if (tc->currentvel > 0.0) {
+        tc->currentacc = acc;
+    } else {
+        tc->currentacc = fmax(acc, 0.0);
+    }
     tpDebugCycleInfo(tp, tc, nexttc, acc);
 
     //Check if we're near the end of the cycle and set appropriate changes
@@ -2798,10 +3166,12 @@ STATIC int tpUpdateInitialStatus(TP_STRUCT const * const tp) {
 /**
  * Flag a segment as needing a split cycle.
  * In addition to flagging a segment as splitting, do any preparations to store
- * data for the next cycle.
+ * data for the next cycle. The final velocity and acceleration are handed on
+ * to the next segment in a tangent split, so they have to match the profile
+ * that brought the segment to its end.
  */
 STATIC inline int tcSetSplitCycle(TC_STRUCT * const tc, double split_time,
-        double v_f)
+        double v_f, double a_f)
 {
     tp_debug_print("split time for id %d is %.16g\n", tc->id, split_time);
     if (tc->splitting != 0 && split_time > 0.0) {
@@ -2815,10 +3185,59 @@ STATIC inline int tcSetSplitCycle(TC_STRUCT * const tc, double split_time,
     tc->splitting = 1;
     tc->cycle_time = split_time;
     tc->term_vel = v_f;
+    tc->currentacc = a_f;
     return 0;
 }
 
 
+/**
+ * Find the split time for a segment with a jerk-limited profile.
+ * Unlike the trapezoidal estimate, which assumes that the final velocity is
+ * reached however much acceleration it takes, the segment runs out the end
+ * at the jerk-limited acceleration it would pick for the next cycle. The
+ * velocity and acceleration then carry on into the next segment without a
+ * step.
+ */
+STATIC int tpCheckSCurveEndCondition(TP_STRUCT const * const tp,
+        TC_STRUCT * const tc, TC_STRUCT const * const nexttc, double dx)
+{
+    double v = tc->currentvel;
+    double a, v_desired;
+    if (tpCalculateSCurveAccel(tp, tc, nexttc, &a, &v_desired) != TP_ERR_OK) {
+        // Too close to the end to plan from the middle of the cycle, so
+        // slow down as hard as the jerk limit allows
+        a = fmax(tc->currentacc - tc->maxjerk * tp->cycleTime,
+                -tpGetScaledAccel(tp, tc));
+    }
+
+    // Solve dx = v * dt + a * dt^2 / 2 for the time to reach the end
+    double disc = pmSq(v) + 2.0 * a * dx;
+    if (disc < 0.0) {
+        tc_debug_print(" slowing down short of the end, dx = %e\n", dx);
+        return TP_ERR_NO_ACTION;
+    }
+    // Rearranged quadratic formula, stable for a near 0
+    double denom = v + pmSqrt(disc);
+    if (denom < TP_VEL_EPSILON) {
+        tc_debug_print(" stopped short of the end, dx = %e\n", dx);
+        return TP_ERR_NO_ACTION;
+    }
+    double dt = 2.0 * dx / denom;
+
+    if (dt < TP_TIME_EPSILON) {
+        tc_debug_print("revised dt small, finishing tc\n");
+        tc->progress = tc->target;
+        tcSetSplitCycle(tc, 0.0, v, a);
+    } else if (dt < tp->cycleTime) {
+        tc_debug_print(" v_f = %f, a = %f\n", v + a * dt, a);
+        tcSetSplitCycle(tc, dt, v + a * dt, a);
+    } else {
+        tc_debug_print(" dt = %f, not at end yet\n", dt);
+    }
+    return TP_ERR_OK;
+}
+
+
 /**
  * Check remaining time in a segment and calculate split cycle if necessary.
  * This function estimates how much time we need to complete the next segment.
@@ -2840,7 +3259,7 @@ STATIC int tpCheckEndCondition(TP_STRUCT const * const tp, TC_STRUCT * const tc,
         tp_debug_print("close to target, dx = %.12f\n",dx);
         //Force progress to land exactly on the target to prevent numerical errors.
         tc->progress = tc->target;
-        tcSetSplitCycle(tc, 0.0, tc->currentvel);
+        tcSetSplitCycle(tc, 0.0, tc->currentvel, tc->currentacc);
         if (tc->term_cond == TC_TERM_COND_STOP || tc->term_cond == TC_TERM_COND_EXACT) {
             tc->remove = 1;
         }
@@ -2849,6 +3268,9 @@ STATIC int tpCheckEndCondition(TP_STRUCT const * const tp, TC_STRUCT * const tc,
         return TP_ERR_NO_ACTION;
     }
 
+    if (tc->maxjerk > 0.0) {
+        return tpCheckSCurveEndCondition(tp, tc, nexttc, dx);
+    }
 
     double v_f = tpGetRealFinalVel(tp, tc, nexttc);
     double v_avg = (tc->currentvel + v_f) / 2.0;
@@ -2916,10 +3338,10 @@ STATIC int tpCheckEndCondition(TP_STRUCT const * const tp, TC_STRUCT * const tc,
         //Close enough, call it done
         tc_debug_print("revised dt small, finishing tc\n");
         tc->progress = tc->target;
-        tcSetSplitCycle(tc, 0.0, v_f);
+        tcSetSplitCycle(tc, 0.0, v_f, a);
     } else if (dt < tp->cycleTime ) {
         tc_debug_print(" corrected v_f = %f, a = %f\n", v_f, a);
-        tcSetSplitCycle(tc, dt, v_f);
+        tcSetSplitCycle(tc, dt, v_f, a);
     } else {
         tc_debug_print(" dt = %f, not at end yet\n",dt);
     }
@@ -2968,6 +3390,7 @@ STATIC int tpHandleSplitCycle(TP_STRUCT * const tp, TC_STRUCT * const tc,
         case TC_TERM_COND_TANGENT:
             nexttc->cycle_time = tp->cycleTime - tc->cycle_time;
             nexttc->currentvel = tc->term_vel;
+            nexttc->currentacc = tc->currentacc;
             tp_debug_print("Doing tangent split\n");
             break;
         case TC_TERM_COND_PARABOLIC:
@@ -3057,6 +3480,12 @@ int tpRunCycle(TP_STRUCT * const tp, long period)
         return TP_ERR_WAITING;
     }
 
+    //Finish any optimization passes that ran out of steps
+    if (tp->opt_pending_count > 0) {
+        int steps = TP_OPTIMIZATION_MAX_STEPS;
+        tpResumeOptimization(tp, &steps);
+    }
+
     tc_debug_print("-------------------\n");
 
 #ifdef TC_DEBUG
@@ -27,6 +27,7 @@ int tpSetCycleTime(TP_STRUCT * const tp, double secs);
 int tpSetVmax(TP_STRUCT * const tp, double vmax, double ini_maxvel);
 int tpSetVlimit(TP_STRUCT * const tp, double vLimit);
 int tpSetAmax(TP_STRUCT * const tp, double aMax);
+int tpSetJmax(TP_STRUCT * const tp, double jMax);
 int tpSetId(TP_STRUCT * const tp, int id);
 int tpGetExecId(TP_STRUCT * const tp);
 int tpSetTermCond(TP_STRUCT * const tp, int cond, double tolerance);
@@ -40,6 +41,9 @@ int tpAddLine(TP_STRUCT * const tp, EmcPose end, int canon_motion_type, double v
 int tpAddCircle(TP_STRUCT * const tp, EmcPose end, PmCartesian center,
         PmCartesian normal, int turn, int canon_motion_type, double vel, double ini_maxvel,
                        double acc, unsigned char enables, char atspeed);
+int tpAddSpline(TP_STRUCT * const tp, EmcPose end, PmCartesian const * const ctrl,
+        double const * const weight, int order, int canon_motion_type, double vel,
+        double ini_maxvel, double acc, unsigned char enables, char atspeed);
 int tpRunCycle(TP_STRUCT * const tp, long period);
 int tpPause(TP_STRUCT * const tp);
 int tpResume(TP_STRUCT * const tp);
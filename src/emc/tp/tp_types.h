@@ -27,6 +27,17 @@
 /* Values chosen for accel ratio to match parabolic blend acceleration
  * limits. */
 #define TP_OPTIMIZATION_CUTOFF 4
+/* Most segments the optimizer may visit in one call, to keep its cost within
+ * a servo cycle bounded however deep the lookahead is. A pass that runs out
+ * is resumed later. */
+#define TP_OPTIMIZATION_MAX_STEPS 100
+/* Number of unfinished optimization passes that are remembered */
+#define TP_OPTIMIZATION_PENDING 8
+/* Bisection steps used to find jerk-limited acceleration */
+#define TP_SCURVE_ITERATIONS 16
+/* Largest shortfall in stopping distance, in cycles of jerk, that is braked
+ * through at the jerk limit instead of falling back to a trapezoidal profile */
+#define TP_SCURVE_SHORTFALL_CYCLES 1.0
 /* If the queue is shorter than the threshold, assume that we're approaching
  * the end of the program */
 #define TP_QUEUE_THRESHOLD 3
@@ -107,6 +118,8 @@ typedef struct {
     //FIXME this shouldn't be a separate limit,
     double aMaxCartesian; /* max cartesian acceleration by machine bounds */
     double aLimit;        /* max accel (unused) */
+    double jMax;        /* max jerk for subsequent moves, 0 for
+                           trapezoidal velocity profiles */
 
     double wMax;		/* rotational velocity max */
     double wDotMax;		/* rotational accelleration max */
@@ -130,6 +143,11 @@ typedef struct {
 
     syncdio_t syncdio; //record tpSetDout's here
 
+    /* Segments where optimization passes ran out of steps; the segments
+     * before each one still need to be optimized */
+    TC_STRUCT *opt_pending[TP_OPTIMIZATION_PENDING];
+    int opt_pending_count;
+
 } TP_STRUCT;
 
 #endif				/* TP_TYPES_H */
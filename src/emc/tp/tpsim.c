@@ -0,0 +1,692 @@
+/********************************************************************
+* Description: tpsim.c
+*   Offline trajectory planner simulation
+*
+*   Runs the trajectory planner from motion (tp.c and friends) outside
+*   of realtime, fed from the canonical commands printed by the
+*   standalone interpreter:
+*
+*       rs274 -g part.ngc | tpsim -a 1000 -v 100
+*
+*   and reports the machining time, the CPU cost per cycle, axis
+*   velocity / acceleration / jerk violations and queue starvation.
+*
+* License: GPL Version 2
+* System: Linux
+*
+* Copyright (c) 2026 All rights reserved.
+********************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <unistd.h>
+#include <math.h>
+#include <time.h>
+
+#include "rtapi.h"
+#include "posemath.h"
+#include "emcpose.h"
+#include "tc.h"
+#include "tp.h"
+#include "spline.h"
+#include "mot_priv.h"
+#include "motion_debug.h"
+#include "motion_types.h"
+
+#define EMC_TRAJ_TERM_COND_STOP  0
+#define EMC_TRAJ_TERM_COND_EXACT 1
+#define EMC_TRAJ_TERM_COND_BLEND 2
+
+/* Most control points read from one NURBS_FEED */
+#define TPSIM_MAX_NURBS_POINTS 256
+
+/* Stand-ins for the motion controller's shared structures */
+static emcmot_status_t sim_status;
+static emcmot_config_t sim_config;
+static emcmot_debug_t sim_debug;
+
+emcmot_status_t *emcmotStatus = &sim_status;
+emcmot_config_t *emcmotConfig = &sim_config;
+emcmot_debug_t *emcmotDebug = &sim_debug;
+
+void emcmotDioWrite(int index, char value) { }
+void emcmotAioWrite(int index, double value) { }
+void emcmotSetRotaryUnlock(int axis, int unlock) { }
+int emcmotGetRotaryIsUnlocked(int axis) { return 1; }
+
+/* Machine limits, in program units */
+static double vel_limit[3] = {100.0, 100.0, 100.0};
+static double acc_limit[3] = {1000.0, 1000.0, 1000.0};
+/* Jerk limit for each axis, 0 if jerk isn't checked (trapezoidal profiles) */
+static double jerk_limit = 0.0;
+
+/* Relative slack allowed before a velocity, acceleration or jerk counts as a
+ * violation (finite differences are noisy at blend boundaries) */
+static double violation_tol = 1e-3;
+
+static int verbose = 0;
+
+/* Interpreter state tracked from the canon commands */
+typedef struct {
+    FILE *in;
+    int line;               /* line of canon input, for error messages */
+    int nline;              /* N word of the current block, 0 if none */
+    int eof;
+    EmcPose pos;
+    double feed;            /* units / sec */
+    int plane;              /* 1 = XY, 2 = YZ, 3 = XZ */
+    double dwell;           /* seconds of pending dwell */
+    int moves;
+    double add_cost;        /* us spent in tpAddLine / tpAddCircle / tpAddSpline */
+} canon_state_t;
+
+typedef struct {
+    long cycles;
+    long idle_cycles;
+    double cost_sum;
+    double cost_max;
+    double *cost;           /* per-cycle cost for percentiles */
+    long cost_len;
+    long cost_size;
+    long vel_violations;
+    long acc_violations;
+    long jerk_violations;
+    double vel_ratio_max;
+    double acc_ratio_max;
+    double jerk_ratio_max;
+    long starved_cycles;
+    long starved_events;
+    int min_depth;
+} sim_stats_t;
+
+static double now_us(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec * 1e-3;
+}
+
+static int parse_limits(const char *arg, double limits[3])
+{
+    int n = sscanf(arg, "%lf,%lf,%lf", &limits[0], &limits[1], &limits[2]);
+    if (n == 1) {
+        limits[1] = limits[2] = limits[0];
+    } else if (n != 3) {
+        return -1;
+    }
+    return (limits[0] > 0 && limits[1] > 0 && limits[2] > 0) ? 0 : -1;
+}
+
+/**
+ * Find the largest velocity or acceleration along a move direction that
+ * keeps each axis within its limit (same approach as emccanon).
+ */
+static double straight_limit(PmCartesian const * const d, double const limits[3])
+{
+    double len;
+    pmCartMag(d, &len);
+    double t = fmax(fmax(fabs(d->x) / limits[0], fabs(d->y) / limits[1]),
+            fabs(d->z) / limits[2]);
+    if (t <= 0.0) {
+        return fmin(fmin(limits[0], limits[1]), limits[2]);
+    }
+    return len / t;
+}
+
+static int add_line(TP_STRUCT * const tp, canon_state_t * const cs,
+        EmcPose const * const end, int type)
+{
+    PmCartesian d = {end->tran.x - cs->pos.tran.x,
+        end->tran.y - cs->pos.tran.y,
+        end->tran.z - cs->pos.tran.z};
+    double ini_maxvel = straight_limit(&d, vel_limit);
+    double acc = straight_limit(&d, acc_limit);
+    double vel = (type == EMC_MOTION_TYPE_TRAVERSE) ? ini_maxvel : fmin(cs->feed, ini_maxvel);
+
+    tpSetId(tp, cs->nline);
+    double t0 = now_us();
+    int res = tpAddLine(tp, *end, type, vel, ini_maxvel, acc,
+            emcmotStatus->enables_new, 0, -1);
+    cs->add_cost += now_us() - t0;
+    cs->pos = *end;
+    if (res == TP_ERR_ZERO_LENGTH) {
+        return 0;
+    }
+    return res;
+}
+
+/**
+ * Convert an ARC_FEED into a tpAddCircle call the way emccanon does,
+ * simplified to XYZ motion.
+ */
+static int add_arc(TP_STRUCT * const tp, canon_state_t * const cs,
+        double e1, double e2, double c1, double c2, int rotation,
+        double e_axis, double a, double b, double c)
+{
+    EmcPose end = cs->pos;
+    PmCartesian center, normal;
+    double r_start, r_end;
+
+    end.a = a;
+    end.b = b;
+    end.c = c;
+    switch (cs->plane) {
+    case 2: /* YZ */
+        end.tran.x = e_axis; end.tran.y = e1; end.tran.z = e2;
+        center.x = e_axis; center.y = c1; center.z = c2;
+        normal.x = 1.0; normal.y = 0.0; normal.z = 0.0;
+        r_start = hypot(cs->pos.tran.y - c1, cs->pos.tran.z - c2);
+        break;
+    case 3: /* XZ */
+        end.tran.x = e2; end.tran.y = e_axis; end.tran.z = e1;
+        center.x = c2; center.y = e_axis; center.z = c1;
+        normal.x = 0.0; normal.y = 1.0; normal.z = 0.0;
+        r_start = hypot(cs->pos.tran.z - c1, cs->pos.tran.x - c2);
+        break;
+    default: /* XY */
+        end.tran.x = e1; end.tran.y = e2; end.tran.z = e_axis;
+        center.x = c1; center.y = c2; center.z = e_axis;
+        normal.x = 0.0; normal.y = 0.0; normal.z = 1.0;
+        r_start = hypot(cs->pos.tran.x - c1, cs->pos.tran.y - c2);
+        break;
+    }
+    r_end = hypot(e1 - c1, e2 - c2);
+
+    if (rotation == 0) {
+        return add_line(tp, cs, &end, EMC_MOTION_TYPE_ARC);
+    }
+
+    /* Limit the in-plane speed by normal acceleration, like emccanon */
+    double v_axes = fmin(fmin(vel_limit[0], vel_limit[1]), vel_limit[2]);
+    double a_axes = fmin(fmin(acc_limit[0], acc_limit[1]), acc_limit[2]);
+    double v_radial = sqrt(a_axes * sqrt(3.0) / 2.0 * fmin(r_start, r_end));
+    double ini_maxvel = fmin(v_radial, v_axes);
+    double vel = fmin(cs->feed, ini_maxvel);
+    int turn = rotation > 0 ? rotation - 1 : rotation;
+
+    tpSetId(tp, cs->nline);
+    double t0 = now_us();
+    int res = tpAddCircle(tp, end, center, normal, turn, EMC_MOTION_TYPE_ARC,
+            vel, ini_maxvel, a_axes, emcmotStatus->enables_new, 0);
+    cs->add_cost += now_us() - t0;
+    cs->pos = end;
+    if (res == TP_ERR_ZERO_LENGTH) {
+        return 0;
+    }
+    return res;
+}
+
+/**
+ * Convert a NURBS_FEED into one tpAddSpline call per span the way emccanon
+ * does. The NURBS lies in the XY plane at the current Z.
+ */
+static int add_nurbs(TP_STRUCT * const tp, canon_state_t * const cs,
+        PmCartesian const * const ctrl, double const * const weight,
+        int count, int order)
+{
+    double v_max = fmin(vel_limit[0], vel_limit[1]);
+    double a_max = fmin(acc_limit[0], acc_limit[1]);
+    double vel = fmin(cs->feed, v_max);
+    int span;
+
+    if (order < 2 || order > SPLINE_MAX_ORDER || count < order) {
+        return -1;
+    }
+    for (span = 0; span <= count - order; ++span) {
+        PmCartesian bezier[SPLINE_MAX_ORDER];
+        double bezier_weight[SPLINE_MAX_ORDER];
+        if (splineNurbsSpan(ctrl, weight, count, order, span,
+                    bezier, bezier_weight)) {
+            return -1;
+        }
+        if (span == count - order) {
+            bezier[order - 1] = ctrl[count - 1];
+        }
+        EmcPose end = cs->pos;
+        end.tran = bezier[order - 1];
+
+        tpSetId(tp, cs->nline);
+        double t0 = now_us();
+        int res = tpAddSpline(tp, end, bezier, bezier_weight, order,
+                EMC_MOTION_TYPE_ARC, vel, v_max, a_max,
+                emcmotStatus->enables_new, 0);
+        cs->add_cost += now_us() - t0;
+        cs->pos = end;
+        if (res < 0 && res != TP_ERR_ZERO_LENGTH) {
+            return res;
+        }
+    }
+    return 0;
+}
+
+/**
+ * Read canon lines until one adds a move to the queue (or needs the queue to
+ * drain first). Returns 1 if a move was added, 0 at end of input or when a
+ * dwell is pending, and -1 on error.
+ */
+static int next_move(TP_STRUCT * const tp, canon_state_t * const cs)
+{
+    char buf[TPSIM_MAX_NURBS_POINTS * 48];
+
+    while (fgets(buf, sizeof(buf), cs->in)) {
+        double v[10];
+        int rot;
+        char *cmd;
+        char *args;
+
+        cs->line++;
+        /* rs274 doesn't print file line numbers, so moves are tagged with
+         * the block's N word ("N....." if it has none) */
+        cmd = strchr(buf, 'N');
+        if (cmd && isdigit(cmd[1])) {
+            cs->nline = atoi(cmd + 1);
+        } else {
+            cs->nline = 0;
+        }
+        /* Skip the output line and N-word columns to the command name */
+        for (cmd = buf; *cmd && !(isupper(cmd[0]) && isupper(cmd[1])); cmd++)
+            ;
+        args = strchr(cmd, '(');
+        if (!args) {
+            continue;
+        }
+        args++;
+
+        if (!strncmp(cmd, "STRAIGHT_FEED(", 14) || !strncmp(cmd, "STRAIGHT_TRAVERSE(", 18)) {
+            EmcPose end = cs->pos;
+            if (sscanf(args, "%lf, %lf, %lf, %lf, %lf, %lf",
+                        &end.tran.x, &end.tran.y, &end.tran.z,
+                        &end.a, &end.b, &end.c) < 3) {
+                fprintf(stderr, "tpsim: bad move at line %d\n", cs->line);
+                return -1;
+            }
+            int type = (cmd[9] == 'T') ? EMC_MOTION_TYPE_TRAVERSE : EMC_MOTION_TYPE_FEED;
+            if (add_line(tp, cs, &end, type) < 0) {
+                fprintf(stderr, "tpsim: can't add line at line %d\n", cs->line);
+                return -1;
+            }
+            cs->moves++;
+            return 1;
+        } else if (!strncmp(cmd, "ARC_FEED(", 9)) {
+            v[6] = cs->pos.a;
+            v[7] = cs->pos.b;
+            v[8] = cs->pos.c;
+            if (sscanf(args, "%lf, %lf, %lf, %lf, %d, %lf, %lf, %lf, %lf",
+                        &v[0], &v[1], &v[2], &v[3], &rot, &v[5],
+                        &v[6], &v[7], &v[8]) < 6) {
+                fprintf(stderr, "tpsim: bad arc at line %d\n", cs->line);
+                return -1;
+            }
+            if (add_arc(tp, cs, v[0], v[1], v[2], v[3], rot, v[5], v[6], v[7], v[8]) < 0) {
+                fprintf(stderr, "tpsim: can't add arc at line %d\n", cs->line);
+                return -1;
+            }
+            cs->moves++;
+            return 1;
+        } else if (!strncmp(cmd, "NURBS_FEED(", 11)) {
+            PmCartesian ctrl[TPSIM_MAX_NURBS_POINTS];
+            double weight[TPSIM_MAX_NURBS_POINTS];
+            int count, order, i;
+            char *end;
+            if (sscanf(args, "%d, %d", &count, &order) != 2 ||
+                    count < 1 || count > TPSIM_MAX_NURBS_POINTS) {
+                fprintf(stderr, "tpsim: bad NURBS at line %d\n", cs->line);
+                return -1;
+            }
+            args = strchr(strchr(args, ',') + 1, ',');
+            for (i = 0; i < count && args; ++i) {
+                ctrl[i].x = strtod(args + 1, &end);
+                ctrl[i].y = strtod(end + 1, &end);
+                weight[i] = strtod(end + 1, &end);
+                ctrl[i].z = cs->pos.tran.z;
+                args = (*end == ',') ? end : NULL;
+            }
+            if (i < count) {
+                fprintf(stderr, "tpsim: bad NURBS at line %d\n", cs->line);
+                return -1;
+            }
+            if (add_nurbs(tp, cs, ctrl, weight, count, order) < 0) {
+                fprintf(stderr, "tpsim: can't add NURBS at line %d\n", cs->line);
+                return -1;
+            }
+            cs->moves++;
+            return 1;
+        } else if (!strncmp(cmd, "SET_FEED_RATE(", 14)) {
+            if (sscanf(args, "%lf", &v[0]) == 1) {
+                cs->feed = v[0] / 60.0;
+            }
+        } else if (!strncmp(cmd, "SET_MOTION_CONTROL_MODE(", 24)) {
+            if (!strncmp(args, "CANON_EXACT_STOP", 16)) {
+                tpSetTermCond(tp, EMC_TRAJ_TERM_COND_STOP, 0.0);
+            } else if (!strncmp(args, "CANON_EXACT_PATH", 16)) {
+                tpSetTermCond(tp, EMC_TRAJ_TERM_COND_EXACT, 0.0);
+            } else if (sscanf(args, "CANON_CONTINUOUS, %lf", &v[0]) == 1) {
+                tpSetTermCond(tp, EMC_TRAJ_TERM_COND_BLEND, v[0]);
+            }
+        } else if (!strncmp(cmd, "SELECT_PLANE(", 13)) {
+            if (strstr(args, "YZ")) {
+                cs->plane = 2;
+            } else if (strstr(args, "XZ")) {
+                cs->plane = 3;
+            } else {
+                cs->plane = 1;
+            }
+        } else if (!strncmp(cmd, "DWELL(", 6)) {
+            if (sscanf(args, "%lf", &v[0]) == 1 && v[0] > 0.0) {
+                cs->dwell = v[0];
+                return 0;
+            }
+        }
+    }
+    cs->eof = 1;
+    return 0;
+}
+
+static int compare_double(const void *a, const void *b)
+{
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+static void record_cost(sim_stats_t * const st, double cost)
+{
+    st->cost_sum += cost;
+    st->cost_max = fmax(st->cost_max, cost);
+    if (st->cost_len == st->cost_size) {
+        long size = st->cost_size ? st->cost_size * 2 : 65536;
+        double *cost_new = realloc(st->cost, size * sizeof(double));
+        if (!cost_new) {
+            return;
+        }
+        st->cost = cost_new;
+        st->cost_size = size;
+    }
+    st->cost[st->cost_len++] = cost;
+}
+
+/**
+ * Check axis velocity and acceleration from the last three positions, and
+ * jerk from the last four.
+ */
+static void check_motion(sim_stats_t * const st, EmcPose const p[4],
+        double dt, FILE *trace, double t, int id)
+{
+    double pos[4][3] = {
+        {p[0].tran.x, p[0].tran.y, p[0].tran.z},
+        {p[1].tran.x, p[1].tran.y, p[1].tran.z},
+        {p[2].tran.x, p[2].tran.y, p[2].tran.z},
+        {p[3].tran.x, p[3].tran.y, p[3].tran.z},
+    };
+    double vel_ratio = 0.0, acc_ratio = 0.0, jerk_ratio = 0.0;
+    double v_path = 0.0, a_path = 0.0;
+    int i;
+
+    for (i = 0; i < 3; ++i) {
+        double v0 = (pos[1][i] - pos[0][i]) / dt;
+        double v1 = (pos[2][i] - pos[1][i]) / dt;
+        double v2 = (pos[3][i] - pos[2][i]) / dt;
+        double a1 = (v1 - v0) / dt;
+        double a = (v2 - v1) / dt;
+        vel_ratio = fmax(vel_ratio, fabs(v2) / vel_limit[i]);
+        acc_ratio = fmax(acc_ratio, fabs(a) / acc_limit[i]);
+        if (jerk_limit > 0.0) {
+            jerk_ratio = fmax(jerk_ratio, fabs(a - a1) / dt / jerk_limit);
+        }
+        v_path += v2 * v2;
+        a_path += a * a;
+    }
+
+    if (vel_ratio > 1.0 + violation_tol) {
+        st->vel_violations++;
+        if (verbose) {
+            fprintf(stderr, "tpsim: t = %f, N%d: velocity %.1f%% of limit\n",
+                    t, id, vel_ratio * 100.0);
+        }
+    }
+    if (acc_ratio > 1.0 + violation_tol) {
+        st->acc_violations++;
+        if (verbose) {
+            fprintf(stderr, "tpsim: t = %f, N%d: acceleration %.1f%% of limit\n",
+                    t, id, acc_ratio * 100.0);
+        }
+    }
+    if (jerk_ratio > 1.0 + violation_tol) {
+        st->jerk_violations++;
+        if (verbose) {
+            fprintf(stderr, "tpsim: t = %f, N%d: jerk %.1f%% of limit\n",
+                    t, id, jerk_ratio * 100.0);
+        }
+    }
+    st->vel_ratio_max = fmax(st->vel_ratio_max, vel_ratio);
+    st->acc_ratio_max = fmax(st->acc_ratio_max, acc_ratio);
+    st->jerk_ratio_max = fmax(st->jerk_ratio_max, jerk_ratio);
+
+    if (trace) {
+        fprintf(trace, "%.6f %.6f %.6f %.6f %.6f %.6f\n", t,
+                p[3].tran.x, p[3].tran.y, p[3].tran.z,
+                sqrt(v_path), sqrt(a_path));
+    }
+}
+
+static void usage(const char *name)
+{
+    fprintf(stderr,
+            "Usage: %s [options] [canon-file]\n"
+            "Simulate the trajectory planner on canon commands printed by rs274.\n"
+            "Lengths are in program units, times in seconds.\n"
+            "  -p period    servo period (default 0.001)\n"
+            "  -v vel       max axis velocity, one value or x,y,z (default 100)\n"
+            "  -a acc       max axis acceleration, one value or x,y,z (default 1000)\n"
+            "  -j jerk      max jerk, 0 for trapezoidal profiles (default 0)\n"
+            "  -d depth     lookahead depth, ARC_BLEND_OPTIMIZATION_DEPTH (default 50)\n"
+            "  -g cycles    ARC_BLEND_GAP_CYCLES (default 4)\n"
+            "  -r freq      ARC_BLEND_RAMP_FREQ (default 100)\n"
+            "  -B           disable arc blends (parabolic blending)\n"
+            "  -f scale     feed override (default 1.0)\n"
+            "  -m scale     max feed override, MAX_FEED_OVERRIDE (default 1.0)\n"
+            "  -n moves     moves queued per servo cycle (default 1)\n"
+            "  -t tol       relative slack before a limit counts as violated (default 0.001)\n"
+            "  -o file      write time, x, y, z, speed and acceleration for each cycle\n"
+            "  -V           print each violation\n",
+            name);
+}
+
+int main(int argc, char *argv[])
+{
+    double period = 0.001;
+    double jerk = 0.0;
+    double feed_scale = 1.0;
+    int moves_per_cycle = 1;
+    const char *trace_name = NULL;
+    FILE *trace = NULL;
+    canon_state_t cs;
+    sim_stats_t st;
+    int opt;
+
+    memset(&cs, 0, sizeof(cs));
+    memset(&st, 0, sizeof(st));
+    cs.in = stdin;
+    cs.plane = 1;
+    cs.feed = 1.0;
+
+    emcmotConfig->arcBlendEnable = 1;
+    emcmotConfig->arcBlendFallbackEnable = 0;
+    emcmotConfig->arcBlendOptDepth = 50;
+    emcmotConfig->arcBlendGapCycles = 4;
+    emcmotConfig->arcBlendRampFreq = 100.0;
+    emcmotConfig->maxFeedScale = 1.0;
+
+    while ((opt = getopt(argc, argv, "p:v:a:j:d:g:r:Bf:m:n:t:o:Vh")) != -1) {
+        switch (opt) {
+        case 'p': period = atof(optarg); break;
+        case 'v':
+            if (parse_limits(optarg, vel_limit)) {
+                fprintf(stderr, "tpsim: bad velocity limit '%s'\n", optarg);
+                return 1;
+            }
+            break;
+        case 'a':
+            if (parse_limits(optarg, acc_limit)) {
+                fprintf(stderr, "tpsim: bad acceleration limit '%s'\n", optarg);
+                return 1;
+            }
+            break;
+        case 'j': jerk = atof(optarg); break;
+        case 'd': emcmotConfig->arcBlendOptDepth = atoi(optarg); break;
+        case 'g': emcmotConfig->arcBlendGapCycles = atoi(optarg); break;
+        case 'r': emcmotConfig->arcBlendRampFreq = atof(optarg); break;
+        case 'B': emcmotConfig->arcBlendEnable = 0; break;
+        case 'f': feed_scale = atof(optarg); break;
+        case 'm': emcmotConfig->maxFeedScale = atof(optarg); break;
+        case 'n': moves_per_cycle = atoi(optarg); break;
+        case 't': violation_tol = atof(optarg); break;
+        case 'o': trace_name = optarg; break;
+        case 'V': verbose = 1; break;
+        default:
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (period <= 0.0 || moves_per_cycle < 1 || jerk < 0.0) {
+        usage(argv[0]);
+        return 1;
+    }
+    jerk_limit = jerk;
+    if (optind < argc) {
+        cs.in = fopen(argv[optind], "r");
+        if (!cs.in) {
+            perror(argv[optind]);
+            return 1;
+        }
+    }
+    if (trace_name) {
+        trace = fopen(trace_name, "w");
+        if (!trace) {
+            perror(trace_name);
+            return 1;
+        }
+    }
+
+    rtapi_set_msg_level(RTAPI_MSG_ERR);
+
+    int i;
+    for (i = 0; i < 3; ++i) {
+        emcmotDebug->joints[i].vel_limit = vel_limit[i];
+        emcmotDebug->joints[i].acc_limit = acc_limit[i];
+    }
+    emcmotConfig->trajCycleTime = period;
+    emcmotStatus->net_feed_scale = feed_scale;
+    emcmotStatus->enables_new = FS_ENABLED | SS_ENABLED | FH_ENABLED;
+    emcmotStatus->spindle_is_atspeed = 1;
+    emcmotConfig->maxJerk = jerk;
+
+    TP_STRUCT *tp = &emcmotDebug->coord_tp;
+    if (tpCreate(tp, DEFAULT_TC_QUEUE_SIZE, emcmotDebug->queueTcSpace)) {
+        fprintf(stderr, "tpsim: can't create trajectory planner\n");
+        return 1;
+    }
+    tpSetCycleTime(tp, period);
+    tpSetPos(tp, &cs.pos);
+    double v_max = fmax(fmax(vel_limit[0], vel_limit[1]), vel_limit[2]);
+    tpSetVmax(tp, v_max, v_max);
+    tpSetVlimit(tp, v_max);
+    tpSetAmax(tp, fmax(fmax(acc_limit[0], acc_limit[1]), acc_limit[2]));
+    tpSetJmax(tp, jerk);
+
+    EmcPose p[4];
+    p[0] = p[1] = p[2] = p[3] = cs.pos;
+    long period_ns = (long)(period * 1e9 + 0.5);
+    int was_starved = 0;
+    double dwell_end = -1.0;
+    st.min_depth = DEFAULT_TC_QUEUE_SIZE;
+
+    while (1) {
+        double t = st.cycles * period;
+
+        /* Queue up moves, as the command handler would. Only the time
+         * spent in the planner counts, not parsing the canon input. */
+        cs.add_cost = 0.0;
+        if (dwell_end >= 0.0 && t >= dwell_end) {
+            dwell_end = -1.0;
+        }
+        if (cs.dwell > 0.0 && tpIsDone(tp) && dwell_end < 0.0) {
+            dwell_end = t + cs.dwell;
+            cs.dwell = 0.0;
+        }
+        int n;
+        for (n = 0; n < moves_per_cycle; ++n) {
+            if (cs.eof || cs.dwell > 0.0 || dwell_end >= 0.0 ||
+                    tcqLen(&tp->queue) >= DEFAULT_TC_QUEUE_SIZE - 2) {
+                break;
+            }
+            if (next_move(tp, &cs) < 0) {
+                return 1;
+            }
+        }
+
+        int depth = tcqLen(&tp->queue);
+        int program_waiting = !cs.eof && cs.dwell <= 0.0 && dwell_end < 0.0;
+        if (depth == 0 && program_waiting && cs.moves > 0) {
+            st.starved_cycles++;
+            if (!was_starved) {
+                st.starved_events++;
+            }
+            was_starved = 1;
+        } else {
+            was_starved = 0;
+        }
+        if (program_waiting && cs.moves > 0) {
+            st.min_depth = depth < st.min_depth ? depth : st.min_depth;
+        }
+
+        double t0 = now_us();
+        tpRunCycle(tp, period_ns);
+        double t1 = now_us();
+        record_cost(&st, cs.add_cost + t1 - t0);
+
+        p[0] = p[1];
+        p[1] = p[2];
+        p[2] = p[3];
+        tpGetPos(tp, &p[3]);
+        st.cycles++;
+        if (st.cycles >= 3) {
+            check_motion(&st, p, period, trace, t, tpGetExecId(tp));
+        }
+
+        if (tpIsDone(tp) && depth == 0) {
+            st.idle_cycles++;
+            if (cs.eof && cs.dwell <= 0.0 && dwell_end < 0.0) {
+                break;
+            }
+        }
+    }
+
+    double total = st.cycles * period;
+    qsort(st.cost, st.cost_len, sizeof(double), compare_double);
+    double p99 = st.cost_len ? st.cost[(long)(st.cost_len * 0.99)] : 0.0;
+
+    printf("moves:               %d\n", cs.moves);
+    printf("cycles:              %ld at %g s\n", st.cycles, period);
+    printf("machining time:      %.3f s (%.3f s idle)\n", total, st.idle_cycles * period);
+    printf("cycle cost:          mean %.2f us, p99 %.2f us, max %.2f us\n",
+            st.cycles ? st.cost_sum / st.cycles : 0.0, p99, st.cost_max);
+    printf("velocity violations: %ld cycles, max %.1f%% of limit\n",
+            st.vel_violations, st.vel_ratio_max * 100.0);
+    printf("accel violations:    %ld cycles, max %.1f%% of limit\n",
+            st.acc_violations, st.acc_ratio_max * 100.0);
+    if (jerk_limit > 0.0) {
+        printf("jerk violations:     %ld cycles, max %.1f%% of limit\n",
+                st.jerk_violations, st.jerk_ratio_max * 100.0);
+    }
+    printf("queue starvation:    %ld times, %ld cycles, min depth %d\n",
+            st.starved_events, st.starved_cycles,
+            st.min_depth == DEFAULT_TC_QUEUE_SIZE ? 0 : st.min_depth);
+
+    if (trace) {
+        fclose(trace);
+    }
+    free(st.cost);
+    return (st.vel_violations || st.acc_violations || st.jerk_violations) ? 2 : 0;
+}
@@ -31,7 +31,9 @@
 #include "inifile.hh"
 #include "timer.hh"
 #include "nml_oi.hh"
+#include "cms.hh"
 #include "rcs_print.hh"
+#include "preview_segments.hh"
 
 #include <cmath>
 
@@ -81,6 +83,8 @@ struct pyIniFile {
 struct pyStatChannel {
     PyObject_HEAD
     RCS_STAT_CHANNEL *c;
+    RCS_STAT_CHANNEL *d;        // emcStatusDelta, if the nml file has it
+    long serial;                // write id status is up to date with
     EMC_STAT status;
 };
 
@@ -265,11 +269,21 @@ static int Stat_init(pyStatChannel *self, PyObject *a, PyObject *k) {
     }
 
     self->c = c;
+
+    set_rcs_print_destination(RCS_PRINT_TO_NULL);
+    self->d = new RCS_STAT_CHANNEL(emcFormat, "emcStatusDelta", "xemc", file);
+    set_rcs_print_destination(RCS_PRINT_TO_STDOUT);
+    if(!self->d->valid()) {
+        delete self->d;
+        self->d = NULL;
+    }
+    self->serial = 0;
     return 0;
 }
 
 static void Stat_dealloc(PyObject *self) {
     delete ((pyStatChannel*)self)->c;
+    delete ((pyStatChannel*)self)->d;
     PyObject_Del(self);
 }
 
@@ -283,9 +297,19 @@ static bool check_stat(RCS_STAT_CHANNEL *emcStatusBuffer) {
 
 static PyObject *poll(pyStatChannel *s, PyObject *o) {
     if(!check_stat(s->c)) return NULL;
+    // only copy what changed, unless we are out of step with the delta
+    if(s->d && s->d->peek() == EMC_STAT_DELTA_TYPE) {
+        EMC_STAT_DELTA *delta =
+            static_cast<EMC_STAT_DELTA*>(s->d->NML::get_address());
+        if(delta->apply(&s->status, &s->serial) >= 0) {
+            Py_INCREF(Py_None);
+            return Py_None;
+        }
+    }
     if(s->c->peek() == EMC_STAT_TYPE) {
         EMC_STAT *emcStatus = static_cast<EMC_STAT*>(s->c->get_address());
         memcpy(&s->status, emcStatus, sizeof(EMC_STAT));
+        s->serial = s->c->cms->in_buffer_id;
     }
     Py_INCREF(Py_None);
     return Py_None;
@@ -1595,20 +1619,60 @@ static PyObject *pyvertex9(PyObject *s, PyObject *o) {
     return Py_BuildValue("(ddd)", &pt[0], &pt[1], &pt[2]);
 }
 
+struct line_strip {
+    int first;
+    int nl;
+    double pl[9];
+};
+
+static void draw_line(struct line_strip *ls, int n, const double p1[9],
+        const double p2[9], const char *geometry, int for_selection) {
+    if(ls->first || memcmp(p1, ls->pl, sizeof(ls->pl))
+            || (for_selection && n != ls->nl)) {
+        if(!ls->first) glEnd();
+        if(for_selection && n != ls->nl) {
+            glLoadName(n);
+            ls->nl = n;
+        }
+        glBegin(GL_LINE_STRIP);
+        glvertex9(p1, geometry);
+        ls->first = 0;
+    }
+    line9(p1, p2, geometry);
+    memcpy(ls->pl, p2, sizeof(ls->pl));
+}
+
+// lines is a list of move tuples or a gcode.segments buffer
 static PyObject *pydraw_lines(PyObject *s, PyObject *o) {
-    PyListObject *li;
+    PyObject *li;
     int for_selection = 0;
-    int i;
-    int first = 1;
-    int nl = -1, n;
-    double p1[9], p2[9], pl[9];
+    int i, n;
+    double p1[9], p2[9];
     char *geometry;
+    struct line_strip ls = {1, -1};
 
-    if(!PyArg_ParseTuple(o, "sO!|i:draw_lines",
-			    &geometry, &PyList_Type, &li, &for_selection))
+    if(!PyArg_ParseTuple(o, "sO|i:draw_lines",
+			    &geometry, &li, &for_selection))
         return NULL;
 
-    for(i=0; i<PyList_GET_SIZE(li); i++) {
+    if(!PyList_Check(li)) {
+        Py_buffer view;
+        if(PyObject_GetBuffer(li, &view, PyBUF_ND | PyBUF_FORMAT) < 0)
+            return NULL;
+        if(view.ndim != 2 || view.shape[1] != PREVIEW_SEGMENT_SIZE
+                || strcmp(view.format, "d")) {
+            PyBuffer_Release(&view);
+            PyErr_SetString(PyExc_TypeError,
+                    "draw_lines: expected a list or gcode.segments");
+            return NULL;
+        }
+        const double *r = (const double*)view.buf;
+        for(i=0; i<view.shape[0]; i++, r += PREVIEW_SEGMENT_SIZE)
+            draw_line(&ls, (int)r[PREVIEW_SEGMENT_LINE],
+                    r + PREVIEW_SEGMENT_START, r + PREVIEW_SEGMENT_END,
+                    geometry, for_selection);
+        PyBuffer_Release(&view);
+    } else for(i=0; i<PyList_GET_SIZE(li); i++) {
         PyObject *it = PyList_GET_ITEM(li, i);
         PyObject *dummy1, *dummy2, *dummy3;
         if(!PyArg_ParseTuple(it, "i(ddddddddd)(ddddddddd)|OOO", &n,
@@ -1619,25 +1683,13 @@ static PyObject *pydraw_lines(PyObject *s, PyObject *o) {
                     p2+3, p2+4, p2+5,
                     p2+6, p2+7, p2+8,
                     &dummy1, &dummy2, &dummy3)) {
-            if(!first) glEnd();
+            if(!ls.first) glEnd();
             return NULL;
         }
-        if(first || memcmp(p1, pl, sizeof(p1))
-                || (for_selection && n != nl)) {
-            if(!first) glEnd();
-            if(for_selection && n != nl) {
-                glLoadName(n);
-                nl = n;
-            }
-            glBegin(GL_LINE_STRIP);
-            glvertex9(p1, geometry);
-            first = 0;
-        }
-        line9(p1, p2, geometry);
-        memcpy(pl, p2, sizeof(p1));
+        draw_line(&ls, n, p1, p2, geometry, for_selection);
     }
 
-    if(!first) glEnd();
+    if(!ls.first) glEnd();
 
     Py_INCREF(Py_None);
     return Py_None;
@@ -1633,9 +1633,6 @@ property_names = [
     ('c', _("C bounds:"))
 ]
 
-def dist((x,y,z),(p,q,r)):
-    return ((x-p)**2 + (y-q)**2 + (z-r)**2) ** .5
-
 # returns units/sec
 def get_jog_speed(a):
     if vars.teleop_mode.get():
@@ -1773,14 +1770,10 @@ class TclCommands(nf.TclCommands):
             mf = vars.max_speed.get()
             #print o.canon.traverse[0]
 
-            g0 = sum(dist(l[1][:3], l[2][:3]) for l in o.canon.traverse)
-            g1 = (sum(dist(l[1][:3], l[2][:3]) for l in o.canon.feed) +
-                sum(dist(l[1][:3], l[2][:3]) for l in o.canon.arcfeed))
-            gt = (sum(dist(l[1][:3], l[2][:3])/min(mf, l[3]) for l in o.canon.feed) +
-                sum(dist(l[1][:3], l[2][:3])/min(mf, l[3])  for l in o.canon.arcfeed) +
-                sum(dist(l[1][:3], l[2][:3])/mf  for l in o.canon.traverse) +
-                o.canon.dwell_time
-                )
+            g0 = o.canon.traverse.distance()
+            g1 = o.canon.feed.distance() + o.canon.arcfeed.distance()
+            gt = (o.canon.feed.time(mf) + o.canon.arcfeed.time(mf) +
+                o.canon.traverse.time(mf) + o.canon.dwell_time)
  
             props['g0'] = "%f %s".replace("%f", fmt) % (from_internal_linear_unit(g0, conv), units)
             props['g1'] = "%f %s".replace("%f", fmt) % (from_internal_linear_unit(g1, conv), units)
@@ -3122,6 +3115,7 @@ c.wait_complete()
 
 o = MyOpengl(widgets.preview_frame, width=400, height=300, double=1, depth=1)
 o.last_line = 1
+o.preview_jobs = int(inifile.find("DISPLAY", "PREVIEW_JOBS") or 0)
 o.pack(fill="both", expand=1)
 
 def match_grid_size(v):
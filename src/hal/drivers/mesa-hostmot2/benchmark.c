@@ -0,0 +1,124 @@
+
+//
+//    This program is free software; you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation; either version 2 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program; if not, write to the Free Software
+//    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301 USA
+//
+
+// Benchmark mode: split the time read() and write() take by module.
+//
+// read() and write() call hm2_benchmark_lap() after each step, which
+// charges the clocks since the previous lap to that step's module.  At
+// the end of write() the totals for the cycle go to the .time pins, the
+// same way HAL reports the run time of a whole function.
+
+
+#include <rtapi_slab.h>
+
+#include "rtapi.h"
+#include "rtapi_string.h"
+#include "rtapi_math.h"
+
+#include "hal.h"
+
+#include "hal/drivers/mesa-hostmot2/hostmot2.h"
+
+
+static const char *hm2_benchmark_names[HM2_BENCHMARK_NUM] = {
+    [HM2_BENCHMARK_TRAM_READ]  = "tram-read",
+    [HM2_BENCHMARK_WATCHDOG]   = "watchdog",
+    [HM2_BENCHMARK_IOPORT]     = "gpio",
+    [HM2_BENCHMARK_ENCODER]    = "encoder",
+    [HM2_BENCHMARK_ABSENC]     = "absenc",
+    [HM2_BENCHMARK_RESOLVER]   = "resolver",
+    [HM2_BENCHMARK_PWMGEN]     = "pwmgen",
+    [HM2_BENCHMARK_TP_PWMGEN]  = "3pwmgen",
+    [HM2_BENCHMARK_STEPGEN]    = "stepgen",
+    [HM2_BENCHMARK_SSERIAL]    = "sserial",
+    [HM2_BENCHMARK_BSPI]       = "bspi",
+    [HM2_BENCHMARK_DPLL]       = "dpll",
+    [HM2_BENCHMARK_LED]        = "led",
+    [HM2_BENCHMARK_TRAM_WRITE] = "tram-write",
+};
+
+
+int hm2_benchmark_setup(hostmot2_t *hm2) {
+    int i, r;
+
+    if (hm2->config.enable_benchmark == 0) {
+        return 0;
+    }
+
+    hm2->benchmark = (hm2_benchmark_t *)hal_malloc(sizeof(hm2_benchmark_t));
+    if (hm2->benchmark == NULL) {
+        HM2_ERR("out of memory!\n");
+        hm2->config.enable_benchmark = 0;
+        return -ENOMEM;
+    }
+
+    for (i = 0; i < HM2_BENCHMARK_NUM; i ++) {
+        r = hal_pin_s32_newf(HAL_OUT, &(hm2->benchmark->hal.pin.time[i]), hm2->llio->comp_id,
+                "%s.benchmark.%s.time", hm2->llio->name, hm2_benchmark_names[i]);
+        if (r < 0) {
+            HM2_ERR("error adding pin '%s.benchmark.%s.time', aborting\n", hm2->llio->name, hm2_benchmark_names[i]);
+            return -EINVAL;
+        }
+
+        r = hal_param_s32_newf(HAL_RW, &(hm2->benchmark->hal.param.tmax[i]), hm2->llio->comp_id,
+                "%s.benchmark.%s.tmax", hm2->llio->name, hm2_benchmark_names[i]);
+        if (r < 0) {
+            HM2_ERR("error adding param '%s.benchmark.%s.tmax', aborting\n", hm2->llio->name, hm2_benchmark_names[i]);
+            return -EINVAL;
+        }
+
+        *(hm2->benchmark->hal.pin.time[i]) = 0;
+        hm2->benchmark->hal.param.tmax[i] = 0;
+        hm2->benchmark->clocks[i] = 0;
+    }
+
+    return 0;
+}
+
+
+// start timing, without charging the time since the last lap to anything
+void hm2_benchmark_mark(hostmot2_t *hm2) {
+    if (hm2->benchmark == NULL) return;
+    hm2->benchmark->lap_start = rtapi_get_clocks();
+}
+
+
+void hm2_benchmark_lap(hostmot2_t *hm2, hm2_benchmark_stage_t stage) {
+    long long int now;
+
+    if (hm2->benchmark == NULL) return;
+
+    now = rtapi_get_clocks();
+    hm2->benchmark->clocks[stage] += now - hm2->benchmark->lap_start;
+    hm2->benchmark->lap_start = now;
+}
+
+
+void hm2_benchmark_publish(hostmot2_t *hm2) {
+    hm2_benchmark_t *b = hm2->benchmark;
+    int i;
+
+    if (b == NULL) return;
+
+    for (i = 0; i < HM2_BENCHMARK_NUM; i ++) {
+        *(b->hal.pin.time[i]) = (hal_s32_t)b->clocks[i];
+        if (*(b->hal.pin.time[i]) > b->hal.param.tmax[i]) {
+            b->hal.param.tmax[i] = *(b->hal.pin.time[i]);
+        }
+        b->clocks[i] = 0;
+    }
+}
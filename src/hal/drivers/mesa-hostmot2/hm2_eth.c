@@ -30,6 +30,8 @@
 #include <spawn.h>
 #include <sys/types.h>
 #include <sys/wait.h>
+#include <poll.h>
+#include <time.h>
 
 #include <rtapi_slab.h>
 #include <rtapi_ctype.h>
@@ -55,6 +57,9 @@ MODULE_SUPPORTED_DEVICE("Mesa-AnythingIO-7i80");
 static char *board_ip;
 RTAPI_MP_STRING(board_ip, "ip address of ethernet board(s)");
 
+static int board_port = LBP16_UDP_PORT;
+RTAPI_MP_INT(board_port, "UDP port of ethernet board(s), only changed for hm2_eth_sim");
+
 static char *config[MAX_ETH_BOARDS];
 RTAPI_MP_ARRAY_STRING(config, MAX_ETH_BOARDS, "config string for the AnyIO boards (see hostmot2(9) manpage)")
 
@@ -71,7 +76,9 @@ static int comp_id;
 #define UDP_PORT 27181
 #define SEND_TIMEOUT_US 10
 #define RECV_TIMEOUT_US 10
-#define READ_PCK_DELAY_NS 10000
+#define READ_TIMEOUT_NS (200*1000*1000)
+#define RECV_BATCH 4
+#define MAX_PACKET_SIZE 1500
 
 static int sockfd = -1;
 static struct sockaddr_in local_addr;
@@ -83,6 +90,7 @@ read_queue_entry_t queue_reads[MAX_ETH_READS];
 lbp16_cmd_addr queue_packets[MAX_ETH_READS];
 int queue_reads_count = 0;
 int queue_buff_size = 0;
+int queue_reads_sent = 0;
 
 static rtapi_u8 write_packet[1400];
 void *write_packet_ptr = &write_packet;
@@ -96,6 +104,11 @@ struct arpreq req;
 static int eth_socket_send(int sockfd, const void *buffer, int len, int flags);
 static int eth_socket_recv(int sockfd, void *buffer, int len, int flags);
 
+// a board on the loopback network is hm2_eth_sim, not hardware
+static bool board_is_local() {
+    return (ntohl(inet_addr(board_ip)) >> 24) == 127;
+}
+
 #define IPTABLES "/sbin/iptables"
 #define CHAIN "hm2-eth-rules-output"
 
@@ -260,7 +273,7 @@ static int init_net(void) {
         return -errno;
     }
     server_addr.sin_family = AF_INET;
-    server_addr.sin_port = htons(LBP16_UDP_PORT);
+    server_addr.sin_port = htons(board_port);
     server_addr.sin_addr.s_addr = inet_addr(board_ip);
 
     local_addr.sin_family      = AF_INET;
@@ -301,6 +314,11 @@ static int init_net(void) {
     }
 
     memset(&req, 0, sizeof(req));
+
+    if(board_is_local()) {
+        LL_PRINT("board is on the loopback network, skipping arp and iptables setup\n");
+        return 0;
+    }
     struct sockaddr_in *sin;
 
     sin = (struct sockaddr_in *) &req.arp_pa;
@@ -353,12 +371,72 @@ static int eth_socket_recv(int sockfd, void *buffer, int len, int flags) {
     return recv(sockfd, buffer, len, flags);
 }
 
+// Send a read request for reply_size bytes.  Whatever is still queued on
+// the socket answers an earlier request that timed out, so it is dropped
+// first and cannot be taken for the answer to this one.
+static int eth_socket_send_request(hm2_eth_t *board, const void *buffer, int len, int reply_size) {
+    int stale = 0;
+
+    while(recv(sockfd, NULL, 0, MSG_DONTWAIT | MSG_TRUNC) >= 0)
+        stale++;
+    if(stale)
+        LL_PRINT_IF(debug, "request : DROPPED %d STALE PACKETS\n", stale);
+    board->reply_size = reply_size;
+    return eth_socket_send(sockfd, buffer, len, 0);
+}
+
+// Wait for the answer to the board's last eth_socket_send_request() and
+// copy it to buffer.  Rather than retrying recv() every 10us, sleep
+// in ppoll() until a datagram arrives and then take all that are queued
+// with a single recvmmsg().  A datagram of another size than the answer
+// belongs to an earlier request and is dropped, so one late reply does
+// not leave every read after it a cycle behind.
+// Returns the size of the answer, or -1 on timeout.
+static int eth_socket_recv_reply(hm2_eth_t *board, void *buffer) {
+    static rtapi_u8 rx_buffer[RECV_BATCH][MAX_PACKET_SIZE];
+    struct mmsghdr msgs[RECV_BATCH];
+    struct iovec iov[RECV_BATCH];
+    struct pollfd pfd = { .fd = sockfd, .events = POLLIN };
+    long long t1 = rtapi_get_time(), left;
+    int i, n, stale = 0, recv = -1;
+
+    while(recv < 0) {
+        left = READ_TIMEOUT_NS - (rtapi_get_time() - t1);
+        if(left <= 0) break;
+        struct timespec timeout = { left / 1000000000, left % 1000000000 };
+        n = ppoll(&pfd, 1, &timeout, NULL);
+        if(n < 0 && errno == EINTR) continue;
+        if(n <= 0) break;
+
+        for(i = 0; i < RECV_BATCH; i++) {
+            iov[i].iov_base = rx_buffer[i];
+            iov[i].iov_len = sizeof(rx_buffer[i]);
+            memset(&msgs[i], 0, sizeof(msgs[i]));
+            msgs[i].msg_hdr.msg_iov = &iov[i];
+            msgs[i].msg_hdr.msg_iovlen = 1;
+        }
+        n = recvmmsg(sockfd, msgs, RECV_BATCH, MSG_DONTWAIT, NULL);
+        for(i = 0; i < n; i++) {
+            if((int)msgs[i].msg_len != board->reply_size) {
+                stale++;
+                continue;
+            }
+            recv = msgs[i].msg_len;
+            memcpy(buffer, rx_buffer[i], recv);
+        }
+    }
+
+    LL_PRINT_IF(debug, "reply : PACKET RECV [SIZE: %d | STALE: %d | TIME: %llu]\n",
+        recv, stale, rtapi_get_time() - t1);
+    return recv;
+}
+
 /// hm2_eth io functions
 
 static int hm2_eth_read(hm2_lowlevel_io_t *this, rtapi_u32 addr, void *buffer, int size) {
-    int send, recv, i = 0;
+    hm2_eth_t *board = this->private;
+    int send, recv;
     rtapi_u8 tmp_buffer[size + 4];
-    long long t1, t2;
 
     if (comm_active == 0) return 1;
     if (size == 0) return 1;
@@ -375,57 +453,59 @@ static int hm2_eth_read(hm2_lowlevel_io_t *this, rtapi_u32 addr, void *buffer, i
 
     LBP16_INIT_PACKET4(read_packet, CMD_READ_HOSTMOT2_ADDR32_INCR(size/4), addr & 0xFFFF);
 
-    send = eth_socket_send(sockfd, (void*) &read_packet, sizeof(read_packet), 0);
+    send = eth_socket_send_request(board, (void*) &read_packet, sizeof(read_packet), size);
     if(send < 0)
         LL_PRINT("ERROR: sending packet: %s\n", strerror(errno));
     LL_PRINT_IF(debug, "read(%d) : PACKET SENT [CMD:%02X%02X | ADDR: %02X%02X | SIZE: %d]\n", read_cnt, read_packet.cmd_hi, read_packet.cmd_lo,
       read_packet.addr_lo, read_packet.addr_hi, size);
-    t1 = rtapi_get_time();
-    do {
-        rtapi_delay(READ_PCK_DELAY_NS);
-        recv = eth_socket_recv(sockfd, (void*) &tmp_buffer, size, 0);
-        t2 = rtapi_get_time();
-        i++;
-    } while ((recv < 0) && ((t2 - t1) < 200*1000*1000));
-
-    if (recv == 4) {
-        LL_PRINT_IF(debug, "read(%d) : PACKET RECV [DATA: %08X | SIZE: %d | TRIES: %d | TIME: %llu]\n", read_cnt, *tmp_buffer, recv, i, t2 - t1);
-    } else {
-        LL_PRINT_IF(debug, "read(%d) : PACKET RECV [SIZE: %d | TRIES: %d | TIME: %llu]\n", read_cnt, recv, i, t2 - t1);
-    }
+    recv = eth_socket_recv_reply(board, (void*) &tmp_buffer);
     if (recv < 0)
         return 0;
     memcpy(buffer, tmp_buffer, size);
     return 1;  // success
 }
 
+static int hm2_eth_send_queued_reads(hm2_lowlevel_io_t *this) {
+    hm2_eth_t *board = this->private;
+    int send;
+
+    if (comm_active == 0) return 1;
+    if (queue_reads_count == 0) return 1;
+    if (queue_reads_sent) return 1;
+
+    read_cnt++;
+    send = eth_socket_send_request(board, (void*) &queue_packets, sizeof(lbp16_cmd_addr)*queue_reads_count, queue_buff_size);
+    if(send < 0) {
+        LL_PRINT("ERROR: sending packet: %s\n", strerror(errno));
+        return 0;
+    }
+    queue_reads_sent = 1;
+    return 1;
+}
+
 static int hm2_eth_enqueue_read(hm2_lowlevel_io_t *this, rtapi_u32 addr, void *buffer, int size) {
     if (comm_active == 0) return 1;
     if (size == 0) return 1;
     if (size == -1) {
-        int send, recv, i = 0;
-        long long t1, t2;
+        hm2_eth_t *board = this->private;
+        int recv, i;
         rtapi_u8 tmp_buffer[queue_buff_size];
 
-        read_cnt++;
-        send = eth_socket_send(sockfd, (void*) &queue_packets, sizeof(lbp16_cmd_addr)*queue_reads_count, 0);
-        if(send < 0)
-            LL_PRINT("ERROR: sending packet: %s\n", strerror(errno));
-        t1 = rtapi_get_time();
-        do {
-            rtapi_delay(READ_PCK_DELAY_NS);
-            recv = eth_socket_recv(sockfd, (void*) &tmp_buffer, queue_buff_size, 0);
-            t2 = rtapi_get_time();
-            i++;
-        } while ((recv < 0) && ((t2 - t1) < 200*1000*1000));
-        LL_PRINT_IF(debug, "enqueue_read(%d) : PACKET RECV [SIZE: %d | TRIES: %d | TIME: %llu]\n", read_cnt, recv, i, t2 - t1);
-
-        for (i = 0; i < queue_reads_count; i++) {
-            memcpy(queue_reads[i].buffer, &tmp_buffer[queue_reads[i].from], queue_reads[i].size);
+        // normally sent here; already on its way if read-request() ran
+        hm2_eth_send_queued_reads(this);
+        recv = eth_socket_recv_reply(board, (void*) &tmp_buffer);
+        LL_PRINT_IF(debug, "enqueue_read(%d) : PACKET RECV [SIZE: %d]\n", read_cnt, recv);
+
+        // on timeout, leave the buffers with what the last good read got
+        if (recv == queue_buff_size) {
+            for (i = 0; i < queue_reads_count; i++) {
+                memcpy(queue_reads[i].buffer, &tmp_buffer[queue_reads[i].from], queue_reads[i].size);
+            }
         }
 
         queue_reads_count = 0;
         queue_buff_size = 0;
+        queue_reads_sent = 0;
     } else {
         LBP16_INIT_PACKET4(queue_packets[queue_reads_count], CMD_READ_HOSTMOT2_ADDR32_INCR(size/4), addr);
         queue_reads[queue_reads_count].buffer = buffer;
@@ -593,6 +673,7 @@ static int hm2_eth_probe() {
     board->llio.write = hm2_eth_write;
     board->llio.queue_read = hm2_eth_enqueue_read;
     board->llio.queue_write = hm2_eth_enqueue_write;
+    board->llio.send_queued_reads = hm2_eth_send_queued_reads;
 
     ret = hm2_register(&board->llio, config[boards_count]);
     if (ret != 0) {
@@ -29,6 +29,7 @@
 
 typedef struct {
     hm2_lowlevel_io_t llio;
+    int reply_size;     // size of the answer to the read request in flight
 } hm2_eth_t;
 
 typedef struct {
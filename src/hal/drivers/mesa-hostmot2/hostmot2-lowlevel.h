@@ -78,6 +78,13 @@ struct hm2_lowlevel_io_struct {
 
     int (*queue_read)(hm2_lowlevel_io_t *self, rtapi_u32 addr, void *buffer, int size);
     int (*queue_write)(hm2_lowlevel_io_t *self, rtapi_u32 addr, void *buffer, int size);
+
+    // this one is optional
+    // it sends the reads collected by queue_read without waiting for the
+    // answer; the queue_read(size=-1) that follows only has to collect it.
+    // If present, the hostmot2 driver exports a read-request() function
+    // so the request can go out early in the thread, ahead of read()
+    int (*send_queued_reads)(hm2_lowlevel_io_t *self);
     // 
     // This is a HAL parameter allocated and added to HAL by hostmot2.
     // 
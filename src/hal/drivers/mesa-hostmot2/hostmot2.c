@@ -74,31 +74,74 @@ static int comp_id;
 // functions exported to LinuxCNC
 //
 
-static void hm2_read(void *void_hm2, long period) {
+static void hm2_queue_read(hostmot2_t *hm2) {
+    hm2_tram_read(hm2);
+    if ((*hm2->llio->io_error) != 0) return;
+    hm2_raw_queue_read(hm2);
+    hm2_tp_pwmgen_queue_read(hm2);
+}
+
+
+static void hm2_read_request(void *void_hm2, long period) {
     hostmot2_t *hm2 = void_hm2;
 
     // if there are comm problems, wait for the user to fix it
     if ((*hm2->llio->io_error) != 0) return;
 
-    hm2_tram_read(hm2);
+    // the last request was never collected by read(); don't queue twice
+    if (hm2->read_requested) return;
+
+    hm2_benchmark_mark(hm2);
+    hm2_queue_read(hm2);
     if ((*hm2->llio->io_error) != 0) return;
-    hm2_raw_queue_read(hm2);
-    hm2_tp_pwmgen_queue_read(hm2);
+    hm2->read_requested = 1;
+
+    // if this fails, read() tries to send the queue again
+    hm2->llio->send_queued_reads(hm2->llio);
+    hm2_benchmark_lap(hm2, HM2_BENCHMARK_TRAM_READ);
+}
+
+
+static void hm2_read(void *void_hm2, long period) {
+    hostmot2_t *hm2 = void_hm2;
+
+    // if there are comm problems, wait for the user to fix it
+    if ((*hm2->llio->io_error) != 0) return;
+
+    hm2_benchmark_mark(hm2);
+
+    // without a read-request() earlier in the thread, ask now
+    if (!hm2->read_requested) {
+        hm2_queue_read(hm2);
+        if ((*hm2->llio->io_error) != 0) return;
+    }
+    hm2->read_requested = 0;
     hm2_finish_read(hm2);
     if ((*hm2->llio->io_error) != 0) return;
+    hm2_benchmark_lap(hm2, HM2_BENCHMARK_TRAM_READ);
 
     hm2_watchdog_process_tram_read(hm2);
+    hm2_benchmark_lap(hm2, HM2_BENCHMARK_WATCHDOG);
     hm2_ioport_gpio_process_tram_read(hm2);
+    hm2_benchmark_lap(hm2, HM2_BENCHMARK_IOPORT);
     hm2_encoder_process_tram_read(hm2, period);
+    hm2_benchmark_lap(hm2, HM2_BENCHMARK_ENCODER);
     hm2_resolver_process_tram_read(hm2, period);
+    hm2_benchmark_lap(hm2, HM2_BENCHMARK_RESOLVER);
     hm2_stepgen_process_tram_read(hm2, period);
+    hm2_benchmark_lap(hm2, HM2_BENCHMARK_STEPGEN);
     hm2_sserial_process_tram_read(hm2, period);
+    hm2_benchmark_lap(hm2, HM2_BENCHMARK_SSERIAL);
     hm2_bspi_process_tram_read(hm2, period);
+    hm2_benchmark_lap(hm2, HM2_BENCHMARK_BSPI);
     hm2_absenc_process_tram_read(hm2, period);
+    hm2_benchmark_lap(hm2, HM2_BENCHMARK_ABSENC);
     //UARTS need to be explicity handled by an external component
 
     hm2_tp_pwmgen_process_read(hm2); // check the status of the fault bit
+    hm2_benchmark_lap(hm2, HM2_BENCHMARK_TP_PWMGEN);
     hm2_dpll_process_tram_read(hm2, period);
+    hm2_benchmark_lap(hm2, HM2_BENCHMARK_DPLL);
 }
 
 
@@ -108,31 +151,53 @@ static void hm2_write(void *void_hm2, long period) {
     // if there are comm problems, wait for the user to fix it
     if ((*hm2->llio->io_error) != 0) return;
 
+    hm2_benchmark_mark(hm2);
+
     hm2_ioport_gpio_prepare_tram_write(hm2);
+    hm2_benchmark_lap(hm2, HM2_BENCHMARK_IOPORT);
     hm2_pwmgen_prepare_tram_write(hm2);
+    hm2_benchmark_lap(hm2, HM2_BENCHMARK_PWMGEN);
     hm2_tp_pwmgen_prepare_tram_write(hm2);
+    hm2_benchmark_lap(hm2, HM2_BENCHMARK_TP_PWMGEN);
     hm2_stepgen_prepare_tram_write(hm2, period);
+    hm2_benchmark_lap(hm2, HM2_BENCHMARK_STEPGEN);
     hm2_sserial_prepare_tram_write(hm2, period);
+    hm2_benchmark_lap(hm2, HM2_BENCHMARK_SSERIAL);
     hm2_bspi_prepare_tram_write(hm2, period);
+    hm2_benchmark_lap(hm2, HM2_BENCHMARK_BSPI);
     hm2_watchdog_prepare_tram_write(hm2);
+    hm2_benchmark_lap(hm2, HM2_BENCHMARK_WATCHDOG);
     //UARTS need to be explicity handled by an external component
     hm2_tram_write(hm2);
+    hm2_benchmark_lap(hm2, HM2_BENCHMARK_TRAM_WRITE);
 
     // these usually do nothing
     // they only write to the FPGA if certain pins & params have changed
     hm2_ioport_write(hm2);    // handles gpio.is_output but not gpio.out (that's done in tram_write() above)
+    hm2_benchmark_lap(hm2, HM2_BENCHMARK_IOPORT);
     hm2_watchdog_write(hm2, period);  // in case the user has written to the watchdog.timeout_ns param
+    hm2_benchmark_lap(hm2, HM2_BENCHMARK_WATCHDOG);
     hm2_pwmgen_write(hm2);    // update pwmgen registers if needed
+    hm2_benchmark_lap(hm2, HM2_BENCHMARK_PWMGEN);
     hm2_tp_pwmgen_write(hm2); // update Three Phase PWM registers if needed
+    hm2_benchmark_lap(hm2, HM2_BENCHMARK_TP_PWMGEN);
     hm2_stepgen_write(hm2);   // update stepgen registers if needed
+    hm2_benchmark_lap(hm2, HM2_BENCHMARK_STEPGEN);
     hm2_encoder_write(hm2);   // update ctrl register if needed
+    hm2_benchmark_lap(hm2, HM2_BENCHMARK_ENCODER);
     hm2_absenc_write(hm2);    // set bit-lengths and frequency
+    hm2_benchmark_lap(hm2, HM2_BENCHMARK_ABSENC);
     hm2_resolver_write(hm2, period); // Update the excitation frequency
+    hm2_benchmark_lap(hm2, HM2_BENCHMARK_RESOLVER);
     hm2_dpll_write(hm2, period); // Update the timer phases
+    hm2_benchmark_lap(hm2, HM2_BENCHMARK_DPLL);
     hm2_led_write(hm2);	      // Update on-board LEDs
+    hm2_benchmark_lap(hm2, HM2_BENCHMARK_LED);
 
     hm2_raw_write(hm2);
     hm2_finish_write(hm2);
+    hm2_benchmark_lap(hm2, HM2_BENCHMARK_TRAM_WRITE);
+    hm2_benchmark_publish(hm2);
 }
 
 
@@ -331,6 +396,7 @@ static int hm2_parse_config_string(hostmot2_t *hm2, char *config_string) {
     hm2->config.num_dplls = -1;
     hm2->config.num_leds = -1;
     hm2->config.enable_raw = 0;
+    hm2->config.enable_benchmark = 0;
     hm2->config.firmware = NULL;
 
     if (config_string == NULL) return 0;
@@ -433,6 +499,9 @@ static int hm2_parse_config_string(hostmot2_t *hm2, char *config_string) {
         } else if (strncmp(token, "enable_raw", 10) == 0) {
             hm2->config.enable_raw = 1;
 
+        } else if (strncmp(token, "enable_benchmark", 16) == 0) {
+            hm2->config.enable_benchmark = 1;
+
         } else if (strncmp(token, "firmware=", 9) == 0) {
             // FIXME: we leak this in hm2_register
             hm2->config.firmware = rtapi_kstrdup(token + 9, RTAPI_GFP_KERNEL);
@@ -464,6 +533,7 @@ static int hm2_parse_config_string(hostmot2_t *hm2, char *config_string) {
     HM2_DBG("    num_bspis=%d\n", hm2->config.num_bspis);
     HM2_DBG("    num_uarts=%d\n", hm2->config.num_uarts);
     HM2_DBG("    enable_raw=%d\n",   hm2->config.enable_raw);
+    HM2_DBG("    enable_benchmark=%d\n", hm2->config.enable_benchmark);
     HM2_DBG("    firmware=%s\n",   hm2->config.firmware ? hm2->config.firmware : "(NULL)");
 
     rtapi_argv_free(argv);
@@ -1409,6 +1479,16 @@ int hm2_register(hm2_lowlevel_io_t *llio, char *config_string) {
     }
 
 
+    //
+    // benchmark mode times each module's part of read() and write()
+    //
+
+    r = hm2_benchmark_setup(hm2);
+    if (r != 0) {
+        goto fail1;
+    }
+
+
     //
     // At this point, all non-TRAM register buffers have been initialized
     // and all HAL objects have been allocated and exported to HAL.
@@ -1520,6 +1600,16 @@ int hm2_register(hm2_lowlevel_io_t *llio, char *config_string) {
             r = -EINVAL;
             goto fail1;
         }
+
+        if (hm2->llio->send_queued_reads) {
+            rtapi_snprintf(name, sizeof(name), "%s.read-request", hm2->llio->name);
+            r = hal_export_funct(name, hm2_read_request, hm2, 1, 0, hm2->llio->comp_id);
+            if (r != 0) {
+                HM2_ERR("error %d exporting read-request function %s\n", r, name);
+                r = -EINVAL;
+                goto fail1;
+            }
+        }
     }
 
 
@@ -949,6 +949,44 @@ typedef struct {
 } hm2_raw_t;
 
 
+//
+// benchmark mode: where read() and write() spend their time
+//
+
+typedef enum {
+    HM2_BENCHMARK_TRAM_READ,    // queueing the TRAM read and waiting for it
+    HM2_BENCHMARK_WATCHDOG,
+    HM2_BENCHMARK_IOPORT,
+    HM2_BENCHMARK_ENCODER,
+    HM2_BENCHMARK_ABSENC,
+    HM2_BENCHMARK_RESOLVER,
+    HM2_BENCHMARK_PWMGEN,
+    HM2_BENCHMARK_TP_PWMGEN,
+    HM2_BENCHMARK_STEPGEN,
+    HM2_BENCHMARK_SSERIAL,
+    HM2_BENCHMARK_BSPI,
+    HM2_BENCHMARK_DPLL,
+    HM2_BENCHMARK_LED,
+    HM2_BENCHMARK_TRAM_WRITE,   // sending the TRAM write and raw writes
+    HM2_BENCHMARK_NUM
+} hm2_benchmark_stage_t;
+
+typedef struct {
+    struct {
+        struct {
+            hal_s32_t *time[HM2_BENCHMARK_NUM];
+        } pin;
+
+        struct {
+            hal_s32_t tmax[HM2_BENCHMARK_NUM];
+        } param;
+    } hal;
+
+    long long int lap_start;
+    long long int clocks[HM2_BENCHMARK_NUM];
+} hm2_benchmark_t;
+
+
 
 
 // 
@@ -988,6 +1026,7 @@ typedef struct {
         int num_dplls;
         char sserial_modes[4][8];
         int enable_raw;
+        int enable_benchmark;
         char *firmware;
     } config;
 
@@ -1014,6 +1053,9 @@ typedef struct {
     rtapi_u32 *tram_write_buffer;
     rtapi_u16 tram_write_size;
 
+    // set by read-request() when the TRAM read is already on its way
+    int read_requested;
+
     // the hostmot2 "Functions"
     hm2_encoder_t encoder;
     hm2_absenc_t absenc;
@@ -1030,6 +1072,7 @@ typedef struct {
     hm2_led_t led;
 
     hm2_raw_t *raw;
+    hm2_benchmark_t *benchmark;
 
     struct rtapi_list_head list;
 } hostmot2_t;
@@ -1295,6 +1338,15 @@ int hm2_raw_setup(hostmot2_t *hm2);
 void hm2_raw_queue_read(hostmot2_t *hm2);
 void hm2_raw_write(hostmot2_t *hm2);
 
+//
+// benchmark mode times each module's part of read() and write()
+//
+
+int hm2_benchmark_setup(hostmot2_t *hm2);
+void hm2_benchmark_mark(hostmot2_t *hm2);
+void hm2_benchmark_lap(hostmot2_t *hm2, hm2_benchmark_stage_t stage);
+void hm2_benchmark_publish(hostmot2_t *hm2);
+
 
 
 
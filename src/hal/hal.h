@@ -460,6 +460,60 @@ extern int hal_link(const char *pin_name, const char *sig_name);
 */
 extern int hal_unlink(const char *pin_name);
 
+#ifdef ULAPI
+/** The 'hal_batch_xxx()' functions let a configuration tool build up
+    a netlist - new signals and pin/signal links - and then apply all
+    of it at once, with a single grab of the HAL mutex.  Either the
+    whole batch is applied, or (if anything in it is invalid) none of
+    it is.  They are only available in user space.
+
+    'hal_batch_begin()' starts a new, empty batch.  It fails if a batch
+    has already been started and not yet committed or aborted.
+
+    'hal_batch_signal_new()' and 'hal_batch_link()' add a signal or a
+    link to the batch.  The arguments are the same as for
+    'hal_signal_new()' and 'hal_link()', but nothing happens until
+    the batch is committed.  A link may refer to a signal that is
+    created earlier in the same batch.  'hal_batch_link()' checks the
+    link against the current state of HAL and against the entries
+    already in the batch, so that a pin linked to two signals, a type
+    mismatch, or a second output pin on a signal is refused right
+    away.  On success they return the (zero based) position of the
+    new entry in the batch, on failure a negative error code.
+
+    'hal_batch_sig_type()' returns the type of a signal that is to be
+    created by the current batch, or HAL_TYPE_UNSPECIFIED if there is
+    no such signal.
+
+    'hal_batch_pin_sig()' returns the name of the signal that the
+    current batch links pin 'pin_name' to, or NULL if there is none.
+
+    'hal_batch_sig_writer()' returns the name of an output or I/O pin
+    that the current batch links to signal 'sig_name', or NULL if
+    there is none.  If 'dir' is not NULL, the direction of that pin is
+    stored there.
+
+    'hal_batch_commit()' creates all the signals and makes all the
+    links, in order, and ends the batch.  On success it returns 0.  On
+    failure it undoes everything it did, ends the batch and returns a
+    negative error code.  If 'failed_entry' is not NULL, it is set to
+    the position of the entry that could not be applied, or -1 if the
+    failure was not caused by a particular entry.  Undoing restores
+    the values of the pins and of any signals that already existed.
+
+    'hal_batch_abort()' discards the current batch, if any.
+*/
+extern int hal_batch_begin(void);
+extern int hal_batch_signal_new(const char *name, hal_type_t type);
+extern int hal_batch_link(const char *pin_name, const char *sig_name);
+extern hal_type_t hal_batch_sig_type(const char *name);
+extern const char *hal_batch_pin_sig(const char *pin_name);
+extern const char *hal_batch_sig_writer(const char *sig_name,
+    hal_pin_dir_t *dir);
+extern int hal_batch_commit(int *failed_entry);
+extern void hal_batch_abort(void);
+#endif /* ULAPI */
+
 /***********************************************************************
 *                     "PARAMETER" FUNCTIONS                            *
 ************************************************************************/
@@ -696,6 +750,27 @@ extern int hal_add_funct_to_thread(const char *funct_name, const char *thread_na
 */
 extern int hal_del_funct_from_thread(const char *funct_name, const char *thread_name);
 
+/** hal_set_funct_group() puts a function that a thread calls into a
+    parallel group.  A run of consecutive functions in a thread that
+    are all in groups forms a parallel section.  The functions of each
+    group still run in thread order, but the groups of a section run
+    at the same time, on other CPUs if the RTAPI and the host allow
+    it (see rtapi_task_parallel()).  The thread waits for all of them
+    before it calls the function after the section, so functions that
+    depend on the section's results simply go after it.  Functions in
+    different groups of the same section must not depend on each other.
+    'funct_name' and 'thread_name' are as for hal_del_funct_from_thread().
+    'group' is from 1 to HAL_MAX_FUNCT_GROUPS, or 0 to take the function
+    out of its group.  Groups can only be changed while the threads are
+    stopped.
+    Returns 0, or a negative error code.    Call
+    only from within user space or init code, not from
+    realtime code.
+*/
+#define HAL_MAX_FUNCT_GROUPS 16
+extern int hal_set_funct_group(const char *funct_name, const char *thread_name,
+    int group);
+
 /** hal_start_threads() starts all threads that have been created.
     This is the point at which realtime functions start being called.
     On success it returns 0, on failure a negative
@@ -70,6 +70,7 @@ MODULE_LICENSE("GPL");
 #if defined(ULAPI)
 #include <sys/types.h>		/* pid_t */
 #include <unistd.h>		/* getpid() */
+#include <stdlib.h>		/* malloc(), qsort() */
 #endif
 
 char *hal_shmem_base = 0;
@@ -113,18 +114,28 @@ static int init_hal_data(void);
 static void *shmalloc_up(long int size);
 static void *shmalloc_dn(long int size);
 
+/** 'link_pin_struct()' links 'pin' to 'sig', after checking that the
+    link is legal.  'unlink_pin()' breaks any link 'pin' may have.  Like
+    the functions below, they assume that the caller has the mutex.
+*/
+
 /** The alloc_xxx_struct() functions allocate a structure of the
     appropriate type and return a pointer to it, or 0 if they fail.
     They attempt to re-use freed structs first, if none are
     available, then they call hal_malloc() to create a new one.
     The free_xxx_struct() functions add the structure at 'p' to
     the appropriate free list, for potential re-use later.
+    'new_sig_struct()' allocates and initializes a signal, including
+    the storage for its value, but doesn't put it in the signal list.
+    It returns 0 on success, or a negative error code.
     All of these functions assume that the caller has already
     grabbed the hal_data mutex.
 */
 hal_comp_t *halpr_alloc_comp_struct(void);
 static hal_pin_t *alloc_pin_struct(void);
 static hal_sig_t *alloc_sig_struct(void);
+static int new_sig_struct(const char *name, hal_type_t type,
+    hal_sig_t ** new);
 static hal_param_t *alloc_param_struct(void);
 static hal_oldname_t *halpr_alloc_oldname_struct(void);
 #ifdef RTAPI
@@ -136,6 +147,7 @@ static hal_thread_t *alloc_thread_struct(void);
 #endif /* RTAPI */
 
 static void free_comp_struct(hal_comp_t * comp);
+static int link_pin_struct(hal_pin_t * pin, hal_sig_t * sig);
 static void unlink_pin(hal_pin_t * pin);
 static void free_pin_struct(hal_pin_t * pin);
 static void free_sig_struct(hal_sig_t * sig);
@@ -149,14 +161,58 @@ static void free_funct_entry_struct(hal_funct_entry_t * funct_entry);
 static void free_thread_struct(hal_thread_t * thread);
 #endif /* RTAPI */
 
+/** The name index functions maintain the hashed index of pin, signal,
+    parameter and function names (see hal_name_slot_t in hal_priv.h).
+    'name_index_add()' enters 'name', which must be stored inside the
+    object 'obj' or its oldname struct, under the object type 'kind'.
+    If the index needs to grow and there isn't enough shared memory,
+    the index is disabled and all lookups fall back to list walks.
+    'name_index_remove()' removes the entry for 'name' that refers to
+    'obj', if there is one.  Both do nothing if the index is disabled,
+    except that 'name_index_remove()' always bumps 'name_generation'.
+    'name_index_find()' returns the object of type 'kind' named 'name',
+    or 0 if there isn't one.  It must only be called when the index is
+    enabled ('name_index_size' non-zero).  All of these functions assume
+    that the caller has already grabbed the hal_data mutex.
+    'name_index_hash()' is the hash function used by the index.
+*/
+static unsigned int name_index_hash(const char *name);
+static void name_index_add(int kind, const char *name, void *obj);
+static void name_index_remove(int kind, const char *name, void *obj);
+static void *name_index_find(int kind, const char *name);
+
 #ifdef RTAPI
 /** 'thread_task()' is a function that is invoked as a realtime task.
     It implements a thread, by running down the thread's function list
     and calling each function in turn.
 */
 static void thread_task(void *arg);
+
+/** 'run_funct_section()' runs the parallel section of 'thread' that
+    starts at 'first' (see hal_set_funct_group()), and returns the first
+    entry after it.  'run_funct_group()' is called, possibly on another
+    CPU, to run one group of the section.  'funct_ran()' updates the
+    runtime data of a function after a call that took 'runtime'.
+*/
+static hal_funct_entry_t *run_funct_section(hal_thread_t * thread,
+    hal_funct_entry_t * first, int stats);
+static void run_funct_group(void *arg, int n);
+static void funct_ran(hal_funct_entry_t * funct_entry,
+    long long int runtime, int stats);
+
+/** 'stats_add()' adds 'sample' to the histogram 'stats', and now and
+    then refreshes its percentile parameters.  It is only called by the
+    thread that owns 'stats'.
+*/
+static void stats_add(hal_stats_t * stats, long long int sample);
 #endif /* RTAPI */
 
+/** 'stats_clear()' discards all samples in 'stats'.  Only the thread
+    that owns 'stats', or config code before anything can use it, may
+    call it.
+*/
+static void stats_clear(hal_stats_t * stats);
+
 /***********************************************************************
 *                  PUBLIC (API) FUNCTION CODE                          *
 ************************************************************************/
@@ -689,6 +745,7 @@ int hal_pin_new(const char *name, hal_type_t type, hal_pin_dir_t dir,
 	    /* reached end of list, insert here */
 	    new->next_ptr = next;
 	    *prev = SHMOFF(new);
+	    name_index_add(HAL_NAME_PIN, new->name, new);
 	    rtapi_mutex_give(&(hal_data->mutex));
 	    return 0;
 	}
@@ -698,6 +755,7 @@ int hal_pin_new(const char *name, hal_type_t type, hal_pin_dir_t dir,
 	    /* found the right place for it, insert here */
 	    new->next_ptr = next;
 	    *prev = SHMOFF(new);
+	    name_index_add(HAL_NAME_PIN, new->name, new);
 	    rtapi_mutex_give(&(hal_data->mutex));
 	    return 0;
 	}
@@ -792,6 +850,12 @@ int hal_pin_alias(const char *pin_name, const char *alias)
 	prev = &(pin->next_ptr);
 	next = *prev;
     }
+    /* the name(s) are about to change, take them out of the index */
+    name_index_remove(HAL_NAME_PIN, pin->name, pin);
+    if (pin->oldname != 0) {
+	oldname = SHMPTR(pin->oldname);
+	name_index_remove(HAL_NAME_PIN, oldname->name, pin);
+    }
     if ( alias != NULL ) {
 	/* adding a new alias */
 	if ( pin->oldname == 0 ) {
@@ -812,6 +876,12 @@ int hal_pin_alias(const char *pin_name, const char *alias)
 	    free_oldname_struct(oldname);
 	}
     }
+    /* put the new name(s) into the index */
+    name_index_add(HAL_NAME_PIN, pin->name, pin);
+    if (pin->oldname != 0) {
+	oldname = SHMPTR(pin->oldname);
+	name_index_add(HAL_NAME_PIN, oldname->name, pin);
+    }
     /* insert pin back into list in proper place */
     prev = &(hal_data->pin_list_ptr);
     next = *prev;
@@ -845,9 +915,8 @@ int hal_pin_alias(const char *pin_name, const char *alias)
 int hal_signal_new(const char *name, hal_type_t type)
 {
 
-    int *prev, next, cmp;
+    int *prev, next, cmp, retval;
     hal_sig_t *new, *ptr;
-    void *data_addr;
 
     if (hal_data == 0) {
 	rtapi_print_msg(RTAPI_MSG_ERR,
@@ -876,60 +945,12 @@ int hal_signal_new(const char *name, hal_type_t type)
 	    "HAL: ERROR: duplicate signal '%s'\n", name);
 	return -EINVAL;
     }
-    /* allocate memory for the signal value */
-    switch (type) {
-    case HAL_BIT:
-	data_addr = shmalloc_up(sizeof(hal_bit_t));
-	break;
-    case HAL_S32:
-	data_addr = shmalloc_up(sizeof(hal_s32_t));
-	break;
-    case HAL_U32:
-	data_addr = shmalloc_up(sizeof(hal_u32_t));
-	break;
-    case HAL_FLOAT:
-	data_addr = shmalloc_up(sizeof(hal_float_t));
-	break;
-    default:
-	rtapi_mutex_give(&(hal_data->mutex));
-	rtapi_print_msg(RTAPI_MSG_ERR,
-	    "HAL: ERROR: illegal signal type %d'\n", type);
-	return -EINVAL;
-	break;
-    }
-    /* allocate a new signal structure */
-    new = alloc_sig_struct();
-    if ((new == 0) || (data_addr == 0)) {
-	/* alloc failed */
+    /* allocate and initialize the signal */
+    retval = new_sig_struct(name, type, &new);
+    if (retval != 0) {
 	rtapi_mutex_give(&(hal_data->mutex));
-	rtapi_print_msg(RTAPI_MSG_ERR,
-	    "HAL: ERROR: insufficient memory for signal '%s'\n", name);
-	return -ENOMEM;
-    }
-    /* initialize the signal value */
-    switch (type) {
-    case HAL_BIT:
-	*((hal_bit_t *) data_addr) = 0;
-	break;
-    case HAL_S32:
-	*((hal_s32_t *) data_addr) = 0;
-        break;
-    case HAL_U32:
-	*((hal_u32_t *) data_addr) = 0;
-        break;
-    case HAL_FLOAT:
-	*((hal_float_t *) data_addr) = 0.0;
-	break;
-    default:
-	break;
+	return retval;
     }
-    /* initialize the structure */
-    new->data_ptr = SHMOFF(data_addr);
-    new->type = type;
-    new->readers = 0;
-    new->writers = 0;
-    new->bidirs = 0;
-    rtapi_snprintf(new->name, sizeof(new->name), "%s", name);
     /* search list for 'name' and insert new structure */
     prev = &(hal_data->sig_list_ptr);
     next = *prev;
@@ -938,6 +959,7 @@ int hal_signal_new(const char *name, hal_type_t type)
 	    /* reached end of list, insert here */
 	    new->next_ptr = next;
 	    *prev = SHMOFF(new);
+	    name_index_add(HAL_NAME_SIG, new->name, new);
 	    rtapi_mutex_give(&(hal_data->mutex));
 	    return 0;
 	}
@@ -947,6 +969,7 @@ int hal_signal_new(const char *name, hal_type_t type)
 	    /* found the right place for it, insert here */
 	    new->next_ptr = next;
 	    *prev = SHMOFF(new);
+	    name_index_add(HAL_NAME_SIG, new->name, new);
 	    rtapi_mutex_give(&(hal_data->mutex));
 	    return 0;
 	}
@@ -1005,8 +1028,7 @@ int hal_link(const char *pin_name, const char *sig_name)
 {
     hal_pin_t *pin;
     hal_sig_t *sig;
-    hal_comp_t *comp;
-    void **data_ptr_addr, *data_addr;
+    int retval;
 
     if (hal_data == 0) {
 	rtapi_print_msg(RTAPI_MSG_ERR,
@@ -1051,96 +1073,11 @@ int hal_link(const char *pin_name, const char *sig_name)
 	    "HAL: ERROR: signal '%s' not found\n", sig_name);
 	return -EINVAL;
     }
-    /* found both pin and signal, are they already connected? */
-    if (SHMPTR(pin->signal) == sig) {
-	rtapi_mutex_give(&(hal_data->mutex));
-	rtapi_print_msg(RTAPI_MSG_WARN,
-	    "HAL: Warning: pin '%s' already linked to '%s'\n", pin_name, sig_name);
-	return 0;
-    }
-    /* is the pin connected to something else? */
-    if(pin->signal) {
-	rtapi_mutex_give(&(hal_data->mutex));
-	sig = SHMPTR(pin->signal);
-	rtapi_print_msg(RTAPI_MSG_ERR,
-	    "HAL: ERROR: pin '%s' is linked to '%s', cannot link to '%s'\n",
-	    pin_name, sig->name, sig_name);
-	return -EINVAL;
-    }
-    /* check types */
-    if (pin->type != sig->type) {
-	rtapi_mutex_give(&(hal_data->mutex));
-	rtapi_print_msg(RTAPI_MSG_ERR,
-	    "HAL: ERROR: type mismatch '%s' <- '%s'\n", pin_name, sig_name);
-	return -EINVAL;
-    }
-    /* linking output pin to sig that already has output or I/O pins? */
-    if ((pin->dir == HAL_OUT) && ((sig->writers > 0) || (sig->bidirs > 0 ))) {
-	/* yes, can't do that */
-	rtapi_mutex_give(&(hal_data->mutex));
-	rtapi_print_msg(RTAPI_MSG_ERR,
-	    "HAL: ERROR: signal '%s' already has output or I/O pin(s)\n", sig_name);
-	return -EINVAL;
-    }
-    /* linking bidir pin to sig that already has output pin? */
-    if ((pin->dir == HAL_IO) && (sig->writers > 0)) {
-	/* yes, can't do that */
-	rtapi_mutex_give(&(hal_data->mutex));
-	rtapi_print_msg(RTAPI_MSG_ERR,
-	    "HAL: ERROR: signal '%s' already has output pin\n", sig_name);
-	return -EINVAL;
-    }
-    /* everything is OK, make the new link */
-    data_ptr_addr = SHMPTR(pin->data_ptr_addr);
-    comp = SHMPTR(pin->owner_ptr);
-    data_addr = comp->shmem_base + sig->data_ptr;
-    *data_ptr_addr = data_addr;
-    if (( sig->readers == 0 ) && ( sig->writers == 0 ) && ( sig->bidirs == 0 )) {
-	/* this is the first pin for this signal, copy value from pin's "dummy" field */
-	data_addr = hal_shmem_base + sig->data_ptr;
-
-        // assure proper typing on assignment, assigning a hal_data_u is
-        // a surefire cause for memory corrupion as hal_data_u is larger
-        // than hal_bit_t, hal_s32_t, and hal_u32_t - this works only for 
-        // hal_float_t (!)
-        // my old, buggy code:
-        //*((hal_data_u *)data_addr) = pin->dummysig;
-
-        switch (pin->type) {
-        case HAL_BIT:
-            *((hal_bit_t *) data_addr) = pin->dummysig.b;
-            break;
-        case HAL_S32:
-            *((hal_s32_t *) data_addr) = pin->dummysig.s;
-            break;
-        case HAL_U32:
-            *((hal_u32_t *) data_addr) = pin->dummysig.u;
-            break;
-        case HAL_FLOAT:
-            *((hal_float_t *) data_addr) = pin->dummysig.f;
-            break;
-        default:
-            rtapi_print_msg(RTAPI_MSG_ERR,
-                          "HAL: BUG: pin '%s' has invalid type %d !!\n",
-                          pin->name, pin->type);
-            return -EINVAL;
-        }
-    }
-    /* update the signal's reader/writer/bidir counts */
-    if ((pin->dir & HAL_IN) != 0) {
-	sig->readers++;
-    }
-    if (pin->dir == HAL_OUT) {
-	sig->writers++;
-    }
-    if (pin->dir == HAL_IO) {
-	sig->bidirs++;
-    }
-    /* and update the pin */
-    pin->signal = SHMOFF(sig);
+    /* found both pin and signal, link them */
+    retval = link_pin_struct(pin, sig);
     /* done, release the mutex and return */
     rtapi_mutex_give(&(hal_data->mutex));
-    return 0;
+    return retval;
 }
 
 int hal_unlink(const char *pin_name)
@@ -1183,117 +1120,714 @@ int hal_unlink(const char *pin_name)
     return 0;
 }
 
+#ifdef ULAPI
 /***********************************************************************
-*                       "PARAM" FUNCTIONS                              *
+*                       "BATCH" FUNCTIONS                              *
 ************************************************************************/
 
-/* wrapper functs for typed params - these call the generic funct below */
-
-int hal_param_bit_new(const char *name, hal_param_dir_t dir, hal_bit_t * data_addr,
-    int comp_id)
+/* An entry in a batch is either a new signal (if 'type' is a HAL type)
+   or a link of 'pin' to 'sig' (if 'type' is HAL_TYPE_UNSPECIFIED).
+   The batch lives in the memory of the process that builds it, not in
+   HAL shared memory.  Two small hash tables let the queueing functions
+   check new entries against the ones already queued: one holds the
+   pins that are to be linked, the other holds one entry per signal
+   that the batch touches - the entry that creates it, or the first
+   link to it if it exists already.  That entry also counts the output
+   and I/O pins that the batch links to the signal.
+*/
+typedef struct {
+    hal_type_t type;		/* signal type, or unspecified for links */
+    hal_pin_dir_t dir;		/* pin direction (links only) */
+    int writers;		/* number of queued output pin links */
+    int bidirs;			/* number of queued I/O pin links */
+    int writer;			/* entry of a queued output or I/O link */
+    char pin[HAL_NAME_LEN + 1];	/* pin name (links only) */
+    char sig[HAL_NAME_LEN + 1];	/* signal name */
+} hal_batch_entry_t;
+
+typedef struct {
+    int *slot;			/* entry number + 1, or 0 if empty */
+    int size;
+    int count;
+    int by_pin;			/* key is the pin name, not the signal */
+} hal_batch_hash_t;
+
+static int batch_active = 0;		/* non-zero if batch was begun */
+static hal_batch_entry_t *batch_entries = 0;
+static int batch_count = 0;		/* number of entries in batch */
+static int batch_alloc = 0;		/* number of entries allocated */
+static int batch_sig_count = 0;		/* number of new signals in batch */
+static hal_batch_hash_t batch_sigs = { 0, 0, 0, 0 };
+static hal_batch_hash_t batch_pins = { 0, 0, 0, 1 };
+
+static void batch_free(void)
 {
-    return hal_param_new(name, HAL_BIT, dir, (void *) data_addr, comp_id);
+    free(batch_entries);
+    free(batch_sigs.slot);
+    free(batch_pins.slot);
+    batch_entries = 0;
+    batch_count = 0;
+    batch_alloc = 0;
+    batch_sig_count = 0;
+    batch_sigs.slot = 0;
+    batch_sigs.size = 0;
+    batch_sigs.count = 0;
+    batch_pins.slot = 0;
+    batch_pins.size = 0;
+    batch_pins.count = 0;
+    batch_active = 0;
 }
 
-int hal_param_float_new(const char *name, hal_param_dir_t dir, hal_float_t * data_addr,
-    int comp_id)
+static const char *batch_key(hal_batch_hash_t * h, int entry)
 {
-    return hal_param_new(name, HAL_FLOAT, dir, (void *) data_addr, comp_id);
+    return h->by_pin ? batch_entries[entry].pin : batch_entries[entry].sig;
 }
 
-int hal_param_u32_new(const char *name, hal_param_dir_t dir, hal_u32_t * data_addr,
-    int comp_id)
+/* returns the entry stored under 'name' in 'h', or -1 if there is none */
+static int batch_find(hal_batch_hash_t * h, const char *name)
 {
-    return hal_param_new(name, HAL_U32, dir, (void *) data_addr, comp_id);
+    int i, mask;
+
+    if (h->size == 0) {
+	return -1;
+    }
+    mask = h->size - 1;
+    i = name_index_hash(name) & mask;
+    while (h->slot[i] != 0) {
+	if (strcmp(batch_key(h, h->slot[i] - 1), name) == 0) {
+	    return h->slot[i] - 1;
+	}
+	i = (i + 1) & mask;
+    }
+    return -1;
 }
 
-int hal_param_s32_new(const char *name, hal_param_dir_t dir, hal_s32_t * data_addr,
-    int comp_id)
+static void batch_hash_insert(hal_batch_hash_t * h, int entry);
+
+/* makes sure that 'h' has room for one more entry */
+static int batch_hash_grow(hal_batch_hash_t * h)
 {
-    return hal_param_new(name, HAL_S32, dir, (void *) data_addr, comp_id);
-}
+    int *old, old_size, n;
 
-static int hal_param_newfv(hal_type_t type, hal_param_dir_t dir,
-	void *data_addr, int comp_id, const char *fmt, va_list ap) {
-    char name[HAL_NAME_LEN + 1];
-    int sz;
-    sz = rtapi_vsnprintf(name, sizeof(name), fmt, ap);
-    if(sz == -1 || sz > HAL_NAME_LEN) {
-        rtapi_print_msg(RTAPI_MSG_ERR,
-	    "hal_param_newfv: length %d too long for name starting '%s'\n",
-	    sz, name);
+    /* keep the load factor at or below 1/2 */
+    if ((h->count + 1) * 2 <= h->size) {
+	return 0;
+    }
+    old = h->slot;
+    old_size = h->size;
+    h->size = old_size ? old_size * 2 : 64;
+    h->slot = calloc(h->size, sizeof(int));
+    if (h->slot == 0) {
+	h->slot = old;
+	h->size = old_size;
 	return -ENOMEM;
     }
-    return hal_param_new(name, type, dir, (void *) data_addr, comp_id);
+    h->count = 0;
+    for (n = 0; n < old_size; n++) {
+	if (old[n] != 0) {
+	    batch_hash_insert(h, old[n] - 1);
+	}
+    }
+    free(old);
+    return 0;
 }
 
-int hal_param_bit_newf(hal_param_dir_t dir, hal_bit_t * data_addr,
-    int comp_id, const char *fmt, ...)
+/* enters 'entry' in the hash table 'h', which must have room for it */
+static void batch_hash_insert(hal_batch_hash_t * h, int entry)
 {
-    va_list ap;
-    int ret;
-    va_start(ap, fmt);
-    ret = hal_param_newfv(HAL_BIT, dir, (void*)data_addr, comp_id, fmt, ap);
-    va_end(ap);
-    return ret;
+    int i, mask;
+
+    mask = h->size - 1;
+    i = name_index_hash(batch_key(h, entry)) & mask;
+    while (h->slot[i] != 0) {
+	i = (i + 1) & mask;
+    }
+    h->slot[i] = entry + 1;
+    h->count++;
 }
 
-int hal_param_float_newf(hal_param_dir_t dir, hal_float_t * data_addr,
-    int comp_id, const char *fmt, ...)
+/* appends a blank entry to the batch, returns its number */
+static int batch_new_entry(void)
 {
-    va_list ap;
-    int ret;
-    va_start(ap, fmt);
-    ret = hal_param_newfv(HAL_FLOAT, dir, (void*)data_addr, comp_id, fmt, ap);
-    va_end(ap);
-    return ret;
+    hal_batch_entry_t *p;
+    int n;
+
+    if (batch_count == batch_alloc) {
+	n = batch_alloc ? batch_alloc * 2 : 256;
+	p = realloc(batch_entries, n * sizeof(hal_batch_entry_t));
+	if (p == 0) {
+	    rtapi_print_msg(RTAPI_MSG_ERR,
+		"HAL: ERROR: insufficient memory for batch\n");
+	    return -ENOMEM;
+	}
+	batch_entries = p;
+	batch_alloc = n;
+    }
+    n = batch_count++;
+    batch_entries[n].writers = 0;
+    batch_entries[n].bidirs = 0;
+    batch_entries[n].writer = -1;
+    return n;
 }
 
-int hal_param_u32_newf(hal_param_dir_t dir, hal_u32_t * data_addr,
-    int comp_id, const char *fmt, ...)
+static int batch_sig_cmp(const void *a, const void *b)
 {
-    va_list ap;
-    int ret;
-    va_start(ap, fmt);
-    ret = hal_param_newfv(HAL_U32, dir, (void*)data_addr, comp_id, fmt, ap);
-    va_end(ap);
-    return ret;
+    return strcmp((*(hal_sig_t **) a)->name, (*(hal_sig_t **) b)->name);
 }
 
-int hal_param_s32_newf(hal_param_dir_t dir, hal_s32_t * data_addr,
-    int comp_id, const char *fmt, ...)
+/* copies the value of a signal or pin of type 'type' from 'src' to
+   'dest'; unlike assigning a hal_data_u, this never touches more
+   memory than the type occupies */
+static void batch_copy_value(hal_type_t type, void *dest, void *src)
 {
-    va_list ap;
-    int ret;
-    va_start(ap, fmt);
-    ret = hal_param_newfv(HAL_S32, dir, (void*)data_addr, comp_id, fmt, ap);
-    va_end(ap);
-    return ret;
+    switch (type) {
+    case HAL_BIT:
+	*((hal_bit_t *) dest) = *((hal_bit_t *) src);
+	break;
+    case HAL_S32:
+	*((hal_s32_t *) dest) = *((hal_s32_t *) src);
+	break;
+    case HAL_U32:
+	*((hal_u32_t *) dest) = *((hal_u32_t *) src);
+	break;
+    case HAL_FLOAT:
+	*((hal_float_t *) dest) = *((hal_float_t *) src);
+	break;
+    default:
+	break;
+    }
 }
 
-
-/* this is a generic function that does the majority of the work. */
-
-int hal_param_new(const char *name, hal_type_t type, hal_param_dir_t dir, void *data_addr,
-    int comp_id)
+int hal_batch_begin(void)
 {
-    int *prev, next, cmp;
-    hal_param_t *new, *ptr;
-    hal_comp_t *comp;
-
-    if (hal_data == 0) {
+    if (batch_active) {
 	rtapi_print_msg(RTAPI_MSG_ERR,
-	    "HAL: ERROR: param_new called before init\n");
+	    "HAL: ERROR: batch already started\n");
 	return -EINVAL;
     }
+    batch_free();
+    batch_active = 1;
+    return 0;
+}
 
-    if (type != HAL_BIT && type != HAL_FLOAT && type != HAL_S32 && type != HAL_U32) {
+int hal_batch_signal_new(const char *name, hal_type_t type)
+{
+    int n;
+
+    if (!batch_active) {
 	rtapi_print_msg(RTAPI_MSG_ERR,
-	    "HAL: ERROR: pin type not one of HAL_BIT, HAL_FLOAT, HAL_S32 or HAL_U32\n");
+	    "HAL: ERROR: batch_signal_new called without batch\n");
 	return -EINVAL;
     }
-
-    if(dir != HAL_RO && dir != HAL_RW) {
+    if (strlen(name) > HAL_NAME_LEN) {
+	rtapi_print_msg(RTAPI_MSG_ERR,
+	    "HAL: ERROR: signal name '%s' is too long\n", name);
+	return -EINVAL;
+    }
+    if (type != HAL_BIT && type != HAL_FLOAT && type != HAL_S32 && type != HAL_U32) {
+	rtapi_print_msg(RTAPI_MSG_ERR,
+	    "HAL: ERROR: illegal signal type %d'\n", type);
+	return -EINVAL;
+    }
+    /* a signal that the batch links to already exists, so this also
+       catches most duplicates of existing signals */
+    if (batch_find(&batch_sigs, name) >= 0) {
+	rtapi_print_msg(RTAPI_MSG_ERR,
+	    "HAL: ERROR: duplicate signal '%s'\n", name);
+	return -EINVAL;
+    }
+    if (batch_hash_grow(&batch_sigs) != 0) {
+	rtapi_print_msg(RTAPI_MSG_ERR,
+	    "HAL: ERROR: insufficient memory for batch\n");
+	return -ENOMEM;
+    }
+    n = batch_new_entry();
+    if (n < 0) {
+	return n;
+    }
+    batch_entries[n].type = type;
+    batch_entries[n].pin[0] = '\0';
+    rtapi_snprintf(batch_entries[n].sig, sizeof(batch_entries[n].sig), "%s", name);
+    batch_hash_insert(&batch_sigs, n);
+    batch_sig_count++;
+    return n;
+}
+
+int hal_batch_link(const char *pin_name, const char *sig_name)
+{
+    hal_pin_t *pin;
+    hal_sig_t *sig;
+    hal_type_t pin_type, sig_type;
+    hal_pin_dir_t dir;
+    int n, head, queued, writers, bidirs, linked_here;
+    char linked[HAL_NAME_LEN + 1];
+
+    if (!batch_active) {
+	rtapi_print_msg(RTAPI_MSG_ERR,
+	    "HAL: ERROR: batch_link called without batch\n");
+	return -EINVAL;
+    }
+    /* make sure we were given a pin name */
+    if (pin_name == 0) {
+	rtapi_print_msg(RTAPI_MSG_ERR, "HAL: ERROR: pin name not given\n");
+	return -EINVAL;
+    }
+    /* make sure we were given a signal name */
+    if (sig_name == 0) {
+	rtapi_print_msg(RTAPI_MSG_ERR, "HAL: ERROR: signal name not given\n");
+	return -EINVAL;
+    }
+    if ((strlen(pin_name) > HAL_NAME_LEN) || (strlen(sig_name) > HAL_NAME_LEN)) {
+	rtapi_print_msg(RTAPI_MSG_ERR,
+	    "HAL: ERROR: pin '%s' or signal '%s' name is too long\n",
+	    pin_name, sig_name);
+	return -EINVAL;
+    }
+    if (hal_data == 0) {
+	rtapi_print_msg(RTAPI_MSG_ERR,
+	    "HAL: ERROR: batch_link called before init\n");
+	return -EINVAL;
+    }
+    /* look at the pin and signal as they are now; the commit checks
+       them again, in case they change before then */
+    rtapi_mutex_get(&(hal_data->mutex));
+    pin = halpr_find_pin_by_name(pin_name);
+    if (pin == 0) {
+	rtapi_mutex_give(&(hal_data->mutex));
+	rtapi_print_msg(RTAPI_MSG_ERR,
+	    "HAL: ERROR: pin '%s' not found\n", pin_name);
+	return -EINVAL;
+    }
+    pin_type = pin->type;
+    dir = pin->dir;
+    linked[0] = '\0';
+    if (pin->signal != 0) {
+	rtapi_snprintf(linked, sizeof(linked), "%s",
+	    ((hal_sig_t *) SHMPTR(pin->signal))->name);
+    }
+    sig = halpr_find_sig_by_name(sig_name);
+    sig_type = HAL_TYPE_UNSPECIFIED;
+    writers = 0;
+    bidirs = 0;
+    if (sig != 0) {
+	sig_type = sig->type;
+	writers = sig->writers;
+	bidirs = sig->bidirs;
+    }
+    rtapi_mutex_give(&(hal_data->mutex));
+    linked_here = 0;
+    if (linked[0] != '\0') {
+	if (strcmp(linked, sig_name) != 0) {
+	    rtapi_print_msg(RTAPI_MSG_ERR,
+		"HAL: ERROR: pin '%s' is linked to '%s', cannot link to '%s'\n",
+		pin_name, linked, sig_name);
+	    return -EINVAL;
+	}
+	/* already linked to this signal, the commit won't change it */
+	linked_here = 1;
+    }
+    queued = batch_find(&batch_pins, pin_name);
+    if (queued >= 0) {
+	if (strcmp(batch_entries[queued].sig, sig_name) != 0) {
+	    rtapi_print_msg(RTAPI_MSG_ERR,
+		"HAL: ERROR: pin '%s' is already queued to link to '%s', "
+		"cannot link to '%s'\n",
+		pin_name, batch_entries[queued].sig, sig_name);
+	    return -EINVAL;
+	}
+	/* the same link twice does nothing, like hal_link() */
+	return queued;
+    }
+    head = batch_find(&batch_sigs, sig_name);
+    if (head >= 0) {
+	if (batch_entries[head].type != HAL_TYPE_UNSPECIFIED) {
+	    sig_type = batch_entries[head].type;
+	}
+	writers += batch_entries[head].writers;
+	bidirs += batch_entries[head].bidirs;
+    } else if (sig == 0) {
+	rtapi_print_msg(RTAPI_MSG_ERR,
+	    "HAL: ERROR: signal '%s' not found\n", sig_name);
+	return -EINVAL;
+    }
+    if (pin_type != sig_type) {
+	rtapi_print_msg(RTAPI_MSG_ERR,
+	    "HAL: ERROR: type mismatch '%s' <- '%s'\n", pin_name, sig_name);
+	return -EINVAL;
+    }
+    if (!linked_here && (dir == HAL_OUT) && ((writers > 0) || (bidirs > 0))) {
+	rtapi_print_msg(RTAPI_MSG_ERR,
+	    "HAL: ERROR: signal '%s' already has output or I/O pin(s)\n",
+	    sig_name);
+	return -EINVAL;
+    }
+    if (!linked_here && (dir == HAL_IO) && (writers > 0)) {
+	rtapi_print_msg(RTAPI_MSG_ERR,
+	    "HAL: ERROR: signal '%s' already has output pin\n", sig_name);
+	return -EINVAL;
+    }
+    if ((batch_hash_grow(&batch_pins) != 0) ||
+	(batch_hash_grow(&batch_sigs) != 0)) {
+	rtapi_print_msg(RTAPI_MSG_ERR,
+	    "HAL: ERROR: insufficient memory for batch\n");
+	return -ENOMEM;
+    }
+    n = batch_new_entry();
+    if (n < 0) {
+	return n;
+    }
+    batch_entries[n].type = HAL_TYPE_UNSPECIFIED;
+    batch_entries[n].dir = dir;
+    rtapi_snprintf(batch_entries[n].pin, sizeof(batch_entries[n].pin), "%s", pin_name);
+    rtapi_snprintf(batch_entries[n].sig, sizeof(batch_entries[n].sig), "%s", sig_name);
+    batch_hash_insert(&batch_pins, n);
+    if (head < 0) {
+	/* first link to an existing signal */
+	batch_hash_insert(&batch_sigs, n);
+	head = n;
+    }
+    if (!linked_here && (dir == HAL_OUT)) {
+	batch_entries[head].writers++;
+	batch_entries[head].writer = n;
+    }
+    if (!linked_here && (dir == HAL_IO)) {
+	batch_entries[head].bidirs++;
+	batch_entries[head].writer = n;
+    }
+    return n;
+}
+
+hal_type_t hal_batch_sig_type(const char *name)
+{
+    int n;
+
+    n = batch_find(&batch_sigs, name);
+    if (n < 0) {
+	return HAL_TYPE_UNSPECIFIED;
+    }
+    return batch_entries[n].type;
+}
+
+const char *hal_batch_pin_sig(const char *pin_name)
+{
+    int n;
+
+    n = batch_find(&batch_pins, pin_name);
+    if (n < 0) {
+	return 0;
+    }
+    return batch_entries[n].sig;
+}
+
+const char *hal_batch_sig_writer(const char *sig_name, hal_pin_dir_t * dir)
+{
+    int n;
+
+    n = batch_find(&batch_sigs, sig_name);
+    if ((n < 0) || (batch_entries[n].writer < 0)) {
+	return 0;
+    }
+    n = batch_entries[n].writer;
+    if (dir != 0) {
+	*dir = batch_entries[n].dir;
+    }
+    return batch_entries[n].pin;
+}
+
+void hal_batch_abort(void)
+{
+    batch_free();
+}
+
+int hal_batch_commit(int *failed_entry)
+{
+    int n, bad, retval, num_new, num_linked, *prev, next;
+    hal_batch_entry_t *e;
+    hal_sig_t **new_sigs, *sig;
+    hal_pin_t **linked, *pin;
+    hal_data_u *saved, *saved_sig;
+
+    if (failed_entry != 0) {
+	*failed_entry = -1;
+    }
+    if (hal_data == 0) {
+	rtapi_print_msg(RTAPI_MSG_ERR,
+	    "HAL: ERROR: batch_commit called before init\n");
+	batch_free();
+	return -EINVAL;
+    }
+    if (!batch_active) {
+	rtapi_print_msg(RTAPI_MSG_ERR,
+	    "HAL: ERROR: batch_commit called without batch\n");
+	return -EINVAL;
+    }
+    if (hal_data->lock & HAL_LOCK_CONFIG)  {
+	rtapi_print_msg(RTAPI_MSG_ERR,
+	    "HAL: ERROR: batch_commit called while HAL locked\n");
+	batch_free();
+	return -EPERM;
+    }
+    /* bookkeeping for undo: the new signals, the pins that were
+       linked along with their original (unlinked) values, and the
+       values of their signals before each link */
+    new_sigs = malloc((batch_sig_count + 1) * sizeof(hal_sig_t *));
+    linked = malloc((batch_count + 1) * sizeof(hal_pin_t *));
+    saved = malloc((batch_count + 1) * sizeof(hal_data_u));
+    saved_sig = malloc((batch_count + 1) * sizeof(hal_data_u));
+    if ((new_sigs == 0) || (linked == 0) || (saved == 0) || (saved_sig == 0)) {
+	free(new_sigs);
+	free(linked);
+	free(saved);
+	free(saved_sig);
+	batch_free();
+	rtapi_print_msg(RTAPI_MSG_ERR,
+	    "HAL: ERROR: insufficient memory for batch\n");
+	return -ENOMEM;
+    }
+    num_new = 0;
+    num_linked = 0;
+    retval = 0;
+    rtapi_print_msg(RTAPI_MSG_DBG,
+	"HAL: committing batch of %d entries\n", batch_count);
+    /* get mutex before accessing data structures */
+    rtapi_mutex_get(&(hal_data->mutex));
+    /* create the new signals */
+    for (n = 0; n < batch_count; n++) {
+	e = &batch_entries[n];
+	if (e->type == HAL_TYPE_UNSPECIFIED) {
+	    continue;
+	}
+	if (halpr_find_sig_by_name(e->sig) != 0) {
+	    rtapi_print_msg(RTAPI_MSG_ERR,
+		"HAL: ERROR: duplicate signal '%s'\n", e->sig);
+	    retval = -EINVAL;
+	    break;
+	}
+	retval = new_sig_struct(e->sig, e->type, &sig);
+	if (retval != 0) {
+	    break;
+	}
+	new_sigs[num_new++] = sig;
+    }
+    bad = n;
+    if (retval != 0) {
+	/* none of the new signals are in the list yet */
+	while (num_new > 0) {
+	    free_sig_struct(new_sigs[--num_new]);
+	}
+	goto done;
+    }
+    /* sort the new signals, then merge them into the signal list in
+       a single pass, instead of searching the list for each one */
+    qsort(new_sigs, num_new, sizeof(hal_sig_t *), batch_sig_cmp);
+    prev = &(hal_data->sig_list_ptr);
+    next = *prev;
+    for (n = 0; n < num_new; n++) {
+	while ((next != 0) &&
+	    (strcmp(((hal_sig_t *) SHMPTR(next))->name, new_sigs[n]->name) < 0)) {
+	    prev = &(((hal_sig_t *) SHMPTR(next))->next_ptr);
+	    next = *prev;
+	}
+	new_sigs[n]->next_ptr = next;
+	*prev = SHMOFF(new_sigs[n]);
+	prev = &(new_sigs[n]->next_ptr);
+	name_index_add(HAL_NAME_SIG, new_sigs[n]->name, new_sigs[n]);
+    }
+    /* make the links, in order */
+    for (n = 0; n < batch_count; n++) {
+	e = &batch_entries[n];
+	if (e->type != HAL_TYPE_UNSPECIFIED) {
+	    continue;
+	}
+	pin = halpr_find_pin_by_name(e->pin);
+	if (pin == 0) {
+	    rtapi_print_msg(RTAPI_MSG_ERR,
+		"HAL: ERROR: pin '%s' not found\n", e->pin);
+	    retval = -EINVAL;
+	    break;
+	}
+	sig = halpr_find_sig_by_name(e->sig);
+	if (sig == 0) {
+	    rtapi_print_msg(RTAPI_MSG_ERR,
+		"HAL: ERROR: signal '%s' not found\n", e->sig);
+	    retval = -EINVAL;
+	    break;
+	}
+	if (pin->signal != 0) {
+	    /* already linked, link_pin_struct() won't change anything */
+	    retval = link_pin_struct(pin, sig);
+	} else {
+	    /* the first pin linked to a signal overwrites its value */
+	    saved[num_linked] = pin->dummysig;
+	    batch_copy_value(sig->type, &saved_sig[num_linked],
+		SHMPTR(sig->data_ptr));
+	    retval = link_pin_struct(pin, sig);
+	    if (retval == 0) {
+		linked[num_linked++] = pin;
+	    }
+	}
+	if (retval != 0) {
+	    break;
+	}
+    }
+    bad = n;
+    if (retval != 0) {
+	/* undo the links, newest first, and restore the pin values and
+	   the values of signals that existed before the batch */
+	while (num_linked > 0) {
+	    num_linked--;
+	    pin = linked[num_linked];
+	    sig = SHMPTR(pin->signal);
+	    unlink_pin(pin);
+	    pin->dummysig = saved[num_linked];
+	    batch_copy_value(sig->type, SHMPTR(sig->data_ptr),
+		&saved_sig[num_linked]);
+	}
+	/* take the new signals back out of the list, they are in the
+	   same order there as in 'new_sigs' */
+	prev = &(hal_data->sig_list_ptr);
+	next = *prev;
+	n = 0;
+	while ((next != 0) && (n < num_new)) {
+	    sig = SHMPTR(next);
+	    if (sig == new_sigs[n]) {
+		*prev = sig->next_ptr;
+		n++;
+	    } else {
+		prev = &(sig->next_ptr);
+	    }
+	    next = *prev;
+	}
+	/* and delete them */
+	for (n = 0; n < num_new; n++) {
+	    free_sig_struct(new_sigs[n]);
+	}
+    }
+done:
+    rtapi_mutex_give(&(hal_data->mutex));
+    if ((retval != 0) && (failed_entry != 0)) {
+	*failed_entry = bad;
+    }
+    free(new_sigs);
+    free(linked);
+    free(saved);
+    free(saved_sig);
+    batch_free();
+    return retval;
+}
+#endif /* ULAPI */
+
+/***********************************************************************
+*                       "PARAM" FUNCTIONS                              *
+************************************************************************/
+
+/* wrapper functs for typed params - these call the generic funct below */
+
+int hal_param_bit_new(const char *name, hal_param_dir_t dir, hal_bit_t * data_addr,
+    int comp_id)
+{
+    return hal_param_new(name, HAL_BIT, dir, (void *) data_addr, comp_id);
+}
+
+int hal_param_float_new(const char *name, hal_param_dir_t dir, hal_float_t * data_addr,
+    int comp_id)
+{
+    return hal_param_new(name, HAL_FLOAT, dir, (void *) data_addr, comp_id);
+}
+
+int hal_param_u32_new(const char *name, hal_param_dir_t dir, hal_u32_t * data_addr,
+    int comp_id)
+{
+    return hal_param_new(name, HAL_U32, dir, (void *) data_addr, comp_id);
+}
+
+int hal_param_s32_new(const char *name, hal_param_dir_t dir, hal_s32_t * data_addr,
+    int comp_id)
+{
+    return hal_param_new(name, HAL_S32, dir, (void *) data_addr, comp_id);
+}
+
+static int hal_param_newfv(hal_type_t type, hal_param_dir_t dir,
+	void *data_addr, int comp_id, const char *fmt, va_list ap) {
+    char name[HAL_NAME_LEN + 1];
+    int sz;
+    sz = rtapi_vsnprintf(name, sizeof(name), fmt, ap);
+    if(sz == -1 || sz > HAL_NAME_LEN) {
+        rtapi_print_msg(RTAPI_MSG_ERR,
+	    "hal_param_newfv: length %d too long for name starting '%s'\n",
+	    sz, name);
+	return -ENOMEM;
+    }
+    return hal_param_new(name, type, dir, (void *) data_addr, comp_id);
+}
+
+int hal_param_bit_newf(hal_param_dir_t dir, hal_bit_t * data_addr,
+    int comp_id, const char *fmt, ...)
+{
+    va_list ap;
+    int ret;
+    va_start(ap, fmt);
+    ret = hal_param_newfv(HAL_BIT, dir, (void*)data_addr, comp_id, fmt, ap);
+    va_end(ap);
+    return ret;
+}
+
+int hal_param_float_newf(hal_param_dir_t dir, hal_float_t * data_addr,
+    int comp_id, const char *fmt, ...)
+{
+    va_list ap;
+    int ret;
+    va_start(ap, fmt);
+    ret = hal_param_newfv(HAL_FLOAT, dir, (void*)data_addr, comp_id, fmt, ap);
+    va_end(ap);
+    return ret;
+}
+
+int hal_param_u32_newf(hal_param_dir_t dir, hal_u32_t * data_addr,
+    int comp_id, const char *fmt, ...)
+{
+    va_list ap;
+    int ret;
+    va_start(ap, fmt);
+    ret = hal_param_newfv(HAL_U32, dir, (void*)data_addr, comp_id, fmt, ap);
+    va_end(ap);
+    return ret;
+}
+
+int hal_param_s32_newf(hal_param_dir_t dir, hal_s32_t * data_addr,
+    int comp_id, const char *fmt, ...)
+{
+    va_list ap;
+    int ret;
+    va_start(ap, fmt);
+    ret = hal_param_newfv(HAL_S32, dir, (void*)data_addr, comp_id, fmt, ap);
+    va_end(ap);
+    return ret;
+}
+
+
+/* this is a generic function that does the majority of the work. */
+
+int hal_param_new(const char *name, hal_type_t type, hal_param_dir_t dir, void *data_addr,
+    int comp_id)
+{
+    int *prev, next, cmp;
+    hal_param_t *new, *ptr;
+    hal_comp_t *comp;
+
+    if (hal_data == 0) {
+	rtapi_print_msg(RTAPI_MSG_ERR,
+	    "HAL: ERROR: param_new called before init\n");
+	return -EINVAL;
+    }
+
+    if (type != HAL_BIT && type != HAL_FLOAT && type != HAL_S32 && type != HAL_U32) {
+	rtapi_print_msg(RTAPI_MSG_ERR,
+	    "HAL: ERROR: pin type not one of HAL_BIT, HAL_FLOAT, HAL_S32 or HAL_U32\n");
+	return -EINVAL;
+    }
+
+    if(dir != HAL_RO && dir != HAL_RW) {
 	rtapi_print_msg(RTAPI_MSG_ERR,
 	    "HAL: ERROR: param direction not one of HAL_RO, or HAL_RW\n");
 	return -EINVAL;
@@ -1359,6 +1893,7 @@ int hal_param_new(const char *name, hal_type_t type, hal_param_dir_t dir, void *
 	    /* reached end of list, insert here */
 	    new->next_ptr = next;
 	    *prev = SHMOFF(new);
+	    name_index_add(HAL_NAME_PARAM, new->name, new);
 	    rtapi_mutex_give(&(hal_data->mutex));
 	    return 0;
 	}
@@ -1368,6 +1903,7 @@ int hal_param_new(const char *name, hal_type_t type, hal_param_dir_t dir, void *
 	    /* found the right place for it, insert here */
 	    new->next_ptr = next;
 	    *prev = SHMOFF(new);
+	    name_index_add(HAL_NAME_PARAM, new->name, new);
 	    rtapi_mutex_give(&(hal_data->mutex));
 	    return 0;
 	}
@@ -1560,6 +2096,12 @@ int hal_param_alias(const char *param_name, const char *alias)
 	prev = &(param->next_ptr);
 	next = *prev;
     }
+    /* the name(s) are about to change, take them out of the index */
+    name_index_remove(HAL_NAME_PARAM, param->name, param);
+    if (param->oldname != 0) {
+	oldname = SHMPTR(param->oldname);
+	name_index_remove(HAL_NAME_PARAM, oldname->name, param);
+    }
     if ( alias != NULL ) {
 	/* adding a new alias */
 	if ( param->oldname == 0 ) {
@@ -1580,6 +2122,12 @@ int hal_param_alias(const char *param_name, const char *alias)
 	    free_oldname_struct(oldname);
 	}
     }
+    /* put the new name(s) into the index */
+    name_index_add(HAL_NAME_PARAM, param->name, param);
+    if (param->oldname != 0) {
+	oldname = SHMPTR(param->oldname);
+	name_index_add(HAL_NAME_PARAM, oldname->name, param);
+    }
     /* insert param back into list in proper place */
     prev = &(hal_data->param_list_ptr);
     next = *prev;
@@ -1687,6 +2235,7 @@ int hal_export_funct(const char *name, void (*funct) (void *, long),
 	    /* reached end of list, insert here */
 	    new->next_ptr = next;
 	    *prev = SHMOFF(new);
+	    name_index_add(HAL_NAME_FUNCT, new->name, new);
 	    /* break out of loop and init the new function */
 	    break;
 	}
@@ -1696,6 +2245,7 @@ int hal_export_funct(const char *name, void (*funct) (void *, long),
 	    /* found the right place for it, insert here */
 	    new->next_ptr = next;
 	    *prev = SHMOFF(new);
+	    name_index_add(HAL_NAME_FUNCT, new->name, new);
 	    /* break out of loop and init the new function */
 	    break;
 	}
@@ -1735,6 +2285,13 @@ int hal_export_funct(const char *name, void (*funct) (void *, long),
     new->maxtime_increased = 0;
     hal_param_bit_new(buf, HAL_RO, &(new->maxtime_increased), comp_id);
 
+    /* create parameters with the function's runtime percentiles, these
+       are only updated while the thread's 'stats-enable' is set */
+    rtapi_snprintf(buf, sizeof(buf), "%s.time-p50", name);
+    hal_param_s32_new(buf, HAL_RO, &(new->time_p50), comp_id);
+    rtapi_snprintf(buf, sizeof(buf), "%s.time-p99", name);
+    hal_param_s32_new(buf, HAL_RO, &(new->time_p99), comp_id);
+
     return 0;
 }
 
@@ -1903,6 +2460,20 @@ int hal_create_thread(const char *name, unsigned long period_nsec, int uses_fp)
         return -EINVAL;
     }
     *(new->runtime) = 0;
+
+    /* execution statistics, off by default (see hal_stats_t) */
+    rtapi_snprintf(buf, sizeof(buf), "%s.stats-enable", new->name);
+    hal_param_bit_new(buf, HAL_RW, &(new->stats_enable), new->comp_id);
+    rtapi_snprintf(buf, sizeof(buf), "%s.stats-reset", new->name);
+    hal_param_bit_new(buf, HAL_RW, &(new->stats_reset), new->comp_id);
+    rtapi_snprintf(buf, sizeof(buf), "%s.time-p50", new->name);
+    hal_param_s32_new(buf, HAL_RO, &(new->stats.p50), new->comp_id);
+    rtapi_snprintf(buf, sizeof(buf), "%s.time-p99", new->name);
+    hal_param_s32_new(buf, HAL_RO, &(new->stats.p99), new->comp_id);
+    rtapi_snprintf(buf, sizeof(buf), "%s.latency-max", new->name);
+    hal_param_s32_new(buf, HAL_RO, &(new->latency.max), new->comp_id);
+    rtapi_snprintf(buf, sizeof(buf), "%s.latency-p99", new->name);
+    hal_param_s32_new(buf, HAL_RO, &(new->latency.p99), new->comp_id);
     hal_ready(new->comp_id);
 
     rtapi_print_msg(RTAPI_MSG_DBG, "HAL: thread created\n");
@@ -2084,6 +2655,9 @@ int hal_add_funct_to_thread(const char *funct_name, const char *thread_name, int
     funct_entry->funct_ptr = SHMOFF(funct);
     funct_entry->arg = funct->arg;
     funct_entry->funct = funct->funct;
+    /* each thread keeps its own statistics for the function, the
+       first one to run it also updates the function's params */
+    funct_entry->export_stats = (funct->users == 0);
     /* add the entry to the list */
     list_add_after((hal_list_t *) funct_entry, list_entry);
     /* update the function usage count */
@@ -2182,6 +2756,89 @@ int hal_del_funct_from_thread(const char *funct_name, const char *thread_name)
     }
 }
 
+int hal_set_funct_group(const char *funct_name, const char *thread_name,
+    int group)
+{
+    hal_thread_t *thread;
+    hal_funct_t *funct;
+    hal_list_t *list_root, *list_entry;
+    hal_funct_entry_t *funct_entry;
+
+    if (hal_data == 0) {
+	rtapi_print_msg(RTAPI_MSG_ERR,
+	    "HAL: ERROR: set_funct_group called before init\n");
+	return -EINVAL;
+    }
+
+    if (hal_data->lock & HAL_LOCK_CONFIG) {
+	rtapi_print_msg(RTAPI_MSG_ERR,
+	    "HAL: ERROR: set_funct_group called while HAL is locked\n");
+	return -EPERM;
+    }
+    if ((group < 0) || (group > HAL_MAX_FUNCT_GROUPS)) {
+	rtapi_print_msg(RTAPI_MSG_ERR,
+	    "HAL: ERROR: bad group: %d (must be 0 to %d)\n", group,
+	    HAL_MAX_FUNCT_GROUPS);
+	return -EINVAL;
+    }
+    /* make sure we were given a function and a thread name */
+    if ((funct_name == 0) || (thread_name == 0)) {
+	rtapi_print_msg(RTAPI_MSG_ERR,
+	    "HAL: ERROR: missing function or thread name\n");
+	return -EINVAL;
+    }
+
+    rtapi_print_msg(RTAPI_MSG_DBG,
+	"HAL: putting function '%s' in thread '%s' in group %d\n",
+	funct_name, thread_name, group);
+    /* get mutex before accessing data structures */
+    rtapi_mutex_get(&(hal_data->mutex));
+    /* the thread reads the groups without the mutex */
+    if (hal_data->threads_running > 0) {
+	rtapi_mutex_give(&(hal_data->mutex));
+	rtapi_print_msg(RTAPI_MSG_ERR,
+	    "HAL: ERROR: set_funct_group called while threads are running\n");
+	return -EBUSY;
+    }
+    /* search function list for the function */
+    funct = halpr_find_funct_by_name(funct_name);
+    if (funct == 0) {
+	/* function not found */
+	rtapi_mutex_give(&(hal_data->mutex));
+	rtapi_print_msg(RTAPI_MSG_ERR,
+	    "HAL: ERROR: function '%s' not found\n", funct_name);
+	return -EINVAL;
+    }
+    /* search thread list for thread_name */
+    thread = halpr_find_thread_by_name(thread_name);
+    if (thread == 0) {
+	/* thread not found */
+	rtapi_mutex_give(&(hal_data->mutex));
+	rtapi_print_msg(RTAPI_MSG_ERR,
+	    "HAL: ERROR: thread '%s' not found\n", thread_name);
+	return -EINVAL;
+    }
+    /* set the group of every entry of the thread that calls funct */
+    list_root = &(thread->funct_list);
+    list_entry = list_next(list_root);
+    funct_entry = 0;
+    while (list_entry != list_root) {
+	if (SHMPTR(((hal_funct_entry_t *) list_entry)->funct_ptr) == funct) {
+	    funct_entry = (hal_funct_entry_t *) list_entry;
+	    funct_entry->group = group;
+	}
+	list_entry = list_next(list_entry);
+    }
+    rtapi_mutex_give(&(hal_data->mutex));
+    if (funct_entry == 0) {
+	rtapi_print_msg(RTAPI_MSG_ERR,
+	    "HAL: ERROR: thread '%s' doesn't use %s\n", thread_name,
+	    funct_name);
+	return -EINVAL;
+    }
+    return 0;
+}
+
 int hal_start_threads(void)
 {
     /* a trivial function for a change! */
@@ -2325,6 +2982,10 @@ hal_pin_t *halpr_find_pin_by_name(const char *name)
     hal_pin_t *pin;
     hal_oldname_t *oldname;
 
+    if (hal_data->name_index_size != 0) {
+	/* the index covers both names and aliases */
+	return name_index_find(HAL_NAME_PIN, name);
+    }
     /* search pin list for 'name' */
     next = hal_data->pin_list_ptr;
     while (next != 0) {
@@ -2352,6 +3013,9 @@ hal_sig_t *halpr_find_sig_by_name(const char *name)
     int next;
     hal_sig_t *sig;
 
+    if (hal_data->name_index_size != 0) {
+	return name_index_find(HAL_NAME_SIG, name);
+    }
     /* search signal list for 'name' */
     next = hal_data->sig_list_ptr;
     while (next != 0) {
@@ -2373,6 +3037,10 @@ hal_param_t *halpr_find_param_by_name(const char *name)
     hal_param_t *param;
     hal_oldname_t *oldname;
 
+    if (hal_data->name_index_size != 0) {
+	/* the index covers both names and aliases */
+	return name_index_find(HAL_NAME_PARAM, name);
+    }
     /* search parameter list for 'name' */
     next = hal_data->param_list_ptr;
     while (next != 0) {
@@ -2420,6 +3088,9 @@ hal_funct_t *halpr_find_funct_by_name(const char *name)
     int next;
     hal_funct_t *funct;
 
+    if (hal_data->name_index_size != 0) {
+	return name_index_find(HAL_NAME_FUNCT, name);
+    }
     /* search function list for 'name' */
     next = hal_data->funct_list_ptr;
     while (next != 0) {
@@ -2562,11 +3233,50 @@ hal_pin_t *halpr_find_pin_by_sig(hal_sig_t * sig, hal_pin_t * start)
 	    /* found a match */
 	    return pin;
 	}
-	/* didn't find it yet, look at next one */
-	next = pin->next_ptr;
+	/* didn't find it yet, look at next one */
+	next = pin->next_ptr;
+    }
+    /* if loop terminates, we reached end of list without finding a match */
+    return 0;
+}
+
+long halpr_stats_percentile(hal_stats_t * stats, int permille)
+{
+    rtapi_u32 count, rest, need, sum;
+    long edge;
+    int n;
+
+    count = stats->count;
+    if (count == 0) {
+	return 0;
+    }
+    if (permille > 1000) {
+	permille = 1000;
+    }
+    /* number of samples above the percentile, without needing 64 bit
+       math (this also runs in kernel space) */
+    rest = (count / 1000) * (1000 - permille) +
+	((count % 1000) * (1000 - permille)) / 1000;
+    need = count - rest;
+    if (need == 0) {
+	need = 1;
+    }
+    sum = 0;
+    for (n = 0; n < HAL_STATS_BUCKETS - 1; n++) {
+	sum += stats->bucket[n];
+	if (sum >= need) {
+	    break;
+	}
     }
-    /* if loop terminates, we reached end of list without finding a match */
-    return 0;
+    if (n == 0) {
+	return 0;
+    }
+    /* upper edge of bucket 'n' */
+    edge = (long) ((1UL << n) - 1);
+    if (edge < stats->max) {
+	return edge;
+    }
+    return stats->max;
 }
 
 /***********************************************************************
@@ -2706,13 +3416,25 @@ void rtapi_app_exit(void)
 static void thread_task(void *arg)
 {
     hal_thread_t *thread;
-    hal_funct_t *funct;
     hal_funct_entry_t *funct_root, *funct_entry;
     long long int start_time, end_time;
     long long int thread_start_time;
+    int stats;
 
     thread = arg;
     while (1) {
+	stats = thread->stats_enable;
+	if (stats && thread->stats_reset) {
+	    stats_clear(&(thread->stats));
+	    stats_clear(&(thread->latency));
+	    funct_root = (hal_funct_entry_t *) & (thread->funct_list);
+	    funct_entry = SHMPTR(funct_root->links.next);
+	    while (funct_entry != funct_root) {
+		stats_clear(&(funct_entry->stats));
+		funct_entry = SHMPTR(funct_entry->links.next);
+	    }
+	    thread->stats_reset = 0;
+	}
 	if (hal_data->threads_running > 0) {
 	    /* point at first function on function list */
 	    funct_root = (hal_funct_entry_t *) & (thread->funct_list);
@@ -2723,20 +3445,19 @@ static void thread_task(void *arg)
 	    thread_start_time = start_time;
 	    /* run thru function list */
 	    while (funct_entry != funct_root) {
+		if (funct_entry->group != 0) {
+		    /* run the groups side by side, then carry on */
+		    funct_entry = run_funct_section(thread, funct_entry, stats);
+		    end_time = rtapi_get_clocks();
+		    start_time = end_time;
+		    continue;
+		}
 		/* call the function */
 		funct_entry->funct(funct_entry->arg, thread->period);
 		/* capture execution time */
 		end_time = rtapi_get_clocks();
-		/* point to function structure */
-		funct = SHMPTR(funct_entry->funct_ptr);
 		/* update execution time data */
-		*(funct->runtime) = (hal_s32_t)(end_time - start_time);
-		if ( *(funct->runtime) > funct->maxtime) {
-		    funct->maxtime = *(funct->runtime);
-		    funct->maxtime_increased = 1;
-		} else {
-		    funct->maxtime_increased = 0;
-		}
+		funct_ran(funct_entry, end_time - start_time, stats);
 		/* point to next next entry in list */
 		funct_entry = SHMPTR(funct_entry->links.next);
 		/* prepare to measure time for next funct */
@@ -2747,19 +3468,157 @@ static void thread_task(void *arg)
 	    if ( *(thread->runtime) > thread->maxtime) {
 	        thread->maxtime = *(thread->runtime);
 	    }
+	    if (stats) {
+		stats_add(&(thread->stats), end_time - thread_start_time);
+	    }
 	}
 	/* wait until next period */
 	rtapi_wait();
+	if (thread->stats_enable) {
+	    /* measured from the deadline the wait was for, so a late
+	       period doesn't shift the reference for the ones after it */
+	    stats_add(&(thread->latency),
+		rtapi_get_time() - rtapi_task_deadline());
+	}
+    }
+}
+
+/* a parallel section, as passed to the groups that run it */
+typedef struct {
+    hal_thread_t *thread;
+    hal_funct_entry_t *first, *end;
+    int stats;
+    int group[HAL_MAX_FUNCT_GROUPS];	/* group run by each call */
+} funct_section_t;
+
+static hal_funct_entry_t *run_funct_section(hal_thread_t * thread,
+    hal_funct_entry_t * first, int stats)
+{
+    funct_section_t section;
+    hal_funct_entry_t *funct_root, *funct_entry;
+    unsigned int groups;
+    int n, count;
+
+    /* find the end of the section, and the groups used in it */
+    funct_root = (hal_funct_entry_t *) & (thread->funct_list);
+    funct_entry = first;
+    groups = 0;
+    while ((funct_entry != funct_root) && (funct_entry->group != 0)) {
+	groups |= 1 << (funct_entry->group - 1);
+	funct_entry = SHMPTR(funct_entry->links.next);
+    }
+    section.thread = thread;
+    section.first = first;
+    section.end = funct_entry;
+    section.stats = stats;
+    count = 0;
+    for (n = 0; n < HAL_MAX_FUNCT_GROUPS; n++) {
+	if (groups & (1 << n)) {
+	    section.group[count++] = n + 1;
+	}
+    }
+    rtapi_task_parallel(run_funct_group, &section, count);
+    return section.end;
+}
+
+static void run_funct_group(void *arg, int n)
+{
+    funct_section_t *section;
+    hal_funct_entry_t *funct_entry;
+    long long int start_time, end_time;
+    int group;
+
+    section = arg;
+    group = section->group[n];
+    start_time = rtapi_get_clocks();
+    for (funct_entry = section->first; funct_entry != section->end;
+	funct_entry = SHMPTR(funct_entry->links.next)) {
+	if (funct_entry->group != group) {
+	    continue;
+	}
+	funct_entry->funct(funct_entry->arg, section->thread->period);
+	end_time = rtapi_get_clocks();
+	funct_ran(funct_entry, end_time - start_time, section->stats);
+	start_time = end_time;
+    }
+}
+
+static void funct_ran(hal_funct_entry_t * funct_entry,
+    long long int runtime, int stats)
+{
+    hal_funct_t *funct;
+
+    funct = SHMPTR(funct_entry->funct_ptr);
+    *(funct->runtime) = (hal_s32_t) runtime;
+    if ( *(funct->runtime) > funct->maxtime) {
+	funct->maxtime = *(funct->runtime);
+	funct->maxtime_increased = 1;
+    } else {
+	funct->maxtime_increased = 0;
+    }
+    if (stats) {
+	stats_add(&(funct_entry->stats), runtime);
+	if (funct_entry->export_stats) {
+	    funct->time_p50 = funct_entry->stats.p50;
+	    funct->time_p99 = funct_entry->stats.p99;
+	}
+    }
+}
+
+static void stats_add(hal_stats_t * stats, long long int sample)
+{
+    rtapi_u32 v;
+    int n;
+
+    if (sample > 0x7fffffff) {
+	sample = 0x7fffffff;
+    }
+    /* find the bucket: the number of significant bits in the sample */
+    n = 0;
+    if (sample > 0) {
+	v = sample;
+	while (v != 0) {
+	    v >>= 1;
+	    n++;
+	}
+    }
+    stats->bucket[n]++;
+    if (stats->count == 0 || sample > stats->max) {
+	stats->max = sample;
+    }
+    stats->count++;
+    /* refresh the percentile params every 256 samples, and right at
+       the start so they don't stay zero for the first few seconds of
+       a slow thread */
+    if ((stats->count & 0xff) == 0 || stats->count < 16) {
+	stats->p50 = halpr_stats_percentile(stats, 500);
+	stats->p99 = halpr_stats_percentile(stats, 990);
     }
 }
+
 #endif /* RTAPI */
 
+static void stats_clear(hal_stats_t * stats)
+{
+    int n;
+
+    stats->count = 0;
+    stats->max = 0;
+    for (n = 0; n < HAL_STATS_BUCKETS; n++) {
+	stats->bucket[n] = 0;
+    }
+    stats->p50 = 0;
+    stats->p99 = 0;
+}
+
 /* see the declarations of these functions (near top of file) for
    a description of what they do.
 */
 
 static int init_hal_data(void)
 {
+    void *p;
+
     /* has the block already been initialized? */
     if (hal_data->version != 0) {
 	/* yes, verify version code */
@@ -2799,6 +3658,17 @@ static int init_hal_data(void)
     hal_data->shmem_bot = sizeof(hal_data_t);
     hal_data->shmem_top = HAL_SIZE;
     hal_data->lock = HAL_LOCK_NONE;
+    /* allocate the name index */
+    hal_data->name_index_size = 0;
+    hal_data->name_index_used = 0;
+    hal_data->name_index_ptr = 0;
+    hal_data->name_generation = 0;
+    p = shmalloc_dn(HAL_NAME_INDEX_MIN * sizeof(hal_name_slot_t));
+    if (p != 0) {
+	memset(p, 0, HAL_NAME_INDEX_MIN * sizeof(hal_name_slot_t));
+	hal_data->name_index_ptr = SHMOFF(p);
+	hal_data->name_index_size = HAL_NAME_INDEX_MIN;
+    }
     /* done, release mutex */
     rtapi_mutex_give(&(hal_data->mutex));
     return 0;
@@ -2914,11 +3784,74 @@ static hal_pin_t *alloc_pin_struct(void)
 	p->dir = 0;
 	p->signal = 0;
 	memset(&p->dummysig, 0, sizeof(hal_data_u));
+	p->oldname = 0;
 	p->name[0] = '\0';
     }
     return p;
 }
 
+static int new_sig_struct(const char *name, hal_type_t type,
+    hal_sig_t ** new)
+{
+    hal_sig_t *sig;
+    void *data_addr;
+
+    /* allocate memory for the signal value */
+    switch (type) {
+    case HAL_BIT:
+	data_addr = shmalloc_up(sizeof(hal_bit_t));
+	break;
+    case HAL_S32:
+	data_addr = shmalloc_up(sizeof(hal_s32_t));
+	break;
+    case HAL_U32:
+	data_addr = shmalloc_up(sizeof(hal_u32_t));
+	break;
+    case HAL_FLOAT:
+	data_addr = shmalloc_up(sizeof(hal_float_t));
+	break;
+    default:
+	rtapi_print_msg(RTAPI_MSG_ERR,
+	    "HAL: ERROR: illegal signal type %d'\n", type);
+	return -EINVAL;
+	break;
+    }
+    /* allocate a new signal structure */
+    sig = alloc_sig_struct();
+    if ((sig == 0) || (data_addr == 0)) {
+	/* alloc failed */
+	rtapi_print_msg(RTAPI_MSG_ERR,
+	    "HAL: ERROR: insufficient memory for signal '%s'\n", name);
+	return -ENOMEM;
+    }
+    /* initialize the signal value */
+    switch (type) {
+    case HAL_BIT:
+	*((hal_bit_t *) data_addr) = 0;
+	break;
+    case HAL_S32:
+	*((hal_s32_t *) data_addr) = 0;
+        break;
+    case HAL_U32:
+	*((hal_u32_t *) data_addr) = 0;
+        break;
+    case HAL_FLOAT:
+	*((hal_float_t *) data_addr) = 0.0;
+	break;
+    default:
+	break;
+    }
+    /* initialize the structure */
+    sig->data_ptr = SHMOFF(data_addr);
+    sig->type = type;
+    sig->readers = 0;
+    sig->writers = 0;
+    sig->bidirs = 0;
+    rtapi_snprintf(sig->name, sizeof(sig->name), "%s", name);
+    *new = sig;
+    return 0;
+}
+
 static hal_sig_t *alloc_sig_struct(void)
 {
     hal_sig_t *p;
@@ -2967,6 +3900,7 @@ static hal_param_t *alloc_param_struct(void)
 	p->next_ptr = 0;
 	p->data_ptr = 0;
 	p->owner_ptr = 0;
+	p->oldname = 0;
 	p->type = 0;
 	p->name[0] = '\0';
     }
@@ -3021,6 +3955,8 @@ static hal_funct_t *alloc_funct_struct(void)
 	p->users = 0;
 	p->arg = 0;
 	p->funct = 0;
+	p->time_p50 = 0;
+	p->time_p99 = 0;
 	p->name[0] = '\0';
     }
     return p;
@@ -3050,6 +3986,9 @@ static hal_funct_entry_t *alloc_funct_entry_struct(void)
 	p->funct_ptr = 0;
 	p->arg = 0;
 	p->funct = 0;
+	p->group = 0;
+	p->export_stats = 0;
+	stats_clear(&(p->stats));
     }
     return p;
 }
@@ -3077,6 +4016,10 @@ static hal_thread_t *alloc_thread_struct(void)
 	p->period = 0;
 	p->priority = 0;
 	p->task_id = 0;
+	p->stats_enable = 0;
+	p->stats_reset = 0;
+	stats_clear(&(p->stats));
+	stats_clear(&(p->latency));
 	list_init_entry(&(p->funct_list));
 	p->name[0] = '\0';
     }
@@ -3157,6 +4100,95 @@ static void free_comp_struct(hal_comp_t * comp)
     hal_data->comp_free_ptr = SHMOFF(comp);
 }
 
+static int link_pin_struct(hal_pin_t * pin, hal_sig_t * sig)
+{
+    hal_comp_t *comp;
+    void **data_ptr_addr, *data_addr;
+
+    /* are they already connected? */
+    if (SHMPTR(pin->signal) == sig) {
+	rtapi_print_msg(RTAPI_MSG_WARN,
+	    "HAL: Warning: pin '%s' already linked to '%s'\n", pin->name, sig->name);
+	return 0;
+    }
+    /* is the pin connected to something else? */
+    if(pin->signal) {
+	rtapi_print_msg(RTAPI_MSG_ERR,
+	    "HAL: ERROR: pin '%s' is linked to '%s', cannot link to '%s'\n",
+	    pin->name, ((hal_sig_t *) SHMPTR(pin->signal))->name, sig->name);
+	return -EINVAL;
+    }
+    /* check types */
+    if (pin->type != sig->type) {
+	rtapi_print_msg(RTAPI_MSG_ERR,
+	    "HAL: ERROR: type mismatch '%s' <- '%s'\n", pin->name, sig->name);
+	return -EINVAL;
+    }
+    /* linking output pin to sig that already has output or I/O pins? */
+    if ((pin->dir == HAL_OUT) && ((sig->writers > 0) || (sig->bidirs > 0 ))) {
+	/* yes, can't do that */
+	rtapi_print_msg(RTAPI_MSG_ERR,
+	    "HAL: ERROR: signal '%s' already has output or I/O pin(s)\n", sig->name);
+	return -EINVAL;
+    }
+    /* linking bidir pin to sig that already has output pin? */
+    if ((pin->dir == HAL_IO) && (sig->writers > 0)) {
+	/* yes, can't do that */
+	rtapi_print_msg(RTAPI_MSG_ERR,
+	    "HAL: ERROR: signal '%s' already has output pin\n", sig->name);
+	return -EINVAL;
+    }
+    /* everything is OK, make the new link */
+    data_ptr_addr = SHMPTR(pin->data_ptr_addr);
+    comp = SHMPTR(pin->owner_ptr);
+    data_addr = comp->shmem_base + sig->data_ptr;
+    *data_ptr_addr = data_addr;
+    if (( sig->readers == 0 ) && ( sig->writers == 0 ) && ( sig->bidirs == 0 )) {
+	/* this is the first pin for this signal, copy value from pin's "dummy" field */
+	data_addr = hal_shmem_base + sig->data_ptr;
+
+        // assure proper typing on assignment, assigning a hal_data_u is
+        // a surefire cause for memory corrupion as hal_data_u is larger
+        // than hal_bit_t, hal_s32_t, and hal_u32_t - this works only for 
+        // hal_float_t (!)
+        // my old, buggy code:
+        //*((hal_data_u *)data_addr) = pin->dummysig;
+
+        switch (pin->type) {
+        case HAL_BIT:
+            *((hal_bit_t *) data_addr) = pin->dummysig.b;
+            break;
+        case HAL_S32:
+            *((hal_s32_t *) data_addr) = pin->dummysig.s;
+            break;
+        case HAL_U32:
+            *((hal_u32_t *) data_addr) = pin->dummysig.u;
+            break;
+        case HAL_FLOAT:
+            *((hal_float_t *) data_addr) = pin->dummysig.f;
+            break;
+        default:
+            rtapi_print_msg(RTAPI_MSG_ERR,
+                          "HAL: BUG: pin '%s' has invalid type %d !!\n",
+                          pin->name, pin->type);
+            return -EINVAL;
+        }
+    }
+    /* update the signal's reader/writer/bidir counts */
+    if ((pin->dir & HAL_IN) != 0) {
+	sig->readers++;
+    }
+    if (pin->dir == HAL_OUT) {
+	sig->writers++;
+    }
+    if (pin->dir == HAL_IO) {
+	sig->bidirs++;
+    }
+    /* and update the pin */
+    pin->signal = SHMOFF(sig);
+    return 0;
+}
+
 static void unlink_pin(hal_pin_t * pin)
 {
     hal_sig_t *sig;
@@ -3216,8 +4248,15 @@ static void free_pin_struct(hal_pin_t * pin)
 {
 
     unlink_pin(pin);
+    /* remove name(s) from index */
+    name_index_remove(HAL_NAME_PIN, pin->name, pin);
+    if ( pin->oldname != 0 ) {
+	name_index_remove(HAL_NAME_PIN,
+	    ((hal_oldname_t *) SHMPTR(pin->oldname))->name, pin);
+    }
     /* clear contents of struct */
     if ( pin->oldname != 0 ) free_oldname_struct(SHMPTR(pin->oldname));
+    pin->oldname = 0;
     pin->data_ptr_addr = 0;
     pin->owner_ptr = 0;
     pin->type = 0;
@@ -3242,6 +4281,8 @@ static void free_sig_struct(hal_sig_t * sig)
 	/* check for another pin linked to the signal */
 	pin = halpr_find_pin_by_sig(sig, pin);
     }
+    /* remove name from index */
+    name_index_remove(HAL_NAME_SIG, sig->name, sig);
     /* clear contents of struct */
     sig->data_ptr = 0;
     sig->type = 0;
@@ -3256,8 +4297,15 @@ static void free_sig_struct(hal_sig_t * sig)
 
 static void free_param_struct(hal_param_t * p)
 {
+    /* remove name(s) from index */
+    name_index_remove(HAL_NAME_PARAM, p->name, p);
+    if ( p->oldname != 0 ) {
+	name_index_remove(HAL_NAME_PARAM,
+	    ((hal_oldname_t *) SHMPTR(p->oldname))->name, p);
+    }
     /* clear contents of struct */
     if ( p->oldname != 0 ) free_oldname_struct(SHMPTR(p->oldname));
+    p->oldname = 0;
     p->data_ptr = 0;
     p->owner_ptr = 0;
     p->type = 0;
@@ -3318,6 +4366,8 @@ static void free_funct_struct(hal_funct_t * funct)
 	    next_thread = thread->next_ptr;
 	}
     }
+    /* remove name from index */
+    name_index_remove(HAL_NAME_FUNCT, funct->name, funct);
     /* clear contents of struct */
     funct->uses_fp = 0;
     funct->owner_ptr = 0;
@@ -3333,6 +4383,32 @@ static void free_funct_struct(hal_funct_t * funct)
 }
 #endif /* RTAPI */
 
+/* sets 'export_stats' on an entry other than 'skip' that runs 'funct' */
+static void pass_funct_stats(hal_funct_t * funct, hal_funct_entry_t * skip)
+{
+    int next_thread;
+    hal_thread_t *thread;
+    hal_list_t *list_root, *list_entry;
+    hal_funct_entry_t *funct_entry;
+
+    next_thread = hal_data->thread_list_ptr;
+    while (next_thread != 0) {
+	thread = SHMPTR(next_thread);
+	list_root = &(thread->funct_list);
+	list_entry = list_next(list_root);
+	while (list_entry != list_root) {
+	    funct_entry = (hal_funct_entry_t *) list_entry;
+	    if ((funct_entry != skip) &&
+		(SHMPTR(funct_entry->funct_ptr) == funct)) {
+		funct_entry->export_stats = 1;
+		return;
+	    }
+	    list_entry = list_next(list_entry);
+	}
+	next_thread = thread->next_ptr;
+    }
+}
+
 static void free_funct_entry_struct(hal_funct_entry_t * funct_entry)
 {
     hal_funct_t *funct;
@@ -3341,8 +4417,14 @@ static void free_funct_entry_struct(hal_funct_entry_t * funct_entry)
 	/* entry points to a function, update the function struct */
 	funct = SHMPTR(funct_entry->funct_ptr);
 	funct->users--;
+	if (funct_entry->export_stats && (funct->users > 0)) {
+	    /* another thread that runs it takes over the params */
+	    funct_entry->export_stats = 0;
+	    pass_funct_stats(funct, funct_entry);
+	}
     }
     /* clear contents of struct */
+    funct_entry->export_stats = 0;
     funct_entry->funct_ptr = 0;
     funct_entry->arg = 0;
     funct_entry->funct = 0;
@@ -3420,6 +4502,149 @@ static void free_thread_struct(hal_thread_t * thread)
 #endif /* RTAPI */
 
 
+/* FNV-1a hash of 'name', used to pick the first slot to probe */
+static unsigned int name_index_hash(const char *name)
+{
+    unsigned int hash = 2166136261U;
+
+    while (*name != '\0') {
+	hash ^= (unsigned char) *name++;
+	hash *= 16777619U;
+    }
+    return hash;
+}
+
+/* doubles the size of the name index, returns 0 on success */
+static int name_index_grow(void)
+{
+    hal_name_slot_t *old, *new;
+    int n, i, old_size, new_size;
+
+    old = SHMPTR(hal_data->name_index_ptr);
+    old_size = hal_data->name_index_size;
+    new_size = old_size * 2;
+    /* the old table is not reclaimed, but since the size doubles each
+       time, the waste never exceeds the size of the current table */
+    new = shmalloc_dn(new_size * sizeof(hal_name_slot_t));
+    if (new == 0) {
+	return -ENOMEM;
+    }
+    memset(new, 0, new_size * sizeof(hal_name_slot_t));
+    /* re-insert all entries */
+    for (n = 0; n < old_size; n++) {
+	if (old[n].name_ptr == 0) {
+	    continue;
+	}
+	i = name_index_hash(SHMPTR(old[n].name_ptr)) & (new_size - 1);
+	while (new[i].name_ptr != 0) {
+	    i = (i + 1) & (new_size - 1);
+	}
+	new[i] = old[n];
+    }
+    hal_data->name_index_ptr = SHMOFF(new);
+    hal_data->name_index_size = new_size;
+    return 0;
+}
+
+static void name_index_add(int kind, const char *name, void *obj)
+{
+    hal_name_slot_t *table;
+    int i, mask;
+
+    if (hal_data->name_index_size == 0) {
+	return;
+    }
+    /* keep the load factor at or below 3/4 */
+    if ((hal_data->name_index_used + 1) * 4 > hal_data->name_index_size * 3) {
+	if (name_index_grow() != 0) {
+	    /* out of shmem, switch to list searches from now on */
+	    rtapi_print_msg(RTAPI_MSG_WARN,
+		"HAL: Warning: insufficient memory for name index, disabled\n");
+	    hal_data->name_index_size = 0;
+	    return;
+	}
+    }
+    table = SHMPTR(hal_data->name_index_ptr);
+    mask = hal_data->name_index_size - 1;
+    i = name_index_hash(name) & mask;
+    while (table[i].name_ptr != 0) {
+	i = (i + 1) & mask;
+    }
+    table[i].name_ptr = SHMOFF(name);
+    table[i].obj_ptr = SHMOFF(obj) | kind;
+    hal_data->name_index_used++;
+}
+
+static void name_index_remove(int kind, const char *name, void *obj)
+{
+    hal_name_slot_t *table;
+    int i, j, k, mask, obj_ptr;
+
+    /* tell users that keep looked up objects (the interpreter's
+       #<_hal[...]> cache) that they may be gone or renamed */
+    hal_data->name_generation++;
+    if (hal_data->name_index_size == 0) {
+	return;
+    }
+    table = SHMPTR(hal_data->name_index_ptr);
+    mask = hal_data->name_index_size - 1;
+    obj_ptr = SHMOFF(obj) | kind;
+    /* find the slot that refers to 'obj' - there may be another
+       object with the same name, if 'obj' is a rejected duplicate */
+    i = name_index_hash(name) & mask;
+    while (1) {
+	if (table[i].name_ptr == 0) {
+	    /* not in the index */
+	    return;
+	}
+	if ((table[i].obj_ptr == obj_ptr)
+	    && (strcmp(SHMPTR(table[i].name_ptr), name) == 0)) {
+	    break;
+	}
+	i = (i + 1) & mask;
+    }
+    /* empty the slot, then move later entries of the same probe run
+       back so that no search stops short at the hole */
+    table[i].name_ptr = 0;
+    hal_data->name_index_used--;
+    j = i;
+    while (1) {
+	j = (j + 1) & mask;
+	if (table[j].name_ptr == 0) {
+	    return;
+	}
+	/* 'k' is the slot where the entry at 'j' would like to be */
+	k = name_index_hash(SHMPTR(table[j].name_ptr)) & mask;
+	/* leave it alone if 'k' lies cyclically in (i, j] */
+	if ((i <= j) ? ((i < k) && (k <= j)) : ((i < k) || (k <= j))) {
+	    continue;
+	}
+	table[i] = table[j];
+	table[j].name_ptr = 0;
+	i = j;
+    }
+}
+
+static void *name_index_find(int kind, const char *name)
+{
+    hal_name_slot_t *table;
+    int i, mask;
+
+    table = SHMPTR(hal_data->name_index_ptr);
+    mask = hal_data->name_index_size - 1;
+    i = name_index_hash(name) & mask;
+    while (table[i].name_ptr != 0) {
+	if (((table[i].obj_ptr & 3) == kind)
+	    && (strcmp(SHMPTR(table[i].name_ptr), name) == 0)) {
+	    /* found a match */
+	    return SHMPTR(table[i].obj_ptr & ~3);
+	}
+	i = (i + 1) & mask;
+    }
+    /* hit an empty slot, no match */
+    return 0;
+}
+
 #ifdef RTAPI
 /* only export symbols when we're building a kernel module */
 
@@ -3471,6 +4696,7 @@ EXPORT_SYMBOL(hal_create_thread);
 
 EXPORT_SYMBOL(hal_add_funct_to_thread);
 EXPORT_SYMBOL(hal_del_funct_from_thread);
+EXPORT_SYMBOL(hal_set_funct_group);
 
 EXPORT_SYMBOL(hal_start_threads);
 EXPORT_SYMBOL(hal_stop_threads);
@@ -3489,5 +4715,6 @@ EXPORT_SYMBOL(halpr_find_param_by_owner);
 EXPORT_SYMBOL(halpr_find_funct_by_owner);
 
 EXPORT_SYMBOL(halpr_find_pin_by_sig);
+EXPORT_SYMBOL(halpr_stats_percentile);
 
 #endif /* rtapi */
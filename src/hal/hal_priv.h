@@ -153,6 +153,29 @@ typedef struct {
     char name[HAL_NAME_LEN + 1];	/* the original name */
 } hal_oldname_t;
 
+/** HAL "name index" data structure.
+    Walking the sorted lists to find an object by name gets slow once
+    a machine has thousands of pins and parameters, so the names of
+    pins, signals, parameters and functions (including the original
+    name of an aliased pin or param) are also kept in an open addressed
+    hash table.  The table is allocated from shared memory and grows
+    as needed.  Like everything else it uses offsets, not pointers.
+    Objects are always 8 byte aligned, so the low two bits of 'obj_ptr'
+    hold the object type (one of the HAL_NAME_xxx values below), which
+    allows a pin and a signal to share a name.
+*/
+typedef struct {
+    int name_ptr;		/* offset of name string, 0 if slot is empty */
+    int obj_ptr;		/* offset of object that owns the name, | type */
+} hal_name_slot_t;
+
+#define HAL_NAME_PIN    0
+#define HAL_NAME_SIG    1
+#define HAL_NAME_PARAM  2
+#define HAL_NAME_FUNCT  3
+
+#define HAL_NAME_INDEX_MIN 512	/* initial number of slots, power of 2 */
+
 /* Master HAL data structure
    There is a single instance of this structure in the machine.
    It resides at the base of the HAL shared memory block, where it
@@ -192,6 +215,10 @@ typedef struct {
     int exact_base_period;      /* if set, pretend that rtapi satisfied our
 				   period request exactly */
     unsigned char lock;         /* hal locking, can be one of the HAL_LOCK_* types */
+    int name_index_ptr;		/* hash table of object names */
+    int name_index_size;	/* number of slots, 0 if index is disabled */
+    int name_index_used;	/* number of slots in use */
+    unsigned long name_generation;	/* changes whenever a name goes away */
 } hal_data_t;
 
 /** HAL 'component' data structure.
@@ -266,9 +293,34 @@ typedef struct {
     of the HAL API.  There are two linked lists, one of functions,
     sorted by name, and one of threads, sorted by execution freqency.
     Each thread has a linked list of 'function entries', structs
-    that identify the functions connected to that thread.
+    that identify the functions connected to that thread.  A run of
+    consecutive entries with non-zero 'group' is a parallel section,
+    see hal_set_funct_group().
 */
 
+/** Execution statistics.  While a thread's 'stats-enable' parameter
+    is set, the thread records its own run time, its wakeup latency
+    (actual start minus the deadline it waited for, in nsec) and the
+    run time of each of its function entries in histograms with
+    log-spaced buckets: bucket 0
+    counts samples of zero or less, bucket n counts samples from
+    2^(n-1) to 2^n - 1.  The realtime thread is the only writer, and
+    readers just read the counts without locking, so a reader may see
+    a histogram that is a sample or so out of date.  A function that
+    is in more than one thread has separate statistics in each.  The
+    thread also copies a few percentiles into 'p50' and 'p99' now and
+    then, for the parameters that export them.
+*/
+#define HAL_STATS_BUCKETS 32
+
+typedef struct {
+    hal_u32_t count;		/* number of samples */
+    hal_s32_t max;		/* largest sample */
+    hal_u32_t bucket[HAL_STATS_BUCKETS];	/* histogram */
+    hal_s32_t p50;		/* (param) median, updated periodically */
+    hal_s32_t p99;		/* (param) 99th percentile, ditto */
+} hal_stats_t;
+
 typedef struct {
     int next_ptr;		/* next function in linked list */
     int uses_fp;		/* floating point flag */
@@ -280,6 +332,8 @@ typedef struct {
     hal_s32_t* runtime;	/* (pin) duration of last run, in nsec */
     hal_s32_t maxtime;	/* (param) duration of longest run, in nsec */
     hal_bit_t maxtime_increased;	/* on last call, maxtime increased */
+    hal_s32_t time_p50;		/* (param) median run time, in one thread */
+    hal_s32_t time_p99;		/* (param) 99th percentile, ditto */
     char name[HAL_NAME_LEN + 1];	/* function name */
 } hal_funct_t;
 
@@ -288,6 +342,10 @@ typedef struct {
     void *arg;			/* argument for function */
     void (*funct) (void *, long);	/* ptr to function code */
     int funct_ptr;		/* pointer to function */
+    int group;			/* parallel group, or 0 for none */
+    int export_stats;		/* set on one entry per funct, which copies
+				   its percentiles to the funct's params */
+    hal_stats_t stats;		/* run time statistics in this thread */
 } hal_funct_entry_t;
 
 #define HAL_STACKSIZE 16384	/* realtime task stacksize */
@@ -300,6 +358,10 @@ typedef struct {
     int task_id;		/* ID of the task that runs this thread */
     hal_s32_t* runtime;	/* (pin) duration of last run, in nsec */
     hal_s32_t maxtime;	/* (param) duration of longest run, in nsec */
+    hal_bit_t stats_enable;	/* (param) collect execution statistics */
+    hal_bit_t stats_reset;	/* (param) clear statistics, self resetting */
+    hal_stats_t stats;		/* run time statistics */
+    hal_stats_t latency;	/* wakeup latency statistics */
     hal_list_t funct_list;	/* list of functions to run */
     char name[HAL_NAME_LEN + 1];	/* thread name */
     int comp_id;
@@ -328,8 +390,8 @@ typedef struct {
 */
 
 #define HAL_KEY   0x48414C32	/* key used to open HAL shared memory */
-#define HAL_VER   0x0000000D	/* version code */
-#define HAL_SIZE  (75*4096)
+#define HAL_VER   0x00000012	/* version code */
+#define HAL_SIZE  (96*4096)
 #define HAL_PSEUDO_COMP_PREFIX "__" /* prefix to identify a pseudo component */
 
 /* These pointers are set by hal_init() to point to the shmem block
@@ -386,7 +448,9 @@ hal_list_t *list_remove_entry(hal_list_t * entry);
 
 /** The 'find_xxx_by_name()' functions search the appropriate list for
     an object that matches 'name'.  They return a pointer to the object,
-    or NULL if no matching object is found.
+    or NULL if no matching object is found.  Pins, signals, parameters
+    and functions are found through the name index instead of a list
+    walk, unless the index had to be disabled for lack of memory.
 */
 extern hal_comp_t *halpr_find_comp_by_name(const char *name);
 extern hal_pin_t *halpr_find_pin_by_name(const char *name);
@@ -426,5 +490,13 @@ extern hal_funct_t *halpr_find_funct_by_owner(hal_comp_t * owner,
 */
 extern hal_pin_t *halpr_find_pin_by_sig(hal_sig_t * sig, hal_pin_t * start);
 
+/** 'stats_percentile()' estimates the value below which 'permille'
+    thousandths of the samples in 'stats' fall.  The estimate is the
+    upper edge of the histogram bucket that contains that point, but
+    never more than the largest sample.  It returns 0 if there are no
+    samples.
+*/
+extern long halpr_stats_percentile(hal_stats_t * stats, int permille);
+
 RTAPI_END_DECLS
 #endif /* HAL_PRIV_H */
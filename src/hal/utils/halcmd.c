@@ -85,6 +85,7 @@ int hal_flag = 0;	/* used to indicate that halcmd might have the
 			   exit, instead it must set 'done' */
 int halcmd_done = 0;		/* used to break out of processing loop */
 int scriptmode = 0;	/* used to make output "script friendly" (suppress headers) */
+int batchmode = 0;	/* queue netlist commands and apply them together */
 int echo_mode = 0;
 char comp_name[HAL_NAME_LEN+1];	/* name for this instance of halcmd */
 
@@ -139,26 +140,27 @@ struct halcmd_command halcmd_commands[] = {
     {"delf",    FUNCT(do_delf_cmd),    A_TWO | A_OPTIONAL },
     {"delsig",  FUNCT(do_delsig_cmd),  A_ONE },
     {"echo",    FUNCT(do_echo_cmd),    A_ZERO },
+    {"fgroup",  FUNCT(do_fgroup_cmd),  A_THREE },
     {"getp",    FUNCT(do_getp_cmd),    A_ONE },
     {"gets",    FUNCT(do_gets_cmd),    A_ONE },
     {"ptype",   FUNCT(do_ptype_cmd),   A_ONE },
     {"stype",   FUNCT(do_stype_cmd),   A_ONE },
     {"help",    FUNCT(do_help_cmd),    A_ONE | A_OPTIONAL },
-    {"linkpp",  FUNCT(do_linkpp_cmd),  A_TWO | A_REMOVE_ARROWS },
-    {"linkps",  FUNCT(do_linkps_cmd),  A_TWO | A_REMOVE_ARROWS },
-    {"linksp",  FUNCT(do_linksp_cmd),  A_TWO | A_REMOVE_ARROWS },
+    {"linkpp",  FUNCT(do_linkpp_cmd),  A_TWO | A_REMOVE_ARROWS | A_BATCH },
+    {"linkps",  FUNCT(do_linkps_cmd),  A_TWO | A_REMOVE_ARROWS | A_BATCH },
+    {"linksp",  FUNCT(do_linksp_cmd),  A_TWO | A_REMOVE_ARROWS | A_BATCH },
     {"list",    FUNCT(do_list_cmd),    A_ONE | A_PLUS },
     {"loadrt",  FUNCT(do_loadrt_cmd),  A_ONE | A_PLUS },
     {"loadusr", FUNCT(do_loadusr_cmd), A_PLUS | A_TILDE },
     {"lock",    FUNCT(do_lock_cmd),    A_ONE | A_OPTIONAL },
-    {"net",     FUNCT(do_net_cmd),     A_ONE | A_PLUS | A_REMOVE_ARROWS },
-    {"newsig",  FUNCT(do_newsig_cmd),  A_TWO },
+    {"net",     FUNCT(do_net_cmd),     A_ONE | A_PLUS | A_REMOVE_ARROWS | A_BATCH },
+    {"newsig",  FUNCT(do_newsig_cmd),  A_TWO | A_BATCH },
     {"save",    FUNCT(do_save_cmd),    A_TWO | A_OPTIONAL | A_TILDE },
     {"setexact_for_test_suite_only", FUNCT(do_setexact_cmd), A_ZERO },
-    {"setp",    FUNCT(do_setp_cmd),    A_TWO },
+    {"setp",    FUNCT(do_setp_cmd),    A_TWO | A_BATCH },
     {"sets",    FUNCT(do_sets_cmd),    A_TWO },
     {"show",    FUNCT(do_show_cmd),    A_ONE | A_OPTIONAL | A_PLUS},
-    {"source",  FUNCT(do_source_cmd),  A_ONE | A_TILDE },
+    {"source",  FUNCT(do_source_cmd),  A_ONE | A_TILDE | A_BATCH },
     {"start",   FUNCT(do_start_cmd),   A_ZERO},
     {"status",  FUNCT(do_status_cmd),  A_ONE | A_OPTIONAL },
     {"stop",    FUNCT(do_stop_cmd),    A_ZERO},
@@ -365,6 +367,12 @@ static int parse_cmd1(char **argv) {
 	    }
 	}
 #endif
+	if(!(command->type & A_BATCH)) {
+	    /* this command may depend on (or be depended on by) the
+	       queued netlist commands, so apply those first */
+	    result = halcmd_commit_batch();
+	    if(result != 0) return result;
+	}
 	if(!strcmp(command->name, "echo")) {echo_mode = 1;}
 	if(!strcmp(command->name, "unecho")) {echo_mode = 0;}
 	switch(nargs | is_plus) {
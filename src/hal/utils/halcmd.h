@@ -71,6 +71,7 @@ enum halcmd_argtype {
     A_REMOVE_ARROWS = 0x200, /* removes any arrows from command */
     A_OPTIONAL = 0x400,      /* arguments may be NULL */
     A_TILDE = 0x800,         /* tilde-expand all arguments */
+    A_BATCH = 0x1000,        /* command may add to a pending batch */
 };
 
 typedef int(*halcmd_func_t)(void);
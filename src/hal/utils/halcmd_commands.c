@@ -67,6 +67,7 @@ static void print_script_sig_info(int type, char **patterns);
 static void print_param_info(int type, char **patterns);
 static void print_funct_info(char **patterns);
 static void print_thread_info(char **patterns);
+static void print_stats_info(char **patterns);
 static void print_comp_names(char **patterns);
 static void print_pin_names(char **patterns);
 static void print_sig_names(char **patterns);
@@ -92,6 +93,9 @@ static void save_nets(FILE *dst, int arrows);
 static void save_params(FILE *dst);
 static void save_threads(FILE *dst);
 static void print_help_commands(void);
+static int batch_start(void);
+static int batch_note(int entry);
+static int batch_net_cmd(char *signal, char *pins[]);
 
 static int tmatch(int req_type, int type) {
     return req_type == -1 || type == req_type;
@@ -158,6 +162,7 @@ int do_linkpp_cmd(char *first_pin_name, char *second_pin_name)
 {
     int retval;
     hal_pin_t *first_pin, *second_pin;
+    hal_type_t type;
     static int dep_msg_printed = 0;
 
     if ( dep_msg_printed == 0 ) {
@@ -180,18 +185,32 @@ int do_linkpp_cmd(char *first_pin_name, char *second_pin_name)
     }
     
     /* give the mutex, as the other functions use their own mutex */
+    type = first_pin->type;
     rtapi_mutex_give(&(hal_data->mutex));
     
     /* check that both pins have the same type, 
        don't want to create a sig, which after that won't be usefull */
-    if (first_pin->type != second_pin->type) {
+    if (type != second_pin->type) {
 	halcmd_error("pins '%s' and '%s' not of the same type\n",
                 first_pin_name, second_pin_name);
 	return -EINVAL; 
     }
+
+    if (batchmode) {
+	/* queue the signal and both links */
+	retval = batch_start();
+	if (retval == 0) retval = batch_note(hal_batch_signal_new(first_pin_name, type));
+	if (retval >= 0) retval = batch_note(hal_batch_link(first_pin_name, first_pin_name));
+	if (retval >= 0) retval = batch_note(hal_batch_link(second_pin_name, first_pin_name));
+	if (retval < 0) {
+	    halcmd_error("linkpp failed\n");
+	    return retval;
+	}
+	return 0;
+    }
 	
     /* now create the signal */
-    retval = hal_signal_new(first_pin_name, first_pin->type);
+    retval = hal_signal_new(first_pin_name, type);
 
     if (retval == 0) {
 	/* if it worked, link the pins to it */
@@ -212,6 +231,15 @@ int do_linkps_cmd(char *pin, char *sig)
 {
     int retval;
 
+    if (batchmode) {
+	retval = batch_start();
+	if (retval == 0) retval = batch_note(hal_batch_link(pin, sig));
+	if (retval < 0) {
+	    halcmd_error("link failed\n");
+	    return retval;
+	}
+	return 0;
+    }
     retval = hal_link(pin, sig);
     if (retval == 0) {
 	/* print success message */
@@ -374,28 +402,49 @@ int do_delf_cmd(char *func, char *thread) {
     return retval;
 }
 
+int do_fgroup_cmd(char *func, char *thread, char *group_str) {
+    int retval, group;
+    char *cp;
+
+    group = strtol(group_str, &cp, 0);
+    if ((*cp != '\0') && (!isspace(*cp))) {
+        halcmd_error("value '%s' invalid for group\n", group_str);
+        return -EINVAL;
+    }
+    retval = hal_set_funct_group(func, thread, group);
+    if(retval == 0) {
+        halcmd_info("Function '%s' in thread '%s' put in group %d\n",
+                    func, thread, group);
+    } else {
+        halcmd_error("fgroup failed\n");
+    }
+
+    return retval;
+}
+
 static int preflight_net_cmd(char *signal, hal_sig_t *sig, char *pins[]) {
     int i, type=-1, writers=0, bidirs=0, pincnt=0;
-    char *writer_name=0, *bidir_name=0;
+    const char *writer_name=0, *bidir_name=0;
     /* if signal already exists, use its info */
     if (sig) {
 	type = sig->type;
 	writers = sig->writers;
 	bidirs = sig->bidirs;
     }
-
-    if(writers || bidirs) 
-    {
-        hal_pin_t *pin;
-        int next;
-        for(next = hal_data->pin_list_ptr; next; next=pin->next_ptr) 
-        {
-            pin = SHMPTR(next);
-            if(SHMPTR(pin->signal) == sig && pin->dir == HAL_OUT)
-                writer_name = pin->name;
-            if(SHMPTR(pin->signal) == sig && pin->dir == HAL_IO)
-                bidir_name = writer_name = pin->name;
-        }
+    if (batchmode) {
+	/* count what the queued netlist commands will add */
+	hal_pin_dir_t dir;
+	const char *name = hal_batch_sig_writer(signal, &dir);
+	if (!sig) {
+	    type = hal_batch_sig_type(signal);
+	}
+	if (name && dir == HAL_OUT) {
+	    writer_name = name;
+	    writers++;
+	} else if (name) {
+	    bidir_name = writer_name = name;
+	    bidirs++;
+	}
     }
 
     for(i=0; pins[i] && *pins[i]; i++) {
@@ -416,6 +465,18 @@ static int preflight_net_cmd(char *signal, hal_sig_t *sig, char *pins[]) {
                     pin->name, osig->name);
             return -EINVAL;
 	}
+        if(batchmode) {
+            const char *qsig = hal_batch_pin_sig(pins[i]);
+            if(qsig && strcmp(qsig, signal) == 0) {
+                /* already queued for this signal */
+                pincnt++;
+                continue;
+            } else if(qsig) {
+                halcmd_error("Pin '%s' is already queued to link to signal '%s'\n",
+                        pin->name, qsig);
+                return -EINVAL;
+            }
+        }
 	if (type == -1) {
 	    /* no pre-existing type, use this pin's type */
 	    type = pin->type;
@@ -429,6 +490,20 @@ static int preflight_net_cmd(char *signal, hal_sig_t *sig, char *pins[]) {
         if(pin->dir == HAL_OUT) {
             if(writers || bidirs) {
             dir_error:
+                if(!writer_name && !bidir_name) {
+                    /* the offending pin was linked earlier, find it
+                       (only now, this walks the whole pin list) */
+                    hal_pin_t *opin;
+                    int next;
+                    for(next = hal_data->pin_list_ptr; next; next=opin->next_ptr)
+                    {
+                        opin = SHMPTR(next);
+                        if(SHMPTR(opin->signal) == sig && opin->dir == HAL_OUT)
+                            writer_name = opin->name;
+                        if(SHMPTR(opin->signal) == sig && opin->dir == HAL_IO)
+                            bidir_name = writer_name = opin->name;
+                    }
+                }
                 halcmd_error(
                     "Signal '%s' can not add %s pin '%s', "
                     "it already has %s pin '%s'\n",
@@ -459,6 +534,9 @@ int do_net_cmd(char *signal, char *pins[]) {
     hal_sig_t *sig;
     int i, retval;
 
+    if(batchmode) {
+        return batch_net_cmd(signal, pins);
+    }
     rtapi_mutex_get(&(hal_data->mutex));
     /* see if signal already exists */
     sig = halpr_find_sig_by_name(signal);
@@ -501,6 +579,147 @@ int do_net_cmd(char *signal, char *pins[]) {
     return retval;
 }
 
+/* In batch mode (halcmd -b) the netlist commands are only checked and
+   queued; the queue is applied by halcmd_commit_batch(), which is called
+   before the next command that is not netlist related and at the end of
+   the input.  The file and line of each queued entry are kept so that a
+   failure at commit time can be reported against the command that
+   caused it. */
+
+typedef struct {
+    char *filename;
+    int linenumber;
+} batch_origin_t;
+
+static batch_origin_t *batch_origins = 0;
+static int batch_norigins = 0, batch_origins_alloc = 0;
+static int batch_started = 0;
+
+static int batch_start(void) {
+    int retval;
+
+    if(batch_started) return 0;
+    retval = hal_batch_begin();
+    if(retval == 0) batch_started = 1;
+    return retval;
+}
+
+/* record where 'entry' (an index returned by hal_batch_xxx()) came from;
+   negative values are error codes and are passed through */
+static int batch_note(int entry) {
+    const char *fn = halcmd_get_filename();
+
+    if(entry < 0) return entry;
+    if(entry >= batch_origins_alloc) {
+        int n = batch_origins_alloc ? 2 * batch_origins_alloc : 64;
+        batch_origin_t *o;
+        while(n <= entry) n *= 2;
+        o = realloc(batch_origins, n * sizeof(batch_origin_t));
+        if(!o) return -ENOMEM;
+        batch_origins = o;
+        batch_origins_alloc = n;
+    }
+    /* consecutive entries nearly always share a file name */
+    if(batch_norigins && strcmp(batch_origins[batch_norigins-1].filename, fn) == 0) {
+        batch_origins[entry].filename = batch_origins[batch_norigins-1].filename;
+    } else {
+        batch_origins[entry].filename = strdup(fn);
+        if(!batch_origins[entry].filename) return -ENOMEM;
+    }
+    batch_origins[entry].linenumber = halcmd_get_linenumber();
+    batch_norigins = entry + 1;
+    return entry;
+}
+
+static void batch_forget(void) {
+    int i;
+
+    for(i=0; i<batch_norigins; i++) {
+        if(i == 0 || batch_origins[i].filename != batch_origins[i-1].filename)
+            free(batch_origins[i].filename);
+    }
+    free(batch_origins);
+    batch_origins = 0;
+    batch_norigins = batch_origins_alloc = 0;
+    batch_started = 0;
+}
+
+int halcmd_commit_batch(void) {
+    int retval, failed = -1;
+
+    if(!batch_started) return 0;
+    retval = hal_batch_commit(&failed);
+    if(retval != 0) {
+        if(failed >= 0 && failed < batch_norigins) {
+            char *filename_save = strdup(halcmd_get_filename());
+            int lineno_save = halcmd_get_linenumber();
+            halcmd_set_filename(batch_origins[failed].filename);
+            halcmd_set_linenumber(batch_origins[failed].linenumber);
+            halcmd_error("batch failed, no queued netlist commands were applied\n");
+            if(filename_save) {
+                halcmd_set_filename(filename_save);
+                free(filename_save);
+            }
+            halcmd_set_linenumber(lineno_save);
+        } else {
+            halcmd_error("batch failed, no queued netlist commands were applied\n");
+        }
+    }
+    batch_forget();
+    return retval;
+}
+
+void halcmd_abort_batch(void) {
+    if(!batch_started) return;
+    hal_batch_abort();
+    batch_forget();
+}
+
+static int batch_net_cmd(char *signal, char *pins[]) {
+    hal_sig_t *sig;
+    hal_pin_t *pin;
+    hal_type_t type;
+    int i, retval;
+
+    rtapi_mutex_get(&(hal_data->mutex));
+    sig = halpr_find_sig_by_name(signal);
+    retval = preflight_net_cmd(signal, sig, pins);
+    if(retval < 0) {
+        rtapi_mutex_give(&(hal_data->mutex));
+        return retval;
+    }
+    if(halpr_find_pin_by_name(signal)) {
+        halcmd_error(
+                "Signal name '%s' must not be the same as a pin.  "
+                "Did you omit the signal name?\n",
+            signal);
+        rtapi_mutex_give(&(hal_data->mutex));
+        return -ENOENT;
+    }
+    pin = halpr_find_pin_by_name(pins[0]);
+    if(!pin) {
+        rtapi_mutex_give(&(hal_data->mutex));
+        halcmd_error("Pin '%s' does not exist\n", pins[0]);
+        return -ENOENT;
+    }
+    type = pin->type;
+    rtapi_mutex_give(&(hal_data->mutex));
+
+    retval = batch_start();
+    if(retval == 0 && !sig && hal_batch_sig_type(signal) == HAL_TYPE_UNSPECIFIED) {
+        /* create the signal with the type of the first pin */
+        retval = batch_note(hal_batch_signal_new(signal, type));
+    }
+    for(i=0; retval >= 0 && pins[i] && *pins[i]; i++) {
+        retval = batch_note(hal_batch_link(pins[i], signal));
+    }
+    if(retval < 0) {
+        halcmd_error("net failed\n");
+        return retval;
+    }
+    return 0;
+}
+
 #if 0  /* newinst deferred to version 2.2 */
 int do_newinst_cmd(char *comp_name, char *inst_name) {
     hal_comp_t *comp = halpr_find_comp_by_name(comp_name);
@@ -611,18 +830,28 @@ int do_newinst_cmd(char *comp_name, char *inst_name) {
 int do_newsig_cmd(char *name, char *type)
 {
     int retval;
+    hal_type_t sigtype;
 
     if (strcasecmp(type, "bit") == 0) {
-	retval = hal_signal_new(name, HAL_BIT);
+	sigtype = HAL_BIT;
     } else if (strcasecmp(type, "float") == 0) {
-	retval = hal_signal_new(name, HAL_FLOAT);
+	sigtype = HAL_FLOAT;
     } else if (strcasecmp(type, "u32") == 0) {
-	retval = hal_signal_new(name, HAL_U32);
+	sigtype = HAL_U32;
     } else if (strcasecmp(type, "s32") == 0) {
-	retval = hal_signal_new(name, HAL_S32);
+	sigtype = HAL_S32;
     } else {
 	halcmd_error("Unknown signal type '%s'\n", type);
+	sigtype = HAL_TYPE_UNSPECIFIED;
+    }
+    if (sigtype == HAL_TYPE_UNSPECIFIED) {
 	retval = -EINVAL;
+    } else if (batchmode) {
+	retval = batch_start();
+	if (retval == 0) retval = batch_note(hal_batch_signal_new(name, sigtype));
+	if (retval > 0) retval = 0;
+    } else {
+	retval = hal_signal_new(name, sigtype);
     }
     if (retval < 0) {
 	halcmd_error("newsig failed\n");
@@ -697,6 +926,17 @@ int do_setp_cmd(char *name, char *value)
     void *d_ptr;
 
     halcmd_info("setting parameter '%s' to '%s'\n", name, value);
+    if (batchmode) {
+	/* params are not affected by the queued netlist commands, but
+	   setting a pin depends on whether it is linked yet */
+	rtapi_mutex_get(&(hal_data->mutex));
+	param = halpr_find_param_by_name(name);
+	rtapi_mutex_give(&(hal_data->mutex));
+	if (param == 0) {
+	    retval = halcmd_commit_batch();
+	    if (retval != 0) return retval;
+	}
+    }
     /* get mutex before accessing shared data */
     rtapi_mutex_get(&(hal_data->mutex));
     /* search param list for name */
@@ -987,6 +1227,8 @@ int do_show_cmd(char *type, char **patterns)
 	print_funct_info(patterns);
     } else if (strcmp(type, "thread") == 0) {
 	print_thread_info(patterns);
+    } else if (strcmp(type, "stats") == 0) {
+	print_stats_info(patterns);
     } else if (strcmp(type, "alias") == 0) {
 	print_pin_aliases(patterns);
 	print_param_aliases(patterns);
@@ -1924,7 +2166,12 @@ static void print_thread_info(char **patterns)
 		/* scriptmode only uses one line per thread, which contains: 
 		   thread period, FP flag, name, then all functs separated by spaces  */
 		if (scriptmode == 0) {
-		    halcmd_output("                 %2d %s\n", n, funct->name);
+		    if (fentry->group != 0) {
+			halcmd_output("                 %2d %s (group %d)\n",
+			    n, funct->name, fentry->group);
+		    } else {
+			halcmd_output("                 %2d %s\n", n, funct->name);
+		    }
 		} else {
 		    halcmd_output(" %s", funct->name);
 		}
@@ -1941,6 +2188,58 @@ static void print_thread_info(char **patterns)
     halcmd_output("\n");
 }
 
+static void print_stats_line(const char *label, const char *name,
+    hal_stats_t *stats)
+{
+    halcmd_output(((scriptmode == 0) ? "    %-8s %-30s %10lu %8ld %8ld %8ld %8ld %8ld\n"
+                                     : "%s %s %lu %ld %ld %ld %ld %ld\n"),
+                  label, name,
+                  (unsigned long)stats->count,
+                  halpr_stats_percentile(stats, 500),
+                  halpr_stats_percentile(stats, 900),
+                  halpr_stats_percentile(stats, 990),
+                  halpr_stats_percentile(stats, 999),
+                  (long)(stats->count ? stats->max : 0));
+}
+
+static void print_stats_info(char **patterns)
+{
+    int next_thread;
+    hal_thread_t *tptr;
+    hal_list_t *list_root, *list_entry;
+    hal_funct_entry_t *fentry;
+    hal_funct_t *funct;
+
+    if (scriptmode == 0) {
+	halcmd_output("Realtime Thread Statistics (percentiles are bucket estimates):\n");
+	halcmd_output("    Type     Name                              Samples      p50      p90      p99    p99.9      Max\n");
+    }
+    rtapi_mutex_get(&(hal_data->mutex));
+    next_thread = hal_data->thread_list_ptr;
+    while (next_thread != 0) {
+	tptr = SHMPTR(next_thread);
+	if ( match(patterns, tptr->name) ) {
+	    if (scriptmode == 0 && !tptr->stats_enable) {
+		halcmd_output("    (set %s.stats-enable to collect statistics)\n",
+		    tptr->name);
+	    }
+	    print_stats_line("thread", tptr->name, &(tptr->stats));
+	    print_stats_line("latency", tptr->name, &(tptr->latency));
+	    list_root = &(tptr->funct_list);
+	    list_entry = list_next(list_root);
+	    while (list_entry != list_root) {
+		fentry = (hal_funct_entry_t *) list_entry;
+		funct = SHMPTR(fentry->funct_ptr);
+		print_stats_line("funct", funct->name, &(fentry->stats));
+		list_entry = list_next(list_entry);
+	    }
+	}
+	next_thread = tptr->next_ptr;
+    }
+    rtapi_mutex_give(&(hal_data->mutex));
+    halcmd_output("\n");
+}
+
 static void print_comp_names(char **patterns)
 {
     int next;
@@ -2656,6 +2955,10 @@ static void save_threads(FILE *dst)
 	    fentry = (hal_funct_entry_t *) list_entry;
 	    funct = SHMPTR(fentry->funct_ptr);
 	    fprintf(dst, "addf %s %s\n", funct->name, tptr->name);
+	    if (fentry->group != 0) {
+		fprintf(dst, "fgroup %s %s %d\n", funct->name, tptr->name,
+		    fentry->group);
+	    }
 	    list_entry = list_next(list_entry);
 	}
 	next_thread = tptr->next_ptr;
@@ -2802,14 +3105,26 @@ int do_help_cmd(char *command)
     } else if (strcmp(command, "delf") == 0) {
 	printf("delf functname threadname\n");
 	printf("  Removes function 'functname' from thread 'threadname'.\n");
+    } else if (strcmp(command, "fgroup") == 0) {
+	printf("fgroup functname threadname group\n");
+	printf("  Puts function 'functname' in thread 'threadname' in\n");
+	printf("  parallel group 'group' (1 to %d, 0 for none).  Functions\n", HAL_MAX_FUNCT_GROUPS);
+	printf("  that are next to each other in a thread and are in groups\n");
+	printf("  form a parallel section.  The groups of a section run at\n");
+	printf("  the same time, on other CPUs when possible, and the thread\n");
+	printf("  waits for all of them before running the next function.\n");
+	printf("  Threads must be stopped.\n");
     } else if (strcmp(command, "show") == 0) {
 	printf("show [type] [pattern]\n");
 	printf("  Prints info about HAL items of the specified type.\n");
 	printf("  'type' is 'comp', 'pin', 'sig', 'param', 'funct',\n");
-	printf("  'thread', or 'all'.  If 'type' is omitted, it assumes\n");
-	printf("  'all' with no pattern.  If 'pattern' is specified\n");
+	printf("  'thread', 'stats', or 'all'.  If 'type' is omitted, it\n");
+	printf("  assumes 'all' with no pattern.  If 'pattern' is specified\n");
 	printf("  it prints only those items whose names match the\n");
 	printf("  pattern, which may be a 'shell glob'.\n");
+	printf("  'stats' prints run time histogram percentiles of each\n");
+	printf("  thread and its functions, and the thread's wakeup latency,\n");
+	printf("  collected while the thread's 'stats-enable' param is set.\n");
     } else if (strcmp(command, "list") == 0) {
 	printf("list type [pattern]\n");
 	printf("  Prints the names of HAL items of the specified type.\n");
@@ -2897,6 +3212,7 @@ static void print_help_commands(void)
     printf("  ptype, stype        Get the type of a pin, parameter or signal\n");
     printf("  setp, sets          Set the value of a pin, parameter or signal\n");
     printf("  addf, delf          Add/remove function to/from a thread\n");
+    printf("  fgroup              Run functions of a thread in parallel groups\n");
     printf("  show                Display info about HAL objects\n");
     printf("  list                Display names of HAL objects\n");
     printf("  source              Execute commands from another .hal file\n");
@@ -46,6 +46,7 @@ extern int do_addf_cmd(char *funct, char *thread, char *tokens[]);
 extern int do_alias_cmd(char *pinparam, char *name, char *alias);
 extern int do_unalias_cmd(char *pinparam, char *name);
 extern int do_delf_cmd(char *funct, char *thread);
+extern int do_fgroup_cmd(char *funct, char *thread, char *group);
 extern int do_echo_cmd();
 extern int do_unecho_cmd();
 extern int do_linkps_cmd(char *pin, char *signal);
@@ -82,8 +83,11 @@ extern int do_waitusr_cmd(char *comp_name);
 extern int do_save_cmd(char *type, char *filename);
 extern int do_setexact_cmd(void);
 
+extern int halcmd_commit_batch(void);
+extern void halcmd_abort_batch(void);
+
 pid_t hal_systemv_nowait(char *const argv[]);
 int hal_systemv(char *const argv[]);
 
-extern int scriptmode, comp_id;
+extern int scriptmode, batchmode, comp_id;
 #endif
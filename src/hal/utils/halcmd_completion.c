@@ -49,7 +49,7 @@ static const char *command_table[] = {
     "loadrt", "loadusr", "unload", "lock", "unlock",
     "linkps", "linksp", "linkpp", "unlinkp",
     "net", "newsig", "delsig", "getp", "gets", "setp", "sets", "ptype", "stype",
-    "addf", "delf", "show", "list", "status", "save", "source",
+    "addf", "delf", "fgroup", "show", "list", "status", "save", "source",
     "start", "stop", "quit", "exit", "help", "alias", "unalias", 
     NULL,
 };
@@ -65,7 +65,7 @@ static const char *alias_table[] = {
 };
 
 static const char *show_table[] = {
-    "all", "alias", "comp", "pin", "sig", "param", "funct", "thread",
+    "all", "alias", "comp", "pin", "sig", "param", "funct", "thread", "stats",
     NULL,
 };
 
@@ -705,6 +705,10 @@ char **halcmd_completer(const char *text, int start, int end, hal_completer_func
         result = func(text, attached_funct_generator);
     } else if(startswith(buffer, "delf ") && argno == 2) {
         result = func(text, thread_generator);
+    } else if(startswith(buffer, "fgroup ") && argno == 1) {
+        result = func(text, attached_funct_generator);
+    } else if(startswith(buffer, "fgroup ") && argno == 2) {
+        result = func(text, thread_generator);
     } else if(startswith(buffer, "help ") && argno == 1) {
         result = completion_matches_table(text, command_table, func);
     } else if(startswith(buffer, "unloadusr ") && argno == 1) {
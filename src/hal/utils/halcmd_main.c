@@ -93,7 +93,7 @@ int main(int argc, char **argv)
     keep_going = 0;
     /* start parsing the command line, options first */
     while(1) {
-        c = getopt(argc, argv, "+RCfi:kqQsvVhe");
+        c = getopt(argc, argv, "+RCbfi:kqQsvVhe");
         if(c == -1) break;
         switch(c) {
             case 'R':
@@ -129,6 +129,10 @@ int main(int argc, char **argv)
 		/* script friendly mode */
 		scriptmode = 1;
 		break;
+	    case 'b':
+		/* batch mode */
+		batchmode = 1;
+		break;
 	    case 'v':
 		/* -v = verbose */
 		rtapi_set_msg_level(RTAPI_MSG_INFO);
@@ -283,6 +287,12 @@ int main(int argc, char **argv)
 	    }
 	}
     }
+    /* apply (or throw away) any netlist commands still queued */
+    if (( errorcount > 0 ) && ( keep_going == 0 )) {
+	halcmd_abort_batch();
+    } else if ( halcmd_commit_batch() != 0 ) {
+	errorcount++;
+    }
     /* all done */
     halcmd_shutdown();
     if ( errorcount > 0 ) {
@@ -362,6 +372,9 @@ static void print_help_general(int showR)
     printf("\nUsage:   halcmd [options] [cmd [args]]\n\n");
     printf("\n         halcmd [options] -f [filename]\n\n");
     printf("options:\n\n");
+    printf("  -b             Batch mode - queue net, newsig and link commands\n");
+    printf("                 and apply them all at once.  If any of them\n");
+    printf("                 fails, none of the queued commands take effect.\n");
     printf("  -e             echo the commands from stdin to stderr\n");
     printf("  -f [filename]  Read commands from 'filename', not command\n");
     printf("                 line.  If no filename, read from stdin.\n");
@@ -244,6 +244,49 @@ def to_c(name):
     name = name.replace("#", "").replace(".", "_").replace("-", "_")
     return re.sub("_+", "_", name)
 
+def batch_prologue(f, has_personality):
+    # With "option batch", rtapi_app_main() sizes the arrays in
+    # __comp_batch before exporting any instance, and each function is
+    # exported once, running over all the instances in turn.
+    members = []
+    if has_personality:
+        members.append("_personality")
+    for name, type, array, dir, value, personality in pins:
+        members.append(to_c(name))
+    for name, type, array, dir, value, personality in params:
+        members.append(to_c(name))
+    for type, name, array, value in variables:
+        members.append(name.lstrip("*"))
+
+    print >>f
+    print >>f, "static int __comp_batch_alloc(int n) {"
+    print >>f, "    __comp_maxinst = n;"
+    print >>f, "    if(n <= 0) return 0;"
+    for m in members:
+        print >>f, "    __comp_batch.%s = hal_malloc(n * sizeof(*__comp_batch.%s));" % (m, m)
+        print >>f, "    if(!__comp_batch.%s) return -ENOMEM;" % m
+        print >>f, "    memset((void*)__comp_batch.%s, 0, n * sizeof(*__comp_batch.%s));" % (m, m)
+    print >>f, "    return 0;"
+    print >>f, "}"
+
+    for name, fp in functions:
+        print >>f
+        print >>f, "static void __comp_batch_%s(void *arg, long period) {" % to_c(name)
+        print >>f, "    int __comp_i;"
+        print >>f, "    for(__comp_i = 0; __comp_i < __comp_ninst; __comp_i++)"
+        print >>f, "        %s(__comp_i, period);" % to_c(name)
+        print >>f, "}"
+
+    print >>f
+    print >>f, "static int __comp_batch_export(void) {"
+    print >>f, "    int r = 0;"
+    for name, fp in functions:
+        print >>f, "    r = hal_export_funct(\"%s\", __comp_batch_%s, 0, %s, 0, comp_id);" % (
+            to_hal(removeprefix(comp_name, "hal_") + "." + name), to_c(name), int(fp))
+        print >>f, "    if(r != 0) return r;"
+    print >>f, "    return 0;"
+    print >>f, "}"
+
 def prologue(f):
     print >> f, "/* Autogenerated by %s on %s -- do not edit */" % (
         sys.argv[0], time.asctime())
@@ -286,6 +329,15 @@ static int comp_id;
 
 
     has_data = options.get("data")
+    batch = options.get("batch")
+
+    # How export() refers to a member of this instance's state.  With
+    # "option batch" the state is a structure of arrays, indexed by
+    # instance number.
+    if batch:
+        inst = "__comp_batch.%s[__comp_i]"
+    else:
+        inst = "inst->%s"
 
     has_array = False
     has_personality = False
@@ -307,50 +359,85 @@ static int comp_id;
             
     print >>f
     print >>f, "struct __comp_state {"
-    print >>f, "    struct __comp_state *_next;"
-    if has_personality:
-        print >>f, "    int _personality;"
+    if batch:
+        # one array per item, holding that item for every instance
+        if has_personality:
+            print >>f, "    int *_personality;"
+        for name, type, array, dir, value, personality in pins:
+            if array:
+                if isinstance(array, tuple): array = array[0]
+                print >>f, "    hal_%s_t *(*%s)[%s];" % (type, to_c(name), array)
+            else:
+                print >>f, "    hal_%s_t **%s;" % (type, to_c(name))
+            names[name] = 1
+        for name, type, array, dir, value, personality in params:
+            if array:
+                if isinstance(array, tuple): array = array[0]
+                print >>f, "    hal_%s_t (*%s)[%s];" % (type, to_c(name), array)
+            else:
+                print >>f, "    hal_%s_t *%s;" % (type, to_c(name))
+            names[name] = 1
+        for type, name, array, value in variables:
+            stars = name[:len(name) - len(name.lstrip("*"))]
+            if array:
+                print >>f, "    %s %s(*%s)[%d];" % (type, stars, name.lstrip("*"), array)
+            else:
+                print >>f, "    %s %s(*%s);" % (type, stars, name.lstrip("*"))
+    else:
+        print >>f, "    struct __comp_state *_next;"
+        if has_personality:
+            print >>f, "    int _personality;"
 
-    for name, type, array, dir, value, personality in pins:
-        if array:
-            if isinstance(array, tuple): array = array[0]
-            print >>f, "    hal_%s_t *%s[%s];" % (type, to_c(name), array)
-        else:
-            print >>f, "    hal_%s_t *%s;" % (type, to_c(name))
-        names[name] = 1
+        for name, type, array, dir, value, personality in pins:
+            if array:
+                if isinstance(array, tuple): array = array[0]
+                print >>f, "    hal_%s_t *%s[%s];" % (type, to_c(name), array)
+            else:
+                print >>f, "    hal_%s_t *%s;" % (type, to_c(name))
+            names[name] = 1
 
-    for name, type, array, dir, value, personality in params:
-        if array:
-            if isinstance(array, tuple): array = array[0]
-            print >>f, "    hal_%s_t %s[%s];" % (type, to_c(name), array)
-        else:
-            print >>f, "    hal_%s_t %s;" % (type, to_c(name))
-        names[name] = 1
+        for name, type, array, dir, value, personality in params:
+            if array:
+                if isinstance(array, tuple): array = array[0]
+                print >>f, "    hal_%s_t %s[%s];" % (type, to_c(name), array)
+            else:
+                print >>f, "    hal_%s_t %s;" % (type, to_c(name))
+            names[name] = 1
 
-    for type, name, array, value in variables:
-        if array:
-            print >>f, "    %s %s[%d];\n" % (type, name, array)
-        else:
-            print >>f, "    %s %s;\n" % (type, name)
-    if has_data:
-        print >>f, "    void *_data;"
+        for type, name, array, value in variables:
+            if array:
+                print >>f, "    %s %s[%d];\n" % (type, name, array)
+            else:
+                print >>f, "    %s %s;\n" % (type, name)
+        if has_data:
+            print >>f, "    void *_data;"
 
     print >>f, "};"
 
     if options.get("userspace"):
         print >>f, "#include <stdlib.h>"
 
-    print >>f, "struct __comp_state *__comp_first_inst=0, *__comp_last_inst=0;"
+    if batch:
+        print >>f, "static struct __comp_state __comp_batch;"
+        print >>f, "static int __comp_ninst=0, __comp_maxinst=0;"
+    else:
+        print >>f, "struct __comp_state *__comp_first_inst=0, *__comp_last_inst=0;"
     
     print >>f
     for name, fp in functions:
         if names.has_key(name):
             Error("Duplicate item name: %s" % name)
-        print >>f, "static void %s(struct __comp_state *__comp_inst, long period);" % to_c(name)
+        if batch:
+            print >>f, "static inline void %s(int __comp_i, long period);" % to_c(name)
+        else:
+            print >>f, "static void %s(struct __comp_state *__comp_inst, long period);" % to_c(name)
         names[name] = 1
 
-    print >>f, "static int __comp_get_data_size(void);"
-    if options.get("extra_setup"):
+    if not batch:
+        print >>f, "static int __comp_get_data_size(void);"
+    if options.get("extra_setup") and batch:
+        print >>f, "static int extra_setup(int __comp_i, char *prefix, long extra_arg);"
+    elif options.get("extra_setup"):
         print >>f, "static int extra_setup(struct __comp_state *__comp_inst, char *prefix, long extra_arg);"
     if options.get("extra_cleanup"):
         print >>f, "static void extra_cleanup(void);"
@@ -370,44 +457,51 @@ static int comp_id;
         print >>f, "static int export(char *prefix, long extra_arg, long personality) {"
     else:
         print >>f, "static int export(char *prefix, long extra_arg) {"
-    if len(functions) > 0:
+    if len(functions) > 0 and not batch:
         print >>f, "    char buf[HAL_NAME_LEN + 1];"
     print >>f, "    int r = 0;"
     if has_array:
         print >>f, "    int j = 0;"
-    print >>f, "    int sz = sizeof(struct __comp_state) + __comp_get_data_size();"
-    print >>f, "    struct __comp_state *inst = hal_malloc(sz);"
-    print >>f, "    memset(inst, 0, sz);"
+    if batch:
+        print >>f, "    int __comp_i = __comp_ninst;"
+        print >>f, "    if(__comp_i >= __comp_maxinst) return -ENOMEM;"
+    else:
+        print >>f, "    int sz = sizeof(struct __comp_state) + __comp_get_data_size();"
+        print >>f, "    struct __comp_state *inst = hal_malloc(sz);"
+        print >>f, "    memset(inst, 0, sz);"
     if has_data:
         print >>f, "    inst->_data = (char*)inst + sizeof(struct __comp_state);"
     if has_personality:
-        print >>f, "    inst->_personality = personality;"
+        print >>f, "    %s = personality;" % (inst % "_personality")
     if options.get("extra_setup"):
-        print >>f, "    r = extra_setup(inst, prefix, extra_arg);"
+        if batch:
+            print >>f, "    r = extra_setup(__comp_i, prefix, extra_arg);"
+        else:
+            print >>f, "    r = extra_setup(inst, prefix, extra_arg);"
 	print >>f, "    if(r != 0) return r;"
         # the extra_setup() function may have changed the personality
         if has_personality:
-            print >>f, "    personality = inst->_personality;"
+            print >>f, "    personality = %s;" % (inst % "_personality")
     for name, type, array, dir, value, personality in pins:
         if personality:
             print >>f, "if(%s) {" % personality
         if array:
             if isinstance(array, tuple): array = array[1]
             print >>f, "    for(j=0; j < (%s); j++) {" % array
-            print >>f, "        r = hal_pin_%s_newf(%s, &(inst->%s[j]), comp_id," % (
-                type, dirmap[dir], to_c(name))
+            print >>f, "        r = hal_pin_%s_newf(%s, &(%s[j]), comp_id," % (
+                type, dirmap[dir], inst % to_c(name))
             print >>f, "            \"%%s%s\", prefix, j);" % to_hal("." + name)
             print >>f, "        if(r != 0) return r;"
             if value is not None:
-                print >>f, "    *(inst->%s[j]) = %s;" % (to_c(name), value)
+                print >>f, "    *(%s[j]) = %s;" % (inst % to_c(name), value)
             print >>f, "    }"
         else:
-            print >>f, "    r = hal_pin_%s_newf(%s, &(inst->%s), comp_id," % (
-                type, dirmap[dir], to_c(name))
+            print >>f, "    r = hal_pin_%s_newf(%s, &(%s), comp_id," % (
+                type, dirmap[dir], inst % to_c(name))
             print >>f, "        \"%%s%s\", prefix);" % to_hal("." + name)
             print >>f, "    if(r != 0) return r;"
             if value is not None:
-                print >>f, "    *(inst->%s) = %s;" % (to_c(name), value)
+                print >>f, "    *(%s) = %s;" % (inst % to_c(name), value)
         if personality:
             print >>f, "}"
 
@@ -417,19 +511,19 @@ static int comp_id;
         if array:
             if isinstance(array, tuple): array = array[1]
             print >>f, "    for(j=0; j < %s; j++) {" % array
-            print >>f, "        r = hal_param_%s_newf(%s, &(inst->%s[j]), comp_id," % (
-                type, dirmap[dir], to_c(name))
+            print >>f, "        r = hal_param_%s_newf(%s, &(%s[j]), comp_id," % (
+                type, dirmap[dir], inst % to_c(name))
             print >>f, "            \"%%s%s\", prefix, j);" % to_hal("." + name)
             print >>f, "        if(r != 0) return r;"
             if value is not None:
-                print >>f, "    inst->%s[j] = %s;" % (to_c(name), value)
+                print >>f, "    %s[j] = %s;" % (inst % to_c(name), value)
             print >>f, "    }"
         else:
-            print >>f, "    r = hal_param_%s_newf(%s, &(inst->%s), comp_id," % (
-                type, dirmap[dir], to_c(name))
+            print >>f, "    r = hal_param_%s_newf(%s, &(%s), comp_id," % (
+                type, dirmap[dir], inst % to_c(name))
             print >>f, "        \"%%s%s\", prefix);" % to_hal("." + name)
             if value is not None:
-                print >>f, "    inst->%s = %s;" % (to_c(name), value)
+                print >>f, "    %s = %s;" % (inst % to_c(name), value)
             print >>f, "    if(r != 0) return r;"
         if personality:
             print >>f, "}"
@@ -438,22 +532,28 @@ static int comp_id;
         if value is None: continue
         if array:
             print >>f, "    for(j=0; j < %s; j++) {" % array
-            print >>f, "        inst->%s[j] = %s;" % (name, value)
+            print >>f, "        %s[j] = %s;" % (inst % name, value)
             print >>f, "    }"
         else:
-            print >>f, "    inst->%s = %s;" % (name, value)
+            print >>f, "    %s = %s;" % (inst % name, value)
 
-    for name, fp in functions:
-        print >>f, "    rtapi_snprintf(buf, sizeof(buf), \"%%s%s\", prefix);"\
-            % to_hal("." + name)
-        print >>f, "    r = hal_export_funct(buf, (void(*)(void *inst, long))%s, inst, %s, 0, comp_id);" % (
-            to_c(name), int(fp))
-        print >>f, "    if(r != 0) return r;"
-    print >>f, "    if(__comp_last_inst) __comp_last_inst->_next = inst;"
-    print >>f, "    __comp_last_inst = inst;"
-    print >>f, "    if(!__comp_first_inst) __comp_first_inst = inst;"
-    print >>f, "    return 0;"
-    print >>f, "}"
+    if batch:
+        print >>f, "    __comp_ninst++;"
+        print >>f, "    return 0;"
+        print >>f, "}"
+        batch_prologue(f, has_personality)
+    else:
+        for name, fp in functions:
+            print >>f, "    rtapi_snprintf(buf, sizeof(buf), \"%%s%s\", prefix);"\
+                % to_hal("." + name)
+            print >>f, "    r = hal_export_funct(buf, (void(*)(void *inst, long))%s, inst, %s, 0, comp_id);" % (
+                to_c(name), int(fp))
+            print >>f, "    if(r != 0) return r;"
+        print >>f, "    if(__comp_last_inst) __comp_last_inst->_next = inst;"
+        print >>f, "    __comp_last_inst = inst;"
+        print >>f, "    if(!__comp_first_inst) __comp_first_inst = inst;"
+        print >>f, "    return 0;"
+        print >>f, "}"
 
     if options.get("count_function"):
         print >>f, "static int get_count(void);"
@@ -495,6 +595,12 @@ static int comp_id;
                 print >>f, "    r = export(\"%s\", 0);" % \
                         to_hal(removeprefix(comp_name, "hal_"))
         elif options.get("count_function"):
+            if batch:
+                print >>f, "    r = __comp_batch_alloc(count);"
+                print >>f, "    if(r) {"
+                print >>f, "        hal_exit(comp_id);"
+                print >>f, "        return r;"
+                print >>f, "    }"
             print >>f, "    for(i=0; i<count; i++) {"
             print >>f, "        char buf[HAL_NAME_LEN + 1];"
             print >>f, "        rtapi_snprintf(buf, sizeof(buf), " \
@@ -512,6 +618,17 @@ static int comp_id;
             print >>f, "        return -EINVAL;"
             print >>f, "    }"
             print >>f, "    if(!count && !names[0]) count = default_count;"
+            if batch:
+                print >>f, "    if(count) {"
+                print >>f, "        r = __comp_batch_alloc(count);"
+                print >>f, "    } else {"
+                print >>f, "        for(i=0; i < (int)(sizeof(names)/sizeof(names[0])) && names[i]; i++);"
+                print >>f, "        r = __comp_batch_alloc(i);"
+                print >>f, "    }"
+                print >>f, "    if(r) {"
+                print >>f, "        hal_exit(comp_id);"
+                print >>f, "        return r;"
+                print >>f, "    }"
             print >>f, "    if(count) {"
             print >>f, "        for(i=0; i<count; i++) {"
             print >>f, "            char buf[HAL_NAME_LEN + 1];"
@@ -542,6 +659,8 @@ static int comp_id;
 
         if options.get("constructable") and not options.get("singleton"):
             print >>f, "    hal_set_constructor(comp_id, export_1);"
+        if batch:
+            print >>f, "    if(r == 0) r = __comp_batch_export();"
         print >>f, "    if(r) {"
 	if options.get("extra_cleanup"):
             print >>f, "    extra_cleanup();"
@@ -579,9 +698,16 @@ static int comp_id;
     print >>f
     if not options.get("no_convenience_defines"):
         print >>f, "#undef FUNCTION"
-        print >>f, "#define FUNCTION(name) static void name(struct __comp_state *__comp_inst, long period)"
-        print >>f, "#undef EXTRA_SETUP"
-        print >>f, "#define EXTRA_SETUP() static int extra_setup(struct __comp_state *__comp_inst, char *prefix, long extra_arg)"
+        if batch:
+            member = "__comp_batch.%s[__comp_i]"
+            print >>f, "#define FUNCTION(name) static inline void name(int __comp_i, long period)"
+            print >>f, "#undef EXTRA_SETUP"
+            print >>f, "#define EXTRA_SETUP() static int extra_setup(int __comp_i, char *prefix, long extra_arg)"
+        else:
+            member = "__comp_inst->%s"
+            print >>f, "#define FUNCTION(name) static void name(struct __comp_state *__comp_inst, long period)"
+            print >>f, "#undef EXTRA_SETUP"
+            print >>f, "#define EXTRA_SETUP() static int extra_setup(struct __comp_state *__comp_inst, char *prefix, long extra_arg)"
         print >>f, "#undef EXTRA_CLEANUP"
         print >>f, "#define EXTRA_CLEANUP() static void extra_cleanup(void)"
         print >>f, "#undef fperiod"
@@ -590,32 +716,32 @@ static int comp_id;
             print >>f, "#undef %s" % to_c(name)
             if array:
                 if dir == 'in':
-                    print >>f, "#define %s(i) (0+*(__comp_inst->%s[i]))" % (to_c(name), to_c(name))
+                    print >>f, "#define %s(i) (0+*(%s[i]))" % (to_c(name), member % to_c(name))
                 else:
-                    print >>f, "#define %s(i) (*(__comp_inst->%s[i]))" % (to_c(name), to_c(name))
+                    print >>f, "#define %s(i) (*(%s[i]))" % (to_c(name), member % to_c(name))
             else:
                 if dir == 'in':
-                    print >>f, "#define %s (0+*__comp_inst->%s)" % (to_c(name), to_c(name))
+                    print >>f, "#define %s (0+*%s)" % (to_c(name), member % to_c(name))
                 else:
-                    print >>f, "#define %s (*__comp_inst->%s)" % (to_c(name), to_c(name))
+                    print >>f, "#define %s (*%s)" % (to_c(name), member % to_c(name))
         for name, type, array, dir, value, personality in params:
             print >>f, "#undef %s" % to_c(name)
             if array:
-                print >>f, "#define %s(i) (__comp_inst->%s[i])" % (to_c(name), to_c(name))
+                print >>f, "#define %s(i) (%s[i])" % (to_c(name), member % to_c(name))
             else:
-                print >>f, "#define %s (__comp_inst->%s)" % (to_c(name), to_c(name))
+                print >>f, "#define %s (%s)" % (to_c(name), member % to_c(name))
 
         for type, name, array, value in variables:
             name = name.replace("*", "")
             print >>f, "#undef %s" % name
-            print >>f, "#define %s (__comp_inst->%s)" % (name, name)
+            print >>f, "#define %s (%s)" % (name, member % name)
 
         if has_data:
             print >>f, "#undef data"
             print >>f, "#define data (*(%s*)(__comp_inst->_data))" % options['data']
         if has_personality:
             print >>f, "#undef personality"
-            print >>f, "#define personality (__comp_inst->_personality)"
+            print >>f, "#define personality (%s)" % (member % "_personality")
 
         if options.get("userspace"):
             print >>f, "#undef FOR_ALL_INSTS"
@@ -626,6 +752,8 @@ static int comp_id;
 def epilogue(f):
     data = options.get('data')
     print >>f
+    if options.get('batch'):
+        return
     if data:
         print >>f, "static int __comp_get_data_size(void) { return sizeof(%s); }" % data
     else:
@@ -808,7 +936,10 @@ def document(filename, outfilename):
         print >>f, ".SH FUNCTIONS"
         for _, name, fp, doc in finddocs('funct'):
             print >>f, ".TP"
-            print >>f, "\\fB%s\\fR" % to_hal_man(name),
+            if options.get("batch"):
+                print >>f, "\\fB%s\\fR" % to_hal_man_unnumbered(name),
+            else:
+                print >>f, "\\fB%s\\fR" % to_hal_man(name),
             if fp:
                 print >>f, "(requires a floating-point thread)"
             else:
@@ -898,6 +1029,13 @@ def process(filename, mode, outfilename):
         base_name = os.path.splitext(os.path.basename(outfilename))[0]
         if comp_name != base_name:
             raise SystemExit, "Component name (%s) does not match filename (%s)" % (comp_name, base_name)
+        if options.get("batch"):
+            for o in ("userspace", "singleton", "constructable", "data",
+                        "no_convenience_defines"):
+                if options.get(o):
+                    raise SystemExit, "Option batch may not be used with option %s" % o
+            if not options.get("rtapi_app", 1):
+                raise SystemExit, "Option batch may not be used with option rtapi_app no"
 
         f = open(outfilename, "w")
 
@@ -0,0 +1,590 @@
+/*    This is a component of LinuxCNC
+ *
+ *    hm2_eth_sim: answer LBP16 requests on a UDP socket the way a Mesa
+ *    Ethernet Anything I/O card does, so hm2_eth can be run, tested and
+ *    benchmarked without hardware.  The simulated HostMot2 configuration
+ *    has an IOPort per connector and a watchdog, plus as many encoders,
+ *    stepgens, pwmgens and smart serial channels as asked for.
+ *
+ *    This program is free software; you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation; either version 2 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program; if not, write to the Free Software
+ *    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <errno.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+#include <rtapi.h>
+#include "hal/drivers/mesa-hostmot2/hostmot2.h"
+#include "hal/drivers/mesa-hostmot2/lbp16.h"
+#include "hal/drivers/mesa-hostmot2/sserial.h"
+
+#define SPACE_SIZE 0x10000
+#define MAX_PACKET_SIZE 1500
+
+#define IDROM_ADDR      0x0400
+#define MD_OFFSET       0x0040
+#define PD_OFFSET       0x0200
+#define REG_STRIDE      0x100       // register stride 0
+
+#define CLOCK_LOW       100000000
+#define CLOCK_HIGH      200000000
+
+#define MAX_ENCODERS    16
+#define MAX_STEPGENS    16
+#define MAX_PWMGENS     16
+#define MAX_SSERIAL_CHANNELS 8
+
+struct sim_board {
+    const char *name;           // as read from the board info space
+    int ports, port_width;
+};
+
+// the boards hm2_eth_probe() knows about
+static const struct sim_board sim_boards[] = {
+    { "7I92",      2, 17 },
+    { "7I76E-16",  3, 17 },
+    { "7I80HD-16", 3, 24 },
+    { "7I80DB-16", 4, 17 },
+};
+
+// The module register file.  Base addresses follow the usual HostMot2
+// layout; every module uses register stride 0 (0x100) and instance
+// stride 0 (4), except smart serial which uses instance stride 1 (0x40).
+enum { IOPORT, WATCHDOG, ENCODER, STEPGEN, PWMGEN, SSERIAL, OTHER, NUM_MODULES };
+
+struct sim_module {
+    const char *name;
+    int gtag, version, num_registers, multiple_registers;
+    rtapi_u16 base;
+    int instances;
+    // bytes moved to and from this module's registers, for -B
+    unsigned long read_bytes, write_bytes;
+};
+
+static struct sim_module modules[NUM_MODULES] = {
+    [IOPORT]   = { "gpio",     HM2_GTAG_IOPORT,      0,  5, 0x1F,  0x1000 },
+    [WATCHDOG] = { "watchdog", HM2_GTAG_WATCHDOG,    0,  3, 0,     0x0C00 },
+    [ENCODER]  = { "encoder",  HM2_GTAG_ENCODER,     3,  5, 0x03,  0x3000 },
+    [STEPGEN]  = { "stepgen",  HM2_GTAG_STEPGEN,     2, 10, 0x1FF, 0x2000 },
+    [PWMGEN]   = { "pwmgen",   HM2_GTAG_PWMGEN,      0,  5, 0x03,  0x4100 },
+    [SSERIAL]  = { "sserial",  HM2_GTAG_SMARTSERIAL, 0,  6, 0x3C,  0x5A00 },
+    [OTHER]    = { "other" },
+};
+
+#define REG(module, reg) (modules[module].base + (reg) * REG_STRIDE)
+
+// each LBP16 memory space, with a little slack for accesses that
+// start just below the top
+static rtapi_u8 space[LBP16_MEM_SPACE_COUNT][SPACE_SIZE + 8];
+static rtapi_u16 space_addr[LBP16_MEM_SPACE_COUNT];
+
+static int verbose;
+
+static rtapi_u32 get32(rtapi_u32 addr) {
+    rtapi_u32 value;
+    memcpy(&value, &space[0][addr], sizeof(value));
+    return value;
+}
+
+static void put32(rtapi_u32 addr, rtapi_u32 value) {
+    memcpy(&space[0][addr], &value, sizeof(value));
+}
+
+static long long now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+
+//
+// encoders count up steadily, encoder i at 1000 * (i+1) counts/s
+//
+
+static long long start_ns;
+
+static void encoder_update(long long t) {
+    int i;
+    rtapi_u32 div = get32(REG(ENCODER, 2)) & 0xFFFF;
+    double ts_per_ns = CLOCK_LOW / 1e9 / (div + 2);
+
+    for(i = 0; i < modules[ENCODER].instances; i++) {
+        double rate = 1000. * (i + 1);
+        long long count = (t - start_ns) * rate / 1e9;
+        // the timestamp latched when the last count came in
+        rtapi_u32 ts = (rtapi_u32)(count / rate * 1e9 * ts_per_ns);
+        put32(REG(ENCODER, 0) + 4 * i, (count & 0xFFFF) | (ts << 16));
+    }
+    put32(REG(ENCODER, 3), (rtapi_u32)((t - start_ns) * ts_per_ns) & 0xFFFF);
+}
+
+
+//
+// stepgens add their step rate register to a 48 bit DDS every clock;
+// the accumulator register holds its top 32 bits, steps in 16.16
+//
+
+static long long stepgen_dds[MAX_STEPGENS];
+static long long stepgen_last_ns;
+
+static void stepgen_update(long long t) {
+    long long ticks = (t - stepgen_last_ns) * (CLOCK_LOW / 1000000) / 1000;
+    int i;
+
+    if(ticks <= 0) return;
+    stepgen_last_ns += ticks * 1000 / (CLOCK_LOW / 1000000);
+    for(i = 0; i < modules[STEPGEN].instances; i++) {
+        rtapi_s32 rate = get32(REG(STEPGEN, 0) + 4 * i);
+        stepgen_dds[i] += (long long)rate * ticks;
+        put32(REG(STEPGEN, 1) + 4 * i, (rtapi_u32)(stepgen_dds[i] >> 16));
+    }
+}
+
+
+//
+// Smart serial: one SSLBP instance whose channels each have an 8i20
+// attached.  The 8i20 is the simplest remote for the driver to set up,
+// since it predates parameter discovery.  Commands complete at once.
+//
+
+#define SSERIAL_COMMAND         REG(SSERIAL, 0)
+#define SSERIAL_DATA            REG(SSERIAL, 1)
+#define SSERIAL_CS(c)           (REG(SSERIAL, 2) + 4 * (c))
+#define SSERIAL_USER(n, c)      (REG(SSERIAL, 3 + (n)) + 4 * (c))
+
+static rtapi_u8 sslbp_local[0x800] = {
+    [SSLBPMAJORREVISIONLOC] = 2,
+    [SSLBPMINORREVISIONLOC] = 43,
+    [SSLBPCHANNELSTARTLOC] = 0x40,
+    [SSLBPCHANNELSTRIDELOC] = 0x40,
+};
+static rtapi_u32 sserial_cs[MAX_SSERIAL_CHANNELS];
+static rtapi_u8 remote_mem[0x1000] = {
+    [2164 & 0xFFF] = 20,        // swrevision
+};
+
+static void sserial_command(rtapi_u32 cmd) {
+    int nchan = modules[SSERIAL].instances;
+    int c;
+
+    if((cmd & 0xF000) == READ_LOCAL_CMD) {
+        put32(SSERIAL_DATA, sslbp_local[cmd & 0x7FF]);
+    } else if((cmd & 0xF000) == WRITE_LOCAL_CMD) {
+        sslbp_local[cmd & 0x7FF] = get32(SSERIAL_DATA);
+    } else if((cmd & 0xF000) == 0x1000) {
+        // do-it: a remote read command in a channel's CS register
+        // leaves its answer in user register 0
+        for(c = 0; c < nchan; c++) {
+            rtapi_u32 addr = sserial_cs[c] & 0xFFF, value = 0;
+            if(!(cmd & (1 << c))) continue;
+            switch(sserial_cs[c] >> 24) {
+            case READ_REM_DOUBLE_CMD >> 24:
+            case READ_REM_LONG_CMD >> 24:
+                value |= remote_mem[(addr + 3) & 0xFFF] << 24;
+                value |= remote_mem[(addr + 2) & 0xFFF] << 16;
+                // fall through
+            case READ_REM_WORD_CMD >> 24:
+                value |= remote_mem[(addr + 1) & 0xFFF] << 8;
+                // fall through
+            case READ_REM_BYTE_CMD >> 24:
+            case 0x4C:
+                value |= remote_mem[addr];
+                put32(SSERIAL_USER(0, c), value);
+                break;
+            }
+        }
+    } else if((cmd & 0xF00) == 0x900 || (cmd & 0xF00) == 0xF00) {
+        // start: the remotes answer with their serial number and name
+        for(c = 0; c < nchan; c++) {
+            if(!(cmd & (1 << c))) continue;
+            put32(SSERIAL_USER(0, c), 0x1000 + c);
+            put32(SSERIAL_USER(1, c), HM2_SSERIAL_TYPE_8I20);
+            put32(SSERIAL_USER(2, c), 0);
+        }
+    }
+    put32(SSERIAL_COMMAND, 0);
+}
+
+// a 32 bit word was written to addr in the hostmot2 space
+static void hm2_written(rtapi_u16 addr) {
+    int c;
+
+    if(modules[SSERIAL].instances == 0) return;
+    if(addr == SSERIAL_COMMAND) {
+        sserial_command(get32(addr));
+        return;
+    }
+    for(c = 0; c < modules[SSERIAL].instances; c++) {
+        if(addr == SSERIAL_CS(c)) {
+            // reads of the CS register return status, i.e. not busy
+            sserial_cs[c] = get32(addr);
+            put32(addr, 0);
+        }
+    }
+}
+
+
+//
+// the IDROM
+//
+
+static rtapi_u32 md_word0(int gtag, int version, int clock_tag, int instances) {
+    return gtag | (version << 8) | (clock_tag << 16) | (instances << 24);
+}
+
+static rtapi_u32 md_word1(int base, int num_registers, int register_stride, int instance_stride) {
+    return base | (num_registers << 16) | (register_stride << 24) | (instance_stride << 28);
+}
+
+// assign count secondary functions of a module to the next free pins
+static int add_pins(int *pin, int io_width, int gtag, int unit, const rtapi_u8 *sec_pins, int count) {
+    int i;
+    for(i = 0; i < count; i++) {
+        if(*pin == io_width) return -1;
+        put32(IDROM_ADDR + PD_OFFSET + 4 * *pin,
+            sec_pins[i] | (gtag << 8) | (unit << 16) | (HM2_GTAG_IOPORT << 24));
+        (*pin)++;
+    }
+    return 0;
+}
+
+static int setup_board(const struct sim_board *b) {
+    static const rtapi_u8 encoder_pins[] = { 0x01, 0x02, 0x03 };
+    static const rtapi_u8 stepgen_pins[] = { 0x81, 0x82 };
+    static const rtapi_u8 pwmgen_pins[] = { 0x81, 0x82, 0x83 };
+    hm2_idrom_t idrom;
+    rtapi_u32 md = IDROM_ADDR + MD_OFFSET;
+    int i, m, pin = 0, r = 0;
+
+    // board info space: the name hm2_eth_probe() matches against
+    strncpy((char *)space[LBP16_SPACE_BOARD_INFO >> 10], b->name, 16);
+
+    // ethernet eeprom: the MAC address, backwards, at word 1
+    static const rtapi_u8 mac[6] = { 0x01, 0x00, 0x00, 0xab, 0x60, 0x00 };
+    memcpy(&space[LBP16_SPACE_ETH_EEPROM >> 10][2], mac, sizeof(mac));
+
+    put32(HM2_ADDR_IOCOOKIE, HM2_IOCOOKIE);
+    memcpy(&space[0][HM2_ADDR_CONFIGNAME], HM2_CONFIGNAME, HM2_CONFIGNAME_LENGTH);
+    put32(HM2_ADDR_IDROM_OFFSET, IDROM_ADDR);
+
+    memset(&idrom, 0, sizeof(idrom));
+    idrom.idrom_type = 3;
+    idrom.offset_to_modules = MD_OFFSET;
+    idrom.offset_to_pin_desc = PD_OFFSET;
+    memcpy(idrom.board_name, "MESASIM ", 8);
+    idrom.fpga_size = 16;
+    idrom.fpga_pins = 144;
+    idrom.io_ports = b->ports;
+    idrom.port_width = b->port_width;
+    idrom.io_width = b->ports * b->port_width;
+    idrom.clock_low = CLOCK_LOW;
+    idrom.clock_high = CLOCK_HIGH;
+    idrom.instance_stride_0 = 4;
+    idrom.instance_stride_1 = 0x40;
+    idrom.register_stride_0 = REG_STRIDE;
+    idrom.register_stride_1 = 4;
+    memcpy(&space[0][IDROM_ADDR], &idrom, sizeof(idrom));
+
+    modules[IOPORT].instances = b->ports;
+    modules[WATCHDOG].instances = 1;
+    for(m = 0; m < OTHER; m++) {
+        struct sim_module *mod = &modules[m];
+        if(mod->instances == 0) continue;
+        put32(md + 0, md_word0(mod->gtag, mod->version, 1,
+            m == SSERIAL ? 1 : mod->instances));
+        put32(md + 4, md_word1(mod->base, mod->num_registers, 0, m == SSERIAL));
+        put32(md + 8, mod->multiple_registers);
+        md += 12;
+    }
+    put32(md, 0);   // end of module descriptors
+
+    for(i = 0; i < modules[ENCODER].instances; i++)
+        r |= add_pins(&pin, idrom.io_width, HM2_GTAG_ENCODER, i, encoder_pins, 3);
+    for(i = 0; i < modules[STEPGEN].instances; i++)
+        r |= add_pins(&pin, idrom.io_width, HM2_GTAG_STEPGEN, i, stepgen_pins, 2);
+    for(i = 0; i < modules[PWMGEN].instances; i++)
+        r |= add_pins(&pin, idrom.io_width, HM2_GTAG_PWMGEN, i, pwmgen_pins, 3);
+    for(i = 0; i < modules[SSERIAL].instances; i++) {
+        rtapi_u8 sserial_pins[] = { i + 1, 0x80 | (i + 1) };
+        r |= add_pins(&pin, idrom.io_width, HM2_GTAG_SMARTSERIAL, 0, sserial_pins, 2);
+    }
+    if(r < 0) {
+        fprintf(stderr, "not enough pins on %s for these modules\n", b->name);
+        return -1;
+    }
+    // every other pin a plain GPIO
+    for(; pin < idrom.io_width; pin++)
+        put32(IDROM_ADDR + PD_OFFSET + 4 * pin, HM2_GTAG_IOPORT << 24);
+    return 0;
+}
+
+
+//
+// LBP16
+//
+
+static int module_of(rtapi_u16 addr) {
+    int m;
+    for(m = 0; m < OTHER; m++) {
+        if(modules[m].instances
+                && addr >= modules[m].base
+                && addr < modules[m].base + modules[m].num_registers * REG_STRIDE)
+            return m;
+    }
+    return OTHER;
+}
+
+// Carry out the LBP16 commands in one request datagram, appending the
+// data of every read to reply.  Returns the size of the reply.
+static int process_request(const rtapi_u8 *req, int len, rtapi_u8 *reply) {
+    int i = 0, out = 0;
+
+    while(i + LBP16_CMD_SIZE <= len) {
+        rtapi_u16 cmd = req[i] | (req[i+1] << 8);
+        int sp = (cmd >> 10) & 7;
+        int size = 1 << ((cmd >> 8) & 3);
+        int count = cmd & LBP16_MAX_PACKET_DATA_SIZE;
+        int n;
+
+        i += LBP16_CMD_SIZE;
+        if(cmd & LBP16_ADDR) {
+            if(i + LBP16_ADDR_SIZE > len) break;
+            space_addr[sp] = req[i] | (req[i+1] << 8);
+            i += LBP16_ADDR_SIZE;
+        }
+        if(verbose)
+            fprintf(stderr, "%s space %d addr 0x%04x: %d x %d bytes\n",
+                (cmd & LBP16_WRITE) ? "write" : "read", sp, space_addr[sp],
+                count, size);
+
+        for(n = 0; n < count; n++) {
+            rtapi_u16 addr = space_addr[sp];
+            int hm2 = sp == 0 && !(cmd & LBP16_INFO_ACC);
+            if(cmd & LBP16_WRITE) {
+                if(i + size > len) return out;
+                // area info is read-only
+                if(!(cmd & LBP16_INFO_ACC))
+                    memcpy(&space[sp][addr], &req[i], size);
+                if(hm2) {
+                    modules[module_of(addr)].write_bytes += size;
+                    hm2_written(addr);
+                }
+                i += size;
+            } else {
+                if(out + size > MAX_PACKET_SIZE) return out;
+                if(cmd & LBP16_INFO_ACC)
+                    memset(&reply[out], 0, size);
+                else
+                    memcpy(&reply[out], &space[sp][addr], size);
+                if(hm2)
+                    modules[module_of(addr)].read_bytes += size;
+                out += size;
+            }
+            if(cmd & LBP16_ADDR_AUTO_INC)
+                space_addr[sp] = addr + size;
+        }
+    }
+    return out;
+}
+
+
+//
+// benchmark mode
+//
+// A servo cycle of hm2_eth sends exactly one datagram that reads the
+// hostmot2 space (the TRAM read), so those are counted as cycles.
+//
+
+static struct {
+    unsigned long cycles, packets_in, packets_out, bytes_in, bytes_out;
+    long long handling_ns, handling_max_ns;
+} bench;
+
+static void bench_report(double seconds) {
+    double cycles = bench.cycles ? bench.cycles : 1;
+    int m;
+
+    printf("%.1f cycles/s; per cycle: %.2f packets in, %.2f out, "
+           "%.1f bytes in, %.1f out; handling %.1fus avg %.1fus max\n",
+        bench.cycles / seconds,
+        bench.packets_in / cycles, bench.packets_out / cycles,
+        bench.bytes_in / cycles, bench.bytes_out / cycles,
+        bench.packets_in ? bench.handling_ns / 1e3 / bench.packets_in : 0.,
+        bench.handling_max_ns / 1e3);
+    printf("    %-10s %10s %10s\n", "module", "read/cyc", "written/cyc");
+    for(m = 0; m < NUM_MODULES; m++) {
+        if(modules[m].read_bytes || modules[m].write_bytes)
+            printf("    %-10s %10.1f %10.1f\n", modules[m].name,
+                modules[m].read_bytes / cycles, modules[m].write_bytes / cycles);
+        modules[m].read_bytes = modules[m].write_bytes = 0;
+    }
+    fflush(stdout);
+    memset(&bench, 0, sizeof(bench));
+}
+
+// true if the request reads from the hostmot2 space
+static int is_hm2_read(const rtapi_u8 *req, int len) {
+    return len >= LBP16_CMD_SIZE
+        && !(req[1] & (LBP16_WRITE >> 8))
+        && (req[1] & ((LBP16_INFO_ACC | 0x1C00) >> 8)) == 0;
+}
+
+
+static void usage(const char *argv0) {
+    size_t i;
+    fprintf(stderr,
+        "Usage: %s [-a address] [-p port] [-b board] [-e encoders] [-s stepgens]\n"
+        "       [-w pwmgens] [-S sserial-channels] [-d delay-us] [-B seconds] [-v]\n"
+        "Simulate a Mesa ethernet card for hm2_eth.\n"
+        "  -a  address to listen on (default 127.0.0.1)\n"
+        "  -p  UDP port, 0 for any free port (default %d)\n"
+        "  -b  board to simulate, one of:", argv0, LBP16_UDP_PORT);
+    for(i = 0; i < sizeof(sim_boards) / sizeof(sim_boards[0]); i++)
+        fprintf(stderr, " %s", sim_boards[i].name);
+    fprintf(stderr, "\n"
+        "  -e, -s, -w  number of encoders, stepgens, pwmgens (default 0, max 16)\n"
+        "  -S  number of smart serial channels, each with an 8i20 (default 0, max 8)\n"
+        "  -d  delay each reply by this many microseconds\n"
+        "  -B  print packet and byte counts per servo cycle every this many seconds\n"
+        "  -v  print each command received\n");
+}
+
+static int count_arg(const char *arg, int max) {
+    int n = atoi(arg);
+    if(n < 0) return 0;
+    return n > max ? max : n;
+}
+
+int main(int argc, char **argv) {
+    const char *address = "127.0.0.1";
+    const struct sim_board *board = &sim_boards[0];
+    int port = LBP16_UDP_PORT, delay_us = 0, bench_interval = 0;
+    long long bench_start;
+    struct sockaddr_in addr;
+    size_t i;
+    int c, sockfd;
+
+    while((c = getopt(argc, argv, "a:p:b:e:s:w:S:d:B:vh")) != -1) {
+        switch(c) {
+        case 'a': address = optarg; break;
+        case 'p': port = atoi(optarg); break;
+        case 'e': modules[ENCODER].instances = count_arg(optarg, MAX_ENCODERS); break;
+        case 's': modules[STEPGEN].instances = count_arg(optarg, MAX_STEPGENS); break;
+        case 'w': modules[PWMGEN].instances = count_arg(optarg, MAX_PWMGENS); break;
+        case 'S': modules[SSERIAL].instances = count_arg(optarg, MAX_SSERIAL_CHANNELS); break;
+        case 'd': delay_us = atoi(optarg); break;
+        case 'B': bench_interval = atoi(optarg); break;
+        case 'v': verbose = 1; break;
+        case 'b':
+            for(i = 0; i < sizeof(sim_boards) / sizeof(sim_boards[0]); i++)
+                if(strcasecmp(optarg, sim_boards[i].name) == 0) break;
+            if(i == sizeof(sim_boards) / sizeof(sim_boards[0])) {
+                fprintf(stderr, "%s: unknown board '%s'\n", argv[0], optarg);
+                usage(argv[0]);
+                return 1;
+            }
+            board = &sim_boards[i];
+            break;
+        default:
+            usage(argv[0]);
+            return c == 'h' ? 0 : 1;
+        }
+    }
+
+    if(setup_board(board) < 0)
+        return 1;
+
+    sockfd = socket(PF_INET, SOCK_DGRAM, 0);
+    if(sockfd < 0) {
+        perror("socket");
+        return 1;
+    }
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    if(inet_pton(AF_INET, address, &addr.sin_addr) != 1) {
+        fprintf(stderr, "%s: invalid address '%s'\n", argv[0], address);
+        return 1;
+    }
+    if(bind(sockfd, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+        perror("bind");
+        return 1;
+    }
+    socklen_t addrlen = sizeof(addr);
+    if(getsockname(sockfd, (struct sockaddr *)&addr, &addrlen) < 0) {
+        perror("getsockname");
+        return 1;
+    }
+    port = ntohs(addr.sin_port);
+    fprintf(stderr, "%s: simulating %s on %s:%d\n", argv[0], board->name, address, port);
+    // requests are queued from here on, so tell whoever started us
+    printf("listening on %s:%d\n", address, port);
+    fflush(stdout);
+
+    start_ns = stepgen_last_ns = bench_start = now_ns();
+    while(1) {
+        rtapi_u8 req[MAX_PACKET_SIZE], reply[MAX_PACKET_SIZE];
+        struct sockaddr_in peer;
+        socklen_t peerlen = sizeof(peer);
+        long long t0, t1;
+        int len, out;
+
+        if(bench_interval) {
+            struct pollfd pfd = { .fd = sockfd, .events = POLLIN };
+            long long left = bench_start + bench_interval * 1000000000LL - now_ns();
+            if(left <= 0 || poll(&pfd, 1, left / 1000000 + 1) == 0) {
+                t0 = now_ns();
+                if(t0 - bench_start >= bench_interval * 1000000000LL) {
+                    bench_report((t0 - bench_start) / 1e9);
+                    bench_start = t0;
+                }
+                continue;
+            }
+        }
+
+        len = recvfrom(sockfd, req, sizeof(req), 0, (struct sockaddr *)&peer, &peerlen);
+        if(len < 0) {
+            if(errno == EINTR) continue;
+            perror("recvfrom");
+            return 1;
+        }
+
+        t0 = now_ns();
+        encoder_update(t0);
+        stepgen_update(t0);
+        out = process_request(req, len, reply);
+        t1 = now_ns();
+
+        bench.packets_in++;
+        bench.bytes_in += len;
+        bench.cycles += is_hm2_read(req, len);
+        bench.handling_ns += t1 - t0;
+        if(t1 - t0 > bench.handling_max_ns) bench.handling_max_ns = t1 - t0;
+
+        if(out == 0) continue;      // writes are not answered
+        if(delay_us) usleep(delay_us);
+        if(sendto(sockfd, reply, out, 0, (struct sockaddr *)&peer, peerlen) < 0)
+            perror("sendto");
+        bench.packets_out++;
+        bench.bytes_out += out;
+    }
+}
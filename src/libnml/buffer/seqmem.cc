@@ -0,0 +1,560 @@
+/********************************************************************
+* Description: seqmem.cc
+*   C++ file for the Communication Management System (CMS).
+*   Includes member Functions for class SEQMEM.
+*   Notes: The class SEQMEM is a shared memory buffer like SHMEM, but
+*   readers never take a lock that the writer has to wait for.
+*
+*   Without queuing the buffer holds two copies of the message.  The
+*   writer fills in the copy that is not current and then makes it
+*   current, readers copy out the current one and check a sequence
+*   count to see that it was not rewritten while they copied it.
+*
+*   With queuing the buffer is a ring of fixed size message slots.
+*   Writers only move the tail and readers only move the head, so a
+*   reader never holds up a writer and a writer only waits for another
+*   writer.
+*
+* Author:
+* License: GPL Version 2
+* System: Linux
+*
+* Copyright (c) 2016 All rights reserved.
+*
+* Last change:
+********************************************************************/
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdio.h>		/* sscanf() */
+#include <stddef.h>		/* size_t */
+#include <sys/types.h>		/* key_t */
+#include <signal.h>		/* kill() */
+#include <unistd.h>		/* getpid() */
+#include <errno.h>		// errno
+#include <string.h>		/* strstr(), memcpy(), memset() */
+#include <stdlib.h>		/* strtod(), malloc() */
+
+#ifdef __cplusplus
+}
+#endif
+#include "rcs_print.hh"		/* rcs_print_error() */
+#include "cms.hh"		/* class CMS */
+#include "seqmem.hh"		/* class SEQMEM */
+#include "shm.hh"		/* class RCS_SHAREDMEM */
+#include "timer.hh"		/* etime(), esleep() */
+
+/* rw-rw-r-- permissions */
+#define MODE (0777)
+
+/* Slots are made at least this big when the count is not configured. */
+#define SEQMEM_MIN_SLOT_SIZE 1024
+
+/* Shared control block, after the 32 byte buffer name. */
+struct SEQMEM_CONTROL {
+    volatile long write_lock;	/* pid of the writer, 0 if free */
+    volatile long read_lock;	/* pid of the queue reader, 0 if free */
+    volatile unsigned long current;	/* slot with the latest message */
+    volatile unsigned long seq[2];	/* odd while the slot is written */
+    volatile long read_id;	/* newest write_id read from the buffer */
+    volatile unsigned long head;	/* queue: count of messages read */
+    volatile unsigned long tail;	/* queue: count of messages written */
+    volatile long write_id;	/* queue: write_id of the last message */
+};
+
+/* Room for the name and control block, keeps the slots aligned. */
+#define SEQMEM_CONTROL_OFFSET 32
+#define SEQMEM_SLOT_OFFSET \
+    ((SEQMEM_CONTROL_OFFSET + sizeof(SEQMEM_CONTROL) + 63) & ~63)
+
+/* SEQMEM Member Functions. */
+
+/* Constructor for use with cms_config. */
+SEQMEM::SEQMEM(const char *bufline, const char *procline, int set_to_server,
+    int set_to_master):CMS(bufline, procline, set_to_server)
+{
+    char *equation;
+
+    shm = NULL;
+    control = NULL;
+    snapshot = NULL;
+    sem_delay = 0.00001;
+    slots = 0;
+    slot_size = 0;
+
+    if (status < 0) {
+	rcs_print_error("SEQMEM: status = %d\n", status);
+	return;
+    }
+
+    /* Save parameters from configuration file. */
+    if (sscanf(bufline, "%*s %*s %*s %*s %*s %*s %*s %*s %*s %d", &key) != 1) {
+	rcs_print_error("SEQMEM: Invalid configuration file format.\n");
+	status = CMS_CONFIG_ERROR;
+	return;
+    }
+
+    master = is_local_master;
+    if (1 == set_to_master) {
+	master = 1;
+    } else if (-1 == set_to_master) {
+	master = 0;
+    }
+    if (NULL != (equation = strstr(proclineupper, "SEMDELAY="))) {
+	sem_delay = strtod(equation + 9, (char **) NULL);
+    } else if (NULL != (equation = strstr(buflineupper, "SEMDELAY="))) {
+	sem_delay = strtod(equation + 9, (char **) NULL);
+    }
+
+    if (NULL != (equation = strstr(buflineupper, "SLOTS="))) {
+	slots = strtol(equation + 6, (char **) NULL, 0);
+    }
+
+    if (neutral) {
+	rcs_print_error("SEQMEM: %s must not be neutral.\n", BufferName);
+	status = CMS_CONFIG_ERROR;
+	return;
+    }
+    if (split_buffer || total_subdivisions > 1) {
+	rcs_print_error
+	    ("SEQMEM: %s can not be split or subdivided.\n", BufferName);
+	status = CMS_CONFIG_ERROR;
+	return;
+    }
+    if (enable_diagnostics) {
+	rcs_print_error
+	    ("SEQMEM: diagnostics are not supported, disabled for %s.\n",
+	    BufferName);
+	enable_diagnostics = 0;
+    }
+
+    /* Open the shared memory buffer. */
+    open();
+}
+
+SEQMEM::~SEQMEM()
+{
+    /* detach from shared memory */
+    close();
+}
+
+/*
+  Open the SEQMEM buffer
+  */
+int SEQMEM::open()
+{
+    long total = size;
+
+    /* Lay out the message slots. */
+    if (!queuing_enabled) {
+	slots = 2;
+    } else if (slots < 1) {
+	slots = (total - (long) SEQMEM_SLOT_OFFSET) / SEQMEM_MIN_SLOT_SIZE;
+	if (slots < 2) {
+	    slots = 2;
+	}
+    }
+    slot_size = (total - (long) SEQMEM_SLOT_OFFSET) / (long) slots;
+    slot_size -= slot_size % 16;
+    if (slot_size <= (long) sizeof(CMS_HEADER)) {
+	rcs_print_error("SEQMEM: %s is too small for %lu slots.\n",
+	    BufferName, slots);
+	status = CMS_CONFIG_ERROR;
+	return -1;
+    }
+
+    if (master) {
+	shm = new RCS_SHAREDMEM(key, total, RCS_SHAREDMEM_CREATE, (int) MODE);
+    } else {
+	shm = new RCS_SHAREDMEM(key, total, RCS_SHAREDMEM_NOCREATE);
+    }
+    if (NULL == shm) {
+	rcs_print_error
+	    ("CMS: couldn't create RCS_SHAREDMEM(%d(0x%X), %ld(0x%lX)).\n",
+	    key, key, total, total);
+	status = CMS_CREATE_ERROR;
+	return -1;
+    }
+    if (shm->addr == NULL) {
+	switch (shm->create_errno) {
+	case EACCES:
+	    status = CMS_PERMISSIONS_ERROR;
+	    break;
+
+	case EEXIST:
+	    status = CMS_RESOURCE_CONFLICT_ERROR;
+	    break;
+
+	case ENOENT:
+	    status = CMS_NO_MASTER_ERROR;
+	    break;
+
+	case ENOMEM:
+	case ENOSPC:
+	    status = CMS_CREATE_ERROR;
+	    break;
+
+	default:
+	    status = CMS_MISC_ERROR;
+	}
+	delete shm;
+	shm = NULL;
+	return -1;
+    }
+
+    if (!shm->created) {
+	char *cptr = (char *) shm->addr;
+	cptr[31] = 0;
+	if (strncmp(cptr, BufferName, 31)) {
+	    rcs_print_error
+		("Shared memory buffers %s and %s may conflict. (key=%d(0x%X))\n",
+		BufferName, cptr, key, key);
+	    strncpy(cptr, BufferName, 32);
+	}
+    }
+    if (master) {
+	memset(shm->addr, 0, total);
+	strncpy((char *) shm->addr, BufferName, 32);
+    }
+    control = (SEQMEM_CONTROL *) ((char *) shm->addr + SEQMEM_CONTROL_OFFSET);
+
+    snapshot = malloc(slot_size);
+    if (NULL == snapshot) {
+	rcs_print_error("SEQMEM: Can't allocate memory for local buffer.\n");
+	status = CMS_CREATE_ERROR;
+	return -1;
+    }
+    memset(snapshot, 0, slot_size);
+
+    /* Each slot is a buffer for one message, as seen by internal_access */
+    long shrink = size - slot_size;
+    size = slot_size;
+    size_without_diagnostics = slot_size;
+    subdiv_size = slot_size;
+    max_message_size = slot_size - sizeof(CMS_HEADER);
+    max_encoded_message_size -= shrink;
+    if (max_encoded_message_size < max_message_size) {
+	max_encoded_message_size = max_message_size;
+    }
+    guaranteed_message_space = max_message_size;
+    free_space = max_message_size;
+    return 0;
+}
+
+/* Detaches from the shared memory. */
+int SEQMEM::close()
+{
+    if (NULL != shm) {
+	shm->delete_totally = delete_totally;
+	delete shm;
+	shm = NULL;
+    }
+    control = NULL;
+    if (NULL != snapshot) {
+	free(snapshot);
+	snapshot = NULL;
+    }
+    return 0;
+}
+
+char *SEQMEM::slot(unsigned long n)
+{
+    return (char *) shm->addr + SEQMEM_SLOT_OFFSET + (n % slots) * slot_size;
+}
+
+/*
+  Take a lock word shared only between writers (or only between queue
+  readers).  Returns 0, or -2 on timeout.  A lock left behind by a process
+  that died holding it is taken over.
+  */
+int SEQMEM::lock(volatile long *lock_word)
+{
+    long pid = (long) getpid();
+    double start_time = etime();
+
+    while (1) {
+	long owner = 0;
+	if (__atomic_compare_exchange_n(lock_word, &owner, pid, false,
+		__ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+	    return 0;
+	}
+	if (owner != pid && kill((pid_t) owner, 0) == -1 && errno == ESRCH) {
+	    if (__atomic_compare_exchange_n(lock_word, &owner, pid, false,
+		    __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+		return 0;
+	    }
+	    continue;
+	}
+	if (timeout >= 0 && etime() - start_time > timeout) {
+	    return -2;
+	}
+	esleep(sem_delay);
+    }
+}
+
+void SEQMEM::unlock(volatile long *lock_word)
+{
+    __atomic_store_n(lock_word, 0, __ATOMIC_RELEASE);
+}
+
+/* Access the shared memory buffer. */
+CMS_STATUS SEQMEM::main_access(void *_local, int *serial_number)
+{
+    /* Check pointers. */
+    if (shm == NULL || control == NULL) {
+	return (status = CMS_MISC_ERROR);
+    }
+
+    if (CMS_CLEAR_ACCESS == internal_access_type) {
+	return clear_slots();
+    }
+    if (CMS_GET_DIAG_INFO_ACCESS == internal_access_type) {
+	return (status = CMS_MISC_ERROR);
+    }
+
+    if (queuing_enabled) {
+	return queue_access(_local, serial_number);
+    }
+    if (internal_access_type == CMS_WRITE_ACCESS ||
+	internal_access_type == CMS_WRITE_IF_READ_ACCESS) {
+	return latest_write(_local, serial_number);
+    }
+    return latest_read(_local, serial_number);
+}
+
+/*
+  Copy the current slot into the snapshot and run the access on that.
+  Retries if the writer rewrote the slot during the copy.
+  */
+CMS_STATUS SEQMEM::latest_read(void *_local, int *serial_number)
+{
+    CMS_HEADER *snap_header = (CMS_HEADER *) snapshot;
+
+    while (1) {
+	unsigned long current =
+	    __atomic_load_n(&control->current, __ATOMIC_ACQUIRE);
+	unsigned long seq =
+	    __atomic_load_n(&control->seq[current], __ATOMIC_ACQUIRE);
+	if (seq & 1) {
+	    /* the writer has lapped us, wait for the next current slot */
+	    esleep(sem_delay);
+	    continue;
+	}
+	memcpy(snapshot, slot(current), sizeof(CMS_HEADER));
+	long in_buffer_size = snap_header->in_buffer_size;
+	if (internal_access_type == CMS_READ_ACCESS ||
+	    internal_access_type == CMS_PEEK_ACCESS) {
+	    if (in_buffer_size < 0 ||
+		in_buffer_size > slot_size - (long) sizeof(CMS_HEADER)) {
+		in_buffer_size = 0;
+	    }
+	    memcpy((char *) snapshot + sizeof(CMS_HEADER),
+		slot(current) + sizeof(CMS_HEADER), in_buffer_size);
+	}
+	__atomic_thread_fence(__ATOMIC_ACQUIRE);
+	if (__atomic_load_n(&control->seq[current], __ATOMIC_RELAXED) == seq) {
+	    break;
+	}
+    }
+
+    snap_header->was_read = (0 != snap_header->write_id &&
+	__atomic_load_n(&control->read_id, __ATOMIC_RELAXED) ==
+	snap_header->write_id);
+
+    internal_access(snapshot, slot_size, _local, serial_number);
+
+    /* Let write_if_read() and check_if_read() know this one was read. */
+    if (internal_access_type == CMS_READ_ACCESS && status >= 0) {
+	long read_id = __atomic_load_n(&control->read_id, __ATOMIC_RELAXED);
+	while (read_id < snap_header->write_id &&
+	    !__atomic_compare_exchange_n(&control->read_id, &read_id,
+		snap_header->write_id, false, __ATOMIC_RELAXED,
+		__ATOMIC_RELAXED)) {
+	}
+    }
+    return (status);
+}
+
+/* Write into the slot that is not current, then make it current. */
+CMS_STATUS SEQMEM::latest_write(void *_local, int *serial_number)
+{
+    switch (lock(&control->write_lock)) {
+    case -2:
+	if (timeout > 0) {
+	    rcs_print_error("SEQMEM: Timed out waiting for writer lock.\n");
+	    rcs_print_error("buffer = %s, timeout = %lf sec.\n",
+		BufferName, timeout);
+	}
+	return (status = CMS_TIMED_OUT);
+    default:
+	break;
+    }
+
+    unsigned long current = control->current;
+    unsigned long next = 1 - current;
+    unsigned long seq = control->seq[next];
+
+    __atomic_store_n(&control->seq[next], seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+
+    /* Carry the header over so write ids keep counting up. */
+    CMS_HEADER *next_header = (CMS_HEADER *) slot(next);
+    memcpy(next_header, slot(current), sizeof(CMS_HEADER));
+    next_header->was_read = (0 != next_header->write_id &&
+	__atomic_load_n(&control->read_id, __ATOMIC_RELAXED) ==
+	next_header->write_id);
+
+    internal_access(slot(next), slot_size, _local, serial_number);
+
+    __atomic_store_n(&control->seq[next], seq + 2, __ATOMIC_RELEASE);
+    if (status == CMS_WRITE_OK) {
+	__atomic_store_n(&control->current, next, __ATOMIC_RELEASE);
+    }
+
+    unlock(&control->write_lock);
+    return (status);
+}
+
+/* Queued access, each slot holds one message. */
+CMS_STATUS SEQMEM::queue_access(void *_local, int *serial_number)
+{
+    unsigned long head, tail;
+    CMS_HEADER *slot_header;
+    CMS_INTERNAL_ACCESS_TYPE access_type = internal_access_type;
+    volatile long *lock_word;
+
+    switch (access_type) {
+    case CMS_GET_QUEUE_LENGTH_ACCESS:
+	head = __atomic_load_n(&control->head, __ATOMIC_ACQUIRE);
+	tail = __atomic_load_n(&control->tail, __ATOMIC_ACQUIRE);
+	queuing_header.queue_length = tail - head;
+	return (status);
+
+    case CMS_GET_SPACE_AVAILABLE_ACCESS:
+	head = __atomic_load_n(&control->head, __ATOMIC_ACQUIRE);
+	tail = __atomic_load_n(&control->tail, __ATOMIC_ACQUIRE);
+	free_space = (slots - (tail - head)) * max_message_size;
+	return (status);
+
+    case CMS_CHECK_IF_READ_ACCESS:
+	head = __atomic_load_n(&control->head, __ATOMIC_ACQUIRE);
+	tail = __atomic_load_n(&control->tail, __ATOMIC_ACQUIRE);
+	header.was_read = (head == tail);
+	return (status);
+
+    case CMS_GET_MSG_COUNT_ACCESS:
+	header.write_id = __atomic_load_n(&control->write_id, __ATOMIC_ACQUIRE);
+	return (status);
+
+    case CMS_WRITE_ACCESS:
+    case CMS_WRITE_IF_READ_ACCESS:
+	lock_word = &control->write_lock;
+	break;
+
+    case CMS_READ_ACCESS:
+    case CMS_PEEK_ACCESS:
+	lock_word = &control->read_lock;
+	break;
+
+    default:
+	return (status = CMS_INTERNAL_ACCESS_ERROR);
+    }
+
+    switch (lock(lock_word)) {
+    case -2:
+	if (timeout > 0) {
+	    rcs_print_error("SEQMEM: Timed out waiting for lock.\n");
+	    rcs_print_error("buffer = %s, timeout = %lf sec.\n",
+		BufferName, timeout);
+	}
+	return (status = CMS_TIMED_OUT);
+    default:
+	break;
+    }
+
+    /* The slot is accessed as a buffer holding a single message. */
+    queuing_enabled = 0;
+    if (lock_word == &control->write_lock) {
+	head = __atomic_load_n(&control->head, __ATOMIC_ACQUIRE);
+	tail = control->tail;
+	if (access_type == CMS_WRITE_IF_READ_ACCESS && head != tail) {
+	    status = CMS_WRITE_WAS_BLOCKED;
+	} else if (tail - head >= slots) {
+	    if (cms_print_queue_full_messages) {
+		rcs_print_error("CMS: %s message queue is full.\n",
+		    BufferName);
+	    }
+	    status = CMS_QUEUE_FULL;
+	} else {
+	    slot_header = (CMS_HEADER *) slot(tail);
+	    slot_header->was_read = 0;
+	    slot_header->write_id = control->write_id;
+	    internal_access_type = CMS_WRITE_ACCESS;
+	    internal_access(slot(tail), slot_size, _local, serial_number);
+	    internal_access_type = access_type;
+	    if (status == CMS_WRITE_OK) {
+		control->write_id = slot_header->write_id;
+		__atomic_store_n(&control->tail, tail + 1, __ATOMIC_RELEASE);
+	    }
+	}
+    } else {
+	head = control->head;
+	tail = __atomic_load_n(&control->tail, __ATOMIC_ACQUIRE);
+	if (head == tail) {
+	    status = CMS_READ_OLD;
+	} else {
+	    slot_header = (CMS_HEADER *) slot(head);
+	    if (access_type == CMS_READ_ACCESS) {
+		/* a peek may already have seen this one */
+		in_buffer_id = slot_header->write_id - 1;
+	    }
+	    internal_access(slot(head), slot_size, _local, serial_number);
+	    if (access_type == CMS_READ_ACCESS && status >= 0) {
+		__atomic_store_n(&control->head, head + 1, __ATOMIC_RELEASE);
+	    }
+	}
+    }
+    queuing_enabled = 1;
+
+    unlock(lock_word);
+    return (status);
+}
+
+/* Empty the buffer, holding the locks so nobody sees a half cleared slot. */
+CMS_STATUS SEQMEM::clear_slots()
+{
+    unsigned long n;
+
+    in_buffer_id = 0;
+    if (0 != lock(&control->write_lock)) {
+	return (status = CMS_TIMED_OUT);
+    }
+    if (queuing_enabled && 0 != lock(&control->read_lock)) {
+	unlock(&control->write_lock);
+	return (status = CMS_TIMED_OUT);
+    }
+
+    for (n = 0; n < slots; n++) {
+	unsigned long seq = 0;
+	if (n < 2) {
+	    seq = control->seq[n];
+	    __atomic_store_n(&control->seq[n], seq + 1, __ATOMIC_RELAXED);
+	    __atomic_thread_fence(__ATOMIC_RELEASE);
+	}
+	memset(slot(n), 0, slot_size);
+	if (n < 2) {
+	    __atomic_store_n(&control->seq[n], seq + 2, __ATOMIC_RELEASE);
+	}
+    }
+    control->read_id = 0;
+    control->write_id = 0;
+    __atomic_store_n(&control->head, control->tail, __ATOMIC_RELEASE);
+
+    if (queuing_enabled) {
+	unlock(&control->read_lock);
+    }
+    unlock(&control->write_lock);
+    return (status = CMS_CLEAR_OK);
+}
@@ -0,0 +1,60 @@
+/********************************************************************
+* Description: seqmem.hh
+*   C++ file for the Communication Management System (CMS).
+*   Includes member Functions for class SEQMEM.
+*   Notes: The class SEQMEM is a shared memory buffer like SHMEM, but
+*   readers never take a lock that the writer has to wait for.
+*   Single message buffers are double buffered and read with a
+*   sequence lock, queued buffers are a ring of message slots.
+*
+* Author:
+* License: GPL Version 2
+* System: Linux
+*
+* Copyright (c) 2016 All rights reserved.
+*
+* Last change:
+********************************************************************/
+
+#ifndef SEQMEM_HH
+#define SEQMEM_HH
+
+#include <sys/types.h>		/* key_t */
+
+#include "cms.hh"		/* class CMS */
+#include "shm.hh"		/* class RCS_SHAREDMEM */
+
+struct SEQMEM_CONTROL;
+
+class SEQMEM:public CMS {
+  public:
+    SEQMEM(const char *bufline, const char *procline, int set_to_server = 0,
+	int set_to_master = 0);
+    virtual ~ SEQMEM();
+
+    CMS_STATUS main_access(void *_local, int *serial_number);
+
+  private:
+    int open();			/* get shared mem */
+    int close();		/* detach from shared mem */
+    char *slot(unsigned long n);	/* CMS buffer image of slot n */
+    int lock(volatile long *lock_word);
+    void unlock(volatile long *lock_word);
+
+    CMS_STATUS latest_read(void *_local, int *serial_number);
+    CMS_STATUS latest_write(void *_local, int *serial_number);
+    CMS_STATUS queue_access(void *_local, int *serial_number);
+    CMS_STATUS clear_slots();
+
+    key_t key;			/* key for shared mem */
+    RCS_SHAREDMEM *shm;		/* shared memory */
+    int master;			/* Is this process responsible for */
+    /* clearing memory? */
+    double sem_delay;		/* Time to wait between polling a lock. */
+    SEQMEM_CONTROL *control;	/* lock words and indexes in shared mem */
+    unsigned long slots;	/* number of message slots */
+    long slot_size;		/* bytes in each slot */
+    void *snapshot;		/* private copy of the slot being read */
+};
+
+#endif /* !SEQMEM_HH */
@@ -330,6 +330,8 @@ CMS::CMS(const char *bufline_in, const char *procline_in, int set_to_server)
 	BufferType = CMS_LOCMEM_TYPE;
     } else if (!strcmp(buffer_type_name, "FILEMEM")) {
 	BufferType = CMS_FILEMEM_TYPE;
+    } else if (!strcmp(buffer_type_name, "SEQMEM")) {
+	BufferType = CMS_SEQMEM_TYPE;
     } else {
 	rcs_print_error("CMS: invalid buffer type (%s)\n", buffer_type_name);
 	status = CMS_CONFIG_ERROR;
@@ -121,6 +121,7 @@ enum CMS_BUFFERTYPE {
     CMS_PHANTOM_BUFFER,
     CMS_LOCMEM_TYPE,
     CMS_FILEMEM_TYPE,
+    CMS_SEQMEM_TYPE,
 };
 
 /* How will this process access the buffer. */
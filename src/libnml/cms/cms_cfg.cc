@@ -63,6 +63,12 @@ extern "C" {
     appropriate critical sections. */
 #include "shmem.hh"		/* class SHMEM */
 
+ /* SEQMEM is a shared memory buffer where readers never block the writer.
+    Single message buffers are double buffered and read under a sequence
+    lock, queued buffers are a ring of fixed size message slots. Best for
+    status buffers that several processes poll. */
+#include "seqmem.hh"		/* class SEQMEM */
+
 #include "rcs_print.hh"		/* rcs_print_error() */
 #include "linklist.hh"		/* LinkedList */
 
@@ -924,6 +930,31 @@ int cms_create(CMS ** cms, const char *buffer_line, const char *proc_line,
 	    }
 	}
 
+	if (!strcmp(buffer_type, "SEQMEM")) {
+	    *cms = new SEQMEM(buffer_line, proc_line, set_to_server,
+		set_to_master);
+	    rcs_print_debug(PRINT_CMS_CONFIG_INFO,
+		"%p = new SEQMEM(%s,%s,%d,%d)\n", *cms, buffer_line,
+		proc_line, set_to_server, set_to_master);
+	    if (NULL == *cms) {
+		if (verbose_nml_error_messages) {
+		    rcs_print_error
+			("cms_config: Can't create new SEQMEM object.\n");
+		}
+		return (-1);
+	    } else if ((*cms)->status < 0) {
+		if (verbose_nml_error_messages) {
+		    rcs_print_error
+			("cms_config: %d(%s) Error occured during SEQMEM create.\n",
+			(*cms)->status,
+			(*cms)->status_string((*cms)->status));
+		}
+		return (-1);
+	    } else {
+		return (0);
+	    }
+	}
+
 	if (!strcmp(buffer_type, "RTLMEM")) {
 	    rcs_print_error("RTLMEM not supported.\n");
 	    return (-1);
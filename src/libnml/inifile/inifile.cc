@@ -18,6 +18,8 @@
 #include <string.h>             /* strstr() */
 #include <ctype.h>              /* isspace() */
 #include <fcntl.h>
+#include <limits.h>
+#include <algorithm>
 
 
 #include "config.h"
@@ -50,9 +52,12 @@ IniFile::IniFile(int _errMask, FILE *_fp)
     fp = _fp;
     errMask = _errMask;
     owned = false;
+    lastLineNo = 0;
+    errLineNo = 0;
+    errCode = ERR_NONE;
 
-    if(fp != NULL)
-        LockFile();
+    if(fp != NULL && LockFile())
+        Parse();
 }
 
 
@@ -77,6 +82,7 @@ IniFile::Open(const char *file)
     if(!LockFile())
         return(false);
 
+    Parse();
     return(true);
 }
 
@@ -99,6 +105,11 @@ IniFile::Close()
         fp = NULL;
     }
 
+    lines.clear();
+    headers.clear();
+    sections.clear();
+    tags.clear();
+
     return(rVal == 0);
 }
 
@@ -265,6 +276,159 @@ IniFile::Find(double *result, StrDoublePair *pPair,
 }
 
 
+/*! Reads the open file into the index used by Find().  Lines are read
+   the way Find() used to read them while searching: backslash at the end
+   of a line continues it on the next one, and blank lines and comments
+   are skipped.  Problems that made a search fail (ambiguous carriage
+   returns, too many continuation lines) are remembered with the line
+   they are on, so that searches that get past that line still fail. */
+void
+IniFile::Parse(void)
+{
+    char                        line[LINELEN + 2];  /* 1 for newline, 1 for NULL */
+    std::string                 eline;
+    int                         extend_ct = 0;
+    int                         newLinePos;
+    const char                  *text;
+    char                        *nonWhite;
+
+    lines.clear();
+    headers.clear();
+    sections.clear();
+    tags.clear();
+    lastLineNo = 0;
+    errLineNo = 0;
+    errCode = ERR_NONE;
+
+    rewind(fp);
+    while (fgets(line, LINELEN + 1, fp) != NULL) {
+        lastLineNo++;
+
+        if (check_line_endings(line) && errLineNo == 0) {
+            errLineNo = lastLineNo;
+            errCode = ERR_CONVERSION;
+        }
+
+        /* strip off newline */
+        newLinePos = strlen(line) - 1;
+        if (newLinePos < 0) {
+            newLinePos = 0;
+        }
+        if (line[newLinePos] == '\n') {
+            line[newLinePos] = 0;
+        }
+        // honor backslash (\) as line-end escape
+        if (newLinePos > 0 && line[newLinePos-1] == '\\') {
+            line[newLinePos-1] = 0;
+            eline += line;
+            extend_ct++;
+            if (extend_ct > MAX_EXTEND_LINES && errLineNo == 0) {
+                fprintf(stderr,
+                   "INIFILE lineno=%d:Too many backslash line extends (limit=%d)\n",
+                   lastLineNo, MAX_EXTEND_LINES);
+                errLineNo = lastLineNo;
+                errCode = ERR_OVER_EXTENDED;
+            }
+            continue; // get next line to extend
+        }
+        if (extend_ct) {
+            eline += line;
+            text = eline.c_str();
+        } else {
+            text = line;
+        }
+        extend_ct = 0;
+
+        if (NULL != (nonWhite = SkipWhite(text))) {
+            AddLine(nonWhite, lastLineNo);
+        }
+        eline.clear();
+    }
+}
+
+
+void
+IniFile::AddLine(const char *nonWhite, unsigned int _lineNo)
+{
+    size_t                      n = lines.size();
+    size_t                      len;
+    const char                  *end;
+
+    lines.push_back(Line());
+    lines[n].text = nonWhite;
+    lines[n].lineNo = _lineNo;
+
+    if (nonWhite[0] == '[') {
+        headers.push_back(n);
+        /* a section is found at its first header */
+        if ((end = strchr(nonWhite, ']')) != NULL) {
+            sections.insert(std::make_pair(
+                std::string(nonWhite, end + 1 - nonWhite), n));
+        }
+        return;
+    }
+
+    /* a tag only matches if whitespace or = follows it */
+    len = strcspn(nonWhite, " \t\r\n=");
+    if (nonWhite[len] != 0) {
+        tags[std::string(nonWhite, len)].push_back(n);
+    }
+}
+
+
+/*! Sets [*first, *end) to the lines of section.
+
+   @return false if there is no such section */
+bool
+IniFile::FindSection(const char *_section, size_t *first, size_t *end)
+{
+    std::string                 bracketSection;
+    size_t                      header = lines.size();
+    LineList::iterator          next;
+
+    bracketSection = std::string("[") + _section + "]";
+    if (strchr(_section, ']') == NULL) {
+        std::map<std::string, size_t>::iterator it =
+            sections.find(bracketSection);
+        if (it != sections.end()) {
+            header = it->second;
+        }
+    } else {
+        for (next = headers.begin(); next != headers.end(); ++next) {
+            if (lines[*next].text.compare(0, bracketSection.size(),
+                                          bracketSection) == 0) {
+                header = *next;
+                break;
+            }
+        }
+    }
+    if (header == lines.size()) {
+        return(false);
+    }
+
+    /* the section ends at the next line that starts with '[' */
+    next = std::upper_bound(headers.begin(), headers.end(), header);
+    *first = header + 1;
+    *end = (next == headers.end()) ? lines.size() : *next;
+    return(true);
+}
+
+
+/*! Fails a search that read the file up to line 'reached', with the
+   error of the first bad line if the search got that far. */
+const char *
+IniFile::Fail(ErrorCode errCode_, unsigned int reached)
+{
+    if (errLineNo != 0 && errLineNo <= reached) {
+        errCode_ = errCode;
+        reached = errLineNo;
+    }
+    lineNo = reached;
+    ThrowException(errCode_);
+    return(NULL);
+}
+
+
 /*! Finds the nth tag in section.
 
    @param tag Entry in the ini file to find.
@@ -277,22 +441,18 @@ IniFile::Find(double *result, StrDoublePair *pPair,
 const char *
 IniFile::Find(const char *_tag, const char *_section, int _num, int *lineno)
 {
-    // WTF, return a pointer to the middle of a local buffer?
+    // Like it always did, this returns a pointer to a static buffer.
     // FIX: this is totally non-reentrant.
-    static char                 line[LINELEN + 2] = "";        /* 1 for newline, 1 for NULL */
-    char                        bracketSection[LINELEN + 2] = "";
-    char                        *nonWhite;
-    int                         newLinePos;                /* position of newline to strip */
-    int                         len;
+    static char                 line[(LINELEN + 2) * (MAX_EXTEND_LINES + 1)] = "";
+    size_t                      first = 0;
+    size_t                      end;
+    size_t                      found;
+    size_t                      len;
+    const char                  *nonWhite;
     char                        tagEnd;
     char                        *valueString;
     char                        *endValueString;
 
-    char  eline [(LINELEN + 2) * (MAX_EXTEND_LINES + 1)];
-    char* elineptr;
-    char* elinenext;
-    int   extend_ct = 0;
-
     // For exceptions.
     lineNo = 0;
     tag = _tag;
@@ -303,165 +463,72 @@ IniFile::Find(const char *_tag, const char *_section, int _num, int *lineno)
     if(!CheckIfOpen())
         return(NULL);
 
-    /* start from beginning */
-    rewind(fp);
-
-    /* check for section first-- if it's non-NULL, then position file at
-       line after [section] */
-    if(section != NULL){
-        sprintf(bracketSection, "[%s]", section);
-
-        /* find [section], and position fp just after it */
-        while (!feof(fp)) {
-
-            if (NULL == fgets(line, LINELEN + 1, fp)) {
-                /* got to end of file without finding it */
-                ThrowException(ERR_SECTION_NOT_FOUND);
-                return(NULL);
-            }
-
-            if(check_line_endings(line)) {
-                ThrowException(ERR_CONVERSION);
-                return(NULL);
-            }
-
-            /* got a line */
-            lineNo++;
+    end = lines.size();
+    if (section != NULL && !FindSection(section, &first, &end)) {
+        return(Fail(ERR_SECTION_NOT_FOUND, lastLineNo));
+    }
 
-            /* strip off newline */
-            newLinePos = strlen(line) - 1;        /* newline is on back from 0 */
-            if (newLinePos < 0) {
-                newLinePos = 0;
+    len = strlen(tag);
+    found = end;
+    if (len != 0 && tag[0] != '[' && strcspn(tag, " \t\r\n=") == len) {
+        /* the usual case: look the tag up in the index */
+        std::map<std::string, LineList>::iterator it = tags.find(tag);
+        if (it != tags.end()) {
+            LineList::iterator l = std::lower_bound(it->second.begin(),
+                                                    it->second.end(), first);
+            if (_num > 0) {
+                l += std::min((size_t) (_num - 1),
+                              (size_t) (it->second.end() - l));
             }
-            if (line[newLinePos] == '\n') {
-                line[newLinePos] = 0;        /* make the newline 0 */
+            if (l != it->second.end() && *l < end) {
+                found = *l;
             }
-
-            if (NULL == (nonWhite = SkipWhite(line))) {
-                /* blank line-- skip */
+        }
+    } else {
+        /* odd tags are matched line by line */
+        for (size_t n = first; n < end; n++) {
+            nonWhite = lines[n].text.c_str();
+            if (strncmp(tag, nonWhite, len) != 0) {
                 continue;
             }
-
-            /* not a blank line, and nonwhite is first char */
-            if (strncmp(bracketSection, nonWhite, strlen(bracketSection)) != 0){
-                /* not on this line */
-                continue;
+            tagEnd = nonWhite[len];
+            if (tagEnd == ' ' || tagEnd == '\r' || tagEnd == '\t'
+                || tagEnd == '\n' || tagEnd == '=') {
+                if (--_num > 0) {
+                    continue;
+                }
+                found = n;
+                break;
             }
-
-            /* it matches-- fp is now set up for search on tag */
-            break;
         }
     }
 
-    while (!feof(fp)) {
-        /* check for end of file */
-        if (NULL == fgets(line, LINELEN + 1, (FILE *) fp)) {
-            /* got to end of file without finding it */
-            ThrowException(ERR_TAG_NOT_FOUND);
-            return(NULL);
-        }
-
-        if(check_line_endings(line)) {
-            ThrowException(ERR_CONVERSION);
-            return(NULL);
-        }
-
-        /* got a line */
-        lineNo++;
-
-        /* strip off newline */
-        newLinePos = strlen(line) - 1;        /* newline is on back from 0 */
-        if (newLinePos < 0) {
-            newLinePos = 0;
-        }
-        if (line[newLinePos] == '\n') {
-            line[newLinePos] = 0;        /* make the newline 0 */
-        }
-        // honor backslash (\) as line-end escape
-        if (line[newLinePos-1] == '\\') {
-           newLinePos = newLinePos-1;
-           line[newLinePos] = 0;
-           if (!extend_ct) {
-               elineptr = (char*)eline; //first time
-               strncpy(elineptr,line,newLinePos);
-               elinenext = elineptr + newLinePos;
-           } else {
-               strncpy(elinenext,line,newLinePos);
-               elinenext = elinenext + newLinePos;
-           }
-           *elinenext = 0;
-           extend_ct++;
-           if (extend_ct > MAX_EXTEND_LINES) {
-              fprintf(stderr,
-                 "INIFILE lineno=%d:Too many backslash line extends (limit=%d)\n",
-                 lineNo, MAX_EXTEND_LINES);
-              ThrowException(ERR_OVER_EXTENDED);
-              return(NULL);
-           }
-           continue; // get next line to extend
-        } else {
-            if (extend_ct) {
-               strncpy(elinenext,line,newLinePos);
-               elinenext = elinenext + newLinePos;
-               *elinenext = 0;
-            }
-        }
-        if (!extend_ct) {
-           elineptr = (char*)line;
-        }
-        extend_ct = 0;
-
-        /* skip leading whitespace */
-        if (NULL == (nonWhite = SkipWhite(elineptr))) {
-            /* blank line-- skip */
-            continue;
-        }
-
-        /* check for '[' char-- if so, it's a section tag, and we're out
-           of our section */
-        if (NULL != section && nonWhite[0] == '[') {
-            ThrowException(ERR_TAG_NOT_FOUND);
-            return(NULL);
-        }
-
-        len = strlen(tag);
-        if (strncmp(tag, nonWhite, len) != 0) {
-            /* not on this line */
-            continue;
-        }
-
-        /* it matches the first part of the string-- if whitespace or = is
-           next char then call it a match */
-        tagEnd = nonWhite[len];
-        if (tagEnd == ' ' || tagEnd == '\r' || tagEnd == '\t'
-            || tagEnd == '\n' || tagEnd == '=') {
-            /* it matches-- return string after =, or NULL */
-            if (--_num > 0) {
-                /* Not looking for this one, so skip it... */
-                continue;
-            }
-            nonWhite += len;
-            valueString = AfterEqual(nonWhite);
-            /* Eliminate white space at the end of a line also. */
-            if (NULL == valueString) {
-                ThrowException(ERR_TAG_NOT_FOUND);
-                return(NULL);
-            }
-            endValueString = valueString + strlen(valueString) - 1;
-            while (*endValueString == ' ' || *endValueString == '\t'
-                   || *endValueString == '\r') {
-                *endValueString = 0;
-                endValueString--;
-            }
-	    if (lineno)
-		*lineno = lineNo;
-            return(valueString);
-        }
-        /* else continue */
+    if (found == end) {
+        return(Fail(ERR_TAG_NOT_FOUND,
+                    end < lines.size() ? lines[end].lineNo : lastLineNo));
+    }
+    if (errLineNo != 0 && errLineNo <= lines[found].lineNo) {
+        return(Fail(ERR_NONE, lines[found].lineNo));
     }
 
-    ThrowException(ERR_TAG_NOT_FOUND);
-    return(NULL);
+    /* return string after =, or NULL */
+    snprintf(line, sizeof(line), "%s", lines[found].text.c_str() + len);
+    lineNo = lines[found].lineNo;
+    valueString = AfterEqual(line);
+    if (NULL == valueString) {
+        ThrowException(ERR_TAG_NOT_FOUND);
+        return(NULL);
+    }
+    /* Eliminate white space at the end of a line also. */
+    endValueString = valueString + strlen(valueString) - 1;
+    while (*endValueString == ' ' || *endValueString == '\t'
+           || *endValueString == '\r') {
+        *endValueString = 0;
+        endValueString--;
+    }
+    if (lineno)
+        *lineno = lineNo;
+    return(valueString);
 }
 
 const char *
@@ -23,6 +23,18 @@
 #endif
 
 #ifdef __cplusplus
+#include <map>
+#include <string>
+#include <vector>
+
+/* The file is read once, when it is opened, into an index of its
+   sections and tags; Find() looks values up in the index instead of
+   reading the file again.  The file stays open (and read locked) until
+   Close(), and changes made to it meanwhile are not seen; Close() and
+   Open() it again to pick them up.  The Python linuxcnc.ini object
+   keeps one IniFile for its lifetime and behaves the same way.  The C
+   iniFind() functions make a new IniFile from the FILE each call, so they
+   read the file again every time. */
 class IniFile {
 public:
     typedef enum {
@@ -117,6 +129,28 @@ private:
     void                        ThrowException(ErrorCode);
     char                        *AfterEqual(const char *string);
     char                        *SkipWhite(const char *string);
+
+    struct Line {
+        std::string             text;   // from the first non-white char,
+                                        // continuation lines joined
+        unsigned int            lineNo; // of its last physical line
+    };
+    typedef std::vector<size_t> LineList;
+
+    std::vector<Line>           lines;  // non-blank, non-comment lines
+    LineList                    headers;        // lines that start with '['
+    std::map<std::string, size_t> sections;     // "[NAME]" to its header
+    std::map<std::string, LineList> tags;       // first word to its lines
+    unsigned int                lastLineNo;
+    unsigned int                errLineNo;      // first bad line, or 0
+    ErrorCode                   errCode;        // what is bad about it
+
+    void                        Parse(void);
+    void                        AddLine(const char *nonWhite,
+                                        unsigned int lineNo);
+    bool                        FindSection(const char *section,
+                                            size_t *first, size_t *end);
+    const char                  *Fail(ErrorCode, unsigned int reached);
 };
 #endif
 
@@ -0,0 +1,185 @@
+/********************************************************************
+* Description: stat_delta.cc
+*   Change tracking for status messages, see stat_delta.hh.
+*
+* Author:
+* License: LGPL Version 2
+* System: Linux
+*
+* Copyright (c) 2016 All rights reserved.
+*
+* Last change:
+********************************************************************/
+
+#include "stat_delta.hh"
+#include "cms.hh"
+#include "rcs_print.hh"
+
+#include <stdlib.h>		// malloc(), free()
+#include <string.h>		// memcmp(), memcpy(), memset()
+
+RCS_STAT_DELTA_MSG::RCS_STAT_DELTA_MSG(NMLTYPE t, size_t sz):NMLmsg(t, sz)
+{
+    stat_type = 0;
+    stat_size = 0;
+    base = 0;
+    serial = 0;
+    sections = 0;
+    memset(section_offset, 0, sizeof(section_offset));
+    memset(section_serial, 0, sizeof(section_serial));
+    data_size = 0;
+}
+
+void RCS_STAT_DELTA_MSG::update(CMS * cms, char *data, long data_max)
+{
+    cms->update(stat_type);
+    cms->update(stat_size);
+    cms->update(base);
+    cms->update(serial);
+    cms->update(sections);
+    cms->update(section_offset, RCS_STAT_DELTA_MAX_SECTIONS);
+    cms->update(section_serial, RCS_STAT_DELTA_MAX_SECTIONS);
+    cms->update(data_size);
+    if (data_size < 0 || data_size > data_max) {
+	data_size = 0;
+    }
+    cms->update(data, data_size);
+}
+
+int RCS_STAT_DELTA_MSG::apply(const char *data, NMLmsg * stat,
+    long *stat_serial) const
+{
+    long used = 0;
+
+    if (*stat_serial <= 0 || *stat_serial < base ||
+	stat->type != stat_type || stat->size != stat_size ||
+	sections < 1 || sections > RCS_STAT_DELTA_MAX_SECTIONS) {
+	return -1;
+    }
+    if (*stat_serial > serial) {
+	/* The reader has a newer status than this delta, or the writer
+	   started over. Either way the sections can't be trusted. */
+	return -1;
+    }
+    if (*stat_serial == serial) {
+	return 0;
+    }
+
+    int copied = 0;
+    for (int i = 0; i < sections; i++) {
+	if (section_serial[i] <= base) {
+	    continue;
+	}
+	long end = (i + 1 < sections) ? section_offset[i + 1] : stat_size;
+	long size = end - section_offset[i];
+	if (section_offset[i] < 0 || size < 0 || end > stat_size ||
+	    used + size > data_size) {
+	    rcs_print_error("RCS_STAT_DELTA_MSG: bad section %d\n", i);
+	    return -1;
+	}
+	if (section_serial[i] > *stat_serial) {
+	    memcpy((char *) stat + section_offset[i], data + used, size);
+	    copied++;
+	}
+	used += size;
+    }
+    *stat_serial = serial;
+    return copied;
+}
+
+RCS_STAT_DELTA::RCS_STAT_DELTA(const long *offsets, int _sections,
+    long _stat_size, long _data_max, long _rebase_size)
+{
+    if (_sections > RCS_STAT_DELTA_MAX_SECTIONS) {
+	rcs_print_error("RCS_STAT_DELTA: %d sections, only %d allowed\n",
+	    _sections, RCS_STAT_DELTA_MAX_SECTIONS);
+	_sections = RCS_STAT_DELTA_MAX_SECTIONS;
+    }
+    sections = _sections;
+    memcpy(offset, offsets, sections * sizeof(long));
+    memset(changed, 0, sizeof(changed));
+    stat_size = _stat_size;
+    data_max = _data_max;
+    rebase_size = _rebase_size;
+    if (rebase_size < 0) {
+	rebase_size = stat_size / 4;
+    }
+    base = 0;
+    last_serial = 0;
+    last = (char *) malloc(stat_size);
+}
+
+RCS_STAT_DELTA::~RCS_STAT_DELTA()
+{
+    free(last);
+}
+
+long RCS_STAT_DELTA::section_size(int i)
+{
+    return ((i + 1 < sections) ? offset[i + 1] : stat_size) - offset[i];
+}
+
+int RCS_STAT_DELTA::encode(const NMLmsg * stat, long serial,
+    RCS_STAT_DELTA_MSG * msg, char *data)
+{
+    const char *p = (const char *) stat;
+    long pending = 0;
+    int i;
+
+    if (NULL == last || stat->size != stat_size) {
+	return -1;
+    }
+
+    if (0 == base) {
+	/* Nothing to compare with, readers start from the full status. */
+	memcpy(last, p, stat_size);
+	for (i = 0; i < sections; i++) {
+	    changed[i] = serial;
+	}
+	base = serial;
+    } else {
+	for (i = 0; i < sections; i++) {
+	    long size = section_size(i);
+	    if (memcmp(p + offset[i], last + offset[i], size)) {
+		memcpy(last + offset[i], p + offset[i], size);
+		changed[i] = serial;
+	    }
+	    if (changed[i] > base) {
+		pending += size;
+	    }
+	}
+	if (pending > rebase_size || pending > data_max) {
+	    pending = 0;
+	    base = last_serial;
+	    for (i = 0; i < sections; i++) {
+		if (changed[i] > base) {
+		    pending += section_size(i);
+		}
+	    }
+	    if (pending > data_max) {
+		base = serial;
+	    }
+	}
+    }
+
+    msg->stat_type = stat->type;
+    msg->stat_size = stat_size;
+    msg->base = base;
+    msg->serial = serial;
+    msg->sections = sections;
+    msg->data_size = 0;
+    for (i = 0; i < sections; i++) {
+	msg->section_offset[i] = offset[i];
+	if (changed[i] > base) {
+	    long size = section_size(i);
+	    msg->section_serial[i] = changed[i];
+	    memcpy(data + msg->data_size, last + offset[i], size);
+	    msg->data_size += size;
+	} else {
+	    msg->section_serial[i] = 0;
+	}
+    }
+    msg->size = (data - (char *) msg) + msg->data_size;
+    last_serial = serial;
+    return 0;
+}
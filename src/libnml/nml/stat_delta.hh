@@ -0,0 +1,83 @@
+/********************************************************************
+* Description: stat_delta.hh
+*   Change tracking for status messages, so that readers can copy
+*   only the parts of a status message that changed since the last
+*   time they looked.
+*
+* Author:
+* License: LGPL Version 2
+* System: Linux
+*
+* Copyright (c) 2016 All rights reserved.
+*
+* Last change:
+********************************************************************/
+#ifndef RCS_STAT_DELTA_HH
+#define RCS_STAT_DELTA_HH
+
+#include "nml.hh"
+#include "nmlmsg.hh"
+
+#define RCS_STAT_DELTA_MAX_SECTIONS 32
+
+/*
+  A status message is split in to sections, each a range of bytes
+  starting at section_offset[i] and ending where the next one starts.
+  The delta carries every section that changed after base, packed in
+  section order in the data that follows this header in the derived
+  class. Serial numbers are the CMS write ids of the status message,
+  so a reader that got the full message knows where it stands.
+  */
+class RCS_STAT_DELTA_MSG:public NMLmsg {
+  public:
+    RCS_STAT_DELTA_MSG(NMLTYPE t, size_t sz);
+    void update(CMS *, char *data, long data_max);
+
+    /* Copy the sections newer than *stat_serial from data in to stat.
+       Returns the number of sections copied, or -1 if stat is older
+       than base or newer than serial and has to be read in full. */
+    int apply(const char *data, NMLmsg * stat, long *stat_serial) const;
+
+    NMLTYPE stat_type;		/* type of the status message */
+    long stat_size;		/* size of the status message */
+    long base;			/* applies to copies at least this new */
+    long serial;		/* write id of the newest status */
+    int sections;
+    long section_offset[RCS_STAT_DELTA_MAX_SECTIONS];
+    long section_serial[RCS_STAT_DELTA_MAX_SECTIONS];	/* 0 if not sent */
+    long data_size;		/* bytes of section data that follow */
+};
+
+/*
+  Writer side. Keeps a copy of the last status written and the write id
+  at which each section last changed. When the sections that changed
+  since base add up to more than rebase_size, base moves up to the
+  previous write, so the delta stays small at the cost of readers that
+  are further behind reading the full status once.
+  */
+class RCS_STAT_DELTA {
+  public:
+    RCS_STAT_DELTA(const long *offsets, int sections, long stat_size,
+	long data_max, long rebase_size = -1);
+    ~RCS_STAT_DELTA();
+
+    /* Fill in msg and data for stat, which was just written with the
+       given write id. */
+    int encode(const NMLmsg * stat, long serial, RCS_STAT_DELTA_MSG * msg,
+	char *data);
+
+  private:
+    long section_size(int i);
+
+    char *last;			/* copy of the last status */
+    long stat_size;
+    int sections;
+    long offset[RCS_STAT_DELTA_MAX_SECTIONS];
+    long changed[RCS_STAT_DELTA_MAX_SECTIONS];	/* write id of last change */
+    long base;
+    long last_serial;		/* write id of the last status encoded */
+    long data_max;
+    long rebase_size;
+};
+
+#endif
@@ -808,6 +808,28 @@ int rtapi_task_start(int task_id, unsigned long int period_nsec)
     return retval;
 }
 
+int rtapi_task_parallel(void (*fn) (void *, int), void *arg, int count)
+{
+    int n;
+
+    /* no helper threads in kernel space, run the calls in order */
+    for (n = 0; n < count; n++) {
+	fn(arg, n);
+    }
+    return 0;
+}
+
+long long int rtapi_task_deadline(void)
+{
+    RTIME start;
+
+    /* the start of this period, in timer counts */
+    start = next_period() - rt_whoami()->period;
+    /* rtapi_get_time() uses the CPU clock, not the timer, so go by
+       how long ago that was */
+    return rtapi_get_time() - count2nano(rt_get_time() - start);
+}
+
 void rtapi_wait(void)
 {
     int result = rt_task_wait_period();
@@ -1705,6 +1727,8 @@ EXPORT_SYMBOL(rtapi_task_new);
 EXPORT_SYMBOL(rtapi_task_delete);
 EXPORT_SYMBOL(rtapi_task_start);
 EXPORT_SYMBOL(rtapi_wait);
+EXPORT_SYMBOL(rtapi_task_parallel);
+EXPORT_SYMBOL(rtapi_task_deadline);
 EXPORT_SYMBOL(rtapi_task_resume);
 EXPORT_SYMBOL(rtapi_task_pause);
 EXPORT_SYMBOL(rtapi_task_self);
@@ -445,6 +445,16 @@ RTAPI_BEGIN_DECLS
 */
     extern void rtapi_wait(void);
 
+/** 'rtapi_task_deadline()' returns the time, in the same units and
+    from the same clock as rtapi_get_time(), at which the current
+    period of the calling task was scheduled to begin - the time that
+    the last call to rtapi_wait() waited for.  After an overrun this
+    may be well before the call to rtapi_wait() returned.  Call only
+    from within a periodic realtime task, after rtapi_wait() has
+    returned at least once.
+*/
+    extern long long int rtapi_task_deadline(void);
+
 /** 'rtapi_task_resume() starts a task in free-running mode. 'task_id'
     is a task ID from a call to rtapi_task_new().  The task must be in
     the "paused" state, or it will return -EINVAL.
@@ -473,6 +483,21 @@ RTAPI_BEGIN_DECLS
 */
     extern int rtapi_task_self(void);
 
+/** 'rtapi_task_parallel()' calls 'fn(arg, n)' for each 'n' from 0
+    to 'count' - 1, and returns when all of those calls have returned.
+    Call 0 runs in the calling task; the others may run at the same
+    time on helper threads on other CPUs, at the priority of the
+    calling task.  The helper threads belong to the calling task and
+    are started along with it, one for each spare CPU, so this makes
+    no system calls other than to wake them and wait for them.  RTAPIs
+    that cannot use other CPUs, or hosts that don't have any to spare,
+    simply make the calls one after another.  Returns the number of
+    calls that ran on helper threads.  Call only from within a realtime
+    task.
+*/
+    extern int rtapi_task_parallel(void (*fn) (void *arg, int n),
+	void *arg, int count);
+
 #endif /* RTAPI */
 
 /***********************************************************************
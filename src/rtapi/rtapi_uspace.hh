@@ -47,7 +47,9 @@ struct RtapiApp
     virtual int task_pause(int task_id) = 0;
     virtual int task_resume(int task_id) = 0;
     virtual int task_self() = 0;
+    virtual int task_parallel(void (*fn)(void *, int), void *arg, int count) = 0;
     virtual void wait() = 0;
+    virtual long long task_deadline() = 0;
     virtual unsigned char do_inb(unsigned int port) = 0;
     virtual void do_outb(unsigned char value, unsigned int port) = 0;
     virtual int run_threads(int fd, int (*callback)(int fd)) = 0;
@@ -59,6 +61,8 @@ struct RtapiApp
 #define TASK_MAGIC    21979	/* random numbers used as signatures */
 #define TASK_MAGIC_INIT   ~21979
 
+struct rtapi_helpers;
+
 struct rtapi_task {
   int magic;			/* to check for valid handle */
   int owner;
@@ -73,6 +77,7 @@ struct rtapi_task {
   unsigned ratio;
   void *arg;
   void (*taskcode) (void*);	/* pointer to task function */
+  struct rtapi_helpers *helpers; /* threads for rtapi_task_parallel */
 };
 
 extern struct rtapi_task task_array[MAX_TASKS];
@@ -40,6 +40,7 @@
 #include <sys/mman.h>
 #include <malloc.h>
 #include <sys/prctl.h>
+#include <semaphore.h>
 
 #include "config.h"
 
@@ -520,7 +521,9 @@ struct Posix : RtapiApp
     int task_pause(int task_id);
     int task_resume(int task_id);
     int task_self();
+    int task_parallel(void (*fn)(void *, int), void *arg, int count);
     void wait();
+    long long task_deadline();
     unsigned char do_inb(unsigned int port);
     void do_outb(unsigned char value, unsigned int port);
     int run_threads(int fd, int (*callback)(int fd));
@@ -765,6 +768,9 @@ rtapi_task *RtapiApp::get_task(int task_id) {
     return task;
 }
 
+static void start_helpers(struct rtapi_task *task, int policy, int nprocs);
+static void stop_helpers(struct rtapi_task *task);
+
 int Posix::task_delete(int id)
 {
   struct rtapi_task *task = get_task(id);
@@ -772,6 +778,7 @@ int Posix::task_delete(int id)
 
   pthread_cancel(task->thr);
   pthread_join(task->thr, 0);
+  stop_helpers(task);
   task->magic = 0;
   return 0;
 }
@@ -808,8 +815,13 @@ int Posix::task_start(int task_id, unsigned long int period_nsec)
   if(nprocs > 1)
       if(pthread_attr_setaffinity_np(&attr, sizeof(cpuset), &cpuset) < 0)
           return -errno;
-  if(pthread_create(&task->thr, &attr, &wrapper, reinterpret_cast<void*>(task)) < 0)
+  // the realtime task must not make system calls to start helpers
+  // later, so start all the ones it could use now
+  start_helpers(task, policy, nprocs);
+  if(pthread_create(&task->thr, &attr, &wrapper, reinterpret_cast<void*>(task)) < 0) {
+      stop_helpers(task);
       return -errno;
+  }
 
   return 0;
 }
@@ -886,6 +898,135 @@ int Posix::task_self() {
     return task - task_array;
 }
 
+/* Helper threads for task_parallel.  Each task gets its own set, so
+   that a faster thread that preempts a slower one in the middle of a
+   parallel section can't find the helpers busy.  They are all started
+   by task_start, one per spare CPU, so that task_parallel never has to
+   make a system call; if fewer start, the task makes do with those.
+   Helper 'i' is pinned to the i'th CPU below the one the realtime
+   tasks run on, and makes the calls i+1, i+1+stride, ... of each job;
+   the task itself makes calls 0, stride, ... */
+#define MAX_HELPERS 16
+
+struct rtapi_helper {
+    pthread_t thr;
+    sem_t go;
+    int index;
+    struct rtapi_helpers *pool;
+};
+
+struct rtapi_helpers {
+    int count;
+    struct rtapi_helper helper[MAX_HELPERS];
+    sem_t done;
+    void (*fn)(void *, int);
+    void *arg;
+    int calls;
+    int stride;
+};
+
+static void sem_wait_nointr(sem_t *sem) {
+    while(sem_wait(sem) < 0 && errno == EINTR) { /* nothing */ }
+}
+
+static void *helper_main(void *arg) {
+    struct rtapi_helper *h = reinterpret_cast<rtapi_helper*>(arg);
+    struct rtapi_helpers *pool = h->pool;
+    while(1) {
+        sem_wait_nointr(&h->go);
+        for(int n = h->index + 1; n < pool->calls; n += pool->stride)
+            pool->fn(pool->arg, n);
+        sem_post(&pool->done);
+    }
+    return NULL;
+}
+
+static int start_helper(struct rtapi_task *task, int policy, int nprocs) {
+    struct rtapi_helpers *pool = task->helpers;
+    int i = pool->count;
+    // the realtime tasks run on the last CPU, so that one isn't spare
+    if(i >= MAX_HELPERS || i >= nprocs - 1) return -ENOSPC;
+
+    struct rtapi_helper *h = &pool->helper[i];
+    h->index = i;
+    h->pool = pool;
+    if(sem_init(&h->go, 0, 0) < 0) return -errno;
+
+    struct sched_param param;
+    memset(&param, 0, sizeof(param));
+    param.sched_priority = task->prio;
+
+    cpu_set_t cpuset;
+    CPU_ZERO(&cpuset);
+    CPU_SET(nprocs-2-i, &cpuset); // assumes processor numbers are contiguous
+
+    pthread_attr_t attr;
+    if(pthread_attr_init(&attr) < 0
+            || pthread_attr_setstacksize(&attr, task->stacksize) < 0
+            || pthread_attr_setschedpolicy(&attr, policy) < 0
+            || pthread_attr_setschedparam(&attr, &param) < 0
+            || pthread_attr_setinheritsched(&attr, PTHREAD_EXPLICIT_SCHED) < 0
+            || pthread_attr_setaffinity_np(&attr, sizeof(cpuset), &cpuset) < 0
+            || pthread_create(&h->thr, &attr, &helper_main, reinterpret_cast<void*>(h)) != 0) {
+        sem_destroy(&h->go);
+        return -EINVAL;
+    }
+    pool->count++;
+    return 0;
+}
+
+static void start_helpers(struct rtapi_task *task, int policy, int nprocs) {
+    if(task->helpers || nprocs < 2) return;
+    struct rtapi_helpers *pool = new rtapi_helpers;
+    memset(pool, 0, sizeof(*pool));
+    if(sem_init(&pool->done, 0, 0) < 0) {
+        delete pool;
+        return;
+    }
+    task->helpers = pool;
+    while(start_helper(task, policy, nprocs) == 0) { /* nothing */ }
+    if(pool->count == 0) {
+        sem_destroy(&pool->done);
+        delete pool;
+        task->helpers = 0;
+        return;
+    }
+    rtapi_print_msg(RTAPI_MSG_INFO, "task %d: started %d helper threads\n",
+            (int)(task - task_array), pool->count);
+}
+
+static void stop_helpers(struct rtapi_task *task) {
+    struct rtapi_helpers *pool = task->helpers;
+    if(!pool) return;
+    for(int i=0; i<pool->count; i++) {
+        pthread_cancel(pool->helper[i].thr);
+        pthread_join(pool->helper[i].thr, 0);
+        sem_destroy(&pool->helper[i].go);
+    }
+    sem_destroy(&pool->done);
+    delete pool;
+    task->helpers = 0;
+}
+
+int Posix::task_parallel(void (*fn)(void *, int), void *arg, int count) {
+    struct rtapi_task *task = reinterpret_cast<rtapi_task*>(pthread_getspecific(key));
+    struct rtapi_helpers *pool = task ? task->helpers : 0;
+    int used = pool ? std::min(pool->count, count - 1) : 0;
+    if(used <= 0) {
+        for(int n=0; n<count; n++) fn(arg, n);
+        return 0;
+    }
+
+    pool->fn = fn;
+    pool->arg = arg;
+    pool->calls = count;
+    pool->stride = used + 1;
+    for(int i=0; i<used; i++) sem_post(&pool->helper[i].go);
+    for(int n=0; n<count; n+=pool->stride) fn(arg, n);
+    for(int i=0; i<used; i++) sem_wait_nointr(&pool->done);
+    return count - (count + used) / (used + 1);
+}
+
 static bool ts_less(const struct timespec &ta, const struct timespec &tb) {
     if(ta.tv_sec < tb.tv_sec) return 1;
     if(ta.tv_sec > tb.tv_sec) return 0;
@@ -921,6 +1062,12 @@ void Posix::wait() {
         pthread_mutex_lock(&thread_lock);
 }
 
+long long Posix::task_deadline() {
+    struct rtapi_task *task = reinterpret_cast<rtapi_task*>(pthread_getspecific(key));
+    // wait() slept until (or found it had already missed) 'nextstart'
+    return task->nextstart.tv_sec * 1000000000LL + task->nextstart.tv_nsec;
+}
+
 unsigned char Posix::do_inb(unsigned int port)
 {
     return inb(port);
@@ -997,11 +1144,21 @@ int rtapi_task_self()
     return App().task_self();
 }
 
+int rtapi_task_parallel(void (*fn)(void *, int), void *arg, int count)
+{
+    return App().task_parallel(fn, arg, count);
+}
+
 void rtapi_wait(void)
 {
     App().wait();
 }
 
+long long int rtapi_task_deadline(void)
+{
+    return App().task_deadline();
+}
+
 void rtapi_outb(unsigned char byte, unsigned int port)
 {
     App().do_outb(byte, port);
@@ -0,0 +1,4 @@
+#!/bin/sh
+set -e
+halcompile --install batch_sum.comp
+halrun dotest.hal
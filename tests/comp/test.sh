@@ -25,3 +25,27 @@ if [ -f names_dont_match.c ]; then
     exit 1
 fi
 
+
+# option batch must produce a component
+rm -f batch.c
+halcompile batch.comp
+if [ $? -ne 0 ]; then
+    echo 'halcompile failed to process batch.comp'
+    exit 1
+fi
+if [ ! -f batch.c ]; then
+    echo 'halcompile failed to produce batch.c'
+    exit 1
+fi
+
+# but not together with option userspace
+rm -f batch_userspace.c
+halcompile batch_userspace.comp
+if [ $? -eq 0 ]; then
+    echo 'halcompile erroneously accepted batch_userspace.comp'
+    exit 1
+fi
+if [ -f batch_userspace.c ]; then
+    echo 'halcompile erroneously produced batch_userspace.c'
+    exit 1
+fi
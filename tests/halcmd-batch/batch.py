@@ -0,0 +1,84 @@
+#!/usr/bin/python
+
+import subprocess
+import hal
+
+def cmd(arg):
+    subprocess.call(arg, shell=True)
+
+def gets(sig):
+    return subprocess.Popen(["halcmd", "-s", "gets", sig],
+        stdout=subprocess.PIPE).communicate()[0].strip()
+
+def has_sig(sig):
+    return subprocess.call(["halcmd", "gets", sig],
+        stdout=subprocess.PIPE, stderr=subprocess.PIPE) == 0
+
+def batch(lines):
+    p = subprocess.Popen(["halcmd", "-b", "-f"], stdin=subprocess.PIPE,
+        stderr=subprocess.PIPE)
+    err = p.communicate("".join(l + "\n" for l in lines))[1]
+    return p.returncode, err
+
+h = hal.component("batchtest")
+h.newpin("out", hal.HAL_FLOAT, hal.HAL_OUT)
+h.newpin("out2", hal.HAL_FLOAT, hal.HAL_OUT)
+h.newpin("in", hal.HAL_FLOAT, hal.HAL_IN)
+h.newpin("in2", hal.HAL_FLOAT, hal.HAL_IN)
+h.ready()
+h['out'] = 1
+h['in'] = 2
+
+# a conflict between two commands of the same batch is caught by the
+# preflight check, reported against the second one, and nothing is applied
+status, err = batch(["net one batchtest.out batchtest.in",
+                     "net two batchtest.out2 batchtest.in"])
+assert status != 0
+assert ":2:" in err and "already queued" in err, err
+assert not has_sig("one")
+assert not has_sig("two")
+
+status, err = batch(["net one batchtest.out batchtest.in",
+                     "net one batchtest.out2"])
+assert status != 0
+assert ":2:" in err and "pin 'batchtest.out'" in err, err
+assert not has_sig("one")
+
+# existing signals that the batch links to
+cmd("halcmd newsig held float")
+cmd("halcmd sets held 42")
+cmd("halcmd newsig gone float")
+
+# queue a link that overwrites the value of 'held' and one to 'gone',
+# then delete 'gone' behind the batch's back so that the commit fails
+p = subprocess.Popen(["halcmd", "-b", "-e", "-f"], stdin=subprocess.PIPE,
+    stderr=subprocess.PIPE)
+p.stdin.write("net held batchtest.out\n")
+p.stdin.write("net gone batchtest.in2\n")
+p.stdin.write("# queued\n")
+p.stdin.flush()
+# the echo of a line is printed after the lines before it have been queued
+echoes = 0
+while echoes < 3:
+    line = p.stderr.readline()
+    assert line, "halcmd exited early"
+    if "<echo>" in line:
+        echoes += 1
+cmd("halcmd delsig gone")
+p.stdin.close()
+err = p.stderr.read()
+assert p.wait() != 0
+assert ":2:" in err, err
+
+# the rollback unlinked the pin and restored both values
+assert float(gets("held")) == 42, gets("held")
+assert h['out'] == 1
+cmd("halcmd setp batchtest.out 3")
+assert float(gets("held")) == 42
+
+# a batch that succeeds
+status, err = batch(["newsig three float",
+                     "net three batchtest.out2 batchtest.in2"])
+assert status == 0, err
+h['out2'] = 5
+assert h['in2'] == 5
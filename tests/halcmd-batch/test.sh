@@ -0,0 +1,9 @@
+#!/bin/bash
+
+realtime start
+python batch.py
+STATUS=$?
+
+realtime stop
+
+exit $STATUS
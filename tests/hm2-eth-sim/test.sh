@@ -0,0 +1,12 @@
+#!/bin/bash
+# Run the simulator on a free port; it prints the port once it is ready
+coproc SIM { exec hm2_eth_sim -a 127.0.0.1 -p 0 -b 7I92 -e 2 -s 2 -w 2 -S 1 2>sim-log; }
+trap "kill $SIM_PID" EXIT
+if ! read -t 10 -r READY <&${SIM[0]}; then
+    echo "hm2_eth_sim did not start" >&2
+    cat sim-log >&2
+    exit 1
+fi
+export SIM_PORT=${READY##*:}
+
+halrun -f test.hal
@@ -0,0 +1,82 @@
+# Compare linuxcnc.ini lookups, which go through IniFile's index, with a
+# linear scan of the file that follows the rules IniFile::Find had when it
+# read the file line by line.
+import sys
+import linuxcnc
+
+def skip_white(s):
+    s = s.lstrip(" \t\r\n")
+    if not s or s[0] in "#;": return None
+    return s
+
+def after_equal(s):
+    i = s.find("=")
+    if i < 0: return None
+    s = s[i+1:].lstrip(" \t\r\n")
+    return s or None
+
+def scan(lines, section, tag, num):
+    i = 0
+    if section is not None:
+        header = "[%s]" % section
+        while i < len(lines):
+            line = skip_white(lines[i])
+            i += 1
+            if line is not None and line.startswith(header): break
+        else:
+            return None
+    extended = ""
+    while i < len(lines):
+        line = lines[i]
+        i += 1
+        if line.endswith("\\"):
+            extended += line[:-1]
+            continue
+        line = skip_white(extended + line)
+        extended = ""
+        if line is None: continue
+        if section is not None and line.startswith("["): return None
+        if not line.startswith(tag) or line[len(tag):len(tag)+1] not in (
+                " ", "\r", "\t", "="):
+            continue
+        num -= 1
+        if num > 0: continue
+        value = after_equal(line[len(tag):])
+        if value is None: return None
+        return value.rstrip(" \t\r")
+    return None
+
+filename = sys.argv[1]
+lines = open(filename).read().split("\n")
+inifile = linuxcnc.ini(filename)
+
+sections = ["MISSING", "AXIS", "AXIS_0]"]
+tags = ["MISSING", "TA", "TAG ", "TAG=nospace", "[AXIS_0]"]
+for line in lines:
+    line = skip_white(line)
+    if line is None: continue
+    if line.startswith("["):
+        sections.append(line[1:line.index("]")])
+    else:
+        tags.append(line.replace("=", " ").split()[0])
+
+count = 0
+for section in sections:
+    for tag in tags:
+        for num in range(1, 5):
+            expected = scan(lines, section, tag, num)
+            found = inifile.find(section, tag, num)
+            if found != expected:
+                print "[%s]%s #%d: found %r, expected %r" % (
+                    section, tag, num, found, expected)
+            count += 1
+        expected = []
+        while True:
+            value = scan(lines, section, tag, len(expected) + 1)
+            if value is None: break
+            expected.append(value)
+        found = inifile.findall(section, tag)
+        if found != expected:
+            print "[%s]%s all: found %r, expected %r" % (
+                section, tag, found, expected)
+print "%d lookups" % count
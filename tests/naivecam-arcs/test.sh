@@ -0,0 +1,47 @@
+#!/bin/bash
+
+rm -f result.halsamples
+
+linuxcnc -r test.ini &
+
+# let linuxcnc come up
+TOGO=80
+while [  $TOGO -gt 0 ]; do
+    echo trying to connect to linuxcncrsh TOGO=$TOGO
+    if nc -z localhost 5007; then
+        break
+    fi
+    sleep 0.25
+    TOGO=$(($TOGO - 1))
+done
+if [  $TOGO -eq 0 ]; then
+    echo connection to linuxcncrsh timed out
+    exit 1
+fi
+
+
+(
+    echo hello EMC mt 1.0
+    echo set enable EMCTOO
+    echo set set_wait done
+
+    echo set mode manual
+    echo set estop off
+    echo set machine on
+
+    echo set mode auto
+    echo set open $(pwd)/test.ngc
+
+    # the program takes about 4 seconds, record 8
+    halsampler -t -n 8000 > result.halsamples &
+    echo set run
+    wait
+
+    echo shutdown
+) | nc localhost 5007
+
+
+# wait for linuxcnc to finish
+wait
+
+exit 0
@@ -0,0 +1,94 @@
+// Round trip through RCS_STAT_DELTA: encode a series of status messages
+// and check that readers at different serials either end up with the same
+// bytes as the writer or are told to read the full status.
+#include "stat_delta.hh"
+#include <string.h>
+#include <stdio.h>
+
+struct TEST_STAT:public NMLmsg {
+    TEST_STAT():NMLmsg(1001, sizeof(TEST_STAT)) {};
+    int a[4];
+    double b[8];
+    char c[256];
+};
+
+struct TEST_STAT_DELTA:public RCS_STAT_DELTA_MSG {
+    TEST_STAT_DELTA():RCS_STAT_DELTA_MSG(1002, sizeof(TEST_STAT_DELTA)) {};
+    int apply(TEST_STAT * stat, long *serial) const {
+	return RCS_STAT_DELTA_MSG::apply(data, stat, serial);
+    };
+    char data[sizeof(TEST_STAT)];
+};
+
+static TEST_STAT stat;
+static TEST_STAT_DELTA delta;
+static long serial;
+
+static void write(RCS_STAT_DELTA & tracker)
+{
+    serial++;
+    tracker.encode(&stat, serial, &delta, delta.data);
+    printf("write %ld: base %ld, %ld bytes\n", serial, delta.base,
+	delta.data_size);
+}
+
+static void read(const char *name, TEST_STAT & copy, long &copy_serial)
+{
+    int copied = delta.apply(&copy, &copy_serial);
+    if (copied < 0) {
+	printf("  %s: full read\n", name);
+	copy = stat;
+	copy_serial = serial;
+	return;
+    }
+    printf("  %s: %d sections, %s\n", name, copied,
+	memcmp(&copy, &stat, sizeof(stat)) ? "DIFFERENT" : "same");
+}
+
+int main()
+{
+    const char *base = (const char *) &stat;
+    long offset[] = { 0, (const char *) stat.a - base,
+	(const char *) stat.b - base, (const char *) stat.c - base
+    };
+    RCS_STAT_DELTA tracker(offset, 4, sizeof(stat), sizeof(delta.data));
+    TEST_STAT fast, slow, ahead;
+    long fast_serial = 0, slow_serial = 0, ahead_serial = 0;
+
+    write(tracker);
+    read("fast", fast, fast_serial);
+    read("slow", slow, slow_serial);
+
+    stat.b[2] = 1.5;
+    write(tracker);
+    read("fast", fast, fast_serial);
+
+    stat.a[0] = 7;
+    stat.b[7] = -2.0;
+    write(tracker);
+    read("fast", fast, fast_serial);
+    // missed the last write, but still newer than base
+    read("slow", slow, slow_serial);
+
+    write(tracker);
+    read("fast", fast, fast_serial);
+
+    // a reader with a newer status than the delta resyncs
+    ahead = stat;
+    ahead_serial = serial + 1;
+    read("ahead", ahead, ahead_serial);
+
+    // more than a quarter of the status changes, so base moves up and
+    // the slow reader falls behind it
+    strcpy(stat.c, "a long string that fills up most of the text section");
+    memset(stat.c + 64, 'x', 128);
+    write(tracker);
+    read("fast", fast, fast_serial);
+    read("slow", slow, slow_serial);
+
+    stat.a[3] = 3;
+    write(tracker);
+    read("fast", fast, fast_serial);
+    read("slow", slow, slow_serial);
+    return 0;
+}
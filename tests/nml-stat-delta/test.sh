@@ -0,0 +1,6 @@
+#!/bin/sh
+set -e
+g++ -I $EMC2_HOME/include stat-delta.cc -L $EMC2_HOME/lib -lnml \
+    -Wl,-rpath,$EMC2_HOME/lib -o stat-delta
+./stat-delta
+rm -f stat-delta
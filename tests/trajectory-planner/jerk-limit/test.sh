@@ -0,0 +1,6 @@
+#!/bin/bash
+# A jerk-limited profile must stay within the jerk limit across junctions,
+# not only inside each segment. The slack covers the last cycle of the
+# final stop, where the landing is rounded to the end point.
+rs274 -g test.ngc | tpsim -j 20000 -t 3
+exit ${PIPESTATUS[1]}
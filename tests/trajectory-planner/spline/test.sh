@@ -0,0 +1,6 @@
+#!/bin/bash
+# Acceleration is found from the change in position over each cycle, so
+# uneven steps along a spline show up as acceleration spikes, and so does
+# too much speed through a bend whose smallest radius was missed.
+rs274 -g test.ngc | tpsim
+exit ${PIPESTATUS[1]}